@@ -0,0 +1,239 @@
+// Background file writer fed with pooled blocks
+
+#include "AsyncWriter.h"
+#include "ThreadPolicy.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+bool WriteFully(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+} // namespace
+
+AsyncWriter::AsyncWriter(size_t blockSize, size_t blockCount)
+    : blockSize_(blockSize), head_(0), count_(0), busy_(false), fd_(-1), bytesWritten_(0), writeErrors_(0) {
+    storage_.reset(new uint8_t[blockSize * blockCount]);
+    blocks_.resize(blockCount);
+    freeBlocks_.reserve(blockCount);
+    for (size_t i = 0; i < blockCount; i++) {
+        blocks_[i].data = storage_.get() + i * blockSize;
+        blocks_[i].size = 0;
+        freeBlocks_.push_back(&blocks_[i]);
+    }
+    // every block can be queued at once, plus headroom for open/close operations
+    queue_.resize(blockCount + 64);
+
+    Metrics::Instance().AddCollector(&AsyncWriter::CollectMetrics, this);
+    thread_ = std::thread(&AsyncWriter::Run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+    Op stop;
+    stop.type = OP_STOP;
+    stop.block = nullptr;
+    Enqueue(stop);
+    thread_.join();
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    Metrics::Instance().RemoveCollector(this);
+}
+
+size_t AsyncWriter::FreeBlocks() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return freeBlocks_.size();
+}
+
+AsyncWriter::Block *AsyncWriter::AcquireBlock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (freeBlocks_.empty()) {
+        return nullptr;
+    }
+    Block *block = freeBlocks_.back();
+    freeBlocks_.pop_back();
+    block->size = 0;
+    return block;
+}
+
+void AsyncWriter::ReleaseBlock(Block *block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    freeBlocks_.push_back(block);
+}
+
+void AsyncWriter::Open(const std::string &path) {
+    Op op;
+    op.type = OP_OPEN;
+    op.block = nullptr;
+    op.path = path;
+    Enqueue(op);
+}
+
+void AsyncWriter::Append(Block *block) {
+    Op op;
+    op.type = OP_APPEND;
+    op.block = block;
+    Enqueue(op);
+}
+
+void AsyncWriter::WriteAt(uint64_t offset, const std::string &bytes) {
+    Op op;
+    op.type = OP_WRITE_AT;
+    op.block = nullptr;
+    op.offset = offset;
+    op.bytes = bytes;
+    Enqueue(op);
+}
+
+void AsyncWriter::Close() {
+    Op op;
+    op.type = OP_CLOSE;
+    op.block = nullptr;
+    Enqueue(op);
+}
+
+void AsyncWriter::Replace(const std::string &path, const std::string &contents) {
+    Op op;
+    op.type = OP_REPLACE;
+    op.block = nullptr;
+    op.path = path;
+    op.bytes = contents;
+    Enqueue(op);
+}
+
+bool AsyncWriter::Drain(unsigned int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return idle_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return count_ == 0 && !busy_; });
+}
+
+size_t AsyncWriter::PendingOperations() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_ + (busy_ ? 1 : 0);
+}
+
+void AsyncWriter::Enqueue(Op &op) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // only reachable with a burst of open/close operations; appends are bounded by the block pool
+    idle_.wait(lock, [this] { return count_ < queue_.size(); });
+    Op &slot = queue_[(head_ + count_) % queue_.size()];
+    slot.type = op.type;
+    slot.block = op.block;
+    slot.offset = op.offset;
+    slot.path.swap(op.path);
+    slot.bytes.swap(op.bytes);
+    count_++;
+    wake_.notify_one();
+}
+
+void AsyncWriter::Run() {
+    ThreadPolicy::Instance().Apply(THREAD_ROLE_WRITER, "zb-writer");
+    Op op;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return count_ > 0; });
+            Op &next = queue_[head_];
+            op.type = next.type;
+            op.block = next.block;
+            op.offset = next.offset;
+            op.path.swap(next.path);
+            op.bytes.swap(next.bytes);
+            head_ = (head_ + 1) % queue_.size();
+            count_--;
+            busy_ = true;
+        }
+
+        if (op.type == OP_STOP) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_ = false;
+            idle_.notify_all();
+            return;
+        }
+        Execute(op);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (op.block) {
+            freeBlocks_.push_back(op.block);
+        }
+        busy_ = false;
+        idle_.notify_all();
+    }
+}
+
+void AsyncWriter::Execute(Op &op) {
+    switch (op.type) {
+    case OP_OPEN:
+        if (fd_ >= 0) {
+            fsync(fd_);
+            close(fd_);
+        }
+        fd_ = open(op.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            std::cerr << "AsyncWriter: cannot open " << op.path << ": " << strerror(errno) << std::endl;
+            writeErrors_++;
+        }
+        break;
+    case OP_APPEND:
+        if (fd_ >= 0 && WriteFully(fd_, op.block->data, op.block->size)) {
+            bytesWritten_ += op.block->size;
+        } else {
+            writeErrors_++;
+        }
+        break;
+    case OP_WRITE_AT:
+        if (fd_ < 0 || pwrite(fd_, op.bytes.data(), op.bytes.size(), (off_t)op.offset) != (ssize_t)op.bytes.size()) {
+            writeErrors_++;
+        }
+        break;
+    case OP_CLOSE:
+        if (fd_ >= 0) {
+            fsync(fd_);
+            close(fd_);
+            fd_ = -1;
+        }
+        break;
+    case OP_REPLACE: {
+        std::string temporary = op.path + ".tmp";
+        int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = fd >= 0 && WriteFully(fd, (const uint8_t *)op.bytes.data(), op.bytes.size()) && fsync(fd) == 0;
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (!ok || rename(temporary.c_str(), op.path.c_str()) != 0) {
+            std::cerr << "AsyncWriter: cannot replace " << op.path << std::endl;
+            writeErrors_++;
+        }
+        break;
+    }
+    case OP_STOP:
+        break;
+    }
+}
+
+void AsyncWriter::CollectMetrics(MetricsWriter &writer, void *context) {
+    AsyncWriter *self = static_cast<AsyncWriter *>(context);
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    writer.Write("zoom_bot_writer_queued_ops", self->count_);
+    writer.Write("zoom_bot_writer_free_blocks", self->freeBlocks_.size());
+    writer.Write("zoom_bot_writer_bytes_total", self->bytesWritten_.load());
+    writer.Write("zoom_bot_writer_errors_total", self->writeErrors_.load());
+}
@@ -0,0 +1,97 @@
+// Background file writer fed with pooled blocks
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Metrics.h"
+
+// Moves disk I/O off the media threads. Producers fill blocks from a fixed pool and queue
+// them together with open/close operations; a single thread executes the operations in
+// order. Producers never wait on the disk: when every block is in flight AcquireBlock
+// returns nullptr and the caller decides what to drop.
+class AsyncWriter {
+public:
+    struct Block {
+        uint8_t *data;
+        size_t size;
+    };
+
+    AsyncWriter(size_t blockSize = 256 * 1024, size_t blockCount = 32);
+    ~AsyncWriter();
+
+    size_t BlockSize() const { return blockSize_; }
+
+    /// \brief Number of blocks currently available to producers.
+    size_t FreeBlocks();
+
+    /// \brief Take an empty block from the pool, or nullptr if all blocks are queued.
+    Block *AcquireBlock();
+
+    /// \brief Return a block without writing it.
+    void ReleaseBlock(Block *block);
+
+    /// \brief Make path the target of following Append calls, closing the previous file.
+    void Open(const std::string &path);
+
+    /// \brief Append block->size bytes to the open file; the block returns to the pool afterwards.
+    void Append(Block *block);
+
+    /// \brief Write bytes at an absolute offset of the open file.
+    void WriteAt(uint64_t offset, const std::string &bytes);
+
+    /// \brief Sync and close the open file.
+    void Close();
+
+    /// \brief Replace path with contents atomically (write to a temporary file, then rename).
+    void Replace(const std::string &path, const std::string &contents);
+
+    /// \brief Wait until every queued operation has been executed.
+    /// \return false if the deadline passed first.
+    bool Drain(unsigned int timeoutMs);
+
+    /// \brief Operations queued or being executed, e.g. what a Drain left behind.
+    size_t PendingOperations();
+
+private:
+    enum OpType { OP_OPEN, OP_APPEND, OP_WRITE_AT, OP_CLOSE, OP_REPLACE, OP_STOP };
+
+    struct Op {
+        OpType type;
+        Block *block;
+        uint64_t offset;
+        std::string path;
+        std::string bytes;
+    };
+
+    void Enqueue(Op &op);
+    void Run();
+    void Execute(Op &op);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    size_t blockSize_;
+    std::unique_ptr<uint8_t[]> storage_;
+    std::vector<Block> blocks_;
+    std::vector<Block *> freeBlocks_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    // fixed ring of pending operations
+    std::vector<Op> queue_;
+    size_t head_;
+    size_t count_;
+    bool busy_;
+
+    int fd_;
+    std::atomic<unsigned long long> bytesWritten_;
+    std::atomic<unsigned long long> writeErrors_;
+    std::thread thread_;
+};
@@ -0,0 +1,347 @@
+// Per-stream audio processing pipeline between the SDK audio callbacks and the writers
+
+#include "AudioPipeline.h"
+#include "SimdKernels.h"
+#include "zoom_sdk_raw_data_def.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+std::string StreamLabel(uint32_t streamId) {
+    if (streamId == kMixedAudioStreamId) {
+        return "mixed";
+    }
+    if (streamId == kShareAudioStreamId) {
+        return "share";
+    }
+    if (!IsParticipantStream(streamId)) {
+        return "interpreter-" + std::to_string(streamId - kInterpreterStreamIdBase);
+    }
+    return std::to_string(streamId);
+}
+
+} // namespace
+
+bool AudioOutputFromName(const std::string &name, AudioOutput &output) {
+    if (name == "pcm") {
+        output = AUDIO_OUTPUT_PCM;
+    } else if (name == "logmel") {
+        output = AUDIO_OUTPUT_LOGMEL;
+    } else if (name == "both") {
+        output = AUDIO_OUTPUT_BOTH;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool AgcTargetFromName(const std::string &name, float &targetLufs) {
+    if (name == "off") {
+        targetLufs = 0.0f;
+        return true;
+    }
+    char *end = nullptr;
+    float value = strtof(name.c_str(), &end);
+    if (name.empty() || *end != '\0' || !(value >= -40.0f && value <= -10.0f)) {
+        return false;
+    }
+    targetLufs = value;
+    return true;
+}
+
+AudioPipeline::AudioPipeline(size_t maxStreams)
+    : sink_(nullptr), scheduler_(nullptr), analytics_(nullptr), mixer_(nullptr), spotter_(nullptr), chunker_(nullptr),
+      features_(false), agcTargetLufs_(0.0f),
+      dropNonSpeech_(false), capacity_(16), streamCount_(0), droppedChunks_(0),
+      inFlight_(0) {
+    while (capacity_ < maxStreams) {
+        capacity_ <<= 1;
+    }
+    streams_.reset(new AudioStream[capacity_]);
+    for (size_t i = 0; i < capacity_; i++) {
+        streams_[i].pipeline = this;
+        streams_[i].inUse.store(false);
+    }
+
+    Metrics::Instance().AddCollector(&AudioPipeline::CollectMetrics, this);
+}
+
+AudioPipeline::~AudioPipeline() {
+    WaitIdle();
+    Metrics::Instance().RemoveCollector(this);
+}
+
+void AudioPipeline::WaitIdle() {
+    {
+        std::unique_lock<std::mutex> lock(idleMutex_);
+        idle_.wait(lock, [this] { return inFlight_.load() == 0; });
+    }
+    // the last task is through the sink; wait for the strands to let go of their workers too
+    for (size_t i = 0; i < capacity_; i++) {
+        if (streams_[i].inUse.load(std::memory_order_acquire)) {
+            streams_[i].strand.WaitIdle();
+        }
+    }
+}
+
+bool AudioPipeline::WaitIdleUntil(std::chrono::steady_clock::time_point deadline) {
+    {
+        std::unique_lock<std::mutex> lock(idleMutex_);
+        if (!idle_.wait_until(lock, deadline, [this] { return inFlight_.load() == 0; })) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < capacity_; i++) {
+        if (streams_[i].inUse.load(std::memory_order_acquire) && !streams_[i].strand.WaitIdleUntil(deadline)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+AudioStream *AudioPipeline::FindOrInsert(uint32_t streamId) {
+    // open addressing with linear probing, keys are never removed
+    const size_t mask = capacity_ - 1;
+    size_t slot = (streamId * 2654435761u) & mask;
+    for (size_t probe = 0; probe < capacity_; probe++) {
+        AudioStream &stream = streams_[slot];
+        if (!stream.inUse.load(std::memory_order_relaxed)) {
+            // keep the table at most 3/4 full so probes stay short
+            if ((streamCount_ + 1) * 4 > capacity_ * 3) {
+                return nullptr;
+            }
+            stream.id = streamId;
+            stream.sampleRate = 0;
+            stream.channels = 0;
+            stream.lastTimestamp = 0;
+            stream.resampler.Reset();
+            stream.vad.Reset();
+            stream.loudness.Reset();
+            stream.agc.Reset();
+            stream.features.Reset();
+            stream.mix.Reset();
+            stream.keywords = nullptr;
+            stream.utterances = nullptr;
+            stream.samples.store(0, std::memory_order_relaxed);
+            stream.speechSamples.store(0, std::memory_order_relaxed);
+            stream.droppedSamples.store(0, std::memory_order_relaxed);
+            stream.featureFrames.store(0, std::memory_order_relaxed);
+            if (scheduler_) {
+                stream.strand.SetScheduler(scheduler_);
+                stream.pending.reset(new PendingAudio[kPendingChunks]);
+                stream.pendingHead.store(0, std::memory_order_relaxed);
+                stream.pendingTail.store(0, std::memory_order_relaxed);
+            }
+            // publish the initialized entry to the metrics collector
+            stream.inUse.store(true, std::memory_order_release);
+            streamCount_++;
+            return &stream;
+        }
+        if (stream.id == streamId) {
+            return &stream;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return nullptr;
+}
+
+void AudioPipeline::Process(uint32_t streamId, AudioRawData *data) {
+    if (!data || !data->GetBuffer() || data->GetBufferLen() == 0) {
+        return;
+    }
+
+    AudioStream *stream = FindOrInsert(streamId);
+    if (!stream) {
+        droppedChunks_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    unsigned int channels = data->GetChannelNum() > 0 ? data->GetChannelNum() : 1;
+    const int16_t *pcm = (const int16_t *)data->GetBuffer();
+    size_t frames = data->GetBufferLen() / (sizeof(int16_t) * channels);
+    std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now();
+    if (!scheduler_) {
+        ProcessPcm(*stream, pcm, frames, data->GetSampleRate(), channels, data->GetTimeStamp(), arrival);
+        return;
+    }
+
+    // the SDK buffer is only valid during the callback: copy it into the stream's ring and
+    // let the strand do the work. A stream whose strand is that far behind loses the chunk
+    size_t tail = stream->pendingTail.load(std::memory_order_relaxed);
+    if (tail - stream->pendingHead.load(std::memory_order_acquire) >= kPendingChunks) {
+        droppedChunks_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    PendingAudio &chunk = stream->pending[tail % kPendingChunks];
+    chunk.pcm.assign(pcm, pcm + frames * channels);
+    chunk.frames = frames;
+    chunk.sampleRate = data->GetSampleRate();
+    chunk.channels = channels;
+    chunk.timestampMs = data->GetTimeStamp();
+    chunk.arrival = arrival;
+    stream->pendingTail.store(tail + 1, std::memory_order_release);
+    inFlight_++;
+    stream->strand.Post(&AudioPipeline::RunPending, stream);
+}
+
+void AudioPipeline::RunPending(void *context) {
+    AudioStream *stream = static_cast<AudioStream *>(context);
+    AudioPipeline *self = stream->pipeline;
+    size_t head = stream->pendingHead.load(std::memory_order_relaxed);
+    PendingAudio &chunk = stream->pending[head % kPendingChunks];
+    self->ProcessPcm(*stream, chunk.pcm.data(), chunk.frames, chunk.sampleRate, chunk.channels, chunk.timestampMs,
+                     chunk.arrival);
+    // hand the slot back to the SDK thread
+    stream->pendingHead.store(head + 1, std::memory_order_release);
+    if (self->inFlight_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(self->idleMutex_);
+        self->idle_.notify_all();
+    }
+}
+
+void AudioPipeline::ProcessPcm(AudioStream &stream, const int16_t *pcm, size_t frames, unsigned int sampleRate,
+                               unsigned int channels, unsigned long long timestampMs,
+                               std::chrono::steady_clock::time_point arrival) {
+    if (!stream.resampler.Configure(sampleRate)) {
+        droppedChunks_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (stream.sampleRate != sampleRate || stream.channels != channels) {
+        std::cout << "AudioPipeline: stream " << stream.id << " format " << sampleRate << " Hz x " << channels
+                  << " ch" << std::endl;
+        stream.sampleRate = sampleRate;
+        stream.channels = channels;
+    }
+    stream.lastTimestamp = timestampMs;
+
+    // scratch of the thread doing the work, the SDK thread or a scheduler worker; the
+    // worst case is upsampling 8 kHz input to 16 kHz
+    thread_local std::vector<float> mono(kMaxSliceFrames);
+    thread_local std::vector<float> resampled(kMaxSliceFrames * 2 + 2);
+    thread_local std::vector<float> features(LogMelExtractor::MaxFrames(kMaxSliceFrames * 2 + 2) *
+                                             LogMelExtractor::kBins);
+
+    size_t maxSlice = kMaxSliceFrames;
+    while (maxSlice > 1 && stream.resampler.MaxOutputSamples(maxSlice) > resampled.size()) {
+        maxSlice /= 2;
+    }
+
+    size_t offset = 0;
+    while (offset < frames) {
+        size_t slice = frames - offset < maxSlice ? frames - offset : maxSlice;
+        SimdKernels::DownmixToMonoFloat(pcm + offset * channels, slice, channels, mono.data());
+        size_t produced = stream.resampler.Process(mono.data(), slice, resampled.data());
+        offset += slice;
+        if (produced == 0) {
+            continue;
+        }
+
+        if (stream.id == kMixedAudioStreamId && selfAudio_.Enabled()) {
+            // the chunk arrived when its last sample was captured
+            long long startUs = (long long)(frames - (offset - slice)) * 1000000 / sampleRate;
+            selfAudio_.Process(resampled.data(), produced, arrival - std::chrono::microseconds(startUs));
+        }
+
+        AudioChunk chunk;
+        chunk.streamId = stream.id;
+        chunk.samples = resampled.data();
+        chunk.count = produced;
+        chunk.timestampMs = stream.lastTimestamp + (offset - slice) * 1000 / stream.sampleRate;
+        chunk.speech = stream.vad.Process(chunk.samples, chunk.count);
+        if (analytics_ && IsParticipantStream(stream.id)) {
+            analytics_->Update(stream.id, chunk.timestampMs, produced, chunk.speech, stream.vad.Voiced());
+        }
+        if (mixer_ && IsParticipantStream(stream.id)) {
+            // at the levels of the meeting, before the AGC evens them out
+            mixer_->Add(stream.mix, stream.id, chunk.samples, chunk.count, chunk.timestampMs);
+        }
+
+        // the meter and the VAD see the audio as it came in, everything after sees it normalized
+        stream.loudness.Process(chunk.samples, chunk.count);
+        if (agcTargetLufs_ != 0.0f) {
+            size_t fill = stream.agc.Process(resampled.data(), produced, agcTargetLufs_, stream.loudness.Momentary(),
+                                             chunk.speech);
+            // the output lags by the look-ahead; at the start of a stream the lag is the empty
+            // delay line, which is skipped instead
+            unsigned long long delayMs = (AutomaticGainControl::kLookAheadSamples - fill) * 1000 / kAsrSampleRate;
+            chunk.samples += fill;
+            chunk.count -= fill;
+            chunk.timestampMs = chunk.timestampMs > delayMs ? chunk.timestampMs - delayMs : 0;
+            if (chunk.count == 0) {
+                continue;
+            }
+        }
+
+        if (chunker_ && IsParticipantStream(stream.id)) {
+            chunker_->Add(stream.utterances, stream.id, chunk.samples, chunk.count, chunk.timestampMs, chunk.speech,
+                          stream.vad.Voiced());
+        }
+
+        chunk.features = nullptr;
+        chunk.featureFrames = 0;
+        chunk.featureTimestampMs = 0;
+        if (features_) {
+            // the first window completed here began with samples buffered from earlier slices
+            unsigned long long bufferedMs = stream.features.Buffered() * 1000 / kAsrSampleRate;
+            chunk.features = features.data();
+            chunk.featureFrames = stream.features.Process(chunk.samples, chunk.count, features.data());
+            chunk.featureTimestampMs = chunk.timestampMs > bufferedMs ? chunk.timestampMs - bufferedMs : 0;
+            stream.featureFrames.fetch_add(chunk.featureFrames, std::memory_order_relaxed);
+            if (spotter_ && IsParticipantStream(stream.id)) {
+                spotter_->Push(stream.keywords, stream.id, chunk.features, chunk.featureFrames,
+                               chunk.featureTimestampMs);
+            }
+        }
+
+        stream.samples.fetch_add(produced, std::memory_order_relaxed);
+        if (chunk.speech) {
+            stream.speechSamples.fetch_add(produced, std::memory_order_relaxed);
+        } else if (dropNonSpeech_ && IsParticipantStream(stream.id)) {
+            stream.droppedSamples.fetch_add(produced, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (sink_) {
+            sink_->onPipelineAudio(chunk);
+        }
+    }
+}
+
+void AudioPipeline::CollectMetrics(MetricsWriter &writer, void *context) {
+    AudioPipeline *self = static_cast<AudioPipeline *>(context);
+    writer.Write("zoom_bot_audio_streams", self->streamCount_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_audio_dropped_chunks_total", self->droppedChunks_.load(std::memory_order_relaxed));
+
+    for (size_t i = 0; i < self->capacity_; i++) {
+        AudioStream &stream = self->streams_[i];
+        if (!stream.inUse.load(std::memory_order_acquire)) {
+            continue;
+        }
+        std::string label = StreamLabel(stream.id);
+        double seconds = (double)stream.samples.load(std::memory_order_relaxed) / kAsrSampleRate;
+        double speechSeconds = (double)stream.speechSamples.load(std::memory_order_relaxed) / kAsrSampleRate;
+        double droppedSeconds = (double)stream.droppedSamples.load(std::memory_order_relaxed) / kAsrSampleRate;
+        writer.Write("zoom_bot_audio_seconds_total", "stream", label, seconds);
+        writer.Write("zoom_bot_audio_speech_seconds_total", "stream", label, speechSeconds);
+        writer.Write("zoom_bot_audio_gated_seconds_total", "stream", label, droppedSeconds);
+        writer.Write("zoom_bot_audio_speech_ratio", "stream", label, seconds > 0.0 ? speechSeconds / seconds : 0.0);
+        writer.Write("zoom_bot_audio_loudness_short_term_lufs", "stream", label, stream.loudness.ShortTerm());
+        writer.Write("zoom_bot_audio_loudness_integrated_lufs", "stream", label, stream.loudness.Integrated());
+        if (self->agcTargetLufs_ != 0.0f) {
+            writer.Write("zoom_bot_audio_agc_gain_db", "stream", label, stream.agc.GainDb());
+        }
+        if (stream.id == kMixedAudioStreamId && self->selfAudio_.Enabled()) {
+            writer.Write("zoom_bot_self_audio_locked", self->selfAudio_.Locked() ? 1.0 : 0.0);
+            writer.Write("zoom_bot_self_audio_delay_ms", (double)self->selfAudio_.DelayMs());
+            writer.Write("zoom_bot_self_audio_cancelled_seconds_total", self->selfAudio_.CancelledSeconds());
+            writer.Write("zoom_bot_self_audio_gated_seconds_total", self->selfAudio_.GatedSeconds());
+            writer.Write("zoom_bot_self_audio_erle_db", self->selfAudio_.ErleDb());
+        }
+        if (self->features_) {
+            writer.Write("zoom_bot_audio_feature_frames_total", "stream", label,
+                         stream.featureFrames.load(std::memory_order_relaxed));
+        }
+    }
+}
@@ -0,0 +1,232 @@
+// Per-stream audio processing pipeline between the SDK audio callbacks and the writers
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioResampler.h"
+#include "AutomaticGainControl.h"
+#include "KeywordSpotter.h"
+#include "LocalMixer.h"
+#include "LogMelExtractor.h"
+#include "LoudnessMeter.h"
+#include "Metrics.h"
+#include "SelfAudioCanceller.h"
+#include "SpeakerAnalytics.h"
+#include "TaskScheduler.h"
+#include "UtteranceChunker.h"
+#include "VoiceActivityDetector.h"
+
+class AudioRawData;
+class AudioPipeline;
+
+// Stream id used for the SDK mixed audio; one-way streams use the participant node id.
+const uint32_t kMixedAudioStreamId = 0xFFFFFFFFu;
+// Stream id of the mix a LocalMixer builds from selected one-way streams.
+const uint32_t kLocalMixStreamId = 0xFFFFFFFEu;
+// Stream id of the audio of a screen share, e.g. the soundtrack of a shared video.
+const uint32_t kShareAudioStreamId = 0xFFFFFFFDu;
+// Interpretation channels are kInterpreterStreamIdBase plus a language index, see
+// InterpreterStreams. Ids from here up are not participants.
+const uint32_t kInterpreterStreamIdBase = 0xFFFFFF00u;
+
+/// \brief Whether streamId is a participant's own voice rather than the mixed stream, a
+/// share or an interpretation channel. Only participant streams feed the per-speaker
+/// stages (analytics, local mix, keywords, utterances) and are gated by dropNonSpeech;
+/// the others are recorded like the mixed stream.
+inline bool IsParticipantStream(uint32_t streamId) {
+    return streamId < kInterpreterStreamIdBase;
+}
+
+// What the capture sink records for each stream.
+enum AudioOutput {
+    // PCM of the mixed, share and interpretation streams
+    AUDIO_OUTPUT_PCM,
+    // log-mel features of every stream, no PCM
+    AUDIO_OUTPUT_LOGMEL,
+    // PCM of the mixed, share and interpretation streams and log-mel features of every stream
+    AUDIO_OUTPUT_BOTH,
+};
+
+/// \brief AudioOutput of an audioOutput name: "pcm", "logmel" or "both".
+/// \return false if the name is none of them.
+bool AudioOutputFromName(const std::string &name, AudioOutput &output);
+
+/// \brief Target loudness of an agcTargetLufs value: "off" (0) or -40 to -10 LUFS, e.g. "-23".
+/// \return false if the value is neither.
+bool AgcTargetFromName(const std::string &name, float &targetLufs);
+
+// An SDK chunk copied out of the callback, waiting for its stream's strand.
+struct PendingAudio {
+    std::vector<int16_t> pcm;
+    size_t frames;
+    unsigned int sampleRate;
+    unsigned int channels;
+    unsigned long long timestampMs;
+    // when the SDK handed the chunk over, for aligning the mixed stream with the bot's own audio
+    std::chrono::steady_clock::time_point arrival;
+};
+
+// State kept for each audio stream. Entries live in a fixed table, so nothing is allocated
+// per callback once a stream has been seen.
+struct AudioStream {
+    AudioPipeline *pipeline;
+    std::atomic<bool> inUse;
+    uint32_t id;
+    unsigned int sampleRate;
+    unsigned int channels;
+    unsigned long long lastTimestamp;
+    AudioResampler resampler;
+    VoiceActivityDetector vad;
+    LoudnessMeter loudness;
+    AutomaticGainControl agc;
+    LogMelExtractor features;
+    LocalMixInput mix;
+    // the stream's queue in the keyword spotter, nullptr until its first frames
+    KeywordSpotter::Stream *keywords;
+    // the stream's state in the utterance chunker, nullptr until its first slice
+    UtteranceChunker::Stream *utterances;
+
+    // with a scheduler: chunks from the SDK thread, processed in order on the stream's
+    // strand. A ring of kPendingChunks; the SDK thread advances pendingTail, the strand pendingHead
+    Strand strand;
+    std::unique_ptr<PendingAudio[]> pending;
+    std::atomic<size_t> pendingHead;
+    std::atomic<size_t> pendingTail;
+
+    // read by the metrics collector, in 16 kHz samples
+    std::atomic<unsigned long long> samples;
+    std::atomic<unsigned long long> speechSamples;
+    std::atomic<unsigned long long> droppedSamples;
+    std::atomic<unsigned long long> featureFrames;
+};
+
+// One processed slice of a stream, only valid during the sink call.
+struct AudioChunk {
+    uint32_t streamId;
+    // mono samples at kAsrSampleRate in [-1, 1)
+    const float *samples;
+    size_t count;
+    // SDK timestamp of the chunk the slice was cut from, plus the slice offset
+    unsigned long long timestampMs;
+    // true if the slice overlaps a detected speech segment
+    bool speech;
+    // with SetFeatures: the log-mel frames this slice completed, LogMelExtractor::kBins
+    // values each and kFrameMs apart; featureTimestampMs is where the first one's window starts
+    const float *features;
+    size_t featureFrames;
+    unsigned long long featureTimestampMs;
+};
+
+// Receives 16 kHz mono float audio from the pipeline.
+class AudioPipelineSink {
+public:
+    virtual ~AudioPipelineSink() {}
+
+    /// \brief Called for every processed slice of a stream: on the SDK audio thread, or on a
+    /// scheduler worker when the pipeline has one. Slices of one stream come in order and
+    /// one at a time; different streams may call concurrently.
+    virtual void onPipelineAudio(const AudioChunk &chunk) = 0;
+};
+
+class AudioPipeline {
+public:
+    /// \param maxStreams Capacity of the stream table, rounded up to a power of two.
+    explicit AudioPipeline(size_t maxStreams = 512);
+    ~AudioPipeline();
+
+    void SetSink(AudioPipelineSink *sink) { sink_ = sink; }
+
+    /// \brief Process streams in parallel on scheduler instead of on the SDK thread. The SDK
+    /// thread then only copies each chunk. Set before the first Process; scheduler must
+    /// outlive the pipeline.
+    void SetScheduler(TaskScheduler *scheduler) { scheduler_ = scheduler; }
+
+    /// \brief Wait until every chunk handed to Process went through the sink.
+    void WaitIdle();
+
+    /// \brief WaitIdle that gives up at deadline.
+    /// \return false if chunks were still on their way then.
+    bool WaitIdleUntil(std::chrono::steady_clock::time_point deadline);
+
+    /// \brief Compute log-mel features of every stream alongside the PCM. Set before the
+    /// first Process.
+    void SetFeatures(bool enabled) { features_ = enabled; }
+
+    /// \brief Normalize every stream towards targetLufs with a look-ahead AGC before the
+    /// features and the sink, 0 to leave levels alone. Slices are then delayed by
+    /// AutomaticGainControl::kLookAheadMs and their timestamps say so. Set before the first Process.
+    void SetAgcTarget(float targetLufs) { agcTargetLufs_ = targetLufs; }
+
+    /// \brief Remove the audio the bot published, as recorded in reference, from the mixed
+    /// stream before anything else sees it. Set before the first Process.
+    void SetPlaybackReference(PlaybackReference *reference, SelfAudioMode mode) { selfAudio_.SetReference(reference, mode); }
+
+    /// \brief Mix the participant streams into mixer as they come in, before the AGC. Set
+    /// before the first Process; mixer must outlive the pipeline.
+    void SetLocalMixer(LocalMixer *mixer) { mixer_ = mixer; }
+
+    /// \brief Hand the log-mel frames of every participant stream to spotter. Features must
+    /// be enabled. Set before the first Process; spotter must outlive the pipeline.
+    void SetKeywordSpotter(KeywordSpotter *spotter) { spotter_ = spotter; }
+
+    /// \brief Assemble every participant stream into utterances in chunker, after the AGC.
+    /// Set before the first Process; chunker must outlive the pipeline.
+    void SetUtteranceChunker(UtteranceChunker *chunker) { chunker_ = chunker; }
+
+    /// \brief Report the VAD decision of every participant slice to analytics, before the
+    /// non-speech gate. Set before the first Process.
+    void SetAnalytics(SpeakerAnalytics *analytics) { analytics_ = analytics; }
+
+    /// \brief Drop one-way slices the VAD marks as non-speech instead of passing them to the sink.
+    /// The mixed, share and interpretation streams are never gated so they stay continuous.
+    void SetDropNonSpeech(bool drop) { dropNonSpeech_ = drop; }
+
+    /// \brief Downmix, resample, classify and optionally featurize one SDK chunk and hand it to the sink.
+    void Process(uint32_t streamId, AudioRawData *data);
+
+    size_t StreamCount() const { return streamCount_; }
+    unsigned long long DroppedChunks() const { return droppedChunks_; }
+
+private:
+    // largest slice converted at once; bigger SDK chunks are processed in several slices
+    static const size_t kMaxSliceFrames = 4800;
+    // chunks a stream may have waiting for its strand, 160 ms of 10 ms callbacks; more are dropped
+    static const size_t kPendingChunks = 16;
+
+    AudioStream *FindOrInsert(uint32_t streamId);
+    void ProcessPcm(AudioStream &stream, const int16_t *pcm, size_t frames, unsigned int sampleRate,
+                    unsigned int channels, unsigned long long timestampMs,
+                    std::chrono::steady_clock::time_point arrival);
+    static void RunPending(void *context);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    AudioPipelineSink *sink_;
+    TaskScheduler *scheduler_;
+    SpeakerAnalytics *analytics_;
+    LocalMixer *mixer_;
+    KeywordSpotter *spotter_;
+    UtteranceChunker *chunker_;
+    bool features_;
+    float agcTargetLufs_;
+    // only the mixed stream's strand uses it
+    SelfAudioCanceller selfAudio_;
+    // changed on the main loop by a config reload, read on the SDK audio thread
+    std::atomic<bool> dropNonSpeech_;
+    std::unique_ptr<AudioStream[]> streams_;
+    size_t capacity_;
+    std::atomic<size_t> streamCount_;
+    std::atomic<unsigned long long> droppedChunks_;
+
+    // chunks queued on strands and not through the sink yet
+    std::atomic<size_t> inFlight_;
+    std::mutex idleMutex_;
+    std::condition_variable idle_;
+};
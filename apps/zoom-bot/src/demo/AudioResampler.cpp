@@ -0,0 +1,191 @@
+// Polyphase sample-rate converter producing the 16 kHz mono ASR format
+
+#include "AudioResampler.h"
+#include "SimdKernels.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+// taps per phase needed for a ~10% transition band at the output Nyquist frequency
+const unsigned int kTapsPerZeroCrossing = 24;
+const unsigned int kMaxInterpolation = 1024;
+const unsigned int kMaxInputRate = 192000;
+const unsigned int kMaxFilterBanks = 32;
+const double kKaiserBeta = 8.0;
+const double kPi = 3.14159265358979323846;
+
+unsigned int GreatestCommonDivisor(unsigned int a, unsigned int b) {
+    while (b != 0) {
+        unsigned int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// zeroth-order modified Bessel function, used by the Kaiser window
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+std::mutex filterBankMutex;
+const PolyphaseFilterBank *filterBanks[kMaxFilterBanks];
+unsigned int filterBankCount = 0;
+
+} // namespace
+
+PolyphaseFilterBank::PolyphaseFilterBank(unsigned int inputRate)
+    : inputRate_(inputRate), interpolation_(1), decimation_(1), taps_(0), coefficients_(nullptr) {
+    unsigned int divisor = GreatestCommonDivisor(kAsrSampleRate, inputRate);
+    interpolation_ = kAsrSampleRate / divisor;
+    decimation_ = inputRate / divisor;
+    if (interpolation_ == 1 && decimation_ == 1) {
+        // already at the ASR rate, Process copies straight through
+        return;
+    }
+
+    unsigned int factor = interpolation_ > decimation_ ? interpolation_ : decimation_;
+    unsigned int taps = (kTapsPerZeroCrossing * factor + interpolation_ - 1) / interpolation_;
+    taps = (taps + 7) & ~7u;
+    if (taps > kMaxTaps) {
+        taps = kMaxTaps;
+    }
+    taps_ = taps;
+
+    // windowed-sinc prototype running at interpolation_ * inputRate
+    size_t length = (size_t)taps_ * interpolation_;
+    double cutoff = 0.45 / factor;
+    double center = (length - 1) / 2.0;
+    double windowNorm = BesselI0(kKaiserBeta);
+    double *prototype = new double[length];
+    double sum = 0.0;
+    for (size_t i = 0; i < length; i++) {
+        double t = i - center;
+        double sinc = t == 0.0 ? 2.0 * cutoff : sin(2.0 * kPi * cutoff * t) / (kPi * t);
+        double ratio = 2.0 * i / (length - 1) - 1.0;
+        double window = BesselI0(kKaiserBeta * sqrt(1.0 - ratio * ratio)) / windowNorm;
+        prototype[i] = sinc * window;
+        sum += prototype[i];
+    }
+
+    // each phase must keep unity DC gain, so the whole prototype sums to the interpolation factor
+    double gain = interpolation_ / sum;
+    coefficients_ = new float[length];
+    for (unsigned int phase = 0; phase < interpolation_; phase++) {
+        for (unsigned int j = 0; j < taps_; j++) {
+            coefficients_[phase * taps_ + j] = (float)(prototype[phase + (taps_ - 1 - j) * interpolation_] * gain);
+        }
+    }
+    delete[] prototype;
+}
+
+const PolyphaseFilterBank *PolyphaseFilterBank::ForRate(unsigned int inputRate) {
+    if (inputRate == 0 || inputRate > kMaxInputRate) {
+        return nullptr;
+    }
+    if (kAsrSampleRate / GreatestCommonDivisor(kAsrSampleRate, inputRate) > kMaxInterpolation) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(filterBankMutex);
+    for (unsigned int i = 0; i < filterBankCount; i++) {
+        if (filterBanks[i]->InputRate() == inputRate) {
+            return filterBanks[i];
+        }
+    }
+    if (filterBankCount == kMaxFilterBanks) {
+        return nullptr;
+    }
+
+    // banks live for the whole process, streams only hold pointers to them
+    PolyphaseFilterBank *bank = new PolyphaseFilterBank(inputRate);
+    filterBanks[filterBankCount++] = bank;
+    std::cout << "Resampler: built filter bank " << inputRate << " Hz -> " << kAsrSampleRate << " Hz, "
+              << bank->Interpolation() << "/" << bank->Decimation() << ", " << bank->Taps() << " taps/phase ("
+              << SimdKernels::InstructionSet() << ")" << std::endl;
+    return bank;
+}
+
+AudioResampler::AudioResampler() : bank_(nullptr), phase_(0), position_(kHistory) {
+    memset(window_, 0, sizeof(window_));
+}
+
+bool AudioResampler::Configure(unsigned int inputRate) {
+    if (bank_ && bank_->InputRate() == inputRate) {
+        return true;
+    }
+    const PolyphaseFilterBank *bank = PolyphaseFilterBank::ForRate(inputRate);
+    if (!bank) {
+        return false;
+    }
+    // keep the history so the first chunk at the new rate does not start from silence
+    bank_ = bank;
+    phase_ = 0;
+    position_ = kHistory;
+    return true;
+}
+
+size_t AudioResampler::MaxOutputSamples(size_t inputSamples) const {
+    if (!bank_) {
+        return 0;
+    }
+    return inputSamples * bank_->Interpolation() / bank_->Decimation() + 2;
+}
+
+size_t AudioResampler::Process(const float *input, size_t count, float *output) {
+    if (!bank_ || count == 0) {
+        return 0;
+    }
+
+    size_t bridged = count < kHistory ? count : kHistory;
+    memcpy(window_ + kHistory, input, bridged * sizeof(float));
+
+    size_t produced = 0;
+    if (bank_->Taps() == 0) {
+        memcpy(output, input, count * sizeof(float));
+        produced = count;
+    } else {
+        const unsigned int taps = bank_->Taps();
+        const unsigned int interpolation = bank_->Interpolation();
+        const unsigned int decimation = bank_->Decimation();
+        const size_t end = kHistory + count;
+        size_t position = position_;
+        unsigned int phase = phase_;
+
+        // position indexes the newest sample of the filter window in [history | input]
+        while (position < end) {
+            size_t start = position + 1 - taps;
+            const float *window = start < kHistory ? window_ + start : input + (start - kHistory);
+            output[produced++] = SimdKernels::DotProduct(bank_->Phase(phase), window, taps);
+
+            phase += decimation;
+            position += phase / interpolation;
+            phase %= interpolation;
+        }
+        position_ = position - count;
+        phase_ = phase;
+    }
+
+    if (count >= kHistory) {
+        memcpy(window_, input + count - kHistory, kHistory * sizeof(float));
+    } else {
+        memmove(window_, window_ + count, kHistory * sizeof(float));
+    }
+    return produced;
+}
+
+void AudioResampler::Reset() {
+    memset(window_, 0, sizeof(window_));
+    phase_ = 0;
+    position_ = kHistory;
+}
@@ -0,0 +1,70 @@
+// Polyphase sample-rate converter producing the 16 kHz mono ASR format
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Sample rate expected by the transcription service
+constexpr unsigned int kAsrSampleRate = 16000;
+
+// Immutable polyphase coefficient table for one input rate.
+// Tables are built once per process and shared by every stream at that rate.
+class PolyphaseFilterBank {
+public:
+    static const unsigned int kMaxTaps = 128;
+
+    /// \brief Get the shared filter bank converting inputRate to kAsrSampleRate.
+    /// \return nullptr if the rate is unsupported (zero or above 192 kHz).
+    static const PolyphaseFilterBank *ForRate(unsigned int inputRate);
+
+    unsigned int InputRate() const { return inputRate_; }
+    unsigned int Interpolation() const { return interpolation_; }
+    unsigned int Decimation() const { return decimation_; }
+    unsigned int Taps() const { return taps_; }
+
+    /// \brief Coefficients of one phase, stored oldest-sample-first so they line up with the input window.
+    const float *Phase(unsigned int phase) const { return coefficients_ + phase * taps_; }
+
+private:
+    PolyphaseFilterBank(unsigned int inputRate);
+
+    unsigned int inputRate_;
+    unsigned int interpolation_;
+    unsigned int decimation_;
+    unsigned int taps_;
+    float *coefficients_;
+};
+
+// Per-stream resampler state. Holds only the filter history, so a rate change switches
+// to another shared filter bank without allocating, and the history carries over chunk
+// boundaries so consecutive chunks are filtered as one continuous signal.
+class AudioResampler {
+public:
+    AudioResampler();
+
+    /// \brief Select the filter bank for the given input rate.
+    /// \return false if the rate is unsupported, the previous configuration is kept.
+    bool Configure(unsigned int inputRate);
+
+    unsigned int InputRate() const { return bank_ ? bank_->InputRate() : 0; }
+
+    /// \brief Upper bound of output samples produced for a given number of input samples.
+    size_t MaxOutputSamples(size_t inputSamples) const;
+
+    /// \brief Resample mono float input to kAsrSampleRate.
+    /// \param output Must hold at least MaxOutputSamples(count) samples.
+    /// \return Number of samples written to output.
+    size_t Process(const float *input, size_t count, float *output);
+
+    /// \brief Drop the filter history, used after a gap so stale audio is not smeared into new audio.
+    void Reset();
+
+private:
+    static const unsigned int kHistory = PolyphaseFilterBank::kMaxTaps - 1;
+
+    const PolyphaseFilterBank *bank_;
+    unsigned int phase_;
+    size_t position_;
+    // [0, kHistory) holds the tail of the previous chunk, the rest bridges into the new chunk
+    float window_[kHistory * 2];
+};
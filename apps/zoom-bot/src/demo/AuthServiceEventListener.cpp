@@ -2,10 +2,10 @@
 #include <iostream>
 
 
-AuthServiceEventListener::AuthServiceEventListener(void(*onAuthSuccess)())
+AuthServiceEventListener::AuthServiceEventListener(AsyncChannel<AuthResult>* results)
 {
     
-    onAuthSuccess_ = onAuthSuccess;
+    results_ = results;
 }
 
 void AuthServiceEventListener::onAuthenticationReturn(ZOOM_SDK_NAMESPACE::AuthResult ret) {
@@ -18,10 +18,10 @@ void AuthServiceEventListener::onAuthenticationReturn(ZOOM_SDK_NAMESPACE::AuthRe
     {
         // SDK Authenticated successfully
         std::cout << "Auth succeeded: JWT." << std::endl;
-          if (onAuthSuccess_) onAuthSuccess_();
     }
     else 
         std::cout << "Auth failed: " << ret << std::endl;
+    if (results_) results_->Push(ret);
 }
 
 void AuthServiceEventListener::onLoginReturnWithReason(LOGINSTATUS ret, IAccountInfo* pAccountInfo, LoginFailReason reason)
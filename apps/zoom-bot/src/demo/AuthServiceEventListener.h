@@ -1,14 +1,17 @@
 #include "auth_service_interface.h"
 
+#include "MainLoopTask.h"
+
 USING_ZOOM_SDK_NAMESPACE
 
 
 class AuthServiceEventListener : public IAuthServiceEvent
 {
 	
-    	 void (*onAuthSuccess_)();
+    	 // every authentication result, for the coroutine waiting on SDKAuth
+    	 AsyncChannel<AuthResult>* results_;
 public:
-    AuthServiceEventListener(void (*onAuthSuccess)());
+    AuthServiceEventListener(AsyncChannel<AuthResult>* results);
 
     /// \brief Authentication result callback.
     /// \param ret Authentication result value.  For more details, see \link AuthResult \endlink enum.
@@ -0,0 +1,76 @@
+// Look-ahead automatic gain control for 16 kHz mono audio
+
+#include "AutomaticGainControl.h"
+#include "AudioResampler.h"
+#include "LoudnessMeter.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// slew limits of the loudness-driven level; the limiter is not bound by them
+const float kRiseDbPerSecond = 3.0f;
+const float kFallDbPerSecond = 12.0f;
+
+} // namespace
+
+AutomaticGainControl::AutomaticGainControl() {
+    Reset();
+}
+
+void AutomaticGainControl::Reset() {
+    memset(delay_, 0, sizeof(delay_));
+    primed_ = 0;
+    levelDb_ = 0.0f;
+    gain_ = 1.0f;
+    gainDb_.store(0.0f, std::memory_order_relaxed);
+}
+
+void AutomaticGainControl::Delay(float *samples, size_t count) {
+    float ahead[kLookAheadSamples];
+    if (count >= kLookAheadSamples) {
+        memcpy(ahead, samples + count - kLookAheadSamples, sizeof(ahead));
+        memmove(samples + kLookAheadSamples, samples, (count - kLookAheadSamples) * sizeof(float));
+        memcpy(samples, delay_, sizeof(delay_));
+        memcpy(delay_, ahead, sizeof(delay_));
+        return;
+    }
+    memcpy(ahead, samples, count * sizeof(float));
+    memcpy(samples, delay_, count * sizeof(float));
+    memmove(delay_, delay_ + count, (kLookAheadSamples - count) * sizeof(float));
+    memcpy(delay_ + kLookAheadSamples - count, ahead, count * sizeof(float));
+}
+
+size_t AutomaticGainControl::Process(float *samples, size_t count, float targetLufs, float loudnessLufs, bool speech) {
+    if (count == 0) {
+        return 0;
+    }
+    if (speech && loudnessLufs > LoudnessMeter::kSilenceLufs) {
+        float seconds = (float)count / kAsrSampleRate;
+        float wanted = std::max(-kMaxCutDb, std::min(kMaxBoostDb, targetLufs - loudnessLufs));
+        if (wanted > levelDb_) {
+            levelDb_ = std::min(wanted, levelDb_ + kRiseDbPerSecond * seconds);
+        } else {
+            levelDb_ = std::max(wanted, levelDb_ - kFallDbPerSecond * seconds);
+        }
+    }
+
+    Delay(samples, count);
+    // what is about to go out plus what follows it
+    float peak = std::max(SimdKernels::PeakAbs(samples, count), SimdKernels::PeakAbs(delay_, kLookAheadSamples));
+    float gain = powf(10.0f, levelDb_ / 20.0f);
+    if (peak * gain > kCeiling) {
+        gain = kCeiling / peak;
+    }
+    float step = (gain - gain_) / count;
+    SimdKernels::ApplyGainRamp(samples, count, gain_ + step, step, samples);
+    gain_ = gain;
+    gainDb_.store(20.0f * log10f(gain), std::memory_order_relaxed);
+
+    size_t fill = std::min(count, kLookAheadSamples - primed_);
+    primed_ += fill;
+    return fill;
+}
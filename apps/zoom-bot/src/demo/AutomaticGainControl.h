@@ -0,0 +1,51 @@
+// Look-ahead automatic gain control for 16 kHz mono audio
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Pulls a stream towards a target loudness. The gain follows the stream's momentary
+// loudness (see LoudnessMeter) while the VAD reports speech and holds in between, so
+// background noise is not raised during pauses. It rises slowly and falls quickly, within
+// kMaxBoostDb and kMaxCutDb of unity.
+//
+// Output is delayed by kLookAheadSamples. The delay lets a peak limiter see 10 ms ahead and
+// lower the gain before a loud onset instead of clipping it: the gain at the end of every
+// slice keeps the slice and the look-ahead under kCeiling, and gain changes are ramped
+// across the slice so they do not click.
+class AutomaticGainControl {
+public:
+    static const size_t kLookAheadSamples = 160;
+    static const unsigned int kLookAheadMs = 10;
+    static constexpr float kMaxBoostDb = 24.0f;
+    static constexpr float kMaxCutDb = 18.0f;
+    // -1 dBFS
+    static constexpr float kCeiling = 0.891f;
+
+    AutomaticGainControl();
+
+    /// \brief Apply the gain in place. samples come out kLookAheadSamples later.
+    /// \param targetLufs Loudness to steer towards.
+    /// \param loudnessLufs Momentary loudness of the stream including these samples.
+    /// \param speech Whether the VAD classified the samples as speech.
+    /// \return How many leading samples are only the empty delay line at the start of the
+    /// stream; skip them. Later calls return 0.
+    size_t Process(float *samples, size_t count, float targetLufs, float loudnessLufs, bool speech);
+
+    /// \brief The gain applied at the end of the last slice, readable from any thread.
+    float GainDb() const { return gainDb_.load(std::memory_order_relaxed); }
+
+    void Reset();
+
+private:
+    void Delay(float *samples, size_t count);
+
+    float delay_[kLookAheadSamples];
+    // samples taken in so far, up to kLookAheadSamples
+    size_t primed_;
+    // the level the loudness asks for, before the limiter
+    float levelDb_;
+    // linear gain at the end of the previous slice
+    float gain_;
+    std::atomic<float> gainDb_;
+};
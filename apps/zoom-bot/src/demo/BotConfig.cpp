@@ -0,0 +1,527 @@
+// Typed configuration merged from config.txt, a ConfigMap mount and the environment
+
+#include "BotConfig.h"
+#include "TemplateKeywordModel.h"
+#include "ThreadPolicy.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <glib-unix.h>
+#include <iostream>
+#include <sstream>
+#include <sys/inotify.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// editors and kubelet touch several files per update; reload once they are done
+const guint kReloadDelayMs = 250;
+
+#define CONFIG_ADDRESS(member) [](BotConfig &config) -> void * { return &config.member; }
+
+const ConfigField kFields[] = {
+    // key, type, address, min, max, reloadable, secret
+    {"token", CONFIG_STRING, CONFIG_ADDRESS(token), 0, 0, false, true},
+    {"meetingNumber", CONFIG_STRING, CONFIG_ADDRESS(meeting.meetingNumber), 0, 0, false, false},
+    {"meetingPassword", CONFIG_STRING, CONFIG_ADDRESS(meeting.meetingPassword), 0, 0, false, true},
+    {"recordingToken", CONFIG_STRING, CONFIG_ADDRESS(meeting.recordingToken), 0, 0, false, true},
+    {"userName", CONFIG_STRING, CONFIG_ADDRESS(meeting.userName), 0, 0, false, false},
+    {"enableVideoRawDataCapture", CONFIG_BOOL, CONFIG_ADDRESS(meeting.enableVideoRawDataCapture), 0, 0, false, false},
+    {"enableAudioRawDataCapture", CONFIG_BOOL, CONFIG_ADDRESS(meeting.enableAudioRawDataCapture), 0, 0, false, false},
+    {"enableVideoRawDataPublishing", CONFIG_BOOL, CONFIG_ADDRESS(meeting.enableVideoRawDataPublishing), 0, 0, false, false},
+    {"enableAudioRawDataPublishing", CONFIG_BOOL, CONFIG_ADDRESS(meeting.enableAudioRawDataPublishing), 0, 0, false, false},
+    {"dropNonSpeechAudio", CONFIG_BOOL, CONFIG_ADDRESS(meeting.dropNonSpeechAudio), 0, 0, true, false},
+    {"audioOutput", CONFIG_STRING, CONFIG_ADDRESS(meeting.audioOutput), 0, 0, false, false},
+    {"agcTargetLufs", CONFIG_STRING, CONFIG_ADDRESS(meeting.agcTargetLufs), 0, 0, false, false},
+    {"selfAudioSuppression", CONFIG_STRING, CONFIG_ADDRESS(meeting.selfAudioSuppression), 0, 0, false, false},
+    {"localMix", CONFIG_BOOL, CONFIG_ADDRESS(meeting.localMix), 0, 0, false, false},
+    {"localMixInclude", CONFIG_STRING, CONFIG_ADDRESS(meeting.localMixInclude), 0, 0, true, false},
+    {"localMixExclude", CONFIG_STRING, CONFIG_ADDRESS(meeting.localMixExclude), 0, 0, true, false},
+    {"localMixGains", CONFIG_STRING, CONFIG_ADDRESS(meeting.localMixGains), 0, 0, true, false},
+    {"keywordTemplates", CONFIG_STRING, CONFIG_ADDRESS(meeting.keywordTemplates), 0, 0, false, false},
+    {"keywordMaxDistance", CONFIG_UINT, CONFIG_ADDRESS(meeting.keywordMaxDistance), 1, 100, false, false},
+    {"keywordThreads", CONFIG_UINT, CONFIG_ADDRESS(meeting.keywordThreads), 1, 8, false, false},
+    {"utterances", CONFIG_BOOL, CONFIG_ADDRESS(meeting.utterances), 0, 0, false, false},
+    {"utteranceMinSeconds", CONFIG_UINT, CONFIG_ADDRESS(meeting.utteranceMinSeconds), 1, 60, false, false},
+    {"utteranceMaxSeconds", CONFIG_UINT, CONFIG_ADDRESS(meeting.utteranceMaxSeconds), 2, 120, false, false},
+    {"utteranceOverlapMs", CONFIG_UINT, CONFIG_ADDRESS(meeting.utteranceOverlapMs), 0, 5000, false, false},
+    {"utteranceBuffers", CONFIG_UINT, CONFIG_ADDRESS(meeting.utteranceBuffers), 2, 1024, false, false},
+    {"interpreterAudio", CONFIG_BOOL, CONFIG_ADDRESS(meeting.interpreterAudio), 0, 0, false, false},
+    {"gallery", CONFIG_BOOL, CONFIG_ADDRESS(meeting.gallery), 0, 0, false, false},
+    {"galleryTiles", CONFIG_UINT, CONFIG_ADDRESS(meeting.galleryTiles), 1, 49, false, false},
+    {"galleryFps", CONFIG_UINT, CONFIG_ADDRESS(meeting.galleryFps), 1, 30, false, false},
+    {"snapshotIntervalSeconds", CONFIG_UINT, CONFIG_ADDRESS(meeting.snapshotIntervalSeconds), 0, 3600, false, false},
+    {"snapshotWidth", CONFIG_UINT, CONFIG_ADDRESS(meeting.snapshotWidth), 64, 1280, false, false},
+    {"snapshotQuality", CONFIG_UINT, CONFIG_ADDRESS(meeting.snapshotQuality), 10, 95, false, false},
+    {"snapshotParticipants", CONFIG_UINT, CONFIG_ADDRESS(meeting.snapshotParticipants), 1, 512, false, false},
+    {"videoResolution", CONFIG_STRING, CONFIG_ADDRESS(meeting.videoResolution), 0, 0, false, false},
+    {"jitterWindowMs", CONFIG_UINT, CONFIG_ADDRESS(meeting.jitterWindowMs), 0, 2000, true, false},
+    {"audioSlots", CONFIG_UINT, CONFIG_ADDRESS(meeting.audioSlots), 16, 4096, false, false},
+    {"videoSlots", CONFIG_UINT, CONFIG_ADDRESS(meeting.videoSlots), 1, 64, false, false},
+    {"writerBlockKb", CONFIG_UINT, CONFIG_ADDRESS(meeting.writerBlockKb), 16, 4096, false, false},
+    {"writerBlocks", CONFIG_UINT, CONFIG_ADDRESS(meeting.writerBlocks), 2, 256, false, false},
+    {"segmentSeconds", CONFIG_UINT, CONFIG_ADDRESS(meeting.segmentSeconds), 1, 3600, true, false},
+    {"mediaWorkers", CONFIG_UINT, CONFIG_ADDRESS(meeting.mediaWorkers), 0, 256, false, false},
+    {"analyticsIntervalSeconds", CONFIG_UINT, CONFIG_ADDRESS(meeting.analyticsIntervalSeconds), 0, 3600, true, false},
+    {"eventSocket", CONFIG_STRING, CONFIG_ADDRESS(meeting.eventSocket), 0, 0, false, false},
+    {"meetings", CONFIG_STRING, CONFIG_ADDRESS(meetings), 0, 0, false, true},
+    {"warmWorkers", CONFIG_UINT, CONFIG_ADDRESS(warmWorkers), 0, 64, false, false},
+    {"controlSocket", CONFIG_STRING, CONFIG_ADDRESS(controlSocket), 0, 0, false, false},
+    {"shutdownDeadlineMs", CONFIG_UINT, CONFIG_ADDRESS(shutdownDeadlineMs), 0, 600000, true, false},
+    {"metricsIntervalSeconds", CONFIG_UINT, CONFIG_ADDRESS(metricsIntervalSeconds), 0, 3600, true, false},
+    {"configMapDirectory", CONFIG_STRING, CONFIG_ADDRESS(configMapDirectory), 0, 0, false, false},
+    {"threadLayout", CONFIG_STRING, CONFIG_ADDRESS(threadLayout), 0, 0, false, false},
+};
+
+#undef CONFIG_ADDRESS
+
+const size_t kFieldCount = sizeof(kFields) / sizeof(kFields[0]);
+
+const ConfigField *FindField(const std::string &key) {
+    for (size_t i = 0; i < kFieldCount; i++) {
+        if (key == kFields[i].key) {
+            return &kFields[i];
+        }
+    }
+    return nullptr;
+}
+
+std::string Trim(const std::string &text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return std::string();
+    }
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+// "key: value" per line; double quotes around the value are dropped
+void ReadConfigFile(const std::string &path, std::map<std::string, std::string> &values) {
+    std::ifstream file(path.c_str());
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = Trim(line.substr(0, colon));
+        std::string value = Trim(line.substr(colon + 1));
+        if (key.empty() || key[0] == '#') {
+            continue;
+        }
+        std::string unquoted;
+        for (size_t i = 0; i < value.size(); i++) {
+            if (value[i] != '"') {
+                unquoted += value[i];
+            }
+        }
+        values[key] = unquoted;
+    }
+}
+
+// Kubernetes mounts each key as a file, through ..data symlinks that are swapped on update
+void ReadConfigMap(const std::string &directory, std::map<std::string, std::string> &values) {
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.' || !FindField(entry->d_name)) {
+            continue;
+        }
+        std::ifstream file((directory + "/" + entry->d_name).c_str());
+        std::stringstream contents;
+        contents << file.rdbuf();
+        values[entry->d_name] = Trim(contents.str());
+    }
+    closedir(dir);
+}
+
+void ReadEnvironment(std::map<std::string, std::string> &values) {
+    for (size_t i = 0; i < kFieldCount; i++) {
+        const char *value = getenv(ConfigStore::EnvironmentName(kFields[i].key).c_str());
+        if (value) {
+            values[kFields[i].key] = value;
+        }
+    }
+}
+
+bool SetField(BotConfig &config, const ConfigField &field, const std::string &value, std::string &error) {
+    void *address = field.address(config);
+    switch (field.type) {
+    case CONFIG_BOOL:
+        if (value != "true" && value != "false") {
+            error = std::string(field.key) + " must be true or false";
+            return false;
+        }
+        *static_cast<bool *>(address) = value == "true";
+        return true;
+    case CONFIG_UINT: {
+        char *end = nullptr;
+        errno = 0;
+        unsigned long parsed = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || errno != 0 || value[0] == '-') {
+            error = std::string(field.key) + " must be a non-negative integer";
+            return false;
+        }
+        if (parsed < field.min || parsed > field.max) {
+            std::ostringstream message;
+            message << field.key << " must be between " << field.min << " and " << field.max;
+            error = message.str();
+            return false;
+        }
+        *static_cast<unsigned int *>(address) = (unsigned int)parsed;
+        return true;
+    }
+    case CONFIG_STRING:
+        *static_cast<std::string *>(address) = value;
+        return true;
+    }
+    return false;
+}
+
+std::string FormatField(BotConfig &config, const ConfigField &field) {
+    if (field.secret) {
+        return static_cast<std::string *>(field.address(config))->empty() ? "(empty)" : "(set)";
+    }
+    void *address = field.address(config);
+    switch (field.type) {
+    case CONFIG_BOOL:
+        return *static_cast<bool *>(address) ? "true" : "false";
+    case CONFIG_UINT: {
+        std::ostringstream text;
+        text << *static_cast<unsigned int *>(address);
+        return text.str();
+    }
+    case CONFIG_STRING:
+        return *static_cast<std::string *>(address);
+    }
+    return std::string();
+}
+
+bool FieldEquals(BotConfig &a, BotConfig &b, const ConfigField &field) {
+    switch (field.type) {
+    case CONFIG_BOOL:
+        return *static_cast<bool *>(field.address(a)) == *static_cast<bool *>(field.address(b));
+    case CONFIG_UINT:
+        return *static_cast<unsigned int *>(field.address(a)) == *static_cast<unsigned int *>(field.address(b));
+    case CONFIG_STRING:
+        return *static_cast<std::string *>(field.address(a)) == *static_cast<std::string *>(field.address(b));
+    }
+    return true;
+}
+
+void CopyField(BotConfig &to, BotConfig &from, const ConfigField &field) {
+    switch (field.type) {
+    case CONFIG_BOOL:
+        *static_cast<bool *>(field.address(to)) = *static_cast<bool *>(field.address(from));
+        break;
+    case CONFIG_UINT:
+        *static_cast<unsigned int *>(field.address(to)) = *static_cast<unsigned int *>(field.address(from));
+        break;
+    case CONFIG_STRING:
+        *static_cast<std::string *>(field.address(to)) = *static_cast<std::string *>(field.address(from));
+        break;
+    }
+}
+
+// rules that span several keys
+void Validate(const BotConfig &config, std::vector<std::string> &errors) {
+    if (config.token.empty()) {
+        errors.push_back("token is required to authenticate the SDK");
+    }
+    if (config.meeting.meetingNumber.empty() && config.meetings.empty() && config.warmWorkers == 0) {
+        errors.push_back("nothing to join: set meetingNumber, meetings or warmWorkers");
+    }
+    if (!config.meetings.empty() && config.Meetings().empty()) {
+        errors.push_back("meetings has no entry of the form number:password[:recordingToken]");
+    }
+    // the number also names the recording directory, so nothing but digits gets through
+    uint64_t number;
+    if (!config.meeting.meetingNumber.empty() && !ParseMeetingNumber(config.meeting.meetingNumber, number)) {
+        errors.push_back("meetingNumber must be a meeting number of up to 20 digits");
+    }
+    std::vector<MeetingOptions> meetings = config.Meetings();
+    for (size_t i = 0; i < meetings.size(); i++) {
+        if (!ParseMeetingNumber(meetings[i].meetingNumber, number)) {
+            errors.push_back("meetings entry " + meetings[i].meetingNumber + " is not a meeting number");
+        }
+    }
+    AudioOutput audioOutput;
+    if (!AudioOutputFromName(config.meeting.audioOutput, audioOutput)) {
+        errors.push_back("audioOutput must be one of pcm, logmel, both");
+    }
+    float agcTargetLufs;
+    if (!AgcTargetFromName(config.meeting.agcTargetLufs, agcTargetLufs)) {
+        errors.push_back("agcTargetLufs must be off or a loudness from -40 to -10");
+    }
+    SelfAudioMode selfAudio;
+    if (!SelfAudioModeFromName(config.meeting.selfAudioSuppression, selfAudio)) {
+        errors.push_back("selfAudioSuppression must be one of off, subtract, gate");
+    }
+    LocalMixRules localMixRules;
+    if (!LocalMixRulesFromConfig(config.meeting.localMixInclude, config.meeting.localMixExclude,
+                                 config.meeting.localMixGains, localMixRules)) {
+        errors.push_back("localMixGains must be name:dB pairs with gains from -40 to +20");
+    }
+    std::vector<std::pair<std::string, std::string>> keywordTemplates;
+    if (!ParseKeywordTemplates(config.meeting.keywordTemplates, keywordTemplates)) {
+        errors.push_back("keywordTemplates must be keyword=file.wav entries");
+    }
+    if (config.meeting.utteranceMaxSeconds <= config.meeting.utteranceMinSeconds) {
+        errors.push_back("utteranceMaxSeconds must be longer than utteranceMinSeconds");
+    }
+    if (config.meeting.utteranceOverlapMs * 2 > config.meeting.utteranceMinSeconds * 1000) {
+        errors.push_back("utteranceOverlapMs must be at most half of utteranceMinSeconds");
+    }
+    if (config.meeting.eventSocket.size() >= sizeof(((sockaddr_un *)0)->sun_path)) {
+        errors.push_back("eventSocket path is too long for a unix socket");
+    }
+    unsigned int width = 0;
+    unsigned int height = 0;
+    if (!VideoResolutionSize(config.meeting.videoResolution, width, height)) {
+        errors.push_back("videoResolution must be one of 90p, 180p, 360p, 720p, 1080p");
+    } else if ((unsigned long long)config.meeting.writerBlockKb * 1024 * config.meeting.writerBlocks <
+               2ull * width * height * 3 / 2) {
+        // the recorder drops a record it cannot place in free blocks
+        errors.push_back("writerBlockKb * writerBlocks must hold at least two " + config.meeting.videoResolution +
+                         " frames");
+    }
+    if (config.warmWorkers > 0 && config.controlSocket.empty()) {
+        errors.push_back("controlSocket is required with warmWorkers");
+    }
+    std::string layoutError;
+    if (!ThreadPolicy::Validate(config.threadLayout, layoutError)) {
+        errors.push_back("threadLayout " + layoutError);
+    }
+}
+
+} // namespace
+
+BotConfig::BotConfig()
+    : warmWorkers(0), controlSocket("/tmp/zoom-bot.sock"), shutdownDeadlineMs(10000), metricsIntervalSeconds(30),
+      configMapDirectory("/etc/zoom-bot") {}
+
+std::vector<MeetingOptions> BotConfig::Meetings() const {
+    std::vector<MeetingOptions> list;
+    std::stringstream entries(meetings);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        std::stringstream fields(entry);
+        MeetingOptions options = meeting;
+        options.recordingToken.clear();
+        std::getline(fields, options.meetingNumber, ':');
+        std::getline(fields, options.meetingPassword, ':');
+        std::getline(fields, options.recordingToken, ':');
+        if (options.meetingNumber.empty()) {
+            continue;
+        }
+        options.recordingDirectory = "recording/" + options.meetingNumber;
+        list.push_back(options);
+    }
+    return list;
+}
+
+ConfigStore::ConfigStore(const std::string &path)
+    : path_(path), inotifyFd_(-1), inotifySource_(0), reloadTimer_(0), callback_(nullptr),
+      callbackContext_(nullptr), reloads_(0), failedReloads_(0) {
+    Metrics::Instance().AddCollector(&ConfigStore::CollectMetrics, this);
+}
+
+ConfigStore::~ConfigStore() {
+    Metrics::Instance().RemoveCollector(this);
+    if (reloadTimer_) {
+        g_source_remove(reloadTimer_);
+    }
+    if (inotifySource_) {
+        g_source_remove(inotifySource_);
+    }
+    if (inotifyFd_ >= 0) {
+        close(inotifyFd_);
+    }
+}
+
+const ConfigField *ConfigStore::Fields(size_t &count) {
+    count = kFieldCount;
+    return kFields;
+}
+
+std::string ConfigStore::EnvironmentName(const std::string &key) {
+    std::string name = "ZOOM_BOT_";
+    for (size_t i = 0; i < key.size(); i++) {
+        if (isupper((unsigned char)key[i]) && i > 0) {
+            name += '_';
+        }
+        name += (char)toupper((unsigned char)key[i]);
+    }
+    return name;
+}
+
+bool ConfigStore::Read(BotConfig &config, std::vector<std::string> &errors) const {
+    // later sources override earlier ones: defaults, config.txt, ConfigMap, environment
+    std::map<std::string, std::string> values;
+    ReadConfigFile(path_, values);
+    std::map<std::string, std::string> environment;
+    ReadEnvironment(environment);
+
+    std::string directory = config.configMapDirectory;
+    if (environment.count("configMapDirectory")) {
+        directory = environment["configMapDirectory"];
+    } else if (values.count("configMapDirectory")) {
+        directory = values["configMapDirectory"];
+    }
+    if (!directory.empty()) {
+        ReadConfigMap(directory, values);
+    }
+    for (std::map<std::string, std::string>::iterator it = environment.begin(); it != environment.end(); ++it) {
+        values[it->first] = it->second;
+    }
+
+    for (std::map<std::string, std::string>::iterator it = values.begin(); it != values.end(); ++it) {
+        const ConfigField *field = FindField(it->first);
+        if (!field) {
+            std::cerr << "ConfigStore: ignoring unknown key " << it->first << std::endl;
+            continue;
+        }
+        std::string error;
+        if (!SetField(config, *field, it->second, error)) {
+            errors.push_back(error);
+        }
+    }
+    Validate(config, errors);
+    return errors.empty();
+}
+
+bool ConfigStore::Load() {
+    BotConfig config;
+    std::vector<std::string> errors;
+    if (!Read(config, errors)) {
+        for (size_t i = 0; i < errors.size(); i++) {
+            std::cerr << "ConfigStore: " << errors[i] << std::endl;
+        }
+        return false;
+    }
+    current_ = config;
+    for (size_t i = 0; i < kFieldCount; i++) {
+        std::cout << kFields[i].key << ": " << FormatField(current_, kFields[i]) << std::endl;
+    }
+    return true;
+}
+
+bool ConfigStore::Reload() {
+    BotConfig config;
+    std::vector<std::string> errors;
+    if (!Read(config, errors)) {
+        failedReloads_++;
+        for (size_t i = 0; i < errors.size(); i++) {
+            std::cerr << "ConfigStore: reload rejected: " << errors[i] << std::endl;
+        }
+        return false;
+    }
+
+    bool applied = false;
+    for (size_t i = 0; i < kFieldCount; i++) {
+        const ConfigField &field = kFields[i];
+        if (FieldEquals(current_, config, field)) {
+            continue;
+        }
+        if (!field.reloadable) {
+            std::cout << "ConfigStore: " << field.key << " changed; it takes effect after a restart" << std::endl;
+            continue;
+        }
+        std::cout << "ConfigStore: " << field.key << ": " << FormatField(current_, field) << " -> "
+                  << FormatField(config, field) << std::endl;
+        CopyField(current_, config, field);
+        applied = true;
+    }
+    reloads_++;
+    if (applied && callback_) {
+        callback_(current_, callbackContext_);
+    }
+    return true;
+}
+
+void ConfigStore::Watch(ReloadCallback callback, void *context) {
+    callback_ = callback;
+    callbackContext_ = context;
+    if (inotifyFd_ >= 0) {
+        return;
+    }
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        std::cerr << "ConfigStore: inotify unavailable: " << strerror(errno) << std::endl;
+        return;
+    }
+    // watch directories, not files: editors and kubelet replace files by renaming over them
+    size_t slash = path_.rfind('/');
+    AddWatch(slash == std::string::npos ? "." : path_.substr(0, slash));
+    if (!current_.configMapDirectory.empty()) {
+        AddWatch(current_.configMapDirectory);
+    }
+    inotifySource_ = g_unix_fd_add(inotifyFd_, G_IO_IN, &ConfigStore::HandleInotify, this);
+
+    // a process forked from a long-running supervisor may have missed earlier changes
+    Reload();
+}
+
+void ConfigStore::AddWatch(const std::string &directory) {
+    int wd = inotify_add_watch(inotifyFd_, directory.c_str(),
+                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+    if (wd < 0) {
+        // a ConfigMap is optional
+        if (errno != ENOENT) {
+            std::cerr << "ConfigStore: cannot watch " << directory << ": " << strerror(errno) << std::endl;
+        }
+        return;
+    }
+    watches_[wd] = directory;
+}
+
+gboolean ConfigStore::HandleInotify(gint fd, GIOCondition condition, gpointer data) {
+    ConfigStore *self = static_cast<ConfigStore *>(data);
+    size_t slash = self->path_.rfind('/');
+    std::string fileName = slash == std::string::npos ? self->path_ : self->path_.substr(slash + 1);
+
+    bool relevant = false;
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char *next = buffer; next < buffer + length;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(next);
+            next += sizeof(struct inotify_event) + event->len;
+            std::map<int, std::string>::iterator watch = self->watches_.find(event->wd);
+            if (watch == self->watches_.end() || event->len == 0) {
+                continue;
+            }
+            // the directory of config.txt may hold other files; every ConfigMap change counts
+            if (watch->second == self->current_.configMapDirectory || fileName == event->name) {
+                relevant = true;
+            }
+        }
+    }
+    if (relevant) {
+        if (self->reloadTimer_) {
+            g_source_remove(self->reloadTimer_);
+        }
+        self->reloadTimer_ = g_timeout_add(kReloadDelayMs, &ConfigStore::HandleReloadTimeout, self);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean ConfigStore::HandleReloadTimeout(gpointer data) {
+    ConfigStore *self = static_cast<ConfigStore *>(data);
+    self->reloadTimer_ = 0;
+    self->Reload();
+    return G_SOURCE_REMOVE;
+}
+
+void ConfigStore::CollectMetrics(MetricsWriter &writer, void *context) {
+    ConfigStore *self = static_cast<ConfigStore *>(context);
+    writer.Write("zoom_bot_config_reloads_total", (double)self->reloads_);
+    writer.Write("zoom_bot_config_reload_failures_total", (double)self->failedReloads_);
+}
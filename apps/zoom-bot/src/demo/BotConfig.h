@@ -0,0 +1,111 @@
+// Typed configuration merged from config.txt, a ConfigMap mount and the environment
+#pragma once
+
+#include <glib.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "MeetingSession.h"
+#include "Metrics.h"
+
+// Settings of the process. The meeting fields are the template for every meeting the pod
+// joins; the pipeline knobs among them are read when a MeetingSession is created.
+struct BotConfig {
+    // JWT used to authenticate the SDK
+    std::string token;
+    MeetingOptions meeting;
+    // several meetings per pod: "number:password[:recordingToken],number:password"
+    std::string meetings;
+    // warm workers kept initialized and authenticated by the supervisor, 0 to disable
+    unsigned int warmWorkers;
+    // where the supervisor accepts JOIN and STATUS commands when warmWorkers is set
+    std::string controlSocket;
+    // how long a stop signal may spend writing out buffered media before the bot leaves anyway
+    unsigned int shutdownDeadlineMs;
+    // interval between metrics dumps to stdout, 0 to disable
+    unsigned int metricsIntervalSeconds;
+    // one file per key, as Kubernetes mounts a ConfigMap; skipped if missing
+    std::string configMapDirectory;
+    // CPUs and scheduling of the media threads, see ThreadPolicy; empty to leave them alone
+    std::string threadLayout;
+
+    BotConfig();
+
+    /// \brief The entries of meetings, each based on meeting.
+    std::vector<MeetingOptions> Meetings() const;
+};
+
+enum ConfigValueType {
+    CONFIG_BOOL,
+    CONFIG_UINT,
+    CONFIG_STRING,
+};
+
+// One key of the schema. The same key is read from config.txt, from a file of that name in
+// the ConfigMap directory and from ZOOM_BOT_<KEY IN UPPER SNAKE CASE>, in that order.
+struct ConfigField {
+    const char *key;
+    ConfigValueType type;
+    // where the value lives in a BotConfig
+    void *(*address)(BotConfig &config);
+    // inclusive range of a CONFIG_UINT
+    unsigned int min;
+    unsigned int max;
+    // applied to a running meeting on reload; other keys wait for the next restart
+    bool reloadable;
+    // never logged
+    bool secret;
+};
+
+// Loads and validates the configuration and, once Watch is called, reloads it when
+// config.txt or the ConfigMap changes. Everything runs on the main loop; a reload that
+// fails validation is logged and leaves the current configuration untouched.
+class ConfigStore {
+public:
+    typedef void (*ReloadCallback)(const BotConfig &config, void *context);
+
+    /// \param path config.txt; a missing file is the same as an empty one.
+    explicit ConfigStore(const std::string &path);
+    ~ConfigStore();
+
+    /// \brief Read every source and replace the configuration if it validates.
+    /// \return false with the problems logged otherwise.
+    bool Load();
+
+    const BotConfig &Current() const { return current_; }
+
+    /// \brief Watch the sources with inotify and reload after they change. Changed
+    /// reloadable keys are applied and passed to callback; others are reported only.
+    void Watch(ReloadCallback callback, void *context);
+
+    /// \brief Read the sources again and apply what may change while in a meeting.
+    /// \return false if the new configuration did not validate.
+    bool Reload();
+
+    /// \brief The schema, for documentation and tests.
+    static const ConfigField *Fields(size_t &count);
+
+    /// \brief The environment variable that overrides key, e.g. ZOOM_BOT_MEETING_NUMBER.
+    static std::string EnvironmentName(const std::string &key);
+
+private:
+    bool Read(BotConfig &config, std::vector<std::string> &errors) const;
+    void AddWatch(const std::string &directory);
+    static gboolean HandleInotify(gint fd, GIOCondition condition, gpointer data);
+    static gboolean HandleReloadTimeout(gpointer data);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    std::string path_;
+    BotConfig current_;
+
+    int inotifyFd_;
+    guint inotifySource_;
+    guint reloadTimer_;
+    std::map<int, std::string> watches_;
+    ReloadCallback callback_;
+    void *callbackContext_;
+
+    unsigned long long reloads_;
+    unsigned long long failedReloads_;
+};
@@ -0,0 +1,180 @@
+// Structured events the bot emits about a meeting, one JSON object per line
+
+#include "BotEventChannel.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void AppendJsonString(std::string &out, const std::string &value) {
+    out += '"';
+    for (size_t i = 0; i < value.size(); i++) {
+        unsigned char c = (unsigned char)value[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+BotEvent::BotEvent(const char *type) {
+    long long wallTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    body_ = "{\"type\": ";
+    AppendJsonString(body_, type);
+    body_ += ", \"wallTimeMs\": " + std::to_string(wallTimeMs);
+}
+
+void BotEvent::Key(const char *key) {
+    body_ += ", ";
+    AppendJsonString(body_, key);
+    body_ += ": ";
+}
+
+BotEvent &BotEvent::Add(const char *key, const std::string &value) {
+    Key(key);
+    AppendJsonString(body_, value);
+    return *this;
+}
+
+BotEvent &BotEvent::Add(const char *key, const char *value) {
+    return Add(key, std::string(value ? value : ""));
+}
+
+BotEvent &BotEvent::Add(const char *key, long long value) {
+    Key(key);
+    body_ += std::to_string(value);
+    return *this;
+}
+
+BotEvent &BotEvent::Add(const char *key, unsigned long long value) {
+    Key(key);
+    body_ += std::to_string(value);
+    return *this;
+}
+
+BotEvent &BotEvent::Add(const char *key, double value) {
+    Key(key);
+    if (std::isfinite(value)) {
+        char number[32];
+        snprintf(number, sizeof(number), "%.6g", value);
+        body_ += number;
+    } else {
+        body_ += "null";
+    }
+    return *this;
+}
+
+BotEvent &BotEvent::Add(const char *key, bool value) {
+    Key(key);
+    body_ += value ? "true" : "false";
+    return *this;
+}
+
+BotEvent &BotEvent::AddRaw(const char *key, const std::string &json) {
+    Key(key);
+    body_ += json;
+    return *this;
+}
+
+std::string BotEvent::Line() const {
+    return body_ + "}\n";
+}
+
+BotEventChannel::BotEventChannel() : fileFd_(-1), socketFd_(-1), emitted_(0), undelivered_(0) {
+    Metrics::Instance().AddCollector(&BotEventChannel::CollectMetrics, this);
+}
+
+BotEventChannel::~BotEventChannel() {
+    Close();
+    Metrics::Instance().RemoveCollector(this);
+}
+
+bool BotEventChannel::Open(const std::string &path, const std::string &socketPath) {
+    Close();
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool ok = true;
+    if (!path.empty()) {
+        // O_APPEND keeps each line whole even if a restarted worker appends to the same file
+        fileFd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fileFd_ < 0) {
+            std::cerr << "BotEventChannel: cannot open " << path << ": " << strerror(errno) << std::endl;
+            ok = false;
+        }
+    }
+    if (!socketPath.empty()) {
+        if (socketPath.size() >= sizeof(((sockaddr_un *)0)->sun_path)) {
+            std::cerr << "BotEventChannel: socket path too long: " << socketPath << std::endl;
+            return false;
+        }
+        socketFd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (socketFd_ < 0) {
+            std::cerr << "BotEventChannel: socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+        socketPath_ = socketPath;
+    }
+    return ok;
+}
+
+void BotEventChannel::Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fileFd_ >= 0) {
+        close(fileFd_);
+        fileFd_ = -1;
+    }
+    if (socketFd_ >= 0) {
+        close(socketFd_);
+        socketFd_ = -1;
+    }
+}
+
+void BotEventChannel::Emit(const BotEvent &event) {
+    std::string line = event.Line();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fileFd_ >= 0) {
+        size_t written = 0;
+        while (written < line.size()) {
+            ssize_t n = write(fileFd_, line.data() + written, line.size() - written);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            written += (size_t)n;
+        }
+    }
+    if (socketFd_ >= 0) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, socketPath_.c_str(), socketPath_.size());
+        // one datagram per event; the consumer sees whole lines or nothing
+        if (sendto(socketFd_, line.data(), line.size(), MSG_DONTWAIT, (sockaddr *)&address, sizeof(address)) < 0) {
+            undelivered_++;
+        }
+    }
+    emitted_++;
+}
+
+void BotEventChannel::CollectMetrics(MetricsWriter &writer, void *context) {
+    BotEventChannel *self = static_cast<BotEventChannel *>(context);
+    writer.Write("zoom_bot_events_total", self->emitted_.load());
+    writer.Write("zoom_bot_events_undelivered_total", self->undelivered_.load());
+}
@@ -0,0 +1,63 @@
+// Structured events the bot emits about a meeting, one JSON object per line
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "Metrics.h"
+
+// Builds one event line: {"type": "...", "wallTimeMs": ..., <fields in the order added>}.
+class BotEvent {
+public:
+    explicit BotEvent(const char *type);
+
+    BotEvent &Add(const char *key, const std::string &value);
+    BotEvent &Add(const char *key, const char *value);
+    BotEvent &Add(const char *key, long long value);
+    BotEvent &Add(const char *key, unsigned long long value);
+    BotEvent &Add(const char *key, unsigned int value) { return Add(key, (unsigned long long)value); }
+    BotEvent &Add(const char *key, int value) { return Add(key, (long long)value); }
+    BotEvent &Add(const char *key, double value);
+    BotEvent &Add(const char *key, bool value);
+    /// \brief Add a value that is already JSON, such as an array built with AppendJsonString.
+    BotEvent &AddRaw(const char *key, const std::string &json);
+
+    /// \brief The event with its closing brace and newline.
+    std::string Line() const;
+
+private:
+    void Key(const char *key);
+
+    std::string body_;
+};
+
+/// \brief Append value to out as a quoted, escaped JSON string.
+void AppendJsonString(std::string &out, const std::string &value);
+
+// Delivers events to the meeting's events.jsonl and, if configured, as datagrams to a unix
+// socket where a local consumer listens. Emit is safe from any thread and never blocks on
+// the consumer: a datagram nobody can take (no listener, full queue) is counted and lost,
+// while the file keeps every event.
+class BotEventChannel {
+public:
+    BotEventChannel();
+    ~BotEventChannel();
+
+    /// \param path File events are appended to, "" for none.
+    /// \param socketPath Unix datagram socket to send events to, "" for none.
+    bool Open(const std::string &path, const std::string &socketPath);
+    void Close();
+
+    void Emit(const BotEvent &event);
+
+private:
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    std::mutex mutex_;
+    int fileFd_;
+    int socketFd_;
+    std::string socketPath_;
+    std::atomic<unsigned long long> emitted_;
+    std::atomic<unsigned long long> undelivered_;
+};
@@ -0,0 +1,91 @@
+// Line protocol between the supervisor, its warm workers and control clients
+
+#include "ControlProtocol.h"
+
+#include <cerrno>
+#include <sstream>
+#include <unistd.h>
+
+namespace ControlProtocol {
+
+bool ParseJoin(const std::string &line, MeetingOptions &options, std::string &error) {
+    std::istringstream fields(line);
+    std::string command;
+    std::string password;
+    std::string recordingToken;
+    if (!(fields >> command >> options.meetingNumber >> password) || command != "JOIN") {
+        error = "usage: JOIN <meeting number> <password> [recording token]";
+        return false;
+    }
+    // checked here so a bad number is answered on the control socket instead of reaching a
+    // warm worker, which would fail to join it
+    uint64_t number = 0;
+    if (!ParseMeetingNumber(options.meetingNumber, number)) {
+        error = "invalid meeting number";
+        return false;
+    }
+    fields >> recordingToken;
+    options.meetingPassword = password == "-" ? "" : password;
+    options.recordingToken = recordingToken;
+    return true;
+}
+
+std::string FormatJoin(const MeetingOptions &options) {
+    std::string line = "JOIN " + options.meetingNumber + " ";
+    line += options.meetingPassword.empty() ? "-" : options.meetingPassword;
+    if (!options.recordingToken.empty()) {
+        line += " " + options.recordingToken;
+    }
+    return line + "\n";
+}
+
+bool Send(int fd, const std::string &message) {
+    size_t sent = 0;
+    while (sent < message.size()) {
+        ssize_t written = write(fd, message.data() + sent, message.size() - sent);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += (size_t)written;
+    }
+    return true;
+}
+
+} // namespace ControlProtocol
+
+bool LineBuffer::ReadFrom(int fd) {
+    char buffer[512];
+    while (true) {
+        ssize_t received = read(fd, buffer, sizeof(buffer));
+        if (received > 0) {
+            pending_.append(buffer, (size_t)received);
+            if (pending_.size() > kMaxLineLength && pending_.find('\n') == std::string::npos) {
+                return false;
+            }
+            continue;
+        }
+        if (received == 0) {
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+bool LineBuffer::NextLine(std::string &line) {
+    size_t end = pending_.find('\n');
+    if (end == std::string::npos) {
+        return false;
+    }
+    line.assign(pending_, 0, end);
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+        line.erase(line.size() - 1);
+    }
+    pending_.erase(0, end + 1);
+    return true;
+}
@@ -0,0 +1,46 @@
+// Line protocol between the supervisor, its warm workers and control clients
+#pragma once
+
+#include <string>
+
+#include "MeetingSession.h"
+
+// Every message is one line of space-separated fields.
+//
+// client -> supervisor:  JOIN <meeting number> <password> [recording token]
+//                        STATUS
+// supervisor -> client:  OK <worker pid> | ERR <reason> | STATUS ... (one line)
+// supervisor -> worker:  JOIN <meeting number> <password> [recording token]
+// worker -> supervisor:  READY        SDK initialized and authenticated
+//                        FIRST_AUDIO  the assigned meeting delivered its first audio
+//
+// An empty password is sent as "-".
+namespace ControlProtocol {
+
+/// \brief Fill the meeting number, password and recording token from a JOIN line.
+/// \param error Why the line was rejected, for the ERR reply.
+bool ParseJoin(const std::string &line, MeetingOptions &options, std::string &error);
+
+/// \brief The JOIN line for options, including the trailing newline.
+std::string FormatJoin(const MeetingOptions &options);
+
+/// \brief Write a whole message, retrying on EINTR.
+bool Send(int fd, const std::string &message);
+
+} // namespace ControlProtocol
+
+// Accumulates bytes from a non-blocking descriptor and splits them into lines.
+class LineBuffer {
+public:
+    /// \brief Read what is available.
+    /// \return false once the peer closed the connection or the line grew too long.
+    bool ReadFrom(int fd);
+
+    /// \brief Take the next complete line without its newline.
+    bool NextLine(std::string &line);
+
+private:
+    static const size_t kMaxLineLength = 4096;
+
+    std::string pending_;
+};
@@ -0,0 +1,300 @@
+// Composes participant video into one gallery-view I420 stream
+
+#include "GalleryCompositor.h"
+#include "SimdKernels.h"
+#include "ThreadPolicy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// limited-range black for the background, dark grey for someone who has sent no video yet
+const uint8_t kBackgroundLuma = 16;
+const uint8_t kPlaceholderLuma = 48;
+const uint8_t kNeutralChroma = 128;
+// pixels of background around each tile
+const unsigned int kTileInset = 2;
+long long SteadyMs(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+// needs a definition: the constructor clamps to it with std::min
+const unsigned int GalleryCompositor::kMaxTiles;
+
+GalleryCompositor::GalleryCompositor(unsigned int width, unsigned int height, unsigned int tiles, unsigned int fps,
+                                     size_t maxSourceFrameBytes)
+    : width_(width & ~1u), height_(height & ~1u), tileCount_(std::min(tiles, kMaxTiles)),
+      interval_(1000000 / std::max(fps, 1u)), maxSourceFrameBytes_(maxSourceFrameBytes), synchronizer_(nullptr),
+      layoutCount_(0), clockOffsetMs_(0), clockKnown_(false), lastTimestampMs_(0), stopping_(false),
+      framesComposed_(0), lateTicks_(0), droppedFrames_(0), maxComposeUs_(0) {
+    if (tileCount_ == 0) {
+        return;
+    }
+    // three frames per tile: one the renderer fills, one published, one on screen
+    tiles_.reset(new Tile[tileCount_]);
+    frameStorage_.reset(new uint8_t[tileCount_ * 3 * maxSourceFrameBytes_]);
+    for (unsigned int i = 0; i < tileCount_; i++) {
+        Tile &tile = tiles_[i];
+        tile.userId.store(0, std::memory_order_relaxed);
+        tile.back = 0;
+        tile.ready.store(1, std::memory_order_relaxed);
+        tile.front = 2;
+        tile.shown = 0;
+        tile.dirty = true;
+        tile.cell = Rect();
+        tile.drawn = Rect();
+        for (unsigned int f = 0; f < 3; f++) {
+            tile.frames[f].userId = 0;
+            tile.frames[f].width = 0;
+            tile.frames[f].height = 0;
+            tile.frames[f].data = frameStorage_.get() + (i * 3 + f) * maxSourceFrameBytes_;
+        }
+    }
+    size_t canvasBytes = (size_t)width_ * height_ * 3 / 2;
+    canvas_.reset(new uint8_t[canvasBytes]);
+    memset(canvas_.get(), kBackgroundLuma, (size_t)width_ * height_);
+    memset(canvas_.get() + (size_t)width_ * height_, kNeutralChroma, canvasBytes - (size_t)width_ * height_);
+    rowSums_.resize(width_);
+    columns_.resize(width_ + 1);
+}
+
+GalleryCompositor::~GalleryCompositor() {
+    Stop();
+}
+
+void GalleryCompositor::Start(MediaSynchronizer *synchronizer) {
+    if (tileCount_ == 0 || thread_.joinable()) {
+        return;
+    }
+    synchronizer_ = synchronizer;
+    Metrics::Instance().AddCollector(&GalleryCompositor::CollectMetrics, this);
+    thread_ = std::thread(&GalleryCompositor::Run, this);
+}
+
+void GalleryCompositor::Stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        wake_.notify_one();
+    }
+    thread_.join();
+    Metrics::Instance().RemoveCollector(this);
+}
+
+void GalleryCompositor::SetTile(unsigned int tile, uint32_t userId) {
+    if (tile < tileCount_) {
+        tiles_[tile].userId.store(userId, std::memory_order_release);
+    }
+}
+
+void GalleryCompositor::PushFrame(unsigned int tile, uint32_t userId, YUVRawDataI420 *frame) {
+    if (tile >= tileCount_ || !frame || userId == 0) {
+        return;
+    }
+    Tile &target = tiles_[tile];
+    if (target.userId.load(std::memory_order_acquire) != userId) {
+        return;
+    }
+    unsigned int width = frame->GetStreamWidth();
+    unsigned int height = frame->GetStreamHeight();
+    size_t ySize = (size_t)width * height;
+    if (!frame->GetYBuffer() || !frame->GetUBuffer() || !frame->GetVBuffer() || width == 0 || height == 0 ||
+        width % 2 != 0 || height % 2 != 0 || ySize * 3 / 2 > maxSourceFrameBytes_) {
+        droppedFrames_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Frame &back = target.frames[target.back];
+    memcpy(back.data, frame->GetYBuffer(), ySize);
+    memcpy(back.data + ySize, frame->GetUBuffer(), ySize / 4);
+    memcpy(back.data + ySize + ySize / 4, frame->GetVBuffer(), ySize / 4);
+    back.userId = userId;
+    back.width = width;
+    back.height = height;
+    target.back = target.ready.exchange(target.back | kFreshFrame, std::memory_order_acq_rel) & ~kFreshFrame;
+
+    clockOffsetMs_.store((long long)frame->GetTimeStamp() - SteadyMs(std::chrono::steady_clock::now()),
+                         std::memory_order_relaxed);
+    clockKnown_.store(true, std::memory_order_release);
+}
+
+void GalleryCompositor::Run() {
+    ThreadPolicy::Instance().Apply(THREAD_ROLE_VIDEO, "zb-gallery");
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        next += interval_;
+        if (wake_.wait_until(lock, next, [this] { return stopping_; })) {
+            return;
+        }
+        lock.unlock();
+
+        // nothing is stamped before the first frame tells what time it is in the meeting
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        if (clockKnown_.load(std::memory_order_acquire)) {
+            Compose();
+            long long timestampMs = SteadyMs(begin) + clockOffsetMs_.load(std::memory_order_relaxed);
+            unsigned long long stamped = std::max((unsigned long long)std::max(timestampMs, 0LL), lastTimestampMs_ + 1);
+            lastTimestampMs_ = stamped;
+            synchronizer_->PushVideo(kGalleryVideoStreamId, canvas_.get(), width_, height_, stamped);
+            framesComposed_.fetch_add(1, std::memory_order_relaxed);
+            unsigned long long composeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                               std::chrono::steady_clock::now() - begin)
+                                               .count();
+            if (composeUs > maxComposeUs_.load(std::memory_order_relaxed)) {
+                maxComposeUs_.store(composeUs, std::memory_order_relaxed);
+            }
+        }
+
+        lock.lock();
+        // a frame that took too long skips ticks rather than composing a burst to catch up
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= next + interval_) {
+            unsigned long long skipped = (unsigned long long)((now - next) / interval_);
+            lateTicks_.fetch_add(skipped, std::memory_order_relaxed);
+            next += interval_ * skipped;
+        }
+    }
+}
+
+void GalleryCompositor::Compose() {
+    unsigned int shown[kMaxTiles];
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < tileCount_; i++) {
+        Tile &tile = tiles_[i];
+        uint32_t userId = tile.userId.load(std::memory_order_acquire);
+        if (userId != tile.shown) {
+            tile.shown = userId;
+            tile.dirty = true;
+        }
+        if (userId != 0) {
+            shown[count++] = i;
+        }
+    }
+    if (count != layoutCount_) {
+        layoutCount_ = count;
+        Fill(Rect{0, 0, width_, height_}, kBackgroundLuma);
+        for (unsigned int i = 0; i < tileCount_; i++) {
+            tiles_[i].dirty = true;
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // the smallest near-square grid; a short last row is centred
+    unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)count));
+    unsigned int rows = (count + columns - 1) / columns;
+    unsigned int cellWidth = (width_ / columns) & ~1u;
+    unsigned int cellHeight = (height_ / rows) & ~1u;
+    unsigned int left = ((width_ - columns * cellWidth) / 2) & ~1u;
+    unsigned int top = ((height_ - rows * cellHeight) / 2) & ~1u;
+    unsigned int lastRowTiles = count - (rows - 1) * columns;
+    unsigned int lastRowLeft = left + (((columns - lastRowTiles) * cellWidth / 2) & ~1u);
+    unsigned int inset = cellWidth > kTileInset * 4 && cellHeight > kTileInset * 4 ? kTileInset : 0;
+
+    for (unsigned int slot = 0; slot < count; slot++) {
+        Tile &tile = tiles_[shown[slot]];
+        unsigned int row = slot / columns;
+        Rect cell;
+        cell.x = (row == rows - 1 ? lastRowLeft : left) + (slot % columns) * cellWidth + inset;
+        cell.y = top + row * cellHeight + inset;
+        cell.width = cellWidth - inset * 2;
+        cell.height = cellHeight - inset * 2;
+        if (cell.x != tile.cell.x || cell.y != tile.cell.y || cell.width != tile.cell.width ||
+            cell.height != tile.cell.height) {
+            tile.cell = cell;
+            tile.dirty = true;
+        }
+
+        bool fresh = false;
+        if (tile.ready.load(std::memory_order_acquire) & kFreshFrame) {
+            tile.front = tile.ready.exchange(tile.front, std::memory_order_acq_rel) & ~kFreshFrame;
+            fresh = true;
+        }
+        DrawTile(tile, cell, fresh);
+    }
+}
+
+void GalleryCompositor::DrawTile(Tile &tile, const Rect &cell, bool fresh) {
+    const Frame &frame = tile.frames[tile.front];
+    if (frame.userId != tile.shown || frame.width == 0) {
+        // nothing from this participant yet
+        if (tile.dirty) {
+            Fill(cell, kPlaceholderLuma);
+            tile.drawn = cell;
+            tile.dirty = false;
+        }
+        return;
+    }
+    if (!fresh && !tile.dirty) {
+        // stalled: what is on the canvas is their last frame
+        return;
+    }
+
+    // fit the frame into the cell, keeping its aspect ratio
+    Rect fit;
+    if ((unsigned long long)frame.width * cell.height > (unsigned long long)frame.height * cell.width) {
+        fit.width = cell.width;
+        fit.height = (unsigned int)((unsigned long long)frame.height * cell.width / frame.width);
+    } else {
+        fit.height = cell.height;
+        fit.width = (unsigned int)((unsigned long long)frame.width * cell.height / frame.height);
+    }
+    fit.width = std::max(fit.width & ~1u, 2u);
+    fit.height = std::max(fit.height & ~1u, 2u);
+    fit.x = cell.x + (((cell.width - fit.width) / 2) & ~1u);
+    fit.y = cell.y + (((cell.height - fit.height) / 2) & ~1u);
+    if (tile.dirty || fit.x != tile.drawn.x || fit.y != tile.drawn.y || fit.width != tile.drawn.width ||
+        fit.height != tile.drawn.height) {
+        // clear what the previous frame or the placeholder left around the new one
+        Fill(cell, kBackgroundLuma);
+    }
+
+    if (rowSums_.size() < frame.width) {
+        rowSums_.resize(frame.width);
+    }
+    size_t ySize = (size_t)frame.width * frame.height;
+    size_t canvasY = (size_t)width_ * height_;
+    unsigned int chromaStride = width_ / 2;
+    size_t chromaOffset = (size_t)(fit.y / 2) * chromaStride + fit.x / 2;
+    SimdKernels::ScalePlaneBox(frame.data, frame.width, frame.height, frame.width,
+                               canvas_.get() + (size_t)fit.y * width_ + fit.x, width_, fit.width, fit.height,
+                               rowSums_.data(), columns_.data());
+    SimdKernels::ScalePlaneBox(frame.data + ySize, frame.width / 2, frame.height / 2, frame.width / 2,
+                               canvas_.get() + canvasY + chromaOffset, chromaStride, fit.width / 2, fit.height / 2,
+                               rowSums_.data(), columns_.data());
+    SimdKernels::ScalePlaneBox(frame.data + ySize + ySize / 4, frame.width / 2, frame.height / 2, frame.width / 2,
+                               canvas_.get() + canvasY + canvasY / 4 + chromaOffset, chromaStride, fit.width / 2,
+                               fit.height / 2, rowSums_.data(), columns_.data());
+    tile.drawn = fit;
+    tile.dirty = false;
+}
+
+void GalleryCompositor::Fill(const Rect &rect, uint8_t luma) {
+    for (unsigned int y = 0; y < rect.height; y++) {
+        memset(canvas_.get() + (size_t)(rect.y + y) * width_ + rect.x, luma, rect.width);
+    }
+    size_t canvasY = (size_t)width_ * height_;
+    unsigned int chromaStride = width_ / 2;
+    for (unsigned int y = 0; y < rect.height / 2; y++) {
+        size_t offset = (size_t)(rect.y / 2 + y) * chromaStride + rect.x / 2;
+        memset(canvas_.get() + canvasY + offset, kNeutralChroma, rect.width / 2);
+        memset(canvas_.get() + canvasY + canvasY / 4 + offset, kNeutralChroma, rect.width / 2);
+    }
+}
+
+void GalleryCompositor::CollectMetrics(MetricsWriter &writer, void *context) {
+    GalleryCompositor *self = static_cast<GalleryCompositor *>(context);
+    writer.Write("zoom_bot_gallery_frames_total", self->framesComposed_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_gallery_late_ticks_total", self->lateTicks_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_gallery_dropped_frames_total", self->droppedFrames_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_gallery_compose_max_us", self->maxComposeUs_.load(std::memory_order_relaxed));
+}
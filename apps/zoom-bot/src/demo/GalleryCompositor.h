@@ -0,0 +1,127 @@
+// Composes participant video into one gallery-view I420 stream
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "zoom_sdk_raw_data_def.h"
+
+#include "MediaSynchronizer.h"
+#include "Metrics.h"
+
+// stream id of the gallery in the recording; it does not collide with user ids
+const uint32_t kGalleryVideoStreamId = 0xFFFFFFFCu;
+
+// Composes the latest frame of every participant shown into one width x height I420 grid and
+// queues it on the synchronizer as kGalleryVideoStreamId at a fixed frame rate. Each tile is
+// fed by a renderer of its own. The grid is as small as the number of participants shown
+// allows, and every frame is box-filtered into its tile keeping its aspect ratio. A tile is
+// only redrawn when its participant sends a new frame or the layout changes, so a stalled
+// participant keeps their last frame. Renderers hand frames over through a triple buffer per
+// tile and never wait for the compositor; one thread does all the scaling and composing.
+class GalleryCompositor {
+public:
+    static const unsigned int kMaxTiles = 49;
+
+    /// \param tiles Participants shown at most, 0 to leave the compositor unused.
+    /// \param maxSourceFrameBytes Largest I420 frame a renderer delivers; larger ones are dropped.
+    GalleryCompositor(unsigned int width, unsigned int height, unsigned int tiles, unsigned int fps,
+                      size_t maxSourceFrameBytes);
+    ~GalleryCompositor();
+
+    /// \brief Start composing onto synchronizer.
+    void Start(MediaSynchronizer *synchronizer);
+
+    /// \brief Stop the thread; nothing is queued on the synchronizer after it returns.
+    void Stop();
+
+    /// \brief Show userId in tile, or empty the tile with 0. Frames of anyone else are ignored.
+    void SetTile(unsigned int tile, uint32_t userId);
+
+    /// \brief Hand over the current frame of the participant shown in tile; renderer threads.
+    void PushFrame(unsigned int tile, uint32_t userId, YUVRawDataI420 *frame);
+
+    unsigned int Tiles() const { return tileCount_; }
+    unsigned long long FramesComposed() const { return framesComposed_.load(std::memory_order_relaxed); }
+    unsigned long long LateTicks() const { return lateTicks_.load(std::memory_order_relaxed); }
+    /// \brief Longest time one frame took to compose so far.
+    unsigned long long MaxComposeUs() const { return maxComposeUs_.load(std::memory_order_relaxed); }
+
+private:
+    struct Rect {
+        unsigned int x;
+        unsigned int y;
+        unsigned int width;
+        unsigned int height;
+    };
+
+    struct Frame {
+        uint32_t userId;
+        unsigned int width;
+        unsigned int height;
+        uint8_t *data;
+    };
+
+    struct Tile {
+        // 0 while the tile is empty
+        std::atomic<uint32_t> userId;
+        // the buffer last published by the renderer, with kFreshFrame until the thread takes it
+        std::atomic<uint32_t> ready;
+        // owned by the renderer
+        uint32_t back;
+        // owned by the thread: the frame on screen, who and where the tile was last composed,
+        // the area its frame covers, and whether it must be redrawn
+        uint32_t front;
+        uint32_t shown;
+        Rect cell;
+        Rect drawn;
+        bool dirty;
+        Frame frames[3];
+    };
+
+    static const uint32_t kFreshFrame = 4;
+
+    void Run();
+    void Compose();
+    void DrawTile(Tile &tile, const Rect &cell, bool fresh);
+    void Fill(const Rect &rect, uint8_t luma);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    unsigned int width_;
+    unsigned int height_;
+    unsigned int tileCount_;
+    std::chrono::microseconds interval_;
+    size_t maxSourceFrameBytes_;
+    MediaSynchronizer *synchronizer_;
+
+    std::unique_ptr<Tile[]> tiles_;
+    std::unique_ptr<uint8_t[]> frameStorage_;
+    std::unique_ptr<uint8_t[]> canvas_;
+    // scratch of the box filter: column sums of the source rows of one output row, and where
+    // each output column starts in the source
+    std::vector<uint16_t> rowSums_;
+    std::vector<uint32_t> columns_;
+    unsigned int layoutCount_;
+
+    // SDK time minus steady time, in ms, as of the newest frame; the gallery is stamped in SDK time
+    std::atomic<long long> clockOffsetMs_;
+    std::atomic<bool> clockKnown_;
+    unsigned long long lastTimestampMs_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+    std::thread thread_;
+
+    std::atomic<unsigned long long> framesComposed_;
+    std::atomic<unsigned long long> lateTicks_;
+    std::atomic<unsigned long long> droppedFrames_;
+    std::atomic<unsigned long long> maxComposeUs_;
+};
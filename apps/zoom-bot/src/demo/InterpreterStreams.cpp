@@ -0,0 +1,76 @@
+// Stream ids of interpretation channels, one per language
+
+#include "InterpreterStreams.h"
+#include "AudioPipeline.h"
+
+#include <cstring>
+
+static_assert(kInterpreterStreamIdBase + InterpreterStreams::kMaxLanguages <= kShareAudioStreamId,
+              "interpreter stream ids run into the other synthetic ids");
+
+namespace {
+
+// FNV-1a, and the length, in one pass; false past maxLength
+bool HashName(const char *name, size_t maxLength, uint32_t &hash, size_t &length) {
+    hash = 2166136261u;
+    for (length = 0; name[length] != '\0'; length++) {
+        if (length == maxLength) {
+            return false;
+        }
+        hash = (hash ^ (unsigned char)name[length]) * 16777619u;
+    }
+    return length > 0;
+}
+
+} // namespace
+
+InterpreterStreams::InterpreterStreams() : count_(0) {}
+
+bool InterpreterStreams::Find(const char *language, uint32_t &streamId, bool &added) {
+    added = false;
+    uint32_t hash = 0;
+    size_t length = 0;
+    if (!language || !HashName(language, kMaxNameBytes, hash, length)) {
+        return false;
+    }
+
+    size_t count = count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+        const Entry &entry = entries_[i];
+        if (entry.hash == hash && entry.length == length && memcmp(entry.name, language, length) == 0) {
+            streamId = kInterpreterStreamIdBase + (uint32_t)i;
+            return true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // another thread may have added it since
+    count = count_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        const Entry &entry = entries_[i];
+        if (entry.hash == hash && entry.length == length && memcmp(entry.name, language, length) == 0) {
+            streamId = kInterpreterStreamIdBase + (uint32_t)i;
+            return true;
+        }
+    }
+    if (count == kMaxLanguages) {
+        return false;
+    }
+    Entry &entry = entries_[count];
+    entry.hash = hash;
+    entry.length = length;
+    memcpy(entry.name, language, length);
+    entry.name[length] = '\0';
+    count_.store(count + 1, std::memory_order_release);
+    streamId = kInterpreterStreamIdBase + (uint32_t)count;
+    added = true;
+    return true;
+}
+
+const char *InterpreterStreams::Language(uint32_t streamId) const {
+    if (streamId < kInterpreterStreamIdBase) {
+        return nullptr;
+    }
+    size_t index = streamId - kInterpreterStreamIdBase;
+    return index < count_.load(std::memory_order_acquire) ? entries_[index].name : nullptr;
+}
@@ -0,0 +1,39 @@
+// Stream ids of interpretation channels, one per language
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Gives every interpretation language the SDK delivers a stream id of its own,
+// kInterpreterStreamIdBase plus the order it was first heard in. The SDK names the
+// language on every callback; a language seen before is found by hash and length in a
+// fixed table, without locking or allocating. Only a new language takes the lock.
+class InterpreterStreams {
+public:
+    static const size_t kMaxLanguages = 64;
+    // longest language name kept, in bytes
+    static const size_t kMaxNameBytes = 63;
+
+    InterpreterStreams();
+
+    /// \brief The stream id of language; added is set if it was heard for the first time.
+    /// \return false if the name is empty or too long, or the table is full.
+    bool Find(const char *language, uint32_t &streamId, bool &added);
+
+    /// \brief The language of a stream id Find returned, nullptr for any other id.
+    const char *Language(uint32_t streamId) const;
+
+private:
+    struct Entry {
+        uint32_t hash;
+        size_t length;
+        char name[kMaxNameBytes + 1];
+    };
+
+    // entries below count_ are complete and never change
+    Entry entries_[kMaxLanguages];
+    std::atomic<size_t> count_;
+    std::mutex mutex_;
+};
@@ -0,0 +1,200 @@
+// Spots keywords in the participant streams and reports them as bot events
+
+#include "KeywordSpotter.h"
+#include "LogMelExtractor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+struct KeywordSpotter::Stream {
+    KeywordSpotter *spotter;
+    uint32_t id;
+    std::unique_ptr<KeywordDetector> detector;
+    Strand strand;
+
+    // a ring of kQueueFrames; the pipeline strand advances tail, the spotter's strand head
+    std::unique_ptr<float[]> frames;
+    unsigned long long timestamps[kQueueFrames];
+    std::chrono::steady_clock::time_point queuedAt[kQueueFrames];
+    // the frame follows dropped ones, the detector starts over there
+    bool afterGap[kQueueFrames];
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    // only the pipeline strand: frames were dropped since the last one queued
+    bool shedding;
+};
+
+KeywordSpotter::KeywordSpotter(const ParticipantRoster *roster)
+    : roster_(roster), events_(nullptr), frames_(0), shedFrames_(0), hits_(0), lastLatencyMs_(0) {}
+
+KeywordSpotter::~KeywordSpotter() {
+    if (!model_) {
+        return;
+    }
+    WaitIdle();
+    Metrics::Instance().RemoveCollector(this);
+    // the strands go with the streams, after the workers that might still hold them
+    scheduler_.reset();
+}
+
+void KeywordSpotter::Start(std::unique_ptr<KeywordModel> model, size_t threads, BotEventChannel *events,
+                           const std::string &meetingNumber) {
+    if (model_ || !model) {
+        return;
+    }
+    events_ = events;
+    meetingNumber_ = meetingNumber;
+    // 0 would mean every CPU of the container; the budget is explicit
+    scheduler_.reset(new TaskScheduler(std::max<size_t>(1, threads), THREAD_ROLE_ANALYSIS));
+    std::cout << "KeywordSpotter: " << model->KeywordCount() << " keyword(s) on " << scheduler_->WorkerCount()
+              << " thread(s)" << std::endl;
+    model_ = std::move(model);
+    Metrics::Instance().AddCollector(&KeywordSpotter::CollectMetrics, this);
+}
+
+void KeywordSpotter::Push(Stream *&stream, uint32_t streamId, const float *frames, size_t count,
+                          unsigned long long timestampMs) {
+    if (!model_ || count == 0) {
+        return;
+    }
+    if (!stream) {
+        std::unique_ptr<Stream> created(new Stream());
+        created->spotter = this;
+        created->id = streamId;
+        created->detector = model_->CreateDetector();
+        created->strand.SetScheduler(scheduler_.get());
+        created->frames.reset(new float[kQueueFrames * LogMelExtractor::kBins]);
+        created->head.store(0, std::memory_order_relaxed);
+        created->tail.store(0, std::memory_order_relaxed);
+        created->shedding = false;
+        stream = created.get();
+        std::lock_guard<std::mutex> lock(streamsMutex_);
+        streams_.push_back(std::move(created));
+    }
+
+    size_t tail = stream->tail.load(std::memory_order_relaxed);
+    size_t queued = tail - stream->head.load(std::memory_order_acquire);
+    if (queued + count > kQueueFrames) {
+        // the pool is behind: drop what does not fit rather than hold up the pipeline
+        shedFrames_.fetch_add(count, std::memory_order_relaxed);
+        stream->shedding = true;
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = (tail + i) % kQueueFrames;
+        memcpy(stream->frames.get() + slot * LogMelExtractor::kBins, frames + i * LogMelExtractor::kBins,
+               LogMelExtractor::kBins * sizeof(float));
+        stream->timestamps[slot] = timestampMs + i * LogMelExtractor::kFrameMs;
+        stream->queuedAt[slot] = now;
+        stream->afterGap[slot] = i == 0 && stream->shedding;
+    }
+    stream->shedding = false;
+    stream->tail.store(tail + count, std::memory_order_release);
+    stream->strand.Post(&KeywordSpotter::Run, stream);
+}
+
+void KeywordSpotter::Run(void *context) {
+    Stream *stream = static_cast<Stream *>(context);
+    KeywordSpotter *self = stream->spotter;
+    KeywordHit hits[kMaxHits];
+    size_t head = stream->head.load(std::memory_order_relaxed);
+    size_t tail = stream->tail.load(std::memory_order_acquire);
+    while (head != tail) {
+        size_t slot = head % kQueueFrames;
+        if (stream->afterGap[slot]) {
+            stream->detector->Reset();
+        }
+        // up to the end of the ring or the next gap, whichever comes first
+        size_t count = std::min(tail - head, kQueueFrames - slot);
+        for (size_t i = 1; i < count; i++) {
+            if (stream->afterGap[slot + i]) {
+                count = i;
+                break;
+            }
+        }
+        size_t found = stream->detector->Process(stream->frames.get() + slot * LogMelExtractor::kBins, count, hits,
+                                                 kMaxHits);
+        for (size_t i = 0; i < found; i++) {
+            self->Report(*stream, hits[i], head);
+        }
+        self->frames_.fetch_add(count, std::memory_order_relaxed);
+        head += count;
+        // hand the slots back to the pipeline strand
+        stream->head.store(head, std::memory_order_release);
+    }
+}
+
+void KeywordSpotter::Report(Stream &stream, const KeywordHit &hit, size_t position) {
+    // the last frame of the match; one the detector held back is no longer in the ring, and
+    // its time follows from the frame spacing
+    long long end = (long long)position + hit.endFrame;
+    size_t reference = (size_t)std::max(end, (long long)position) % kQueueFrames;
+    long long endMs = (long long)stream.timestamps[reference] +
+                      (end - std::max(end, (long long)position)) * (long long)LogMelExtractor::kFrameMs;
+    long long startMs = endMs - (long long)hit.frames * LogMelExtractor::kFrameMs;
+    long long latencyMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                                stream.queuedAt[reference])
+                              .count();
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    lastLatencyMs_.store(latencyMs, std::memory_order_relaxed);
+    if (!events_) {
+        return;
+    }
+
+    std::string name;
+    if (roster_) {
+        std::shared_ptr<const RosterSnapshot> roster = roster_->Snapshot();
+        if (const Participant *participant = roster->Find(stream.id)) {
+            name = participant->name;
+        }
+    }
+    BotEvent event("keyword");
+    event.Add("meetingNumber", meetingNumber_)
+        .Add("keyword", model_->Keyword(hit.keyword))
+        .Add("nodeId", stream.id)
+        .Add("name", name)
+        .Add("startMs", std::max(0LL, startMs))
+        .Add("endMs", std::max(0LL, endMs))
+        .Add("confidence", (double)hit.confidence)
+        .Add("latencyMs", latencyMs);
+    events_->Emit(event);
+}
+
+void KeywordSpotter::WaitIdle() {
+    std::vector<Stream *> streams;
+    {
+        std::lock_guard<std::mutex> lock(streamsMutex_);
+        for (size_t i = 0; i < streams_.size(); i++) {
+            streams.push_back(streams_[i].get());
+        }
+    }
+    for (size_t i = 0; i < streams.size(); i++) {
+        streams[i]->strand.WaitIdle();
+    }
+}
+
+bool KeywordSpotter::WaitIdleUntil(std::chrono::steady_clock::time_point deadline) {
+    std::vector<Stream *> streams;
+    {
+        std::lock_guard<std::mutex> lock(streamsMutex_);
+        for (size_t i = 0; i < streams_.size(); i++) {
+            streams.push_back(streams_[i].get());
+        }
+    }
+    for (size_t i = 0; i < streams.size(); i++) {
+        if (!streams[i]->strand.WaitIdleUntil(deadline)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void KeywordSpotter::CollectMetrics(MetricsWriter &writer, void *context) {
+    KeywordSpotter *self = static_cast<KeywordSpotter *>(context);
+    writer.Write("zoom_bot_keyword_frames_total", self->frames_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_keyword_shed_frames_total", self->shedFrames_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_keyword_hits_total", self->hits_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_keyword_last_latency_ms", (double)self->lastLatencyMs_.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,117 @@
+// Spots keywords in the participant streams and reports them as bot events
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BotEventChannel.h"
+#include "Metrics.h"
+#include "ParticipantRoster.h"
+#include "TaskScheduler.h"
+
+// One keyword a detector found.
+struct KeywordHit {
+    // index of the keyword in the model
+    size_t keyword;
+    // the frame, counted from the first frame of the Process call, the keyword ended on;
+    // may be before the call when the detector waited for a better match
+    long long endFrame;
+    // length of the match in frames
+    size_t frames;
+    // 0 to 1, higher is more certain
+    float confidence;
+};
+
+// Finds keywords in one stream of log-mel frames. Created per stream and only used on that
+// stream's strand, so it may keep state without locking.
+class KeywordDetector {
+public:
+    virtual ~KeywordDetector() {}
+
+    /// \brief Run count frames of LogMelExtractor::kBins values through the detector.
+    /// \return The number of hits written to hits, at most maxHits.
+    virtual size_t Process(const float *frames, size_t count, KeywordHit *hits, size_t maxHits) = 0;
+
+    /// \brief Forget the frames seen so far, e.g. because frames were skipped.
+    virtual void Reset() = 0;
+};
+
+// A keyword spotting model: the keywords it knows and a factory of per-stream detectors.
+// TemplateKeywordModel is the reference implementation; a small neural model plugs in by
+// implementing the same two classes.
+class KeywordModel {
+public:
+    virtual ~KeywordModel() {}
+
+    virtual size_t KeywordCount() const = 0;
+    virtual const std::string &Keyword(size_t index) const = 0;
+
+    /// \brief State for one more stream. Called on the stream's pipeline strand.
+    virtual std::unique_ptr<KeywordDetector> CreateDetector() const = 0;
+};
+
+// Runs a KeywordModel over the log-mel frames of every participant stream and emits a
+// "keyword" event for each hit. The work runs on a pool of its own, kept to the threads it
+// is given, under the analysis role of threadLayout, so it never takes CPU the capture path
+// was promised. Each stream queues at most kQueueFrames for the pool. When the pool cannot
+// keep up, frames that do not fit are dropped and counted, and the stream's detector starts
+// over after the gap: alerts come late or not at all, but the capture path never waits and
+// memory stays bounded.
+class KeywordSpotter {
+public:
+    // 500 ms; with the detector's own wait a hit is out within a second of the keyword
+    static const size_t kQueueFrames = 50;
+    static const size_t kMaxHits = 8;
+
+    struct Stream;
+
+    /// \param roster Names the participant in events, nullptr to report node ids only.
+    explicit KeywordSpotter(const ParticipantRoster *roster = nullptr);
+    ~KeywordSpotter();
+
+    /// \brief Start spotting with threads workers; hits go to events, if not nullptr.
+    void Start(std::unique_ptr<KeywordModel> model, size_t threads, BotEventChannel *events,
+               const std::string &meetingNumber);
+
+    bool Enabled() const { return model_ != nullptr; }
+
+    /// \brief Queue count frames of streamId, the first starting at timestampMs. Called on
+    /// the stream's pipeline strand; stream is the caller's handle, nullptr at first.
+    void Push(Stream *&stream, uint32_t streamId, const float *frames, size_t count, unsigned long long timestampMs);
+
+    /// \brief Wait until every frame queued so far went through the model.
+    void WaitIdle();
+
+    /// \brief WaitIdle that gives up at deadline.
+    /// \return false if frames were still queued then.
+    bool WaitIdleUntil(std::chrono::steady_clock::time_point deadline);
+
+    unsigned long long Hits() const { return hits_.load(std::memory_order_relaxed); }
+    unsigned long long ShedFrames() const { return shedFrames_.load(std::memory_order_relaxed); }
+
+private:
+    static void Run(void *context);
+    void Report(Stream &stream, const KeywordHit &hit, size_t position);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    const ParticipantRoster *roster_;
+    std::unique_ptr<KeywordModel> model_;
+    BotEventChannel *events_;
+    std::string meetingNumber_;
+    std::unique_ptr<TaskScheduler> scheduler_;
+
+    // creation and the metrics collector; every stream is kept until the spotter goes
+    std::mutex streamsMutex_;
+    std::vector<std::unique_ptr<Stream>> streams_;
+
+    std::atomic<unsigned long long> frames_;
+    std::atomic<unsigned long long> shedFrames_;
+    std::atomic<unsigned long long> hits_;
+    std::atomic<long long> lastLatencyMs_;
+};
@@ -0,0 +1,263 @@
+// Rebuilds a mixed track from selected participant streams
+
+#include "LocalMixer.h"
+#include "AudioPipeline.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+const float kMinGainDb = -40.0f;
+const float kMaxGainDb = 20.0f;
+
+std::string TrimSpaces(const std::string &text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return "";
+    }
+    return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+std::vector<std::string> SplitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        item = TrimSpaces(item);
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+bool Matches(const std::string &entry, uint32_t streamId, const Participant *participant) {
+    return entry == std::to_string(streamId) || (participant && entry == participant->name);
+}
+
+bool MatchesAny(const std::vector<std::string> &entries, uint32_t streamId, const Participant *participant) {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (Matches(entries[i], streamId, participant)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NamesAnyone(const std::vector<std::string> &entries) {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].find_first_not_of("0123456789") != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool LocalMixRulesFromConfig(const std::string &include, const std::string &exclude, const std::string &gains,
+                             LocalMixRules &rules) {
+    LocalMixRules parsed;
+    parsed.include = SplitList(include);
+    parsed.exclude = SplitList(exclude);
+    std::vector<std::string> pairs = SplitList(gains);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        // names may contain colons, the gain follows the last one
+        size_t colon = pairs[i].rfind(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        std::string name = TrimSpaces(pairs[i].substr(0, colon));
+        std::string value = TrimSpaces(pairs[i].substr(colon + 1));
+        char *end = nullptr;
+        float gainDb = strtof(value.c_str(), &end);
+        if (name.empty() || value.empty() || *end != '\0' || !(gainDb >= kMinGainDb && gainDb <= kMaxGainDb)) {
+            return false;
+        }
+        parsed.gainsDb.push_back(std::make_pair(name, gainDb));
+    }
+    rules = parsed;
+    return true;
+}
+
+// EmitLocked's std::min binds it by reference
+const size_t LocalMixer::kBlockSamples;
+
+LocalMixer::LocalMixer(const ParticipantRoster *roster)
+    : roster_(roster), sink_(nullptr), rules_(std::make_shared<LocalMixRules>()), rulesVersion_(1), emitted_(-1),
+      horizon_(-1), mixedSamples_(0), lateSamples_(0), resyncs_(0) {}
+
+LocalMixer::~LocalMixer() {
+    if (sink_) {
+        Metrics::Instance().RemoveCollector(this);
+    }
+}
+
+void LocalMixer::SetSink(AudioPipelineSink *sink) {
+    if (!sink_ && sink) {
+        ring_.reset(new int16_t[kRingSamples]);
+        memset(ring_.get(), 0, kRingSamples * sizeof(int16_t));
+        block_.resize(kBlockSamples);
+        Metrics::Instance().AddCollector(&LocalMixer::CollectMetrics, this);
+    }
+    sink_ = sink;
+}
+
+void LocalMixer::SetRules(const LocalMixRules &rules) {
+    std::atomic_store(&rules_, std::shared_ptr<const LocalMixRules>(std::make_shared<LocalMixRules>(rules)));
+    rulesVersion_.fetch_add(1, std::memory_order_release);
+}
+
+float LocalMixer::Resolve(LocalMixInput &input, uint32_t streamId) {
+    uint64_t rulesVersion = rulesVersion_.load(std::memory_order_acquire);
+    std::shared_ptr<const RosterSnapshot> snapshot = roster_ ? roster_->Snapshot() : nullptr;
+    uint64_t rosterVersion = snapshot ? snapshot->Version() : 0;
+    if (input.resolved && input.rulesVersion == rulesVersion && input.rosterVersion == rosterVersion) {
+        return input.gain;
+    }
+
+    std::shared_ptr<const LocalMixRules> rules = std::atomic_load(&rules_);
+    const Participant *participant = snapshot ? snapshot->Find(streamId) : nullptr;
+    bool included = (rules->include.empty() || MatchesAny(rules->include, streamId, participant)) &&
+                    !MatchesAny(rules->exclude, streamId, participant);
+    if (snapshot && !participant && (NamesAnyone(rules->include) || NamesAnyone(rules->exclude))) {
+        // whether a name rule is about this stream is not known yet; the next roster version
+        // resolves it again
+        included = false;
+    }
+    float gain = 0.0f;
+    if (included) {
+        float gainDb = 0.0f;
+        for (size_t i = 0; i < rules->gainsDb.size(); i++) {
+            if (Matches(rules->gainsDb[i].first, streamId, participant)) {
+                gainDb = rules->gainsDb[i].second;
+            }
+        }
+        gain = powf(10.0f, gainDb / 20.0f);
+    }
+    input.gain = gain;
+    input.resolved = true;
+    input.rulesVersion = rulesVersion;
+    input.rosterVersion = rosterVersion;
+    return gain;
+}
+
+void LocalMixer::Add(LocalMixInput &input, uint32_t streamId, const float *samples, size_t count,
+                     unsigned long long timestampMs) {
+    if (!sink_ || count == 0) {
+        return;
+    }
+    float gain = Resolve(input, streamId);
+
+    // millisecond timestamps jitter by a few samples; a stream that keeps coming continues
+    // where it left off
+    long long start = (long long)(timestampMs * kAsrSampleRate / 1000);
+    if (input.cursor >= 0 && std::llabs(start - input.cursor) <= (long long)kResyncSamples) {
+        start = input.cursor;
+    }
+    long long end = start + (long long)count;
+    input.cursor = end;
+
+    // scale and convert on the stream's own thread, only the sum happens under the lock
+    thread_local std::vector<float> scaled;
+    thread_local std::vector<int16_t> pcm;
+    if (gain > 0.0f) {
+        if (pcm.size() < count) {
+            scaled.resize(count);
+            pcm.resize(count);
+        }
+        SimdKernels::ApplyGainRamp(samples, count, gain, 0.0f, scaled.data());
+        SimdKernels::FloatToInt16(scaled.data(), count, pcm.data());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    AdvanceLocked(start, end);
+    // the part already handed to the sink is too late to be mixed
+    long long first = std::max(start, emitted_);
+    if (first > start) {
+        lateSamples_.fetch_add((unsigned long long)(std::min(first, end) - start), std::memory_order_relaxed);
+    }
+    if (gain <= 0.0f || first >= end) {
+        return;
+    }
+    size_t position = (size_t)(first % (long long)kRingSamples);
+    size_t total = (size_t)(end - first);
+    size_t head = std::min(total, kRingSamples - position);
+    const int16_t *source = pcm.data() + (first - start);
+    SimdKernels::AddSaturating(source, head, ring_.get() + position);
+    SimdKernels::AddSaturating(source + head, total - head, ring_.get());
+}
+
+void LocalMixer::AdvanceLocked(long long start, long long end) {
+    if (emitted_ < 0) {
+        emitted_ = start;
+        horizon_ = start;
+    }
+    if (end - emitted_ > (long long)kRingSamples) {
+        // the slice does not fit the ring: write out what it holds, and if that is still not
+        // enough room, nobody sent audio for a while; the mix continues after a gap
+        EmitLocked((size_t)(horizon_ - emitted_));
+        if (end - emitted_ > (long long)kRingSamples) {
+            emitted_ = start;
+            horizon_ = start;
+            resyncs_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    horizon_ = std::max(horizon_, end);
+    while (horizon_ - emitted_ >= (long long)(kLatencySamples + kBlockSamples)) {
+        EmitLocked(kBlockSamples);
+    }
+}
+
+void LocalMixer::EmitLocked(size_t count) {
+    while (count > 0) {
+        size_t block = std::min(count, kBlockSamples);
+        size_t position = (size_t)(emitted_ % (long long)kRingSamples);
+        size_t head = std::min(block, kRingSamples - position);
+        SimdKernels::DownmixToMonoFloat(ring_.get() + position, head, 1, block_.data());
+        SimdKernels::DownmixToMonoFloat(ring_.get(), block - head, 1, block_.data() + head);
+        // the ring is reused for the timeline one lap ahead
+        memset(ring_.get() + position, 0, head * sizeof(int16_t));
+        memset(ring_.get(), 0, (block - head) * sizeof(int16_t));
+
+        AudioChunk chunk;
+        chunk.streamId = kLocalMixStreamId;
+        chunk.samples = block_.data();
+        chunk.count = block;
+        chunk.timestampMs = (unsigned long long)emitted_ * 1000 / kAsrSampleRate;
+        // the mix is not classified
+        chunk.speech = false;
+        chunk.features = nullptr;
+        chunk.featureFrames = 0;
+        chunk.featureTimestampMs = 0;
+        sink_->onPipelineAudio(chunk);
+
+        emitted_ += (long long)block;
+        count -= block;
+        mixedSamples_.fetch_add(block, std::memory_order_relaxed);
+    }
+}
+
+void LocalMixer::Flush() {
+    if (!sink_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (emitted_ >= 0) {
+        EmitLocked((size_t)(horizon_ - emitted_));
+    }
+}
+
+void LocalMixer::CollectMetrics(MetricsWriter &writer, void *context) {
+    LocalMixer *self = static_cast<LocalMixer *>(context);
+    writer.Write("zoom_bot_local_mix_seconds_total",
+                 (double)self->mixedSamples_.load(std::memory_order_relaxed) / kAsrSampleRate);
+    writer.Write("zoom_bot_local_mix_late_seconds_total",
+                 (double)self->lateSamples_.load(std::memory_order_relaxed) / kAsrSampleRate);
+    writer.Write("zoom_bot_local_mix_resyncs_total", self->resyncs_.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,116 @@
+// Rebuilds a mixed track from selected participant streams
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AudioResampler.h"
+#include "Metrics.h"
+#include "ParticipantRoster.h"
+
+class AudioPipelineSink;
+
+// Who is in the local mix. Entries are participant names or decimal node ids.
+struct LocalMixRules {
+    // empty for everyone
+    std::vector<std::string> include;
+    std::vector<std::string> exclude;
+    // in dB, for participants that are in the mix
+    std::vector<std::pair<std::string, float>> gainsDb;
+};
+
+/// \brief LocalMixRules of the localMixInclude, localMixExclude and localMixGains values:
+/// comma-separated names or node ids, and name:dB pairs with gains from -40 to +20 dB.
+/// \return false if a gain is malformed or out of range.
+bool LocalMixRulesFromConfig(const std::string &include, const std::string &exclude, const std::string &gains,
+                             LocalMixRules &rules);
+
+// What the mixer remembers of one participant stream. The caller keeps it with its other
+// per-stream state and passes it to every Add of that stream.
+struct LocalMixInput {
+    // timeline index where the stream's next slice goes, -1 before its first slice
+    long long cursor;
+    float gain;
+    bool resolved;
+    uint64_t rosterVersion;
+    uint64_t rulesVersion;
+
+    void Reset() {
+        cursor = -1;
+        gain = 0.0f;
+        resolved = false;
+        rosterVersion = 0;
+        rulesVersion = 0;
+    }
+};
+
+// Mixes the 16 kHz one-way streams of the participants the rules select into one track,
+// for recordings that must leave someone out; the SDK's mixed stream always has everyone.
+// Slices are placed on a shared timeline by SDK timestamp, converted to int16 with their
+// gain and summed with saturating adds into a ring of kRingSamples. The timeline is handed
+// to the sink as stream kLocalMixStreamId in kBlockSamples blocks once the newest audio is
+// kLatencySamples past them, so streams processed a little behind the others still make it.
+// Audio later than that is dropped and counted. When nobody is sending audio the mix has a
+// gap, like the participant streams.
+//
+// Add is called from the strand of each stream, concurrently for different streams; the
+// ring is shared under a mutex. Rules are matched against the roster when a stream is first
+// seen and again whenever the roster or the rules change. While the include or exclude list
+// has a name in it, a stream the roster does not know yet is left out of the mix.
+class LocalMixer {
+public:
+    static const size_t kRingSamples = 2 * kAsrSampleRate;
+    // 300 ms, above the 160 ms a stream's strand may have queued
+    static const size_t kLatencySamples = kAsrSampleRate * 3 / 10;
+    static const size_t kBlockSamples = kAsrSampleRate / 10;
+    // a stream's slice within 30 ms of where the previous one ended is taken as contiguous
+    static const size_t kResyncSamples = kAsrSampleRate * 3 / 100;
+
+    /// \param roster Resolves participant names in the rules, nullptr to match node ids only.
+    explicit LocalMixer(const ParticipantRoster *roster = nullptr);
+    ~LocalMixer();
+
+    /// \brief Start mixing into sink. Set before the first Add.
+    void SetSink(AudioPipelineSink *sink);
+
+    bool Enabled() const { return sink_ != nullptr; }
+
+    /// \brief Replace the rules; streams pick them up with their next slice. Any thread.
+    void SetRules(const LocalMixRules &rules);
+
+    /// \brief Mix count 16 kHz samples of streamId starting at timestampMs.
+    void Add(LocalMixInput &input, uint32_t streamId, const float *samples, size_t count,
+             unsigned long long timestampMs);
+
+    /// \brief Hand everything still held back for late streams to the sink.
+    void Flush();
+
+private:
+    float Resolve(LocalMixInput &input, uint32_t streamId);
+    void AdvanceLocked(long long start, long long end);
+    void EmitLocked(size_t count);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    const ParticipantRoster *roster_;
+    AudioPipelineSink *sink_;
+    std::shared_ptr<const LocalMixRules> rules_;
+    std::atomic<uint64_t> rulesVersion_;
+
+    std::mutex mutex_;
+    std::unique_ptr<int16_t[]> ring_;
+    std::vector<float> block_;
+    // timeline index of the next sample handed to the sink, -1 before the first Add
+    long long emitted_;
+    // one past the newest sample mixed
+    long long horizon_;
+
+    std::atomic<unsigned long long> mixedSamples_;
+    std::atomic<unsigned long long> lateSamples_;
+    std::atomic<unsigned long long> resyncs_;
+};
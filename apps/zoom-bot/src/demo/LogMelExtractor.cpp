@@ -0,0 +1,124 @@
+// Streaming log-mel filterbank features for 16 kHz mono audio
+
+#include "LogMelExtractor.h"
+#include "RealFft.h"
+#include "SimdKernels.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const size_t kFftSize = 512;
+const float kSampleRate = 16000.0f;
+const float kLowHz = 20.0f;
+const float kHighHz = 7600.0f;
+const float kLogFloor = 1e-10f;
+
+const RealFft &SharedFft() {
+    static const RealFft fft(kFftSize);
+    return fft;
+}
+
+float HzToMel(float hz) {
+    return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+float MelToHz(float mel) {
+    return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+// Each triangular filter covers a contiguous run of FFT bins, stored as its first bin and
+// the weights of the run, so applying it is one dot product over the power spectrum.
+struct MelTable {
+    float hann[LogMelExtractor::kWindowSamples];
+    size_t firstBin[LogMelExtractor::kBins];
+    size_t binCount[LogMelExtractor::kBins];
+    size_t weightOffset[LogMelExtractor::kBins];
+    std::vector<float> weights;
+
+    MelTable() {
+        // periodic Hann, as the STFT front ends of ASR models use
+        for (size_t i = 0; i < LogMelExtractor::kWindowSamples; i++) {
+            hann[i] = 0.5f - 0.5f * cosf(2.0f * 3.14159265f * i / LogMelExtractor::kWindowSamples);
+        }
+
+        float lowMel = HzToMel(kLowHz);
+        float step = (HzToMel(kHighHz) - lowMel) / (LogMelExtractor::kBins + 1);
+        float binHz = kSampleRate / kFftSize;
+        for (size_t m = 0; m < LogMelExtractor::kBins; m++) {
+            float left = MelToHz(lowMel + step * m);
+            float center = MelToHz(lowMel + step * (m + 1));
+            float right = MelToHz(lowMel + step * (m + 2));
+            firstBin[m] = (size_t)ceilf(left / binHz);
+            weightOffset[m] = weights.size();
+            size_t bin = firstBin[m];
+            for (; bin * binHz < right && bin <= kFftSize / 2; bin++) {
+                float hz = bin * binHz;
+                weights.push_back(hz <= center ? (hz - left) / (center - left) : (right - hz) / (right - center));
+            }
+            binCount[m] = bin - firstBin[m];
+        }
+    }
+};
+
+const MelTable &SharedMelTable() {
+    static const MelTable table;
+    return table;
+}
+
+} // namespace
+
+LogMelExtractor::LogMelExtractor() {
+    // build the shared tables before the first audio callback
+    SharedFft();
+    SharedMelTable();
+    Reset();
+}
+
+void LogMelExtractor::Reset() {
+    fill_ = 0;
+    frames_ = 0;
+}
+
+size_t LogMelExtractor::Process(const float *samples, size_t count, float *frames) {
+    size_t produced = 0;
+    while (count > 0) {
+        size_t take = kWindowSamples - fill_;
+        if (take > count) {
+            take = count;
+        }
+        memcpy(window_ + fill_, samples, take * sizeof(float));
+        fill_ += take;
+        samples += take;
+        count -= take;
+
+        if (fill_ == kWindowSamples) {
+            ComputeFrame(frames + produced * kBins);
+            produced++;
+            frames_++;
+            // keep the 15 ms the next window shares with this one
+            memmove(window_, window_ + kHopSamples, (kWindowSamples - kHopSamples) * sizeof(float));
+            fill_ = kWindowSamples - kHopSamples;
+        }
+    }
+    return produced;
+}
+
+void LogMelExtractor::ComputeFrame(float *out) {
+    const MelTable &table = SharedMelTable();
+    float windowed[kFftSize];
+    SimdKernels::Multiply(window_, table.hann, kWindowSamples, windowed);
+    memset(windowed + kWindowSamples, 0, (kFftSize - kWindowSamples) * sizeof(float));
+
+    float power[kFftSize / 2 + 1];
+    SharedFft().PowerSpectrum(windowed, power);
+
+    const float *weights = table.weights.data();
+    for (size_t m = 0; m < kBins; m++) {
+        float energy = SimdKernels::DotProduct(power + table.firstBin[m], weights + table.weightOffset[m],
+                                               table.binCount[m]);
+        out[m] = logf(energy > kLogFloor ? energy : kLogFloor);
+    }
+}
@@ -0,0 +1,45 @@
+// Streaming log-mel filterbank features for 16 kHz mono audio
+#pragma once
+
+#include <cstddef>
+
+// Turns 16 kHz audio into the 80-bin log-mel frames ASR models take as input: a 25 ms Hann
+// window every 10 ms, zero-padded to a 512-point FFT, the power spectrum weighted by
+// triangular HTK mel filters between 20 and 7600 Hz, and the natural log with a floor of
+// 1e-10. No dither, DC removal, pre-emphasis or normalization is applied; consumers
+// normalize as their model expects.
+//
+// Samples are carried across calls, so a frame can span several SDK chunks. Tables are
+// shared by all instances and nothing is allocated per call.
+class LogMelExtractor {
+public:
+    static const size_t kBins = 80;
+    static const size_t kWindowSamples = 400;
+    static const size_t kHopSamples = 160;
+    static const unsigned int kFrameMs = 10;
+
+    LogMelExtractor();
+
+    /// \brief Feed samples and compute every frame they complete.
+    /// \param frames Receives kBins values per frame, at least MaxFrames(count) frames.
+    /// \return The number of frames written.
+    size_t Process(const float *samples, size_t count, float *frames);
+
+    /// \brief Upper bound of the frames one Process call on count samples produces.
+    static size_t MaxFrames(size_t count) { return count / kHopSamples + 1; }
+
+    /// \brief Samples waiting for the next frame. The first frame of the next Process call
+    /// starts this many samples before the samples passed to it.
+    size_t Buffered() const { return fill_; }
+
+    unsigned long long Frames() const { return frames_; }
+
+    void Reset();
+
+private:
+    void ComputeFrame(float *out);
+
+    float window_[kWindowSamples];
+    size_t fill_;
+    unsigned long long frames_;
+};
@@ -0,0 +1,182 @@
+// Streaming EBU R128 loudness of 16 kHz mono audio
+
+#include "LoudnessMeter.h"
+#include "AudioResampler.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// samples filtered into the stack buffer at once
+const size_t kWeightingBlock = 256;
+const double kPi = 3.14159265358979323846;
+
+struct Biquad {
+    double b0, b1, b2, a1, a2;
+};
+
+// BS.1770 K-weighting re-derived from its analog prototype for kAsrSampleRate; the
+// published coefficients are for 48 kHz only
+struct KWeighting {
+    Biquad shelf;
+    Biquad highPass;
+    // loudness at the centre of every histogram bin, as mean square
+    double binEnergy[LoudnessMeter::kHistogramBins];
+
+    KWeighting() {
+        const double fs = kAsrSampleRate;
+        double f0 = 1681.974450955533;
+        double gainDb = 3.999843853973347;
+        double q = 0.7071752369554196;
+        double k = tan(kPi * f0 / fs);
+        double vh = pow(10.0, gainDb / 20.0);
+        double vb = pow(vh, 0.4996667741545416);
+        double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+        f0 = 38.13547087602444;
+        q = 0.5003270373238773;
+        k = tan(kPi * f0 / fs);
+        a0 = 1.0 + k / q + k * k;
+        highPass.b0 = 1.0;
+        highPass.b1 = -2.0;
+        highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highPass.a2 = (1.0 - k / q + k * k) / a0;
+
+        for (size_t i = 0; i < LoudnessMeter::kHistogramBins; i++) {
+            double lufs = LoudnessMeter::kSilenceLufs + (i + 0.5) * 0.1;
+            binEnergy[i] = pow(10.0, (lufs + 0.691) / 10.0);
+        }
+    }
+};
+
+const KWeighting &SharedKWeighting() {
+    static const KWeighting weighting;
+    return weighting;
+}
+
+inline double Filter(const Biquad &f, double *state, double x) {
+    double y = f.b0 * x + state[0];
+    state[0] = f.b1 * x - f.a1 * y + state[1];
+    state[1] = f.b2 * x - f.a2 * y;
+    return y;
+}
+
+float Lufs(double meanSquare) {
+    if (meanSquare <= 0.0) {
+        return LoudnessMeter::kSilenceLufs;
+    }
+    return std::max(LoudnessMeter::kSilenceLufs, (float)(-0.691 + 10.0 * log10(meanSquare)));
+}
+
+} // namespace
+
+// bound by reference in std::min, so they need a definition
+const size_t LoudnessMeter::kShortTermBlocks;
+const size_t LoudnessMeter::kMomentaryBlocks;
+
+LoudnessMeter::LoudnessMeter() {
+    // build the shared coefficients before the first audio callback
+    SharedKWeighting();
+    Reset();
+}
+
+void LoudnessMeter::Reset() {
+    memset(shelfState_, 0, sizeof(shelfState_));
+    memset(highPassState_, 0, sizeof(highPassState_));
+    subBlockEnergy_ = 0.0;
+    subBlockFill_ = 0;
+    memset(energies_, 0, sizeof(energies_));
+    blocks_ = 0;
+    memset(histogram_, 0, sizeof(histogram_));
+    gatedBlocks_ = 0;
+    momentary_.store(kSilenceLufs, std::memory_order_relaxed);
+    shortTerm_.store(kSilenceLufs, std::memory_order_relaxed);
+    integrated_.store(kSilenceLufs, std::memory_order_relaxed);
+}
+
+void LoudnessMeter::Process(const float *samples, size_t count) {
+    const KWeighting &weighting = SharedKWeighting();
+    float weighted[kWeightingBlock];
+    size_t offset = 0;
+    while (offset < count) {
+        size_t n = std::min(count - offset, std::min(kWeightingBlock, kSubBlockSamples - subBlockFill_));
+        // the filters are recursive and stay scalar; the energy sum is vectorized
+        for (size_t i = 0; i < n; i++) {
+            double shelved = Filter(weighting.shelf, shelfState_, samples[offset + i]);
+            weighted[i] = (float)Filter(weighting.highPass, highPassState_, shelved);
+        }
+        subBlockEnergy_ += SimdKernels::DotProduct(weighted, weighted, n);
+        subBlockFill_ += n;
+        offset += n;
+        if (subBlockFill_ == kSubBlockSamples) {
+            CompleteSubBlock();
+        }
+    }
+}
+
+void LoudnessMeter::CompleteSubBlock() {
+    energies_[blocks_ % kShortTermBlocks] = subBlockEnergy_;
+    blocks_++;
+    subBlockEnergy_ = 0.0;
+    subBlockFill_ = 0;
+
+    // until the windows are full they cover the audio there is
+    double sum = 0.0;
+    double momentarySum = 0.0;
+    size_t available = std::min(blocks_, kShortTermBlocks);
+    for (size_t i = 0; i < available; i++) {
+        double energy = energies_[(blocks_ - 1 - i) % kShortTermBlocks];
+        sum += energy;
+        if (i < kMomentaryBlocks) {
+            momentarySum += energy;
+        }
+    }
+    momentary_.store(Lufs(momentarySum / (std::min(available, kMomentaryBlocks) * kSubBlockSamples)),
+                     std::memory_order_relaxed);
+    shortTerm_.store(Lufs(sum / (available * kSubBlockSamples)), std::memory_order_relaxed);
+
+    // gating blocks are 400 ms long and overlap by 75%, one per sub-block
+    if (blocks_ >= kMomentaryBlocks) {
+        float loudness = Momentary();
+        if (loudness > kSilenceLufs) {
+            size_t bin = std::min(kHistogramBins - 1, (size_t)((loudness - kSilenceLufs) * 10.0f));
+            histogram_[bin]++;
+            gatedBlocks_++;
+        }
+    }
+    if (blocks_ % kIntegrateEvery == 0) {
+        UpdateIntegrated();
+    }
+}
+
+void LoudnessMeter::UpdateIntegrated() {
+    if (gatedBlocks_ == 0) {
+        return;
+    }
+    const KWeighting &weighting = SharedKWeighting();
+    double sum = 0.0;
+    for (size_t i = 0; i < kHistogramBins; i++) {
+        sum += histogram_[i] * weighting.binEnergy[i];
+    }
+    // relative gate: 10 LU below the loudness of the blocks above the absolute gate
+    float relativeGate = Lufs(sum / gatedBlocks_) - 10.0f;
+    size_t first = relativeGate > kSilenceLufs ? (size_t)((relativeGate - kSilenceLufs) * 10.0f) : 0;
+    sum = 0.0;
+    unsigned long long blocks = 0;
+    for (size_t i = first; i < kHistogramBins; i++) {
+        sum += histogram_[i] * weighting.binEnergy[i];
+        blocks += histogram_[i];
+    }
+    if (blocks > 0) {
+        integrated_.store(Lufs(sum / blocks), std::memory_order_relaxed);
+    }
+}
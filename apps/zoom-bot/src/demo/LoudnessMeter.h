@@ -0,0 +1,60 @@
+// Streaming EBU R128 loudness of 16 kHz mono audio
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Measures loudness as ITU-R BS.1770 / EBU R128 define it: K-weighting (a high shelf and a
+// high-pass, designed for 16 kHz), mean square over 100 ms sub-blocks, momentary loudness
+// over the last 400 ms and short-term loudness over the last 3 s. Integrated loudness gates
+// the 400 ms blocks at -70 LUFS and then 10 LU below their mean, using a histogram of block
+// loudness in 0.1 LU steps instead of keeping every block, so memory stays constant.
+//
+// Process runs on the stream's strand; the loudness values are published atomically after
+// every sub-block and can be read from any thread.
+class LoudnessMeter {
+public:
+    static const size_t kSubBlockSamples = 1600;
+    // the absolute gate; quieter audio reads as this
+    static constexpr float kSilenceLufs = -70.0f;
+    // block loudness from -70 to +5 LUFS in 0.1 LU steps
+    static const size_t kHistogramBins = 750;
+
+    LoudnessMeter();
+
+    /// \brief Feed 16 kHz mono samples in [-1, 1).
+    void Process(const float *samples, size_t count);
+
+    float Momentary() const { return momentary_.load(std::memory_order_relaxed); }
+    float ShortTerm() const { return shortTerm_.load(std::memory_order_relaxed); }
+    float Integrated() const { return integrated_.load(std::memory_order_relaxed); }
+
+    void Reset();
+
+private:
+    static const size_t kShortTermBlocks = 30;
+    static const size_t kMomentaryBlocks = 4;
+    // the integrated value is recomputed once a second, the histogram scan is not free
+    static const size_t kIntegrateEvery = 10;
+
+    void CompleteSubBlock();
+    void UpdateIntegrated();
+
+    // K-weighting biquads, transposed direct form II
+    double shelfState_[2];
+    double highPassState_[2];
+
+    double subBlockEnergy_;
+    size_t subBlockFill_;
+    // sum of squares of the last kShortTermBlocks sub-blocks, a ring
+    double energies_[kShortTermBlocks];
+    size_t blocks_;
+
+    uint32_t histogram_[kHistogramBins];
+    unsigned long long gatedBlocks_;
+
+    std::atomic<float> momentary_;
+    std::atomic<float> shortTerm_;
+    std::atomic<float> integrated_;
+};
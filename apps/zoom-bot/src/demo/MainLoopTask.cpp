@@ -0,0 +1,23 @@
+// Coroutines that run on the GLib main loop: tasks, sleeps and channels with timeouts
+
+#include "MainLoopTask.h"
+
+Sleep::~Sleep() {
+    // the coroutine was destroyed while sleeping
+    if (source_) {
+        g_source_remove(source_);
+    }
+}
+
+void Sleep::await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    source_ = g_timeout_add(delayMs_, &Sleep::HandleTimeout, this);
+}
+
+gboolean Sleep::HandleTimeout(gpointer data) {
+    Sleep *self = static_cast<Sleep *>(data);
+    self->source_ = 0;
+    // the coroutine may finish and free this awaiter before resume returns
+    self->handle_.resume();
+    return G_SOURCE_REMOVE;
+}
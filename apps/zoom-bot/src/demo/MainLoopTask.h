@@ -0,0 +1,294 @@
+// Coroutines that run on the GLib main loop: tasks, sleeps and channels with timeouts
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <glib.h>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// timeout of AsyncChannel::Next that waits as long as it takes
+constexpr unsigned int kNoTimeout = 0xFFFFFFFFu;
+
+// A coroutine is suspended at a co_await and resumed by a GSource of the default main
+// context, so everything between two co_awaits runs on the main loop thread, like any
+// other GLib callback, and a wait costs a source instead of a thread.
+//
+// Nothing here throws: an exception escaping a coroutine terminates the process, as it
+// would escaping a GLib callback.
+
+template <typename T = void>
+class Task;
+
+namespace task_detail {
+
+struct PromiseBase {
+    // the coroutine awaiting this one, resumed when it finishes
+    std::coroutine_handle<> continuation;
+    // started with Detach: the frame frees itself when it finishes
+    bool detached = false;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { std::terminate(); }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            PromiseBase &promise = handle.promise();
+            if (promise.continuation) {
+                return promise.continuation;
+            }
+            if (promise.detached) {
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    void return_value(T result) { value = std::move(result); }
+    T Result() { return std::move(*value); }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void Result() noexcept {}
+};
+
+} // namespace task_detail
+
+// A coroutine returning T. It starts suspended and runs when awaited (co_await task), or
+// with Start or Detach from plain code. The Task owns the frame: destroying it cancels a
+// suspended coroutine, and the sources it waits on are removed with it.
+template <typename T>
+class Task {
+public:
+    typedef task_detail::Promise<T> promise_type;
+
+    Task() noexcept {}
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task() { Reset(); }
+
+    /// \brief Run until the first co_await that suspends. The Task keeps owning the frame.
+    void Start() {
+        if (handle_ && !handle_.done()) {
+            handle_.resume();
+        }
+    }
+
+    /// \brief Run and let the coroutine free itself when it finishes.
+    void Detach() {
+        if (handle_) {
+            std::coroutine_handle<promise_type> handle = std::exchange(handle_, nullptr);
+            handle.promise().detached = true;
+            handle.resume();
+        }
+    }
+
+    /// \brief True once the coroutine returned; false for an empty Task.
+    bool Done() const { return handle_ && handle_.done(); }
+
+    /// \brief Destroy the frame, cancelling the coroutine if it is suspended.
+    void Reset() {
+        if (handle_) {
+            std::exchange(handle_, nullptr).destroy();
+        }
+    }
+
+    struct Awaiter {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+        T await_resume() { return handle.promise().Result(); }
+    };
+
+    /// \brief Run the task and resume the awaiting coroutine with its result.
+    Awaiter operator co_await() && noexcept { return Awaiter{handle_}; }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace task_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace task_detail
+
+// co_await Sleep(ms): resume after ms on the main loop.
+class Sleep {
+public:
+    explicit Sleep(unsigned int delayMs) : delayMs_(delayMs), source_(0) {}
+    Sleep(const Sleep &) = delete;
+    Sleep &operator=(const Sleep &) = delete;
+    ~Sleep();
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept {}
+
+private:
+    static gboolean HandleTimeout(gpointer data);
+
+    unsigned int delayMs_;
+    guint source_;
+    std::coroutine_handle<> handle_;
+};
+
+// Values for one waiting coroutine, buffered in order until it takes them. Push may be
+// called from any thread; the waiter is resumed from a source on the main loop, never
+// inside Push, so a producer never runs the consumer's code.
+template <typename T>
+class AsyncChannel {
+public:
+    class Receive;
+
+    AsyncChannel() : waiter_(nullptr) {}
+    AsyncChannel(const AsyncChannel &) = delete;
+    AsyncChannel &operator=(const AsyncChannel &) = delete;
+
+    /// \brief Queue value and wake the waiting coroutine, if any.
+    void Push(T value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        values_.push_back(std::move(value));
+        if (waiter_ && !waiter_->wakeSource_) {
+            waiter_->wakeSource_ = g_idle_add_full(G_PRIORITY_DEFAULT, &Receive::HandleWake, waiter_, nullptr);
+        }
+    }
+
+    /// \brief Drop values nobody took yet.
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        values_.clear();
+    }
+
+    /// \brief co_await Next(timeoutMs): the oldest value, or std::nullopt if none arrived
+    /// within timeoutMs. One coroutine may wait at a time.
+    Receive Next(unsigned int timeoutMs = kNoTimeout) { return Receive(this, timeoutMs); }
+
+    class Receive {
+    public:
+        Receive(AsyncChannel *channel, unsigned int timeoutMs)
+            : channel_(channel), timeoutMs_(timeoutMs), wakeSource_(0), timer_(0) {}
+        Receive(const Receive &) = delete;
+        Receive &operator=(const Receive &) = delete;
+        ~Receive() {
+            std::lock_guard<std::mutex> lock(channel_->mutex_);
+            Disarm();
+        }
+
+        bool await_ready() {
+            std::lock_guard<std::mutex> lock(channel_->mutex_);
+            return !channel_->values_.empty() || timeoutMs_ == 0;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::lock_guard<std::mutex> lock(channel_->mutex_);
+            if (!channel_->values_.empty()) {
+                // pushed since await_ready
+                return false;
+            }
+            handle_ = handle;
+            channel_->waiter_ = this;
+            if (timeoutMs_ != kNoTimeout) {
+                timer_ = g_timeout_add(timeoutMs_, &Receive::HandleTimeout, this);
+            }
+            return true;
+        }
+
+        std::optional<T> await_resume() {
+            std::lock_guard<std::mutex> lock(channel_->mutex_);
+            if (channel_->values_.empty()) {
+                return std::nullopt;
+            }
+            T value = std::move(channel_->values_.front());
+            channel_->values_.pop_front();
+            return value;
+        }
+
+    private:
+        friend class AsyncChannel;
+
+        // called with the channel locked
+        void Disarm() {
+            if (channel_->waiter_ == this) {
+                channel_->waiter_ = nullptr;
+            }
+            if (wakeSource_) {
+                g_source_remove(wakeSource_);
+                wakeSource_ = 0;
+            }
+            if (timer_) {
+                g_source_remove(timer_);
+                timer_ = 0;
+            }
+        }
+
+        static gboolean HandleWake(gpointer data) {
+            Receive *self = static_cast<Receive *>(data);
+            {
+                std::lock_guard<std::mutex> lock(self->channel_->mutex_);
+                // returning G_SOURCE_REMOVE removes this source
+                self->wakeSource_ = 0;
+                self->Disarm();
+            }
+            self->handle_.resume();
+            return G_SOURCE_REMOVE;
+        }
+
+        static gboolean HandleTimeout(gpointer data) {
+            Receive *self = static_cast<Receive *>(data);
+            {
+                std::lock_guard<std::mutex> lock(self->channel_->mutex_);
+                self->timer_ = 0;
+                self->Disarm();
+            }
+            self->handle_.resume();
+            return G_SOURCE_REMOVE;
+        }
+
+        AsyncChannel *channel_;
+        unsigned int timeoutMs_;
+        guint wakeSource_;
+        guint timer_;
+        std::coroutine_handle<> handle_;
+    };
+
+private:
+    std::mutex mutex_;
+    std::deque<T> values_;
+    Receive *waiter_;
+};
@@ -0,0 +1,336 @@
+// Timestamp-ordered jitter buffer that aligns audio and video before they are written
+
+#include "MediaSynchronizer.h"
+#include "AudioResampler.h"
+#include "zoom_sdk_raw_data_def.h"
+
+#include <cstring>
+#include <iostream>
+
+MediaSynchronizer::MediaSynchronizer(unsigned int jitterWindowMs, size_t audioSlots, size_t videoSlots,
+                                     size_t maxVideoFrameBytes)
+    : sink_(nullptr), jitterWindowMs_(jitterWindowMs), maxVideoFrameBytes_(maxVideoFrameBytes),
+      newestTimestampMs_(0), sequence_(0), lateDrops_(0), oversizeDrops_(0), forcedReleases_(0), gaps_(0) {
+    size_t total = audioSlots + videoSlots;
+    slots_.resize(total);
+    heap_.reserve(total);
+    freeAudio_.reserve(audioSlots);
+    freeVideo_.reserve(videoSlots);
+
+    audioStorage_.reset(new float[audioSlots * kMaxAudioSlotSamples]);
+    videoStorage_.reset(new uint8_t[videoSlots * maxVideoFrameBytes]);
+    for (size_t i = 0; i < total; i++) {
+        Slot &slot = slots_[i];
+        slot.samples = nullptr;
+        slot.frame = nullptr;
+        if (i < audioSlots) {
+            slot.kind = SYNCED_MEDIA_AUDIO;
+            slot.samples = audioStorage_.get() + i * kMaxAudioSlotSamples;
+            freeAudio_.push_back((uint32_t)i);
+        } else {
+            slot.kind = SYNCED_MEDIA_VIDEO;
+            slot.frame = videoStorage_.get() + (i - audioSlots) * maxVideoFrameBytes;
+            freeVideo_.push_back((uint32_t)i);
+        }
+    }
+
+    streams_.resize(kMaxStreams);
+    for (size_t i = 0; i < kMaxStreams; i++) {
+        streams_[i].inUse = false;
+    }
+
+    Metrics::Instance().AddCollector(&MediaSynchronizer::CollectMetrics, this);
+}
+
+MediaSynchronizer::~MediaSynchronizer() {
+    Metrics::Instance().RemoveCollector(this);
+}
+
+void MediaSynchronizer::SetSink(MediaSyncSink *sink) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sink_ = sink;
+}
+
+bool MediaSynchronizer::Earlier(uint32_t a, uint32_t b) const {
+    const Slot &x = slots_[a];
+    const Slot &y = slots_[b];
+    if (x.timestampMs != y.timestampMs) {
+        return x.timestampMs < y.timestampMs;
+    }
+    // equal timestamps keep arrival order
+    return x.sequence < y.sequence;
+}
+
+void MediaSynchronizer::HeapPush(uint32_t slot) {
+    size_t i = heap_.size();
+    heap_.push_back(slot);
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!Earlier(heap_[i], heap_[parent])) {
+            break;
+        }
+        std::swap(heap_[i], heap_[parent]);
+        i = parent;
+    }
+}
+
+uint32_t MediaSynchronizer::HeapPop() {
+    uint32_t top = heap_[0];
+    heap_[0] = heap_.back();
+    heap_.pop_back();
+    size_t i = 0;
+    size_t size = heap_.size();
+    while (true) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t smallest = i;
+        if (left < size && Earlier(heap_[left], heap_[smallest])) {
+            smallest = left;
+        }
+        if (right < size && Earlier(heap_[right], heap_[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        std::swap(heap_[i], heap_[smallest]);
+        i = smallest;
+    }
+    return top;
+}
+
+MediaSynchronizer::StreamState *MediaSynchronizer::FindStream(SyncedMediaKind kind, uint32_t streamId) {
+    uint64_t key = ((uint64_t)kind << 32) | streamId;
+    size_t mask = kMaxStreams - 1;
+    size_t index = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    for (size_t probe = 0; probe < kMaxStreams; probe++) {
+        StreamState &state = streams_[index];
+        if (!state.inUse) {
+            state.inUse = true;
+            state.key = key;
+            state.released = false;
+            state.lastTimestampMs = 0;
+            state.expectedTimestampMs = 0;
+            return &state;
+        }
+        if (state.key == key) {
+            return &state;
+        }
+        index = (index + 1) & mask;
+    }
+    return nullptr;
+}
+
+uint32_t MediaSynchronizer::AcquireSlot(SyncedMediaKind kind) {
+    std::vector<uint32_t> &pool = kind == SYNCED_MEDIA_VIDEO ? freeVideo_ : freeAudio_;
+    // pool exhausted: release the oldest items early rather than dropping new media
+    while (pool.empty() && !heap_.empty()) {
+        forcedReleases_++;
+        Emit(HeapPop());
+    }
+    if (pool.empty()) {
+        return UINT32_MAX;
+    }
+    uint32_t slot = pool.back();
+    pool.pop_back();
+    return slot;
+}
+
+void MediaSynchronizer::Enqueue(uint32_t slot) {
+    Slot &item = slots_[slot];
+    item.sequence = sequence_++;
+    HeapPush(slot);
+    if (item.timestampMs > newestTimestampMs_) {
+        newestTimestampMs_ = item.timestampMs;
+    }
+    if (newestTimestampMs_ > jitterWindowMs_) {
+        ReleaseUntil(newestTimestampMs_ - jitterWindowMs_);
+    }
+}
+
+void MediaSynchronizer::PushAudio(uint32_t streamId, const float *samples, size_t count, unsigned long long timestampMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t offset = 0;
+    while (offset < count) {
+        size_t take = count - offset < kMaxAudioSlotSamples ? count - offset : kMaxAudioSlotSamples;
+        uint32_t index = AcquireSlot(SYNCED_MEDIA_AUDIO);
+        if (index == UINT32_MAX) {
+            return;
+        }
+        Slot &slot = slots_[index];
+        slot.kind = SYNCED_MEDIA_AUDIO;
+        slot.streamId = streamId;
+        slot.timestampMs = timestampMs + offset * 1000 / kAsrSampleRate;
+        slot.sampleCount = take;
+        memcpy(slot.samples, samples + offset, take * sizeof(float));
+        Enqueue(index);
+        offset += take;
+    }
+}
+
+void MediaSynchronizer::PushFeatures(uint32_t streamId, const float *frames, size_t frameCount, unsigned int bins,
+                                     unsigned int frameMs, unsigned long long timestampMs) {
+    if (bins == 0 || bins > kMaxAudioSlotSamples) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t framesPerSlot = kMaxAudioSlotSamples / bins;
+    size_t offset = 0;
+    while (offset < frameCount) {
+        size_t take = frameCount - offset < framesPerSlot ? frameCount - offset : framesPerSlot;
+        uint32_t index = AcquireSlot(SYNCED_MEDIA_FEATURES);
+        if (index == UINT32_MAX) {
+            return;
+        }
+        Slot &slot = slots_[index];
+        slot.kind = SYNCED_MEDIA_FEATURES;
+        slot.streamId = streamId;
+        slot.timestampMs = timestampMs + offset * frameMs;
+        slot.sampleCount = take * bins;
+        slot.width = bins;
+        slot.height = (unsigned int)take;
+        slot.frameMs = frameMs;
+        memcpy(slot.samples, frames + offset * bins, take * bins * sizeof(float));
+        Enqueue(index);
+        offset += take;
+    }
+}
+
+void MediaSynchronizer::PushVideo(uint32_t streamId, YUVRawDataI420 *frame) {
+    if (!frame || !frame->GetYBuffer() || !frame->GetUBuffer() || !frame->GetVBuffer()) {
+        return;
+    }
+    PushPlanes(streamId, (const uint8_t *)frame->GetYBuffer(), (const uint8_t *)frame->GetUBuffer(),
+               (const uint8_t *)frame->GetVBuffer(), frame->GetStreamWidth(), frame->GetStreamHeight(),
+               frame->GetTimeStamp());
+}
+
+void MediaSynchronizer::PushVideo(uint32_t streamId, const uint8_t *frame, unsigned int width, unsigned int height,
+                                  unsigned long long timestampMs) {
+    size_t ySize = (size_t)width * height;
+    PushPlanes(streamId, frame, frame + ySize, frame + ySize + ySize / 4, width, height, timestampMs);
+}
+
+void MediaSynchronizer::PushPlanes(uint32_t streamId, const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                                   unsigned int width, unsigned int height, unsigned long long timestampMs) {
+    size_t ySize = (size_t)width * height;
+    size_t uvSize = ySize / 4;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ySize + uvSize * 2 > maxVideoFrameBytes_) {
+        oversizeDrops_++;
+        return;
+    }
+    uint32_t index = AcquireSlot(SYNCED_MEDIA_VIDEO);
+    if (index == UINT32_MAX) {
+        return;
+    }
+    Slot &slot = slots_[index];
+    slot.streamId = streamId;
+    slot.timestampMs = timestampMs;
+    slot.width = width;
+    slot.height = height;
+    slot.frameBytes = ySize + uvSize * 2;
+    memcpy(slot.frame, y, ySize);
+    memcpy(slot.frame + ySize, u, uvSize);
+    memcpy(slot.frame + ySize + uvSize, v, uvSize);
+    Enqueue(index);
+}
+
+void MediaSynchronizer::SetJitterWindow(unsigned int jitterWindowMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jitterWindowMs_ = jitterWindowMs;
+}
+
+size_t MediaSynchronizer::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t released = heap_.size();
+    while (!heap_.empty()) {
+        Emit(HeapPop());
+    }
+    return released;
+}
+
+void MediaSynchronizer::ReleaseUntil(unsigned long long watermarkMs) {
+    while (!heap_.empty() && slots_[heap_[0]].timestampMs <= watermarkMs) {
+        Emit(HeapPop());
+    }
+}
+
+void MediaSynchronizer::Emit(uint32_t index) {
+    Slot &slot = slots_[index];
+    StreamState *state = FindStream(slot.kind, slot.streamId);
+
+    bool late = state && state->released && slot.timestampMs < state->lastTimestampMs;
+    if (late) {
+        // arrived after later media of the same stream was already released
+        lateDrops_++;
+    } else if (state) {
+        if (state->released && sink_) {
+            unsigned long long gapStart = 0;
+            if (slot.kind != SYNCED_MEDIA_VIDEO && slot.timestampMs > state->expectedTimestampMs + kAudioGapToleranceMs) {
+                gapStart = state->expectedTimestampMs;
+            } else if (slot.kind == SYNCED_MEDIA_VIDEO && slot.timestampMs > state->lastTimestampMs + kVideoGapMs) {
+                gapStart = state->lastTimestampMs;
+            }
+            if (gapStart != 0) {
+                SyncedMedia gap;
+                memset(&gap, 0, sizeof(gap));
+                gap.kind = SYNCED_MEDIA_GAP;
+                gap.gapKind = slot.kind;
+                gap.streamId = slot.streamId;
+                gap.timestampMs = gapStart;
+                gap.gapMs = slot.timestampMs - gapStart;
+                gaps_++;
+                sink_->onSyncedMedia(gap);
+            }
+        }
+        state->released = true;
+        state->lastTimestampMs = slot.timestampMs;
+        state->expectedTimestampMs = slot.timestampMs;
+        if (slot.kind == SYNCED_MEDIA_AUDIO) {
+            state->expectedTimestampMs += slot.sampleCount * 1000 / kAsrSampleRate;
+        } else if (slot.kind == SYNCED_MEDIA_FEATURES) {
+            state->expectedTimestampMs += (unsigned long long)slot.height * slot.frameMs;
+        }
+    }
+
+    if (!late && sink_) {
+        SyncedMedia media;
+        memset(&media, 0, sizeof(media));
+        media.kind = slot.kind;
+        media.streamId = slot.streamId;
+        media.timestampMs = slot.timestampMs;
+        if (slot.kind == SYNCED_MEDIA_AUDIO) {
+            media.samples = slot.samples;
+            media.sampleCount = slot.sampleCount;
+        } else if (slot.kind == SYNCED_MEDIA_FEATURES) {
+            media.features = slot.samples;
+            media.featureFrames = slot.height;
+            media.featureBins = slot.width;
+            media.frameMs = slot.frameMs;
+        } else {
+            media.frame = slot.frame;
+            media.width = slot.width;
+            media.height = slot.height;
+            media.frameBytes = slot.frameBytes;
+        }
+        sink_->onSyncedMedia(media);
+    }
+
+    if (slot.kind == SYNCED_MEDIA_VIDEO) {
+        freeVideo_.push_back(index);
+    } else {
+        freeAudio_.push_back(index);
+    }
+}
+
+void MediaSynchronizer::CollectMetrics(MetricsWriter &writer, void *context) {
+    MediaSynchronizer *self = static_cast<MediaSynchronizer *>(context);
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    writer.Write("zoom_bot_sync_buffered_items", self->heap_.size());
+    writer.Write("zoom_bot_sync_late_drops_total", self->lateDrops_);
+    writer.Write("zoom_bot_sync_oversize_drops_total", self->oversizeDrops_);
+    writer.Write("zoom_bot_sync_forced_releases_total", self->forcedReleases_);
+    writer.Write("zoom_bot_sync_gaps_total", self->gaps_);
+}
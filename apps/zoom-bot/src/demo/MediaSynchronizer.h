@@ -0,0 +1,158 @@
+// Timestamp-ordered jitter buffer that aligns audio and video before they are written
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Metrics.h"
+
+class YUVRawDataI420;
+
+enum SyncedMediaKind {
+    SYNCED_MEDIA_AUDIO,
+    SYNCED_MEDIA_VIDEO,
+    // a stream skipped ahead; [timestampMs, timestampMs + gapMs) has no media
+    SYNCED_MEDIA_GAP,
+    // log-mel frames of an audio stream
+    SYNCED_MEDIA_FEATURES,
+};
+
+// One released item. Pointers are only valid during the sink call.
+struct SyncedMedia {
+    SyncedMediaKind kind;
+    // stream the item belongs to; gaps carry the kind of stream that skipped in gapKind
+    uint32_t streamId;
+    unsigned long long timestampMs;
+
+    // SYNCED_MEDIA_AUDIO: 16 kHz mono samples
+    const float *samples;
+    size_t sampleCount;
+
+    // SYNCED_MEDIA_VIDEO: contiguous I420 planes
+    const uint8_t *frame;
+    unsigned int width;
+    unsigned int height;
+    size_t frameBytes;
+
+    // SYNCED_MEDIA_FEATURES: featureFrames frames of featureBins values, frameMs apart
+    const float *features;
+    size_t featureFrames;
+    unsigned int featureBins;
+    unsigned int frameMs;
+
+    // SYNCED_MEDIA_GAP
+    SyncedMediaKind gapKind;
+    unsigned long long gapMs;
+};
+
+class MediaSyncSink {
+public:
+    virtual ~MediaSyncSink() {}
+
+    /// \brief Called with audio and video in non-decreasing timestamp order across all streams.
+    /// A gap is reported when its stream resumes, just before the item that ends it, so its
+    /// start can be earlier than media of other streams that was already released.
+    virtual void onSyncedMedia(const SyncedMedia &media) = 0;
+};
+
+// Buffers media from all streams for a short jitter window and releases it in SDK timestamp
+// order. Payloads are copied into slots preallocated at construction and ordered by a
+// fixed-capacity min-heap, so pushing and releasing never allocate.
+class MediaSynchronizer {
+public:
+    /// \param jitterWindowMs How long an item is held back waiting for earlier items.
+    /// \param audioSlots Number of pooled audio chunks, each up to kMaxAudioSlotSamples.
+    /// \param videoSlots Number of pooled video frames, each up to maxVideoFrameBytes.
+    MediaSynchronizer(unsigned int jitterWindowMs = 120, size_t audioSlots = 256, size_t videoSlots = 8,
+                      size_t maxVideoFrameBytes = 1280 * 720 * 3 / 2);
+    ~MediaSynchronizer();
+
+    void SetSink(MediaSyncSink *sink);
+
+    /// \brief Queue 16 kHz mono audio. Chunks longer than a slot are split.
+    void PushAudio(uint32_t streamId, const float *samples, size_t count, unsigned long long timestampMs);
+
+    /// \brief Queue log-mel frames. They share the audio slots, split when they do not fit one.
+    void PushFeatures(uint32_t streamId, const float *frames, size_t frameCount, unsigned int bins,
+                      unsigned int frameMs, unsigned long long timestampMs);
+
+    /// \brief Queue a copy of an I420 frame.
+    void PushVideo(uint32_t streamId, YUVRawDataI420 *frame);
+
+    /// \brief Queue a copy of a contiguous I420 frame, e.g. one composed by the bot.
+    void PushVideo(uint32_t streamId, const uint8_t *frame, unsigned int width, unsigned int height,
+                   unsigned long long timestampMs);
+
+    /// \brief Release everything that is buffered, regardless of the jitter window.
+    /// \return The number of buffered items released.
+    size_t Flush();
+
+    /// \brief Change the jitter window; items already queued are released by the new one.
+    void SetJitterWindow(unsigned int jitterWindowMs);
+
+private:
+    static const size_t kMaxAudioSlotSamples = 1600;
+    static const size_t kMaxStreams = 512;
+    // audio further than this past the expected timestamp is reported as a gap
+    static const unsigned int kAudioGapToleranceMs = 30;
+    static const unsigned int kVideoGapMs = 500;
+
+    struct Slot {
+        SyncedMediaKind kind;
+        uint32_t streamId;
+        unsigned long long timestampMs;
+        unsigned long long sequence;
+        // floats used in samples, for audio and features
+        size_t sampleCount;
+        // video frame size; features keep bins in width and frames in height
+        unsigned int width;
+        unsigned int height;
+        size_t frameBytes;
+        unsigned int frameMs;
+        float *samples;
+        uint8_t *frame;
+    };
+
+    struct StreamState {
+        uint64_t key;
+        bool inUse;
+        bool released;
+        unsigned long long lastTimestampMs;
+        unsigned long long expectedTimestampMs;
+    };
+
+    bool Earlier(uint32_t a, uint32_t b) const;
+    void HeapPush(uint32_t slot);
+    uint32_t HeapPop();
+    uint32_t AcquireSlot(SyncedMediaKind kind);
+    void Enqueue(uint32_t slot);
+    void PushPlanes(uint32_t streamId, const uint8_t *y, const uint8_t *u, const uint8_t *v, unsigned int width,
+                    unsigned int height, unsigned long long timestampMs);
+    void ReleaseUntil(unsigned long long watermarkMs);
+    void Emit(uint32_t slot);
+    StreamState *FindStream(SyncedMediaKind kind, uint32_t streamId);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    std::mutex mutex_;
+    MediaSyncSink *sink_;
+    unsigned int jitterWindowMs_;
+    size_t maxVideoFrameBytes_;
+    unsigned long long newestTimestampMs_;
+    unsigned long long sequence_;
+
+    std::vector<Slot> slots_;
+    std::unique_ptr<float[]> audioStorage_;
+    std::unique_ptr<uint8_t[]> videoStorage_;
+    std::vector<uint32_t> freeAudio_;
+    std::vector<uint32_t> freeVideo_;
+    std::vector<uint32_t> heap_;
+    std::vector<StreamState> streams_;
+
+    unsigned long long lateDrops_;
+    unsigned long long oversizeDrops_;
+    unsigned long long forcedReleases_;
+    unsigned long long gaps_;
+};
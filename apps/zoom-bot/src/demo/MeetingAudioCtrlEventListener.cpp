@@ -0,0 +1,30 @@
+#include "MeetingAudioCtrlEventListener.h"
+
+MeetingAudioCtrlEventListener::MeetingAudioCtrlEventListener(MeetingEventBus* events)
+{
+	events_ = events;
+}
+
+/// \brief User's audio status changed callback.
+/// \param lstAudioStatusChange List of the user information with audio status changed. The list will be emptied once the function calls end. 
+void MeetingAudioCtrlEventListener::onUserAudioStatusChange(IList<IUserAudioStatus* >* lstAudioStatusChange, const zchar_t* strAudioStatusList)
+{
+	if (!lstAudioStatusChange) return;
+	for (int i = 0; i < lstAudioStatusChange->GetCount(); i++) {
+		IUserAudioStatus* status = lstAudioStatusChange->GetItem(i);
+		if (!status) continue;
+		AudioStatus audio = status->GetStatus();
+		MeetingEvent event(MEETING_EVENT_USER_AUDIO_CHANGED);
+		event.userId = status->GetUserId();
+		event.flag = audio == Audio_Muted || audio == Audio_Muted_ByHost || audio == Audio_MutedAll_ByHost;
+		events_->Post(event);
+	}
+}
+
+void MeetingAudioCtrlEventListener::onUserActiveAudioChange(IList<unsigned int >* plstActiveAudio) {}
+
+void MeetingAudioCtrlEventListener::onHostRequestStartAudio(IRequestStartAudioHandler* handler_) {}
+
+void MeetingAudioCtrlEventListener::onJoin3rdPartyTelephonyAudio(const zchar_t* audioInfo) {}
+
+void MeetingAudioCtrlEventListener::onMuteOnEntryStatusChange(bool bEnabled) {}
@@ -0,0 +1,38 @@
+#include "zoom_sdk.h"
+#include <meeting_service_interface.h>
+#include <meeting_service_components/meeting_audio_interface.h>
+
+#include "MeetingEventBus.h"
+
+USING_ZOOM_SDK_NAMESPACE
+
+class MeetingAudioCtrlEventListener :
+	public IMeetingAudioCtrlEvent
+{
+	MeetingEventBus* events_;
+
+public:
+	/// \brief Mute changes are posted to events and handled on the main loop.
+	MeetingAudioCtrlEventListener(MeetingEventBus* events);
+
+	/// \brief User's audio status changed callback.
+	/// \param lstAudioStatusChange List of the user information with audio status changed. The list will be emptied once the function calls end. 
+	/// \param strAudioStatusList List of the user information whose audio status changes, saved in json format. This parameter is currently invalid, hereby only for reservations. 
+	virtual void onUserAudioStatusChange(IList<IUserAudioStatus* >* lstAudioStatusChange, const zchar_t* strAudioStatusList = nullptr);
+
+	/// \brief The callback event that users whose audio is active changed.
+	/// \param plstActiveAudio List to store the ID of user whose audio is active.
+	virtual void onUserActiveAudioChange(IList<unsigned int >* plstActiveAudio);
+
+	/// \brief Callback event of the requirement to turn on the audio from the host.
+	/// \param handler_ A pointer to the IRequestStartAudioHandler. For more details, see \link IRequestStartAudioHandler \endlink.
+	virtual void onHostRequestStartAudio(IRequestStartAudioHandler* handler_);
+
+	/// \brief Callback event that requests to join third party telephony audio.
+	/// \param audioInfo Instruction on how to join the meeting with third party audio.
+	virtual void onJoin3rdPartyTelephonyAudio(const zchar_t* audioInfo);
+
+	/// \brief Callback event for the mute on entry status change. 
+	/// \param bEnabled Specify whether mute on entry is enabled or not.
+	virtual void onMuteOnEntryStatusChange(bool bEnabled);
+};
@@ -0,0 +1,117 @@
+// Hands SDK callbacks over to the GLib main loop as typed events
+
+#include "MeetingEventBus.h"
+
+namespace {
+
+gboolean DispatchWhenReady(GSource *source, GSourceFunc callback, gpointer data) {
+    // stay idle until the next Post marks the source ready again
+    g_source_set_ready_time(source, -1);
+    return callback(data);
+}
+
+// no prepare/check: the source is dispatched only when its ready time is set
+GSourceFuncs kEventSourceFuncs = {nullptr, nullptr, &DispatchWhenReady, nullptr};
+
+} // namespace
+
+MeetingEventBus::MeetingEventBus(Handler handler, void *handlerContext, GMainContext *context)
+    : handler_(handler), handlerContext_(handlerContext), source_(nullptr), head_(&stub_), tail_(&stub_),
+      scheduled_(false), sequence_(0), dispatched_(0), maxDelayUs_(0) {
+    stub_.next.store(nullptr, std::memory_order_relaxed);
+
+    source_ = g_source_new(&kEventSourceFuncs, sizeof(GSource));
+    g_source_set_callback(source_, &MeetingEventBus::HandleReady, this, nullptr);
+    g_source_set_ready_time(source_, -1);
+    g_source_attach(source_, context);
+    Metrics::Instance().AddCollector(&MeetingEventBus::CollectMetrics, this);
+}
+
+MeetingEventBus::~MeetingEventBus() {
+    Metrics::Instance().RemoveCollector(this);
+    g_source_destroy(source_);
+    g_source_unref(source_);
+    // producers are gone by now; drop what they left behind
+    while (Node *node = Pop()) {
+        delete node;
+    }
+}
+
+void MeetingEventBus::Post(const MeetingEvent &event) {
+    Node *node = new Node;
+    node->event = event;
+    node->event.sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+    node->event.postedAt = std::chrono::steady_clock::now();
+    Push(node);
+
+    // the node is linked before the flag is read, so a dispatcher that already cleared the
+    // flag either sees the node or leaves the flag for us to set again
+    if (!scheduled_.exchange(true)) {
+        g_source_set_ready_time(source_, 0);
+    }
+}
+
+size_t MeetingEventBus::Dispatch() {
+    scheduled_.store(false);
+    size_t handled = 0;
+    while (Node *node = Pop()) {
+        long long delayUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - node->event.postedAt)
+                                .count();
+        long long maxDelayUs = maxDelayUs_.load(std::memory_order_relaxed);
+        while (delayUs > maxDelayUs && !maxDelayUs_.compare_exchange_weak(maxDelayUs, delayUs)) {
+        }
+        handler_(node->event, handlerContext_);
+        delete node;
+        handled++;
+    }
+    dispatched_ += handled;
+    return handled;
+}
+
+void MeetingEventBus::Push(Node *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *previous = head_.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+MeetingEventBus::Node *MeetingEventBus::Pop() {
+    Node *tail = tail_;
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+        if (!next) {
+            return nullptr;
+        }
+        tail_ = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+        // a producer swapped in a node but has not linked it yet; its Post reschedules us
+        return nullptr;
+    }
+    // tail is the last node: put the stub behind it so tail can be handed out
+    Push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+gboolean MeetingEventBus::HandleReady(gpointer data) {
+    static_cast<MeetingEventBus *>(data)->Dispatch();
+    return G_SOURCE_CONTINUE;
+}
+
+void MeetingEventBus::CollectMetrics(MetricsWriter &writer, void *context) {
+    MeetingEventBus *self = static_cast<MeetingEventBus *>(context);
+    writer.Write("zoom_bot_events_posted_total", (double)self->sequence_.load());
+    writer.Write("zoom_bot_events_dispatched_total", (double)self->dispatched_.load());
+    writer.Write("zoom_bot_event_dispatch_delay_max_us", (double)self->maxDelayUs_.exchange(0));
+}
@@ -0,0 +1,97 @@
+// Hands SDK callbacks over to the GLib main loop as typed events
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <glib.h>
+#include <vector>
+
+#include "Metrics.h"
+
+enum MeetingEventType {
+    // status and result of IMeetingServiceEvent::onMeetingStatusChanged
+    MEETING_EVENT_STATUS_CHANGED,
+    // the SDK is about to join; sent with the meeting parameters
+    MEETING_EVENT_JOINING,
+    // userId is the new host
+    MEETING_EVENT_HOST_CHANGED,
+    // userId gained (flag) or lost co-host
+    MEETING_EVENT_COHOST_CHANGED,
+    // flag tells whether this user may record now
+    MEETING_EVENT_RECORDING_PRIVILEGE_CHANGED,
+    // userIds joined, left or were renamed
+    MEETING_EVENT_USERS_JOINED,
+    MEETING_EVENT_USERS_LEFT,
+    MEETING_EVENT_USER_NAMES_CHANGED,
+    // flag tells whether userId is muted now
+    MEETING_EVENT_USER_AUDIO_CHANGED,
+    // flag tells whether userId has video on now
+    MEETING_EVENT_USER_VIDEO_CHANGED,
+    // the SDK destroyed a video renderer; userId is the user it was subscribed to
+    MEETING_EVENT_RENDERER_DESTROYED,
+};
+
+struct MeetingEvent {
+    MeetingEventType type;
+    int status;
+    int result;
+    unsigned int userId;
+    bool flag;
+    // copied out of the SDK list, which is only valid during the callback
+    std::vector<unsigned int> userIds;
+
+    // set by Post; events are dispatched in this order
+    uint64_t sequence;
+    std::chrono::steady_clock::time_point postedAt;
+
+    explicit MeetingEvent(MeetingEventType type = MEETING_EVENT_STATUS_CHANGED)
+        : type(type), status(0), result(0), userId(0), flag(false), sequence(0) {}
+};
+
+// SDK listeners only describe what happened and Post it; the handler runs later on the
+// thread of the main loop, where it is safe to make blocking SDK calls and (un)subscribe
+// raw data. Producers never take a lock: events go through an intrusive MPSC queue and the
+// first event after a dispatch marks a GSource ready, which also wakes the loop.
+class MeetingEventBus {
+public:
+    typedef void (*Handler)(const MeetingEvent &event, void *context);
+
+    /// \param context Main context to dispatch on; nullptr is the default context.
+    MeetingEventBus(Handler handler, void *handlerContext, GMainContext *context = nullptr);
+    ~MeetingEventBus();
+
+    /// \brief Queue event for the main loop. Safe to call from any thread.
+    void Post(const MeetingEvent &event);
+
+    /// \brief Run the handler for every queued event. Must be called on the main loop thread.
+    /// \return The number of events handled.
+    size_t Dispatch();
+
+private:
+    struct Node {
+        std::atomic<Node *> next;
+        MeetingEvent event;
+    };
+
+    void Push(Node *node);
+    Node *Pop();
+    static gboolean HandleReady(gpointer data);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    Handler handler_;
+    void *handlerContext_;
+    GSource *source_;
+
+    // producers swap themselves in at head_, the dispatcher consumes from tail_
+    std::atomic<Node *> head_;
+    Node *tail_;
+    Node stub_;
+    // true while the source is marked ready, so only one producer per batch touches GLib
+    std::atomic<bool> scheduled_;
+
+    std::atomic<uint64_t> sequence_;
+    std::atomic<unsigned long long> dispatched_;
+    // longest time an event waited for the main loop since the last scrape
+    std::atomic<long long> maxDelayUs_;
+};
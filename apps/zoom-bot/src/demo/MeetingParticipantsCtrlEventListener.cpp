@@ -4,27 +4,46 @@ using namespace std;
 
 
 
-MeetingParticipantsCtrlEventListener::MeetingParticipantsCtrlEventListener(void(*onHostPrivilegeGranted)(), void(*onCoHostPrivilegeGranted)())
+MeetingParticipantsCtrlEventListener::MeetingParticipantsCtrlEventListener(MeetingEventBus* events)
 
 {
-	onHostPrivilegeGranted_ = onHostPrivilegeGranted;
-	onCoHostPrivilegeGranted_ = onCoHostPrivilegeGranted;
+	events_ = events;
+}
+
+// the list belongs to the SDK and is only valid during the callback, so the ids are copied
+void MeetingParticipantsCtrlEventListener::PostUsers(MeetingEventType type, IList<unsigned int>* lstUserID)
+{
+	MeetingEvent event(type);
+	if (lstUserID) {
+		int count = lstUserID->GetCount();
+		event.userIds.reserve(count);
+		for (int i = 0; i < count; i++) {
+			event.userIds.push_back(lstUserID->GetItem(i));
+		}
+	}
+	events_->Post(event);
 }
 
 /// \brief Callback event of notification of users who are in the meeting.
 	/// \param lstUserID List of the user ID. 
 	/// \param strUserList List of user in json format. This function is currently invalid, hereby only for reservations.
-void MeetingParticipantsCtrlEventListener::onUserJoin(IList<unsigned int >* lstUserID, const zchar_t* strUserList ){ }
+void MeetingParticipantsCtrlEventListener::onUserJoin(IList<unsigned int >* lstUserID, const zchar_t* strUserList ) {
+	PostUsers(MEETING_EVENT_USERS_JOINED, lstUserID);
+}
 
 /// \brief Callback event of notification of user who leaves the meeting.
 /// \param lstUserID List of the user ID who leaves the meeting.
 /// \param strUserList List of the user in json format. This function is currently invalid, hereby only for reservations.
-void MeetingParticipantsCtrlEventListener::onUserLeft(IList<unsigned int >* lstUserID, const zchar_t* strUserList ) {}
+void MeetingParticipantsCtrlEventListener::onUserLeft(IList<unsigned int >* lstUserID, const zchar_t* strUserList ) {
+	PostUsers(MEETING_EVENT_USERS_LEFT, lstUserID);
+}
 
 /// \brief Callback event of notification of the new host. 
 /// \param userId Specify the ID of the new host. 
 void MeetingParticipantsCtrlEventListener::onHostChangeNotification(unsigned int userId) {
-	if (onHostPrivilegeGranted_) onHostPrivilegeGranted_();
+	MeetingEvent event(MEETING_EVENT_HOST_CHANGED);
+	event.userId = userId;
+	events_->Post(event);
 }
 
 /// \brief Callback event of changing the state of the hand.
@@ -34,13 +53,18 @@ void MeetingParticipantsCtrlEventListener::onLowOrRaiseHandStatusChanged(bool bL
 
 /// \brief Callback event of changing the screen name. 
 /// \param userId list Specify the users ID whose status changes.
-void MeetingParticipantsCtrlEventListener::onUserNamesChanged(IList<unsigned int>* lstUserID) {}
+void MeetingParticipantsCtrlEventListener::onUserNamesChanged(IList<unsigned int>* lstUserID) {
+	PostUsers(MEETING_EVENT_USER_NAMES_CHANGED, lstUserID);
+}
 
 /// \brief Callback event of changing the co-host.
 /// \param userId Specify the user ID whose status changes. 
 /// \param isCoHost TRUE indicates that the specified user is co-host.
 void MeetingParticipantsCtrlEventListener::onCoHostChangeNotification(unsigned int userId, bool isCoHost) {
-	if (onCoHostPrivilegeGranted_) onCoHostPrivilegeGranted_();
+	MeetingEvent event(MEETING_EVENT_COHOST_CHANGED);
+	event.userId = userId;
+	event.flag = isCoHost;
+	events_->Post(event);
 }
 /// \brief Callback event of invalid host key.
 void MeetingParticipantsCtrlEventListener::onInvalidReclaimHostkey() {}
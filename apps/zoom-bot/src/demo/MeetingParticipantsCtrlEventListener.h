@@ -3,16 +3,21 @@
 #include <meeting_service_interface.h>
 #include <meeting_service_components/meeting_audio_interface.h>
 #include <meeting_service_components/meeting_participants_ctrl_interface.h>
+
+#include "MeetingEventBus.h"
+
 USING_ZOOM_SDK_NAMESPACE
 
 class MeetingParticipantsCtrlEventListener :
 	public IMeetingParticipantsCtrlEvent
 {
-	void (*onHostPrivilegeGranted_)();
-	void (*onCoHostPrivilegeGranted_)();
+	MeetingEventBus* events_;
+
+	void PostUsers(MeetingEventType type, IList<unsigned int>* lstUserID);
 
 public:
-	MeetingParticipantsCtrlEventListener(void (*onHostPrivilegeGranted)(), void (*onCoHostPrivilegeGranted)());
+	/// \brief Roster and role changes are posted to events and handled on the main loop.
+	MeetingParticipantsCtrlEventListener(MeetingEventBus* events);
 
 
 	/// \brief Callback event of notification of users who are in the meeting.
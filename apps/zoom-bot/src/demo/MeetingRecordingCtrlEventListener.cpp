@@ -3,9 +3,9 @@
 using namespace std;
 
 
-MeetingRecordingCtrlEventListener::MeetingRecordingCtrlEventListener(void(*onRecordingPermissionGranted)())
+MeetingRecordingCtrlEventListener::MeetingRecordingCtrlEventListener(MeetingEventBus* events)
 {
-	onRecordingPermissionGranted_ = onRecordingPermissionGranted;
+	events_ = events;
 }
 
 /// \brief Callback event that the status of my local recording changes.
@@ -18,10 +18,9 @@ void MeetingRecordingCtrlEventListener::onCloudRecordingStatus(RecordingStatus s
 /// \brief Callback event that the recording authority changes.
 /// \param bCanRec TRUE indicates to enable to record.
 void MeetingRecordingCtrlEventListener::onRecordPrivilegeChanged(bool bCanRec) {
-
-	if (bCanRec) {
-		if (onRecordingPermissionGranted_) onRecordingPermissionGranted_();
-	}
+	MeetingEvent event(MEETING_EVENT_RECORDING_PRIVILEGE_CHANGED);
+	event.flag = bCanRec;
+	events_->Post(event);
 }
 
 /// \brief Callback event that the status of request local recording privilege.
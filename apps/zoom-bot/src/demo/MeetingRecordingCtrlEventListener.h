@@ -2,14 +2,17 @@
 #include <meeting_service_components/meeting_recording_interface.h>
 #include "zoom_sdk.h"
 
+#include "MeetingEventBus.h"
+
 
 USING_ZOOM_SDK_NAMESPACE
 
 class MeetingRecordingCtrlEventListener : public IMeetingRecordingCtrlEvent
 {
-	void (*onRecordingPermissionGranted_)();
+	MeetingEventBus* events_;
 public:
-	MeetingRecordingCtrlEventListener(void (*onRecordingPermissionGranted)());
+	/// \brief Recording privilege changes are posted to events and handled on the main loop.
+	MeetingRecordingCtrlEventListener(MeetingEventBus* events);
 
 	/// \brief Callback event that the status of my local recording changes.
 	/// \param status Value of recording status. For more details, see \link RecordingStatus \endlink enum.
@@ -1,5 +1,7 @@
 #include <algorithm>
+#include <fcntl.h>
 #include <fstream>
+#include <glib-unix.h>
 #include <glib.h>
 #include <iosfwd>
 #include <iostream>
@@ -21,266 +23,65 @@
 #include "setting_service_interface.h"
 #include "zoom_sdk.h"
 
-// used to accept prompts
-#include "MeetingReminderEventListener.h"
-// used to listen to callbacks from meeting related matters
-#include "MeetingServiceEventListener.h"
 // used to listen to callbacks from authentication related matters
 #include "AuthServiceEventListener.h"
+// the start-up and meeting lifecycle are coroutines on the main loop
+#include "MainLoopTask.h"
 // used for connection helper
 #include "NetworkConnectionHandler.h"
 
-// used for event listener
-#include "MeetingParticipantsCtrlEventListener.h"
-#include "MeetingRecordingCtrlEventListener.h"
+// typed settings with ConfigMap/environment overrides and hot reload
+#include "BotConfig.h"
+// per-meeting services, raw data capture and recording
+#include "MeetingSession.h"
+// one worker process per meeting when config.txt lists several, plus the warm worker pool
+#include "ControlProtocol.h"
+#include "SessionSupervisor.h"
 
-// references for enableVideoRawDataCapture
-#include "ZoomSdkRenderer.h"
-#include "rawdata/rawdata_renderer_interface.h"
-#include "rawdata/zoom_rawdata_api.h"
-
-// references for enableAudioRawDataCapture
-#include "ZoomSdkAudioRawData.h"
-#include "meeting_service_components/meeting_recording_interface.h"
-
-// references for enableVideoRawDataPublishing
-#include "ZoomSdkVideoSource.h"
-
-// references for enableAudioRawDataPublishing
-#include "ZoomSdkVirtualAudioMicEvent.h"
+// references for pipeline metrics
+#include "AudioResampler.h"
+#include "Metrics.h"
+#include "ThreadPolicy.h"
 
 #include <mutex>
+#include <vector>
 
 USING_ZOOM_SDK_NAMESPACE
 
-// references for enableAudioRawDataPublishing
-const std::string kDefaultAudioSource = "yourwavefile.wav";
-
-// references for enableVideoRawDataPublishing
-const std::string kDefaultVideoSource = "yourmp4file.mp4";
-
 GMainLoop *mainLoop;
 
-// These are needed to readsettingsfromTEXT named config.txt
-std::string meetingNumber, token, meetingPassword, recordingToken;
+// config.txt merged with the ConfigMap mount and the environment, see BotConfig.h
+ConfigStore *configStore = nullptr;
 
-// Services which are needed to initialize, authenticate and configure settings for the SDK
+// Services which are needed to initialize and authenticate the SDK, shared by the process
 ZOOM_SDK_NAMESPACE::IAuthService *m_pAuthService;
-ZOOM_SDK_NAMESPACE::IMeetingService *m_pMeetingService;
-ZOOM_SDK_NAMESPACE::ISettingService *m_pSettingService;
 INetworkConnectionHelper *networkConnectionHelper;
 
-// references for enableVideoRawDataCapture
-ZoomSdkRenderer *videoRenderer = new ZoomSdkRenderer();
-IZoomSDKRenderer *videoHelper;
-IMeetingRecordingController *m_pRecordController;
-IMeetingParticipantsController *m_pParticipantsController;
-
-// references for enableAudioRawDataCapture
-ZoomSdkAudioRawData *audioRawDataSink = new ZoomSdkAudioRawData();
-IZoomSDKAudioRawDataHelper *audioHelper;
-
-// this is used to get a userID, there is no specific proper logic here. It just gets the first userID.
-// userID is needed for video subscription.
-unsigned int userID;
-
-// this will enable or disable logic to get raw video and raw audio
-// do note that this will be overwritten by config.txt
-bool enableVideoRawDataCapture = true;
-bool enableAudioRawDataCapture = true;
-bool enableVideoRawDataPublishing = false;
-bool enableAudioRawDataPublishing = false;
-
-// this is a helper method to get the first User ID, it is just an arbitary UserID
-uint32_t GetFirstParticipantId() {
-    m_pParticipantsController = m_pMeetingService->GetMeetingParticipantsController();
-    int returnvalue = m_pParticipantsController->GetParticipantsList()->GetItem(0);
-    std::cout << "UserID is : " << returnvalue << std::endl;
-    return returnvalue;
-}
-
-IUserInfo *GetCurrentUser() {
-    m_pParticipantsController = m_pMeetingService->GetMeetingParticipantsController();
-    IUserInfo *returnvalue = m_pParticipantsController->GetMySelfUser();
-    // std::cout << "UserID is : " << returnvalue << std::endl;
-    return returnvalue;
-}
+// the meeting of this process, created once the configuration is known or, in a warm
+// worker, once the supervisor assigns one
+MeetingSession *meetingSession = nullptr;
 
-// this is a helper method to get the first User Object, it is just an arbitary User Object
-IUserInfo *GetFirstParticipant() {
-    m_pParticipantsController = m_pMeetingService->GetMeetingParticipantsController();
-    int userID = m_pParticipantsController->GetParticipantsList()->GetItem(0);
-    IUserInfo *returnvalue = m_pParticipantsController->GetUserByUserID(userID);
-    std::cout << "UserID is : " << returnvalue << std::endl;
-    return returnvalue;
-}
+// socket to the supervisor when this process is a warm worker, otherwise -1
+int supervisorFd = -1;
+LineBuffer supervisorInput;
 
-// check if you have permission to start raw recording
-void StartRawRecordingIfPermitted(bool isVideo, bool isAudio) {
-
-    if (isVideo || isAudio) {
-        m_pRecordController = m_pMeetingService->GetMeetingRecordingController();
-        SDKError err2 = m_pMeetingService->GetMeetingRecordingController()->CanStartRawRecording();
-
-        if (err2 == SDKERR_SUCCESS) {
-            SDKError err1 = m_pRecordController->StartRawRecording();
-            if (err1 != SDKERR_SUCCESS) {
-                std::cout << "Error occurred starting raw recording" << std::endl;
-            } else {
-                // enableVideoRawDataCapture
-                if (isVideo) {
-                    SDKError err = createRenderer(&videoHelper, videoRenderer);
-                    if (err != SDKERR_SUCCESS) {
-                        std::cout << "Error occurred" << std::endl;
-                        // Handle error
-                    } else {
-                        std::cout << "attemptToStartRawRecording : subscribing" << std::endl;
-                        videoHelper->setRawDataResolution(ZoomSDKResolution_720P);
-                        videoHelper->subscribe(GetFirstParticipantId(), RAW_DATA_TYPE_VIDEO);
-                    }
-                }
-                // enableAudioRawDataCapture
-                if (isAudio) {
-                    audioHelper = GetAudioRawdataHelper();
-                    std::cout << "attemptToStartRawRecording : audio helper obtained = " << (audioHelper != nullptr) << std::endl;
-
-                    // Check if HasRawdataLicense returns true
-                    bool hasLicense = HasRawdataLicense();
-                    std::cout << "Has Raw Data License: " << (hasLicense ? "Yes" : "No") << std::endl;
-
-                    if (audioHelper && audioRawDataSink) {
-                        // Try to unsubscribe first in case there's a previous subscription
-                        audioHelper->unSubscribe();
-
-                        // Now attempt to subscribe
-                        SDKError err = audioHelper->subscribe(audioRawDataSink);
-                        std::cout << "Error occurred subscribing to audio : " << err << std::endl;
-                        std::cout << "SDKERR_SUCCESS : " << SDKERR_SUCCESS << std::endl;
-
-                        if (err != SDKERR_SUCCESS) {
-                            std::cout << "Error occurred subscribing to audio : " << err << std::endl;
-                            // Try with interpreter parameter set to true
-                            err = audioHelper->subscribe(audioRawDataSink, true);
-                            std::cout << "Attempted with interpreter flag: Error = " << err << std::endl;
-                        }
-                    } else {
-                        std::cout << "Error getting audioHelper" << std::endl;
-                    }
-                }
-            }
-        } else {
-            std::cout << "Cannot start raw recording: no permissions yet, need host, co-host, or recording privilege" << std::endl;
-        }
-    }
-}
+// authentication results as the SDK reports them, for AuthenticateMeetingSdk
+AsyncChannel<AuthResult> authResults;
 
-// check if you meet the requirements to send raw data
-void StartRawDataPublishingIfPermitted(bool isVideo, bool isAudio) {
+// what this process is doing: authenticating, then attending its meeting
+Task<> lifecycle;
 
-    // enableVideoRawDataPublishing
-    if (isVideo) {
+// nonzero when the SDK could not be authenticated or the meeting joined, so the
+// supervisor restarts the worker
+int exitCode = 0;
 
-        ZoomSdkVideoSource *virtualVideoSource = new ZoomSdkVideoSource(kDefaultVideoSource);
-        IZoomSDKVideoSourceHelper *videoSourceHelper = GetRawdataVideoSourceHelper();
+// how long SDKAuth may take to answer, and how often a failed authentication is tried
+const unsigned int kAuthTimeoutMs = 30000;
+const unsigned int kMaxAuthAttempts = 3;
 
-        if (videoSourceHelper) {
-            SDKError err = videoSourceHelper->setExternalVideoSource(virtualVideoSource);
-
-            if (err != SDKERR_SUCCESS) {
-                printf("attemptToStartRawVideoSending(): Failed to set external video source, error code: %d\n", err);
-            } else {
-                printf("attemptToStartRawVideoSending(): Success \n");
-                IMeetingVideoController *meetingController = m_pMeetingService->GetMeetingVideoController();
-                meetingController->UnmuteVideo();
-            }
-        } else {
-            printf("attemptToStartRawVideoSending(): Failed to get video source helper\n");
-        }
-    }
-
-    // enableAudioRawDataPublishing
-    if (isAudio) {
-        ZoomSdkVirtualAudioMicEvent *virtualAudioMic = new ZoomSdkVirtualAudioMicEvent(kDefaultAudioSource);
-        IZoomSDKAudioRawDataHelper *audioPublishingHelper = GetAudioRawdataHelper();
-        if (audioPublishingHelper) {
-            SDKError err = audioPublishingHelper->setExternalAudioSource(virtualAudioMic);
-        }
-    }
-}
-
-// callback when given host permission
-void HandleHostPrivilege() {
-    printf("Is host now...\n");
-    StartRawRecordingIfPermitted(enableVideoRawDataCapture, enableAudioRawDataCapture);
-}
-
-// callback when given cohost permission
-void HandleCoHostPrivilege() {
-    printf("Is co-host now...\n");
-    StartRawRecordingIfPermitted(enableVideoRawDataCapture, enableAudioRawDataCapture);
-}
-// callback when given recording permission
-void HandleRecordingPermissionGranted() {
-    printf("Is given recording permissions now...\n");
-    StartRawRecordingIfPermitted(enableVideoRawDataCapture, enableAudioRawDataCapture);
-}
-
-void EnableRawDataPublishing() {
-    // testing WIP
-    if (enableVideoRawDataPublishing) {
-        IMeetingVideoController *meetingVidController = m_pMeetingService->GetMeetingVideoController();
-        meetingVidController->UnmuteVideo();
-    }
-    // testing WIP
-    if (enableAudioRawDataPublishing) {
-        IMeetingAudioController *meetingAudController = m_pMeetingService->GetMeetingAudioController();
-        meetingAudController->JoinVoip();
-        printf("Is my audio muted: %d\n", GetCurrentUser()->IsAudioMuted());
-        meetingAudController->UnMuteAudio(GetCurrentUser()->GetUserID());
-    }
-}
-void DisableRawDataPublishing() {
-    // testing WIP
-    if (enableVideoRawDataPublishing) {
-        IMeetingVideoController *meetingVidController = m_pMeetingService->GetMeetingVideoController();
-        meetingVidController->MuteVideo();
-    }
-    // testing WIP
-    if (enableAudioRawDataPublishing) {
-        IMeetingAudioController *meetingAudController = m_pMeetingService->GetMeetingAudioController();
-        meetingAudController->MuteAudio(GetCurrentUser()->GetUserID(), true);
-    }
-}
-
-// callback when the SDK is inmeeting
-void HandleInMeeting() {
-
-    printf("HandleInMeeting Invoked\n");
-
-    // double check if you are in a meeting
-    if (m_pMeetingService->GetMeetingStatus() == ZOOM_SDK_NAMESPACE::MEETING_STATUS_INMEETING) {
-        printf("In Meeting Now...\n");
-
-        // print all list of participants
-        IList<unsigned int> *participants = m_pMeetingService->GetMeetingParticipantsController()->GetParticipantsList();
-        printf("Participants count: %d\n", participants->GetCount());
-    }
-
-    // first attempt to start raw recording  / sending, upon successfully joined and achieved "in-meeting" state.
-    StartRawRecordingIfPermitted(enableVideoRawDataCapture, enableAudioRawDataCapture);
-    StartRawDataPublishingIfPermitted(enableVideoRawDataPublishing, enableAudioRawDataPublishing);
-}
-
-// on meeting ended, typically by host, do something here. it is possible to reuse this SDK instance
-void HandleMeetingEnded() {
-    // ShutdownSdk();
-    // std::exit(0);
-}
-
-void HandleMeetingJoined() {
-
-    printf("Joining Meeting...\n");
-}
+// periodic metrics dump, rescheduled when metricsIntervalSeconds is reloaded
+guint metricsTimer = 0;
+guint metricsIntervalSeconds = 0;
 
 // get path, helper method used to read json config file
 std::string GetExecutableDirectory() {
@@ -295,119 +96,12 @@ std::string GetExecutableDirectory() {
     return std::string(dest);
 }
 
-// Function to process a line containing a key-value pair
-void ParseConfigLine(const std::string &line, std::map<std::string, std::string> &config) {
-    // Find the position of the ':' character
-    size_t colonPos = line.find(':');
-
-    if (colonPos != std::string::npos) {
-        // Extract the key and value parts
-        std::string key = line.substr(0, colonPos);
-        std::string value = line.substr(colonPos + 1);
-
-        // Remove leading/trailing whitespaces from the key and value
-        key.erase(0, key.find_first_not_of(" \t"));
-        key.erase(key.find_last_not_of(" \t") + 1);
-        value.erase(0, value.find_first_not_of(" \t"));
-        value.erase(value.find_last_not_of(" \t") + 1);
-
-        // Remove double-quote characters and carriage return ('\r') from the value
-        value.erase(std::remove_if(value.begin(), value.end(), [](char c) { return c == '"' || c == '\r'; }), value.end());
-
-        // Store the key-value pair in the map
-        config[key] = value;
-    }
-}
-
-void LoadConfiguration() {
-
-    std::string self_dir = GetExecutableDirectory();
-    printf("self path: %s\n", self_dir.c_str());
-    self_dir.append("/config.txt");
-
-    std::ifstream configFile(self_dir.c_str());
-    if (!configFile) {
-        std::cerr << "Error opening config file." << std::endl;
-    } else {
-
-        std::cerr << "Readfile success." << std::endl;
-    }
-
-    std::map<std::string, std::string> config;
-    std::string line;
-
-    while (std::getline(configFile, line)) {
-        // Process each line to extract key-value pairs
-        ParseConfigLine(line, config);
-
-        std::cerr << "Reading.." << line << std::endl;
-    }
-
-    // Example: Accessing values by key
-    if (config.find("meetingNumber") != config.end()) {
-
-        meetingNumber = config["meetingNumber"];
-        std::cout << "Meeting Number: " << config["meetingNumber"] << std::endl;
-    }
-    if (config.find("token") != config.end()) {
-        token = config["token"];
-        std::cout << "Token: " << token << std::endl;
-    }
-    if (config.find("meetingPassword") != config.end()) {
-
-        meetingPassword = config["meetingPassword"];
-        std::cout << "meetingPassword: " << meetingPassword << std::endl;
-    }
-    if (config.find("recordingToken") != config.end()) {
-
-        recordingToken = config["recordingToken"];
-        std::cout << "recordingToken: " << recordingToken << std::endl;
-    }
-    if (config.find("enableVideoRawDataCapture") != config.end()) {
-        std::cout << "enableVideoRawDataCapture before parsing is : " << config["enableVideoRawDataCapture"] << std::endl;
-
-        if (config["enableVideoRawDataCapture"] == "true") {
-            enableVideoRawDataCapture = true;
-        } else {
-            enableVideoRawDataCapture = false;
-        }
-        std::cout << "enableVideoRawDataCapture: " << enableVideoRawDataCapture << std::endl;
-    }
-    if (config.find("enableAudioRawDataCapture") != config.end()) {
-        std::cout << "enableAudioRawDataCapture before parsing is : " << config["enableAudioRawDataCapture"] << std::endl;
-
-        if (config["enableAudioRawDataCapture"] == "true") {
-            enableAudioRawDataCapture = true;
-        } else {
-            enableAudioRawDataCapture = false;
-        }
-        std::cout << "enableAudioRawDataCapture: " << enableAudioRawDataCapture << std::endl;
-    }
-
-    if (config.find("enableVideoRawDataPublishing") != config.end()) {
-        std::cout << "enableVideoRawDataPublishing before parsing is : " << config["enableVideoRawDataPublishing"] << std::endl;
-
-        if (config["enableVideoRawDataPublishing"] == "true") {
-            enableVideoRawDataPublishing = true;
-        } else {
-            enableVideoRawDataPublishing = false;
-        }
-        std::cout << "enableVideoRawDataPublishing: " << enableVideoRawDataPublishing << std::endl;
-    }
-    if (config.find("enableAudioRawDataPublishing") != config.end()) {
-        std::cout << "enableAudioRawDataPublishing before parsing is : " << config["enableAudioRawDataPublishing"] << std::endl;
-
-        if (config["enableAudioRawDataPublishing"] == "true") {
-            enableAudioRawDataPublishing = true;
-        } else {
-            enableAudioRawDataPublishing = false;
-        }
-        std::cout << "enableAudioRawDataPublishing: " << enableAudioRawDataPublishing << std::endl;
-    }
-
-    // Additional processing or handling of parsed values can be done here
-
-    printf("directory of config file: %s\n", self_dir.c_str());
+// read config.txt next to the executable, then the ConfigMap and environment overrides
+bool LoadConfiguration() {
+    std::string path = GetExecutableDirectory() + "/config.txt";
+    printf("config file: %s\n", path.c_str());
+    configStore = new ConfigStore(path);
+    return configStore->Load();
 }
 
 void ShutdownSdk() {
@@ -417,19 +111,8 @@ void ShutdownSdk() {
         ZOOM_SDK_NAMESPACE::DestroyAuthService(m_pAuthService);
         m_pAuthService = NULL;
     }
-    if (m_pSettingService) {
-        ZOOM_SDK_NAMESPACE::DestroySettingService(m_pSettingService);
-        m_pSettingService = NULL;
-    }
-    if (m_pMeetingService) {
-        ZOOM_SDK_NAMESPACE::DestroyMeetingService(m_pMeetingService);
-        m_pMeetingService = NULL;
-    }
-    if (videoHelper) {
-        videoHelper->unSubscribe();
-    }
-    if (audioPublishingHelper) {
-        audioHelper->unSubscribe();
+    if (meetingSession) {
+        meetingSession->Destroy();
     }
     // if (networkConnectionHelper)
     //{
@@ -445,214 +128,51 @@ void ShutdownSdk() {
     }
 }
 
-void ConfigureAudioDevices() {
-    ZOOM_SDK_NAMESPACE::IAudioSettingContext *pAudioContext = m_pSettingService->GetAudioSettings();
-    if (pAudioContext) {
-        // setting speaker
-        // if there are speakers detected
-        if (pAudioContext->GetSpeakerList()->GetCount() >= 1) {
-            std::cout << "Number of speaker(s) : " << pAudioContext->GetSpeakerList()->GetCount() << std::endl;
-            ISpeakerInfo *sInfo = pAudioContext->GetSpeakerList()->GetItem(0);
-            const zchar_t *deviceName = sInfo->GetDeviceName();
-
-            // set speaker
-            if (deviceName != nullptr && deviceName[0] != '\0') {
-                std::cout << "Speaker(0) name : " << sInfo->GetDeviceName() << std::endl;
-                std::cout << "Speaker(0) id : " << sInfo->GetDeviceId() << std::endl;
-                pAudioContext->SelectSpeaker(sInfo->GetDeviceId(), sInfo->GetDeviceName());
-                std::cout << "Is selected speaker? : " << pAudioContext->GetSpeakerList()->GetItem(0)->IsSelectedDevice() << std::endl;
-            } else {
-                std::cout << "Speaker(0) name is empty or null." << std::endl;
-                std::cout << "Speaker(0) id is empty or null." << std::endl;
-            }
-        }
-
-        // setting microphone
-        // if there are microphone detected
-        if (pAudioContext->GetMicList()->GetCount() >= 1) {
-            IMicInfo *mInfo = pAudioContext->GetMicList()->GetItem(0);
-            std::cout << "Number of mic(s) : " << pAudioContext->GetMicList()->GetCount() << std::endl;
-            const zchar_t *deviceName = mInfo->GetDeviceName();
-
-            // set microphone
-            if (deviceName != nullptr && deviceName[0] != '\0') {
-                std::cout << "Mic(0) name : " << mInfo->GetDeviceName() << std::endl;
-                std::cout << "Mic(0) id : " << mInfo->GetDeviceId() << std::endl;
-                pAudioContext->SelectMic(mInfo->GetDeviceId(), mInfo->GetDeviceName());
-                std::cout << "Is selected Mic? : " << pAudioContext->GetMicList()->GetItem(0)->IsSelectedDevice() << std::endl;
-            } else {
-                std::cout << "Mic(0) name is empty or null." << std::endl;
-                std::cout << "Mic(0) id is empty or null." << std::endl;
-            }
-        }
-    }
-}
-
-void JoinMeetingSession() {
-    std::cerr << "Joining Meeting" << std::endl;
-    SDKError err2(SDKError::SDKERR_SUCCESS);
-
-    // try to create the meetingservice object,
-    // this object will be used to join the meeting
-    if ((err2 = CreateMeetingService(&m_pMeetingService)) != SDKError::SDKERR_SUCCESS) {
-    };
-    std::cerr << "MeetingService created." << std::endl;
-
-    // before joining a meeting, create the setting service
-    // this object is used to for settings
-    CreateSettingService(&m_pSettingService);
-    std::cerr << "Settingservice created." << std::endl;
-
-    // Set the event listener for meeting status
-    m_pMeetingService->SetEvent(new MeetingServiceEventListener(&HandleMeetingJoined, &HandleMeetingEnded, &HandleInMeeting));
-
-    // Set the event listener for host, co-host
-    m_pParticipantsController = m_pMeetingService->GetMeetingParticipantsController();
-    m_pParticipantsController->SetEvent(new MeetingParticipantsCtrlEventListener(&HandleHostPrivilege, &HandleCoHostPrivilege));
-
-    // Set the event listener for recording privilege status
-    m_pRecordController = m_pMeetingService->GetMeetingRecordingController();
-    m_pRecordController->SetEvent(new MeetingRecordingCtrlEventListener(&HandleRecordingPermissionGranted));
-
-    // set event listnener for prompt handler
-    IMeetingReminderController *meetingremindercontroller = m_pMeetingService->GetMeetingReminderController();
-    MeetingReminderEventListener *meetingremindereventlistener = new MeetingReminderEventListener();
-    meetingremindercontroller->SetEvent(meetingremindereventlistener);
-
-    // prepare params used for joining meeting
-    ZOOM_SDK_NAMESPACE::JoinParam joinParam;
-    ZOOM_SDK_NAMESPACE::SDKError err(ZOOM_SDK_NAMESPACE::SDKERR_SERVICE_FAILED);
-    joinParam.userType = ZOOM_SDK_NAMESPACE::SDK_UT_WITHOUT_LOGIN;
-    ZOOM_SDK_NAMESPACE::JoinParam4WithoutLogin &withoutloginParam = joinParam.param.withoutloginuserJoin;
-    // withoutloginParam.meetingNumber = 1231231234;
-    withoutloginParam.meetingNumber = std::stoull(meetingNumber);
-    withoutloginParam.vanityID = NULL;
-    withoutloginParam.userName = "LinuxChun";
-    // withoutloginParam.psw = "1";
-    withoutloginParam.psw = meetingPassword.c_str();
-    withoutloginParam.customer_key = NULL;
-    withoutloginParam.webinarToken = NULL;
-    withoutloginParam.isVideoOff = false;
-    withoutloginParam.isAudioOff = false;
-
-    std::cerr << "JWT token is " << token << std::endl;
-    std::cerr << "Recording token is " << recordingToken << std::endl;
-
-    // automatically set app_privilege token if it is present in config.txt, or retrieved from web service
-    withoutloginParam.app_privilege_token = NULL;
-    if (!recordingToken.size() == 0) {
-        withoutloginParam.app_privilege_token = recordingToken.c_str();
-        std::cerr << "Setting recording token" << std::endl;
-    } else {
-        withoutloginParam.app_privilege_token = NULL;
-        std::cerr << "Leaving recording token as NULL" << std::endl;
-    }
-
-    if (enableAudioRawDataCapture) {
-        // set join audio to true
-        ZOOM_SDK_NAMESPACE::IAudioSettingContext *pAudioContext = m_pSettingService->GetAudioSettings();
-        if (pAudioContext) {
-            // ensure auto join audio
-            pAudioContext->EnableAutoJoinAudio(true);
-        }
-    }
-    if (enableVideoRawDataPublishing) {
-
-        // ensure video is turned on
-        withoutloginParam.isVideoOff = false;
-        // set join video to true
-        ZOOM_SDK_NAMESPACE::IVideoSettingContext *pVideoContext = m_pSettingService->GetVideoSettings();
-        if (pVideoContext) {
-            pVideoContext->EnableAutoTurnOffVideoWhenJoinMeetingSession(false);
-        }
-    }
-    if (enableAudioRawDataPublishing) {
-
-        ZOOM_SDK_NAMESPACE::IAudioSettingContext *pAudioContext = m_pSettingService->GetAudioSettings();
-        if (pAudioContext) {
-            // ensure auto join audio
-            pAudioContext->EnableAutoJoinAudio(true);
-            pAudioContext->EnableAlwaysMuteMicWhenJoinVoip(true);
-            pAudioContext->SetSuppressBackgroundNoiseLevel(Suppress_BGNoise_Level_None);
-        }
-    }
-
-    // attempt to join meeting
-    if (m_pMeetingService) {
-        err = m_pMeetingService->Join(joinParam);
-    } else {
-        std::cout << "join_meeting m_pMeetingService:Null" << std::endl;
-    }
-
-    if (ZOOM_SDK_NAMESPACE::SDKERR_SUCCESS == err) {
-        std::cout << "join_meeting:success" << std::endl;
-    } else {
-        std::cout << "join_meeting:error" << std::endl;
-    }
-}
-
-void LeaveMeetingSession() {
-    ZOOM_SDK_NAMESPACE::MeetingStatus status = ZOOM_SDK_NAMESPACE::MEETING_STATUS_FAILED;
-
-    if (NULL == m_pMeetingService) {
-
-        std::cout << "leave_meeting m_pMeetingService:Null" << std::endl;
-
-    } else {
-        status = m_pMeetingService->GetMeetingStatus();
-    }
-
-    if (status == ZOOM_SDK_NAMESPACE::MEETING_STATUS_IDLE ||
-        status == ZOOM_SDK_NAMESPACE::MEETING_STATUS_ENDED ||
-        status == ZOOM_SDK_NAMESPACE::MEETING_STATUS_FAILED) {
-
-        std::cout << "LeaveMeetingSession() not in meeting " << std::endl;
-    }
-
-    if (SDKError::SDKERR_SUCCESS == m_pMeetingService->Leave(ZOOM_SDK_NAMESPACE::LEAVE_MEETING)) {
-        std::cout << "LeaveMeetingSession() success " << std::endl;
-
-    } else {
-        std::cout << "LeaveMeetingSession() error" << std::endl;
-    }
-}
-
-// callback when authentication is compeleted
-void HandleAuthenticationComplete() {
-    std::cout << "HandleAuthenticationComplete" << std::endl;
-    JoinMeetingSession();
-}
-
-void AuthenticateMeetingSdk() {
+// create the auth service, send the JWT and wait for the SDK's answer
+Task<bool> AuthenticateMeetingSdk() {
     SDKError err(SDKError::SDKERR_SUCCESS);
 
     // create auth service
     if ((err = CreateAuthService(&m_pAuthService)) != SDKError::SDKERR_SUCCESS) {
-    };
+        std::cerr << "AuthService could not be created: " << err << std::endl;
+        co_return false;
+    }
     std::cerr << "AuthService created." << std::endl;
 
-    // Create a param to insert jwt token
-    ZOOM_SDK_NAMESPACE::AuthContext param;
-
     // set the event listener for onauthenticationcompleted
-    if ((err = m_pAuthService->SetEvent(new AuthServiceEventListener(&HandleAuthenticationComplete))) != SDKError::SDKERR_SUCCESS) {
+    if ((err = m_pAuthService->SetEvent(new AuthServiceEventListener(&authResults))) != SDKError::SDKERR_SUCCESS) {
     };
     std::cout << "AuthServiceEventListener added." << std::endl;
 
-    if (!token.size() == 0) {
+    // Create a param to insert jwt token; the token outlives the waits below
+    ZOOM_SDK_NAMESPACE::AuthContext param;
+    std::string token = configStore->Current().token;
+    if (!token.empty()) {
         param.jwt_token = token.c_str();
-        std::cerr << "AuthSDK:token extracted from config file " << param.jwt_token << std::endl;
+        std::cerr << "AuthSDK:token extracted from config file" << std::endl;
     }
-    m_pAuthService->SDKAuth(param);
-    ////attempt to authenticate
-    // ZOOM_SDK_NAMESPACE::SDKError sdkErrorResult = m_pAuthService->SDKAuth(param);
 
-    // if (ZOOM_SDK_NAMESPACE::SDKERR_SUCCESS != sdkErrorResult){
-    //	std::cerr << "AuthSDK:error " << std::endl;
-    // }
-    // else{
-    //	std::cerr << "AuthSDK:send success, awaiting callback " << std::endl;
-    // }
+    for (unsigned int attempt = 1;; attempt++) {
+        authResults.Clear();
+        std::optional<AuthResult> result;
+        // attempt to authenticate
+        if ((err = m_pAuthService->SDKAuth(param)) != SDKError::SDKERR_SUCCESS) {
+            std::cerr << "AuthSDK:error " << err << std::endl;
+        } else {
+            result = co_await authResults.Next(kAuthTimeoutMs);
+            if (!result) {
+                std::cerr << "AuthSDK: no answer within " << kAuthTimeoutMs << " ms" << std::endl;
+            }
+        }
+        if (result && *result == ZOOM_SDK_NAMESPACE::AUTHRET_SUCCESS) {
+            co_return true;
+        }
+        // a wrong token stays wrong; anything else may be the network
+        if ((result && *result == ZOOM_SDK_NAMESPACE::AUTHRET_JWTTOKENWRONG) || attempt == kMaxAuthAttempts) {
+            co_return false;
+        }
+        co_await Sleep(1000 * attempt);
+    }
 }
 
 void InitializeMeetingSdk() {
@@ -687,25 +207,6 @@ void InitializeMeetingSdk() {
     // }
 }
 
-// used for non headless app
-
-void StartMeetingSession() {
-
-    ZOOM_SDK_NAMESPACE::StartParam startParam;
-    startParam.userType = ZOOM_SDK_NAMESPACE::SDK_UT_NORMALUSER;
-    startParam.param.normaluserStart.vanityID = NULL;
-    startParam.param.normaluserStart.customer_key = NULL;
-    startParam.param.normaluserStart.isVideoOff = false;
-    startParam.param.normaluserStart.isAudioOff = false;
-
-    ZOOM_SDK_NAMESPACE::SDKError err = m_pMeetingService->Start(startParam);
-    if (SDKError::SDKERR_SUCCESS == err) {
-        std::cerr << "StartMeetingSession:success " << std::endl;
-    } else {
-        std::cerr << "StartMeetingSession:error " << std::endl;
-    }
-}
-
 // Define a struct to hold the response data
 struct ResponseData {
     std::ostringstream stream;
@@ -723,38 +224,215 @@ gboolean HandleTimeout(gpointer data) {
     return TRUE;
 }
 
-// this catches a break signal, such as Ctrl + C
-void HandleSignal(int s) {
-    printf("\nCaught signal %d\n", s);
-    LeaveMeetingSession();
-    printf("Leaving session.\n");
+// periodically print pipeline metrics such as the per-participant speech ratio
+gboolean HandleMetricsTimeout(gpointer data) {
+    std::ostringstream metrics;
+    Metrics::Instance().Render(metrics);
+    std::cout << "===== METRICS =====\n" << metrics.str() << "===================" << std::endl;
+    return TRUE;
+}
+
+// (re)start the periodic metrics dump; 0 seconds turns it off
+void ScheduleMetricsDump(guint seconds) {
+    if (seconds == metricsIntervalSeconds && (metricsTimer != 0 || seconds == 0)) {
+        return;
+    }
+    if (metricsTimer != 0) {
+        g_source_remove(metricsTimer);
+        metricsTimer = 0;
+    }
+    metricsIntervalSeconds = seconds;
+    if (seconds > 0) {
+        metricsTimer = g_timeout_add_seconds(seconds, HandleMetricsTimeout, NULL);
+    }
+}
+
+// reloadable keys changed on disk: apply them without leaving the meeting
+void HandleConfigReload(const BotConfig &config, void *context) {
+    if (meetingSession) {
+        meetingSession->ApplyOptions(config.meeting);
+    }
+    ScheduleMetricsDump(config.metricsIntervalSeconds);
+}
+
+// flush the recording within the deadline, then leave the meeting and stop the main loop
+void Shutdown() {
+    static bool shuttingDown = false;
+    if (shuttingDown) {
+        return;
+    }
+    shuttingDown = true;
+
+    if (meetingSession) {
+        MeetingSession::DrainReport report = meetingSession->Drain(configStore->Current().shutdownDeadlineMs);
+        std::cout << "Shutdown drain " << (report.complete ? "complete" : "hit the deadline") << " after "
+                  << report.elapsedMs << " ms: flushed " << report.releasedMedia << " buffered items, wrote "
+                  << report.recordsWritten << " records, dropped " << report.droppedRecords << ", "
+                  << report.pendingWrites << " writes not on disk" << std::endl;
+        meetingSession->Leave();
+        printf("Leaving session.\n");
+    }
     ShutdownSdk();
+    g_main_loop_quit(mainLoop);
+}
 
-    // InitializeMeetingSdk();
-    // AuthenticateMeetingSdk();
+// attend the meeting until it is over, then leave like on a stop signal; the worker has
+// nothing else to do
+Task<> AttendMeeting() {
+    if (!co_await meetingSession->Attend()) {
+        exitCode = 1;
+    }
+    Shutdown();
+}
+
+// from start-up on: authenticate, then attend the configured meeting or, in a warm
+// worker, tell the supervisor the SDK is ready and wait for a JOIN
+Task<> RunLifecycle() {
+    if (!co_await AuthenticateMeetingSdk()) {
+        std::cerr << "Could not authenticate the SDK" << std::endl;
+        exitCode = 1;
+        Shutdown();
+        co_return;
+    }
+    std::cout << "HandleAuthenticationComplete" << std::endl;
+    if (meetingSession) {
+        co_await AttendMeeting();
+    } else if (supervisorFd >= 0) {
+        ControlProtocol::Send(supervisorFd, "READY\n");
+    }
+}
 
-    std::exit(0);
+// SIGINT (Ctrl + C) or SIGTERM (Kubernetes stopping the pod), delivered on the main loop
+gboolean HandleStopSignal(gpointer data) {
+    printf("\nCaught signal %d\n", GPOINTER_TO_INT(data));
+    Shutdown();
+    return G_SOURCE_CONTINUE;
 }
 
 void InitializeApplicationSettings() {
-    struct sigaction sigIntHandler;
-    sigIntHandler.sa_handler = HandleSignal;
-    sigemptyset(&sigIntHandler.sa_mask);
-    sigIntHandler.sa_flags = 0;
-    sigaction(SIGINT, &sigIntHandler, NULL);
+    // GLib turns the signals into main loop events through a wakeup pipe, so the drain and
+    // the SDK calls run outside the signal handler
+    g_unix_signal_add(SIGINT, HandleStopSignal, GINT_TO_POINTER(SIGINT));
+    g_unix_signal_add(SIGTERM, HandleStopSignal, GINT_TO_POINTER(SIGTERM));
 }
 
-int main(int argc, char *argv[]) {
+// build lookup tables once in the supervisor so forked workers share them copy-on-write
+void PrewarmSharedTables() {
+    const unsigned int kCommonSampleRates[] = {32000, 44100, 48000};
+    for (unsigned int rate : kCommonSampleRates) {
+        PolyphaseFilterBank::ForRate(rate);
+    }
+}
 
-    LoadConfiguration();
+// started from the loop, so that a lifecycle failing at once quits a loop that is running;
+// a quit before g_main_loop_run would be lost and leave the worker hanging
+gboolean StartLifecycle(gpointer data) {
+    lifecycle = RunLifecycle();
+    lifecycle.Start();
+    return G_SOURCE_REMOVE;
+}
+
+// join one meeting with this process and run until it is interrupted
+int RunMeetingWorker(const MeetingOptions &options) {
+    meetingSession = new MeetingSession(options);
 
     InitializeMeetingSdk();
-    AuthenticateMeetingSdk();
     InitializeApplicationSettings();
 
     mainLoop = g_main_loop_new(NULL, FALSE);
+    g_idle_add(StartLifecycle, NULL);
     // add source to default context
     g_timeout_add(1000, HandleTimeout, mainLoop);
+    ScheduleMetricsDump(configStore->Current().metricsIntervalSeconds);
+    configStore->Watch(&HandleConfigReload, NULL);
     g_main_loop_run(mainLoop);
-    return 0;
+
+    // the coroutines may still wait on the session
+    lifecycle.Reset();
+    delete meetingSession;
+    meetingSession = nullptr;
+    return exitCode;
+}
+
+// tell the supervisor the assigned meeting is delivering audio, so it can report the latency
+void HandleFirstAudio(void *context) {
+    ControlProtocol::Send(supervisorFd, "FIRST_AUDIO\n");
+}
+
+// a JOIN from the supervisor: the SDK is already authenticated, so join right away
+gboolean HandleSupervisorInput(gint fd, GIOCondition condition, gpointer data) {
+    bool open = supervisorInput.ReadFrom(fd);
+    std::string line;
+    while (supervisorInput.NextLine(line)) {
+        // a meeting assigned now gets the reloadable options as they are now
+        MeetingOptions options = configStore->Current().meeting;
+        std::string error;
+        if (meetingSession || !lifecycle.Done() || !ControlProtocol::ParseJoin(line, options, error)) {
+            std::cerr << "Ignoring supervisor message: " << line << std::endl;
+            continue;
+        }
+        options.recordingDirectory = "recording/" + options.meetingNumber;
+        meetingSession = new MeetingSession(options);
+        meetingSession->SetFirstAudioCallback(&HandleFirstAudio, NULL);
+        lifecycle = AttendMeeting();
+        lifecycle.Start();
+    }
+    if (!open) {
+        // the supervisor is gone; leave like on Ctrl + C
+        printf("\nSupervisor closed the control socket\n");
+        Shutdown();
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// initialize and authenticate the SDK ahead of time, then wait for a meeting from the supervisor
+int RunWarmWorker(int controlFd) {
+    supervisorFd = controlFd;
+    fcntl(supervisorFd, F_SETFL, fcntl(supervisorFd, F_GETFL) | O_NONBLOCK);
+
+    InitializeMeetingSdk();
+    InitializeApplicationSettings();
+
+    mainLoop = g_main_loop_new(NULL, FALSE);
+    g_idle_add(StartLifecycle, NULL);
+    g_unix_fd_add(supervisorFd, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR), HandleSupervisorInput, NULL);
+    g_timeout_add(1000, HandleTimeout, mainLoop);
+    ScheduleMetricsDump(configStore->Current().metricsIntervalSeconds);
+    configStore->Watch(&HandleConfigReload, NULL);
+    g_main_loop_run(mainLoop);
+
+    lifecycle.Reset();
+    delete meetingSession;
+    meetingSession = nullptr;
+    return exitCode;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (!LoadConfiguration()) {
+        return 1;
+    }
+    const BotConfig &config = configStore->Current();
+    std::vector<MeetingOptions> meetings = config.Meetings();
+    // resolved once here; forked workers inherit it and their media threads apply it
+    ThreadPolicy::Instance().Configure(config.threadLayout);
+
+    if (meetings.empty() && config.warmWorkers == 0) {
+        return RunMeetingWorker(config.meeting);
+    }
+
+    // the SDK hosts one meeting per process: fork a worker for each configured meeting and
+    // keep warm workers for meetings assigned over the control socket
+    PrewarmSharedTables();
+    SessionSupervisor supervisor(&RunMeetingWorker);
+    // workers get the drain deadline plus time to leave the meeting before they are killed
+    supervisor.SetStopTimeout(config.shutdownDeadlineMs + 5000);
+    for (size_t i = 0; i < meetings.size(); i++) {
+        supervisor.Add(meetings[i]);
+    }
+    if (config.warmWorkers > 0 && !supervisor.EnableWarmPool(&RunWarmWorker, config.warmWorkers, config.controlSocket)) {
+        return 1;
+    }
+    return supervisor.Run();
 }
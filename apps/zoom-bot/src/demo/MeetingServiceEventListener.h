@@ -1,15 +1,16 @@
 #include "meeting_service_interface.h"
 #include "zoom_sdk.h"
 
+#include "MeetingEventBus.h"
+
 USING_ZOOM_SDK_NAMESPACE
 
 class MeetingServiceEventListener : public ZOOM_SDK_NAMESPACE::IMeetingServiceEvent
 {
-	 void (*onMeetingEnds_)();
-	 void (*onMeetingStarts_)();
-	 void (*onInMeeting_)();
+	MeetingEventBus* events_;
 public:
-	MeetingServiceEventListener(void (*onMeetingStarts_)(), void (*onMeetingEnds_)(), void (*onInMeeting_)());
+	/// \brief Status changes are posted to events and handled on the main loop.
+	MeetingServiceEventListener(MeetingEventBus* events);
 
 	/// \brief Meeting status changed callback.
 	/// \param status The value of meeting. For more details, see \link MeetingStatus \endlink.
@@ -0,0 +1,1277 @@
+// One joined meeting: its SDK services, raw data capture and recording
+
+#include "MeetingSession.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "meeting_service_components/meeting_audio_interface.h"
+#include "meeting_service_components/meeting_participants_ctrl_interface.h"
+#include "meeting_service_components/meeting_recording_interface.h"
+#include "meeting_service_components/meeting_video_interface.h"
+#include "rawdata/rawdata_video_source_helper_interface.h"
+#include "rawdata/zoom_rawdata_api.h"
+
+#include "MeetingAudioCtrlEventListener.h"
+#include "MeetingParticipantsCtrlEventListener.h"
+#include "MeetingRecordingCtrlEventListener.h"
+#include "MeetingReminderEventListener.h"
+#include "MeetingServiceEventListener.h"
+#include "MeetingVideoCtrlEventListener.h"
+#include "TemplateKeywordModel.h"
+#include "ZoomSdkVideoSource.h"
+#include "ZoomSdkVirtualAudioMicEvent.h"
+
+// references for enableAudioRawDataPublishing
+const std::string kDefaultAudioSource = "yourwavefile.wav";
+
+// references for enableVideoRawDataPublishing
+const std::string kDefaultVideoSource = "yourmp4file.mp4";
+
+// recovery after a lost connection retries after 0.5 s, 1 s, 2 s, ... up to 30 s apart
+const unsigned int kInitialRecoveryDelayMs = 500;
+const unsigned int kMaxRecoveryDelayMs = 30000;
+const unsigned int kMaxRecoveryAttempts = 12;
+
+// while connecting the SDK reports progress well within this; the waiting room and a host
+// who has not started the meeting yet are waited for without a limit
+const unsigned int kJoinTimeoutMs = 60000;
+
+namespace {
+
+unsigned int RecoveryDelayMs(unsigned int attempt) {
+    return std::min(kInitialRecoveryDelayMs << std::min(attempt, 16u), kMaxRecoveryDelayMs);
+}
+
+struct VideoResolution {
+    const char *name;
+    ZoomSDKResolution resolution;
+    unsigned int width;
+    unsigned int height;
+};
+
+const VideoResolution kVideoResolutions[] = {
+    {"90p", ZoomSDKResolution_90P, 160, 90},       {"180p", ZoomSDKResolution_180P, 320, 180},
+    {"360p", ZoomSDKResolution_360P, 640, 360},    {"720p", ZoomSDKResolution_720P, 1280, 720},
+    {"1080p", ZoomSDKResolution_1080P, 1920, 1080},
+};
+
+const VideoResolution *FindVideoResolution(const std::string &name) {
+    for (size_t i = 0; i < sizeof(kVideoResolutions) / sizeof(kVideoResolutions[0]); i++) {
+        if (name == kVideoResolutions[i].name) {
+            return &kVideoResolutions[i];
+        }
+    }
+    return nullptr;
+}
+
+// the videoResolution a name stands for, 720p for an unknown one
+const VideoResolution &RecordedResolution(const std::string &name) {
+    const VideoResolution *resolution = FindVideoResolution(name);
+    return resolution ? *resolution : *FindVideoResolution("720p");
+}
+
+// bytes of one I420 frame, which is what a video slot of the synchronizer holds
+size_t VideoFrameBytes(const std::string &name) {
+    const VideoResolution &resolution = RecordedResolution(name);
+    return (size_t)resolution.width * resolution.height * 3 / 2;
+}
+
+// what gallery tiles subscribe at: the smallest resolution covering a quarter of the gallery,
+// the largest a tile gets once two participants are shown
+const VideoResolution &GalleryTileResolution(const std::string &name) {
+    const VideoResolution &gallery = RecordedResolution(name);
+    for (size_t i = 0; i < sizeof(kVideoResolutions) / sizeof(kVideoResolutions[0]); i++) {
+        if (kVideoResolutions[i].width * 2 >= gallery.width && kVideoResolutions[i].height * 2 >= gallery.height) {
+            return kVideoResolutions[i];
+        }
+    }
+    return gallery;
+}
+
+} // namespace
+
+bool VideoResolutionSize(const std::string &name, unsigned int &width, unsigned int &height) {
+    const VideoResolution *resolution = FindVideoResolution(name);
+    if (!resolution) {
+        return false;
+    }
+    width = resolution->width;
+    height = resolution->height;
+    return true;
+}
+
+bool ParseMeetingNumber(const std::string &text, uint64_t &number) {
+    if (text.empty() || text.size() > 20 || text[0] == '0' ||
+        text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    errno = 0;
+    char *end = nullptr;
+    unsigned long long value = strtoull(text.c_str(), &end, 10);
+    if (errno == ERANGE || *end != '\0') {
+        return false;
+    }
+    number = value;
+    return true;
+}
+
+MeetingSession *MeetingSession::active_ = nullptr;
+
+MeetingSession::MeetingSession(const MeetingOptions &options)
+    : options_(options), events_(&MeetingSession::HandleEvent, this), createdAt_(std::chrono::steady_clock::now()), firstAudioLatencyMs_(-1),
+      state_(SESSION_IDLE), everInMeeting_(false), reconnects_(0),
+      failedRecoveries_(0), lastRecoveryMs_(-1), maxRecoveryMs_(-1), onFirstAudio_(nullptr), firstAudioContext_(nullptr), meetingService_(nullptr), settingService_(nullptr),
+      meetingServiceListener_(nullptr), participantsListener_(nullptr), recordingListener_(nullptr),
+      reminderListener_(nullptr), audioListener_(nullptr), videoListener_(nullptr),
+      snapshots_(options.snapshotIntervalSeconds * 1000, options.snapshotParticipants, options.snapshotWidth,
+                 options.snapshotQuality),
+      snapshotServer_(snapshots_, roster_), videoHelper_(nullptr),
+      galleryStarted_(false),
+      audioSubscribed_(false), analyticsTimer_(0), talkTimeFinal_(false), localMixer_(&roster_),
+      keywordSpotter_(&roster_),
+      utteranceChunker_(options.utteranceMinSeconds * 1000, options.utteranceMaxSeconds * 1000, options.utteranceOverlapMs,
+                        options.utterances ? options.utteranceBuffers : 0),
+      utteranceWriter_(&utteranceChunker_, &roster_), mediaScheduler_(options.mediaWorkers, THREAD_ROLE_AUDIO), virtualAudioMic_(nullptr), audioHelper_(nullptr),
+      synchronizer_(options.jitterWindowMs, options.audioSlots, options.videoSlots,
+                    VideoFrameBytes(options.videoResolution)),
+      writer_((size_t)options.writerBlockKb * 1024, options.writerBlocks),
+      recorder_(options.recordingDirectory, options.segmentSeconds * 1000, &writer_),
+      gallery_(RecordedResolution(options.videoResolution).width, RecordedResolution(options.videoResolution).height,
+               options.gallery ? options.galleryTiles : 0, options.galleryFps,
+               VideoFrameBytes(GalleryTileResolution(options.videoResolution).name)) {
+    // connect the capture delegates to the synchronizer and the recorder
+    synchronizer_.SetSink(&recorder_);
+    audioRawDataSink_.SetSynchronizer(&synchronizer_);
+    audioRawDataSink_.SetScheduler(&mediaScheduler_);
+    AudioOutput audioOutput = AUDIO_OUTPUT_PCM;
+    AudioOutputFromName(options.audioOutput, audioOutput);
+    audioRawDataSink_.SetAudioOutput(audioOutput);
+    float agcTargetLufs = 0.0f;
+    AgcTargetFromName(options.agcTargetLufs, agcTargetLufs);
+    audioRawDataSink_.SetAgcTarget(agcTargetLufs);
+    SelfAudioMode selfAudio = SELF_AUDIO_SUBTRACT;
+    SelfAudioModeFromName(options.selfAudioSuppression, selfAudio);
+    if (options.enableAudioRawDataPublishing) {
+        audioRawDataSink_.SetPlaybackReference(&playbackReference_, selfAudio);
+    }
+    audioRawDataSink_.SetSpeakerAnalytics(&speakerAnalytics_);
+    if (options.localMix) {
+        LocalMixRules rules;
+        LocalMixRulesFromConfig(options.localMixInclude, options.localMixExclude, options.localMixGains, rules);
+        localMixer_.SetRules(rules);
+        audioRawDataSink_.SetLocalMixer(&localMixer_);
+    }
+    botEvents_.Open(options.recordingDirectory + "/events.jsonl", options.eventSocket);
+    audioRawDataSink_.SetEventChannel(&botEvents_, options.meetingNumber);
+    if (!options.keywordTemplates.empty()) {
+        std::string error;
+        std::unique_ptr<TemplateKeywordModel> model =
+            TemplateKeywordModel::Load(options.keywordTemplates, options.keywordMaxDistance / 100.0f, error);
+        if (model) {
+            keywordSpotter_.Start(std::move(model), options.keywordThreads, &botEvents_, options.meetingNumber);
+            audioRawDataSink_.SetKeywordSpotter(&keywordSpotter_);
+        } else {
+            std::cerr << "MeetingSession: keyword spotting disabled, " << error << std::endl;
+        }
+    }
+    if (options.utterances) {
+        utteranceWriter_.Start(options.recordingDirectory + "/utterances", &botEvents_, options.meetingNumber);
+        utteranceChunker_.SetSink(&utteranceWriter_);
+        audioRawDataSink_.SetUtteranceChunker(&utteranceChunker_);
+    }
+    ScheduleAnalytics();
+    audioRawDataSink_.SetFirstAudioCallback(&MeetingSession::HandleFirstAudio, this);
+    videoRenderer_.SetEventBus(&events_);
+    if (options.gallery) {
+        galleryRenderers_.resize(gallery_.Tiles());
+        for (size_t i = 0; i < galleryRenderers_.size(); i++) {
+            galleryRenderers_[i].renderer.SetEventBus(&events_);
+            galleryRenderers_[i].helper = nullptr;
+            galleryRenderers_[i].userId = 0;
+        }
+        gallery_.Start(&synchronizer_);
+    }
+    if (snapshots_.Enabled()) {
+        videoRenderer_.SetSnapshots(&snapshots_);
+        for (size_t i = 0; i < galleryRenderers_.size(); i++) {
+            galleryRenderers_[i].renderer.SetSnapshots(&snapshots_);
+        }
+        // the recorder has created the directory
+        snapshotServer_.Start(options.recordingDirectory + "/snapshots.sock");
+    }
+    Metrics::Instance().AddCollector(&MeetingSession::CollectMetrics, this);
+}
+
+MeetingSession::~MeetingSession() {
+    Destroy();
+    FinishRecording();
+    if (analyticsTimer_ != 0) {
+        g_source_remove(analyticsTimer_);
+        analyticsTimer_ = 0;
+    }
+    if (active_ == this) {
+        active_ = nullptr;
+    }
+    Metrics::Instance().RemoveCollector(this);
+}
+
+Task<bool> MeetingSession::Attend() {
+    if (!CreateServices()) {
+        co_return false;
+    }
+    unsigned int attempts = 0;
+    for (;;) {
+        if (co_await JoinMeeting()) {
+            attempts = 0;
+            co_await CaptureUntilDisconnected();
+        }
+        if (state_ == SESSION_ENDED || state_ == SESSION_DRAINING) {
+            co_return true;
+        }
+        if (!everInMeeting_) {
+            // never got in (wrong password, meeting not started): nothing to recover
+            std::cerr << "Meeting " << options_.meetingNumber << ": could not join" << std::endl;
+            co_return false;
+        }
+        // the SDK gave up on the connection; join again ourselves after a backoff
+        if (attempts >= kMaxRecoveryAttempts) {
+            std::cerr << "Meeting " << options_.meetingNumber << ": giving up after " << attempts
+                      << " recovery attempts" << std::endl;
+            failedRecoveries_++;
+            co_return false;
+        }
+        co_await Sleep(RecoveryDelayMs(attempts++));
+        if (state_ == SESSION_DRAINING || !meetingService_) {
+            co_return true;
+        }
+        std::cout << "Meeting " << options_.meetingNumber << ": joining again, attempt " << attempts << std::endl;
+    }
+}
+
+// request the join and wait until the SDK puts us in the meeting or gives up
+Task<bool> MeetingSession::JoinMeeting() {
+    // statuses of the previous connection are answered already
+    lifecycleEvents_.Clear();
+    if (!RequestJoin()) {
+        if (everInMeeting_) {
+            EnterState(SESSION_REJOINING);
+        }
+        co_return false;
+    }
+    bool waiting = false;
+    for (;;) {
+        std::optional<MeetingEvent> event = co_await lifecycleEvents_.Next(waiting ? kNoTimeout : kJoinTimeoutMs);
+        if (!event) {
+            std::cerr << "Meeting " << options_.meetingNumber << ": no answer to the join request within "
+                      << kJoinTimeoutMs << " ms" << std::endl;
+            if (everInMeeting_) {
+                EnterState(SESSION_REJOINING);
+            }
+            co_return false;
+        }
+        if (event->type != MEETING_EVENT_STATUS_CHANGED) {
+            continue;
+        }
+        switch (event->status) {
+        case MEETING_STATUS_INMEETING:
+            co_return true;
+        case MEETING_STATUS_FAILED:
+        case MEETING_STATUS_ENDED:
+            co_return false;
+        case MEETING_STATUS_WAITINGFORHOST:
+        case MEETING_STATUS_IN_WAITING_ROOM:
+            waiting = true;
+            break;
+        default:
+            waiting = false;
+            break;
+        }
+    }
+}
+
+// In the meeting: start raw recording, again whenever privilege or a role is granted and,
+// while recovering from an outage, on a backoff. Reconnects the SDK handles itself are
+// ridden out here; returns when the connection failed for good or the meeting ended.
+Task<> MeetingSession::CaptureUntilDisconnected() {
+    bool firstTime = !everInMeeting_;
+    OnInMeeting();
+    unsigned int attempts = 0;
+    for (;;) {
+        unsigned int timeoutMs = kNoTimeout;
+        if ((state_ == SESSION_IN_MEETING || state_ == SESSION_RECOVERING) && !StartCapture() &&
+            state_ == SESSION_RECOVERING) {
+            // recording privilege may not be back yet; a privilege event also retries
+            if (attempts < kMaxRecoveryAttempts) {
+                timeoutMs = RecoveryDelayMs(attempts++);
+            } else if (attempts++ == kMaxRecoveryAttempts) {
+                std::cerr << "Meeting " << options_.meetingNumber << ": giving up after " << kMaxRecoveryAttempts
+                          << " recovery attempts" << std::endl;
+                failedRecoveries_++;
+            }
+        }
+        if (firstTime) {
+            firstTime = false;
+            StartRawDataPublishingIfPermitted(options_.enableVideoRawDataPublishing, options_.enableAudioRawDataPublishing);
+        }
+
+        std::optional<MeetingEvent> event = co_await lifecycleEvents_.Next(timeoutMs);
+        if (!event) {
+            continue;
+        }
+        if (event->type == MEETING_EVENT_RENDERER_DESTROYED) {
+            // subscribe a new renderer if we are still in the meeting
+            if (state_ == SESSION_IN_MEETING) {
+                EnterState(SESSION_RECOVERING);
+                lostAt_ = std::chrono::steady_clock::now();
+                attempts = 0;
+            }
+        } else if (event->type == MEETING_EVENT_STATUS_CHANGED) {
+            if (event->status == MEETING_STATUS_INMEETING && state_ == SESSION_RECONNECTING) {
+                // the SDK reconnected on its own
+                OnInMeeting();
+                attempts = 0;
+            } else if (event->status == MEETING_STATUS_FAILED || event->status == MEETING_STATUS_ENDED) {
+                co_return;
+            }
+        }
+        // a privilege or role change: try again
+    }
+}
+
+bool MeetingSession::CreateServices() {
+    if (active_ && active_ != this) {
+        std::cerr << "MeetingSession: meeting " << active_->options_.meetingNumber
+                  << " is already active in this process" << std::endl;
+        return false;
+    }
+    active_ = this;
+    std::cerr << "Joining Meeting " << options_.meetingNumber << std::endl;
+
+    // try to create the meetingservice object,
+    // this object will be used to join the meeting
+    if (CreateMeetingService(&meetingService_) != SDKError::SDKERR_SUCCESS || !meetingService_) {
+        std::cout << "join_meeting m_pMeetingService:Null" << std::endl;
+        return false;
+    }
+    std::cerr << "MeetingService created." << std::endl;
+
+    // before joining a meeting, create the setting service
+    // this object is used to for settings
+    CreateSettingService(&settingService_);
+    std::cerr << "Settingservice created." << std::endl;
+
+    // Set the event listener for meeting status
+    meetingServiceListener_ = new MeetingServiceEventListener(&events_);
+    meetingService_->SetEvent(meetingServiceListener_);
+
+    // Set the event listener for host, co-host
+    participantsListener_ = new MeetingParticipantsCtrlEventListener(&events_);
+    meetingService_->GetMeetingParticipantsController()->SetEvent(participantsListener_);
+
+    // Set the event listener for recording privilege status
+    recordingListener_ = new MeetingRecordingCtrlEventListener(&events_);
+    meetingService_->GetMeetingRecordingController()->SetEvent(recordingListener_);
+
+    // keep the roster's audio and video state current
+    audioListener_ = new MeetingAudioCtrlEventListener(&events_);
+    meetingService_->GetMeetingAudioController()->SetEvent(audioListener_);
+    videoListener_ = new MeetingVideoCtrlEventListener(&events_);
+    meetingService_->GetMeetingVideoController()->SetEvent(videoListener_);
+
+    // set event listnener for prompt handler
+    reminderListener_ = new MeetingReminderEventListener();
+    meetingService_->GetMeetingReminderController()->SetEvent(reminderListener_);
+
+    if (options_.enableAudioRawDataCapture) {
+        // set join audio to true
+        ZOOM_SDK_NAMESPACE::IAudioSettingContext *pAudioContext = settingService_->GetAudioSettings();
+        if (pAudioContext) {
+            // ensure auto join audio
+            pAudioContext->EnableAutoJoinAudio(true);
+        }
+    }
+    if (options_.enableVideoRawDataPublishing) {
+        // set join video to true
+        ZOOM_SDK_NAMESPACE::IVideoSettingContext *pVideoContext = settingService_->GetVideoSettings();
+        if (pVideoContext) {
+            pVideoContext->EnableAutoTurnOffVideoWhenJoinMeeting(false);
+        }
+    }
+    if (options_.enableAudioRawDataPublishing) {
+
+        ZOOM_SDK_NAMESPACE::IAudioSettingContext *pAudioContext = settingService_->GetAudioSettings();
+        if (pAudioContext) {
+            // ensure auto join audio
+            pAudioContext->EnableAutoJoinAudio(true);
+            pAudioContext->EnableAlwaysMuteMicWhenJoinVoip(true);
+            pAudioContext->SetSuppressBackgroundNoiseLevel(Suppress_BGNoise_Level_None);
+        }
+    }
+    return true;
+}
+
+bool MeetingSession::RequestJoin() {
+    // prepare params used for joining meeting
+    ZOOM_SDK_NAMESPACE::JoinParam joinParam;
+    joinParam.userType = ZOOM_SDK_NAMESPACE::SDK_UT_WITHOUT_LOGIN;
+    ZOOM_SDK_NAMESPACE::JoinParam4WithoutLogin &withoutloginParam = joinParam.param.withoutloginuserJoin;
+    uint64_t meetingNumber;
+    if (!ParseMeetingNumber(options_.meetingNumber, meetingNumber)) {
+        std::cerr << "Meeting " << options_.meetingNumber << ": not a meeting number" << std::endl;
+        return false;
+    }
+    withoutloginParam.meetingNumber = meetingNumber;
+    withoutloginParam.vanityID = NULL;
+    withoutloginParam.userName = options_.userName.c_str();
+    withoutloginParam.psw = options_.meetingPassword.c_str();
+    withoutloginParam.customer_key = NULL;
+    withoutloginParam.webinarToken = NULL;
+    withoutloginParam.isVideoOff = false;
+    withoutloginParam.isAudioOff = false;
+
+    std::cerr << "Recording token is " << options_.recordingToken << std::endl;
+
+    // automatically set app_privilege token if it is present in config.txt, or retrieved from web service
+    if (!options_.recordingToken.empty()) {
+        withoutloginParam.app_privilege_token = options_.recordingToken.c_str();
+        std::cerr << "Setting recording token" << std::endl;
+    } else {
+        withoutloginParam.app_privilege_token = NULL;
+        std::cerr << "Leaving recording token as NULL" << std::endl;
+    }
+
+    EnterState(SESSION_JOINING);
+    // attempt to join meeting
+    SDKError err = meetingService_->Join(joinParam);
+    if (ZOOM_SDK_NAMESPACE::SDKERR_SUCCESS == err) {
+        std::cout << "join_meeting:success" << std::endl;
+        return true;
+    }
+    std::cout << "join_meeting:error" << std::endl;
+    return false;
+}
+
+void MeetingSession::Leave() {
+    if (NULL == meetingService_) {
+        std::cout << "leave_meeting m_pMeetingService:Null" << std::endl;
+        return;
+    }
+
+    ZOOM_SDK_NAMESPACE::MeetingStatus status = meetingService_->GetMeetingStatus();
+    if (status == ZOOM_SDK_NAMESPACE::MEETING_STATUS_IDLE ||
+        status == ZOOM_SDK_NAMESPACE::MEETING_STATUS_ENDED ||
+        status == ZOOM_SDK_NAMESPACE::MEETING_STATUS_FAILED) {
+
+        std::cout << "LeaveMeetingSession() not in meeting " << std::endl;
+    }
+
+    if (SDKError::SDKERR_SUCCESS == meetingService_->Leave(ZOOM_SDK_NAMESPACE::LEAVE_MEETING)) {
+        std::cout << "LeaveMeetingSession() success " << std::endl;
+    } else {
+        std::cout << "LeaveMeetingSession() error" << std::endl;
+    }
+}
+
+void MeetingSession::ApplyOptions(const MeetingOptions &options) {
+    options_.dropNonSpeechAudio = options.dropNonSpeechAudio;
+    options_.jitterWindowMs = options.jitterWindowMs;
+    options_.segmentSeconds = options.segmentSeconds;
+    audioRawDataSink_.SetDropNonSpeech(options_.dropNonSpeechAudio);
+    synchronizer_.SetJitterWindow(options_.jitterWindowMs);
+    recorder_.SetSegmentDuration(options_.segmentSeconds * 1000);
+    if (options.localMixInclude != options_.localMixInclude || options.localMixExclude != options_.localMixExclude ||
+        options.localMixGains != options_.localMixGains) {
+        options_.localMixInclude = options.localMixInclude;
+        options_.localMixExclude = options.localMixExclude;
+        options_.localMixGains = options.localMixGains;
+        LocalMixRules rules;
+        LocalMixRulesFromConfig(options_.localMixInclude, options_.localMixExclude, options_.localMixGains, rules);
+        localMixer_.SetRules(rules);
+    }
+    if (options.analyticsIntervalSeconds != options_.analyticsIntervalSeconds) {
+        options_.analyticsIntervalSeconds = options.analyticsIntervalSeconds;
+        ScheduleAnalytics();
+    }
+}
+
+void MeetingSession::ScheduleAnalytics() {
+    if (analyticsTimer_ != 0) {
+        g_source_remove(analyticsTimer_);
+        analyticsTimer_ = 0;
+    }
+    if (options_.analyticsIntervalSeconds > 0 && !talkTimeFinal_) {
+        analyticsTimer_ = g_timeout_add_seconds(options_.analyticsIntervalSeconds, &MeetingSession::HandleAnalyticsTimeout, this);
+    }
+}
+
+gboolean MeetingSession::HandleAnalyticsTimeout(gpointer context) {
+    MeetingSession *self = static_cast<MeetingSession *>(context);
+    self->EmitTalkTime(false);
+    return TRUE;
+}
+
+void MeetingSession::EmitTalkTime(bool final) {
+    if (talkTimeFinal_) {
+        return;
+    }
+    std::vector<SpeakerStats> speakers(speakerAnalytics_.Capacity());
+    ConversationStats conversation;
+    size_t count = speakerAnalytics_.Snapshot(speakers.data(), speakers.size(), conversation);
+    if (count == 0 && !final) {
+        return;
+    }
+    std::shared_ptr<const RosterSnapshot> roster = roster_.Snapshot();
+
+    std::string list = "[";
+    for (size_t i = 0; i < count; i++) {
+        const SpeakerStats &stats = speakers[i];
+        const Participant *participant = roster->Find(stats.speakerId);
+        list += i > 0 ? ", {\"userId\": " : "{\"userId\": ";
+        list += std::to_string(stats.speakerId) + ", \"name\": ";
+        AppendJsonString(list, participant ? participant->name : "");
+        list += std::string(", \"speaking\": ") + (stats.speaking ? "true" : "false");
+        list += ", \"talkMs\": " + std::to_string(stats.talkMs);
+        list += ", \"segments\": " + std::to_string(stats.segments);
+        list += ", \"longestSegmentMs\": " + std::to_string(stats.longestSegmentMs);
+        list += ", \"overlapMs\": " + std::to_string(stats.overlapMs);
+        list += ", \"interruptions\": " + std::to_string(stats.interruptions);
+        list += ", \"interrupted\": " + std::to_string(stats.interrupted) + "}";
+    }
+    list += "]";
+
+    BotEvent event("talk_time");
+    event.Add("meetingNumber", options_.meetingNumber)
+        .Add("final", final)
+        .Add("talkMs", conversation.talkMs)
+        .Add("speakerChanges", conversation.speakerChanges)
+        .Add("meanResponseGapMs", conversation.speakerChanges > 0
+                                      ? (double)conversation.totalResponseGapMs / conversation.speakerChanges
+                                      : 0.0)
+        .Add("interruptions", conversation.interruptions)
+        .Add("droppedSpeakers", conversation.droppedSpeakers)
+        .AddRaw("speakers", list);
+    botEvents_.Emit(event);
+
+    if (final) {
+        talkTimeFinal_ = true;
+        ScheduleAnalytics();
+    }
+}
+
+void MeetingSession::FinishRecording() {
+    // let the audio already received reach the synchronizer, write out whatever is still
+    // held in the jitter window, then close the open segment
+    audioRawDataSink_.WaitIdle();
+    gallery_.Stop();
+    EmitTalkTime(true);
+    synchronizer_.Flush();
+    recorder_.Finish();
+    utteranceWriter_.Drain(5000);
+}
+
+MeetingSession::DrainReport MeetingSession::Drain(unsigned int deadlineMs) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::milliseconds(deadlineMs);
+    DrainReport report;
+    report.recordsWritten = recorder_.RecordsWritten();
+    report.droppedRecords = recorder_.DroppedRecords();
+
+    // stop intake first so nothing new lands behind the flush; a waiting Attend sees the
+    // state and returns instead of joining or subscribing again
+    EnterState(SESSION_DRAINING);
+    ReleaseSubscriptions();
+
+    // the gallery thread only finishes the composite in progress, and must be gone before
+    // the flush; audio still queued at the deadline is left behind and the drain incomplete
+    gallery_.Stop();
+    bool audioIdle = audioRawDataSink_.WaitIdleUntil(deadline);
+    EmitTalkTime(true);
+    report.releasedMedia = synchronizer_.Flush();
+    long long remainingMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    report.complete = recorder_.Finish(remainingMs > 0 ? (unsigned int)remainingMs : 0);
+    remainingMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+    report.complete = utteranceWriter_.Drain(remainingMs > 0 ? (unsigned int)remainingMs : 0) && report.complete;
+    report.complete = audioIdle && report.complete;
+
+    report.recordsWritten = recorder_.RecordsWritten() - report.recordsWritten;
+    report.droppedRecords = recorder_.DroppedRecords() - report.droppedRecords;
+    report.pendingWrites = recorder_.PendingWrites();
+    report.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                           .count();
+    return report;
+}
+
+void MeetingSession::Destroy() {
+    ReleaseSubscriptions();
+    // the microphone's playing thread outlives the session
+    if (virtualAudioMic_) {
+        virtualAudioMic_->SetReference(nullptr);
+    }
+    if (settingService_) {
+        ZOOM_SDK_NAMESPACE::DestroySettingService(settingService_);
+        settingService_ = NULL;
+    }
+    if (meetingService_) {
+        ZOOM_SDK_NAMESPACE::DestroyMeetingService(meetingService_);
+        meetingService_ = NULL;
+    }
+
+    // the services are gone, so no more callbacks can reach the listeners
+    delete meetingServiceListener_;
+    delete participantsListener_;
+    delete recordingListener_;
+    delete reminderListener_;
+    delete audioListener_;
+    delete videoListener_;
+    meetingServiceListener_ = nullptr;
+    participantsListener_ = nullptr;
+    recordingListener_ = nullptr;
+    reminderListener_ = nullptr;
+    audioListener_ = nullptr;
+    videoListener_ = nullptr;
+}
+
+void MeetingSession::Start() {
+    ZOOM_SDK_NAMESPACE::StartParam startParam;
+    startParam.userType = ZOOM_SDK_NAMESPACE::SDK_UT_NORMALUSER;
+    startParam.param.normaluserStart.vanityID = NULL;
+    startParam.param.normaluserStart.customer_key = NULL;
+    startParam.param.normaluserStart.isVideoOff = false;
+    startParam.param.normaluserStart.isAudioOff = false;
+
+    ZOOM_SDK_NAMESPACE::SDKError err = meetingService_->Start(startParam);
+    if (SDKError::SDKERR_SUCCESS == err) {
+        std::cerr << "StartMeetingSession:success " << std::endl;
+    } else {
+        std::cerr << "StartMeetingSession:error " << std::endl;
+    }
+}
+
+void MeetingSession::ConfigureAudioDevices() {
+    ZOOM_SDK_NAMESPACE::IAudioSettingContext *pAudioContext = settingService_->GetAudioSettings();
+    if (pAudioContext) {
+        // setting speaker
+        // if there are speakers detected
+        if (pAudioContext->GetSpeakerList()->GetCount() >= 1) {
+            std::cout << "Number of speaker(s) : " << pAudioContext->GetSpeakerList()->GetCount() << std::endl;
+            ISpeakerInfo *sInfo = pAudioContext->GetSpeakerList()->GetItem(0);
+            const zchar_t *deviceName = sInfo->GetDeviceName();
+
+            // set speaker
+            if (deviceName != nullptr && deviceName[0] != '\0') {
+                std::cout << "Speaker(0) name : " << sInfo->GetDeviceName() << std::endl;
+                std::cout << "Speaker(0) id : " << sInfo->GetDeviceId() << std::endl;
+                pAudioContext->SelectSpeaker(sInfo->GetDeviceId(), sInfo->GetDeviceName());
+                std::cout << "Is selected speaker? : " << pAudioContext->GetSpeakerList()->GetItem(0)->IsSelectedDevice() << std::endl;
+            } else {
+                std::cout << "Speaker(0) name is empty or null." << std::endl;
+                std::cout << "Speaker(0) id is empty or null." << std::endl;
+            }
+        }
+
+        // setting microphone
+        // if there are microphone detected
+        if (pAudioContext->GetMicList()->GetCount() >= 1) {
+            IMicInfo *mInfo = pAudioContext->GetMicList()->GetItem(0);
+            std::cout << "Number of mic(s) : " << pAudioContext->GetMicList()->GetCount() << std::endl;
+            const zchar_t *deviceName = mInfo->GetDeviceName();
+
+            // set microphone
+            if (deviceName != nullptr && deviceName[0] != '\0') {
+                std::cout << "Mic(0) name : " << mInfo->GetDeviceName() << std::endl;
+                std::cout << "Mic(0) id : " << mInfo->GetDeviceId() << std::endl;
+                pAudioContext->SelectMic(mInfo->GetDeviceId(), mInfo->GetDeviceName());
+                std::cout << "Is selected Mic? : " << pAudioContext->GetMicList()->GetItem(0)->IsSelectedDevice() << std::endl;
+            } else {
+                std::cout << "Mic(0) name is empty or null." << std::endl;
+                std::cout << "Mic(0) id is empty or null." << std::endl;
+            }
+        }
+    }
+}
+
+void MeetingSession::EnableRawDataPublishing() {
+    // testing WIP
+    if (options_.enableVideoRawDataPublishing) {
+        IMeetingVideoController *meetingVidController = meetingService_->GetMeetingVideoController();
+        meetingVidController->UnmuteVideo();
+    }
+    // testing WIP
+    if (options_.enableAudioRawDataPublishing) {
+        IMeetingAudioController *meetingAudController = meetingService_->GetMeetingAudioController();
+        meetingAudController->JoinVoip();
+        const Participant *myself = roster_.Snapshot()->Myself();
+        printf("Is my audio muted: %d\n", myself ? myself->audioMuted : true);
+        meetingAudController->UnMuteAudio(GetMyUserId());
+    }
+}
+
+void MeetingSession::DisableRawDataPublishing() {
+    // testing WIP
+    if (options_.enableVideoRawDataPublishing) {
+        IMeetingVideoController *meetingVidController = meetingService_->GetMeetingVideoController();
+        meetingVidController->MuteVideo();
+    }
+    // testing WIP
+    if (options_.enableAudioRawDataPublishing) {
+        IMeetingAudioController *meetingAudController = meetingService_->GetMeetingAudioController();
+        meetingAudController->MuteAudio(GetMyUserId(), true);
+    }
+}
+
+void MeetingSession::SetFirstAudioCallback(void (*callback)(void *), void *context) {
+    onFirstAudio_ = callback;
+    firstAudioContext_ = context;
+}
+
+void MeetingSession::HandleFirstAudio(void *context) {
+    MeetingSession *self = static_cast<MeetingSession *>(context);
+    long long latencyMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - self->createdAt_)
+                              .count();
+    self->firstAudioLatencyMs_ = latencyMs;
+    std::cout << "Meeting " << self->options_.meetingNumber << ": join request to first audio took " << latencyMs
+              << " ms" << std::endl;
+    if (self->onFirstAudio_) {
+        self->onFirstAudio_(self->firstAudioContext_);
+    }
+}
+
+void MeetingSession::CollectMetrics(MetricsWriter &writer, void *context) {
+    MeetingSession *self = static_cast<MeetingSession *>(context);
+    long long latencyMs = self->firstAudioLatencyMs_;
+    if (latencyMs >= 0) {
+        writer.Write("zoom_bot_join_to_first_audio_ms", latencyMs);
+    }
+    writer.Write("zoom_bot_participants", self->roster_.Snapshot()->Size());
+    writer.Write("zoom_bot_session_state", self->state_);
+    writer.Write("zoom_bot_reconnects_total", self->reconnects_);
+    writer.Write("zoom_bot_failed_recoveries_total", self->failedRecoveries_);
+    if (self->lastRecoveryMs_ >= 0) {
+        writer.Write("zoom_bot_reconnect_recovery_ms", self->lastRecoveryMs_);
+        writer.Write("zoom_bot_reconnect_recovery_max_ms", self->maxRecoveryMs_);
+    }
+}
+
+void MeetingSession::HandleEvent(const MeetingEvent &event, void *context) {
+    static_cast<MeetingSession *>(context)->OnEvent(event);
+}
+
+void MeetingSession::OnEvent(const MeetingEvent &event) {
+    // events posted before Destroy may still be queued; while draining nothing may resubscribe
+    if (!meetingService_ || state_ == SESSION_DRAINING) {
+        return;
+    }
+    switch (event.type) {
+    case MEETING_EVENT_STATUS_CHANGED:
+        OnMeetingStatusChanged(event.status, event.result);
+        lifecycleEvents_.Push(event);
+        break;
+    case MEETING_EVENT_JOINING:
+        printf("Joining Meeting...\n");
+        break;
+    case MEETING_EVENT_HOST_CHANGED:
+        OnRosterEvent(event);
+        printf("Is host now...\n");
+        lifecycleEvents_.Push(event);
+        break;
+    case MEETING_EVENT_COHOST_CHANGED:
+        OnRosterEvent(event);
+        printf("Is co-host now...\n");
+        lifecycleEvents_.Push(event);
+        break;
+    case MEETING_EVENT_RECORDING_PRIVILEGE_CHANGED:
+        if (event.flag) {
+            printf("Is given recording permissions now...\n");
+            lifecycleEvents_.Push(event);
+        }
+        break;
+    case MEETING_EVENT_USERS_JOINED:
+    case MEETING_EVENT_USERS_LEFT:
+    case MEETING_EVENT_USER_NAMES_CHANGED:
+    case MEETING_EVENT_USER_AUDIO_CHANGED:
+    case MEETING_EVENT_USER_VIDEO_CHANGED:
+        OnRosterEvent(event);
+        break;
+    case MEETING_EVENT_RENDERER_DESTROYED:
+        if (options_.gallery) {
+            // a tile's participant is gone or their renderer was lost; that is no outage,
+            // the tile is just filled again
+            for (size_t i = 0; i < galleryRenderers_.size(); i++) {
+                if (galleryRenderers_[i].helper && galleryRenderers_[i].userId == event.userId) {
+                    galleryRenderers_[i].helper = nullptr;
+                    ReleaseGalleryTile((unsigned int)i);
+                }
+            }
+            if (galleryStarted_) {
+                SyncGallery();
+            }
+            break;
+        }
+        // the SDK freed the renderer; Attend subscribes a new one
+        videoHelper_ = nullptr;
+        lifecycleEvents_.Push(event);
+        break;
+    }
+}
+
+void MeetingSession::OnMeetingStatusChanged(int status, int result) {
+    std::cout << "onMeetingStatusChanged: " << status << ", iResult: " << result << std::endl;
+    switch (status) {
+    case MEETING_STATUS_IDLE:
+        printf("No meeting is running.\n");
+        break;
+    case MEETING_STATUS_CONNECTING:
+        printf("Connect to the meeting server status.\n");
+        break;
+    case MEETING_STATUS_WAITINGFORHOST:
+        printf("Waiting for the host to start the meeting.\n");
+        break;
+    case MEETING_STATUS_INMEETING:
+        printf("onMeetingStatusChanged() In Meeting.\n");
+        break;
+    case MEETING_STATUS_DISCONNECTING:
+        printf("Disconnect the meeting server, leave meeting status.\n");
+        break;
+    case MEETING_STATUS_RECONNECTING:
+        printf("Reconnecting meeting server status\n");
+        OnConnectionLost(SESSION_RECONNECTING);
+        break;
+    case MEETING_STATUS_FAILED:
+        printf("Failed to connect the meeting server.\n");
+        OnConnectionLost(SESSION_REJOINING);
+        break;
+    case MEETING_STATUS_ENDED:
+        // on meeting ended, typically by host. it is possible to reuse this SDK instance
+        printf("Meeting ends.\n");
+        ReleaseSubscriptions();
+        FinishRecording();
+        EnterState(SESSION_ENDED);
+        break;
+    case MEETING_STATUS_UNKNOWN:
+        printf("Unknown status.\n");
+        break;
+    case MEETING_STATUS_LOCKED:
+        printf("Meeting is locked to prevent the further participants to join the meeting.\n");
+        break;
+    case MEETING_STATUS_UNLOCKED:
+        printf("Meeting is open and participants can join the meeting.\n");
+        break;
+    case MEETING_STATUS_IN_WAITING_ROOM:
+        printf("Participants who join the meeting before the start are in the waiting room.\n");
+        break;
+    }
+}
+
+void MeetingSession::OnInMeeting() {
+    // double check if you are in a meeting
+    if (meetingService_->GetMeetingStatus() == ZOOM_SDK_NAMESPACE::MEETING_STATUS_INMEETING) {
+        printf("In Meeting %s Now...\n", options_.meetingNumber.c_str());
+
+        // the roster is kept up to date by events from here on
+        SeedRoster();
+        printf("Participants count: %zu\n", roster_.Snapshot()->Size());
+    }
+
+    if (everInMeeting_) {
+        // back after an outage: the sinks kept their state, only the subscriptions are gone
+        EnterState(SESSION_RECOVERING);
+        return;
+    }
+    // CaptureUntilDisconnected makes the first attempt to start raw recording / sending
+    EnterState(SESSION_IN_MEETING);
+    everInMeeting_ = true;
+}
+
+void MeetingSession::EnterState(MeetingSessionState state) {
+    static const char *const kStateNames[] = {"idle", "joining", "in-meeting", "reconnecting",
+                                              "rejoining", "recovering", "ended", "draining"};
+    if (state != state_) {
+        std::cout << "Meeting " << options_.meetingNumber << ": " << kStateNames[state_] << " -> "
+                  << kStateNames[state] << std::endl;
+        state_ = state;
+    }
+}
+
+void MeetingSession::OnConnectionLost(MeetingSessionState state) {
+    if (!everInMeeting_) {
+        // never got in (wrong password, meeting not started): nothing to recover
+        return;
+    }
+    // a loss during an unfinished recovery still counts from the first outage
+    if (state_ == SESSION_IN_MEETING) {
+        lostAt_ = std::chrono::steady_clock::now();
+        reconnects_++;
+    }
+    // the subscriptions die with the connection; the sinks, synchronizer and recorder stay
+    // untouched so the outage shows up downstream as a gap
+    ReleaseSubscriptions();
+    EnterState(state);
+    if (state == SESSION_REJOINING) {
+        // the SDK gave up; Attend joins again. User ids are handed out anew on the next join
+        roster_.Clear();
+        roster_.Publish();
+    }
+}
+
+// start raw recording and, when that completes an outage, record how long it took
+bool MeetingSession::StartCapture() {
+    if (!StartRawRecordingIfPermitted(options_.enableVideoRawDataCapture, options_.enableAudioRawDataCapture)) {
+        return false;
+    }
+    if (state_ == SESSION_RECOVERING) {
+        long long recoveryMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now() - lostAt_)
+                                   .count();
+        lastRecoveryMs_ = recoveryMs;
+        if (recoveryMs > maxRecoveryMs_) {
+            maxRecoveryMs_ = recoveryMs;
+        }
+        std::cout << "Meeting " << options_.meetingNumber << ": capture recovered after " << recoveryMs << " ms"
+                  << std::endl;
+        EnterState(SESSION_IN_MEETING);
+    }
+    return true;
+}
+
+void MeetingSession::ReleaseSubscriptions() {
+    if (videoHelper_) {
+        videoHelper_->unSubscribe();
+        destroyRenderer(videoHelper_);
+        videoHelper_ = nullptr;
+    }
+    for (size_t i = 0; i < galleryRenderers_.size(); i++) {
+        ReleaseGalleryTile((unsigned int)i);
+    }
+    galleryStarted_ = false;
+    if (audioHelper_) {
+        audioHelper_->unSubscribe();
+        audioHelper_ = nullptr;
+    }
+    audioSubscribed_ = false;
+}
+
+void MeetingSession::OnRosterEvent(const MeetingEvent &event) {
+    switch (event.type) {
+    case MEETING_EVENT_USERS_JOINED:
+        for (size_t i = 0; i < event.userIds.size(); i++) {
+            AddParticipant(event.userIds[i]);
+        }
+        printf("%zu participant(s) joined\n", event.userIds.size());
+        break;
+    case MEETING_EVENT_USERS_LEFT:
+        for (size_t i = 0; i < event.userIds.size(); i++) {
+            roster_.Remove(event.userIds[i]);
+        }
+        printf("%zu participant(s) left\n", event.userIds.size());
+        break;
+    case MEETING_EVENT_USER_NAMES_CHANGED:
+        for (size_t i = 0; i < event.userIds.size(); i++) {
+            Participant *participant = roster_.Edit(event.userIds[i]);
+            IUserInfo *user = meetingService_->GetMeetingParticipantsController()->GetUserByUserID(event.userIds[i]);
+            if (participant && user && user->GetUserName()) {
+                strncpy(participant->name, user->GetUserName(), sizeof(participant->name) - 1);
+            }
+        }
+        break;
+    case MEETING_EVENT_HOST_CHANGED: {
+        // there is one host: whoever held the role before is an attendee now
+        std::vector<Participant> participants = roster_.Snapshot()->List();
+        for (size_t i = 0; i < participants.size(); i++) {
+            Participant *previous = roster_.Edit(participants[i].userId);
+            if (previous && previous->role == PARTICIPANT_HOST && previous->userId != event.userId) {
+                previous->role = PARTICIPANT_ATTENDEE;
+            }
+        }
+        if (Participant *participant = roster_.Edit(event.userId)) {
+            participant->role = PARTICIPANT_HOST;
+        }
+        break;
+    }
+    case MEETING_EVENT_COHOST_CHANGED:
+        if (Participant *participant = roster_.Edit(event.userId)) {
+            if (participant->role != PARTICIPANT_HOST) {
+                participant->role = event.flag ? PARTICIPANT_COHOST : PARTICIPANT_ATTENDEE;
+            }
+        }
+        break;
+    case MEETING_EVENT_USER_AUDIO_CHANGED:
+        if (Participant *participant = roster_.Edit(event.userId)) {
+            participant->audioMuted = event.flag;
+        }
+        break;
+    case MEETING_EVENT_USER_VIDEO_CHANGED:
+        if (Participant *participant = roster_.Edit(event.userId)) {
+            participant->videoOn = event.flag;
+        }
+        break;
+    default:
+        break;
+    }
+    roster_.Publish();
+    if (galleryStarted_ && (event.type == MEETING_EVENT_USERS_JOINED || event.type == MEETING_EVENT_USERS_LEFT)) {
+        SyncGallery();
+    }
+}
+
+// the only place that asks the SDK about a participant: once, when they join
+void MeetingSession::AddParticipant(unsigned int userId) {
+    if (roster_.Edit(userId)) {
+        return;
+    }
+    IUserInfo *user = meetingService_->GetMeetingParticipantsController()->GetUserByUserID(userId);
+    if (!user) {
+        return;
+    }
+    Participant participant;
+    memset(&participant, 0, sizeof(participant));
+    participant.userId = userId;
+    switch (user->GetUserRole()) {
+    case USERROLE_HOST:
+        participant.role = PARTICIPANT_HOST;
+        break;
+    case USERROLE_COHOST:
+        participant.role = PARTICIPANT_COHOST;
+        break;
+    default:
+        participant.role = PARTICIPANT_ATTENDEE;
+        break;
+    }
+    participant.isMyself = user->IsMySelf();
+    participant.audioMuted = user->IsAudioMuted();
+    participant.videoOn = user->IsVideoOn();
+    participant.joinedAtMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::system_clock::now().time_since_epoch())
+                                 .count();
+    participant.joinSequence = roster_.NextJoinSequence();
+    if (user->GetUserName()) {
+        strncpy(participant.name, user->GetUserName(), sizeof(participant.name) - 1);
+    }
+    roster_.Upsert(participant);
+}
+
+// fill the roster with whoever was in the meeting before the bot got there
+void MeetingSession::SeedRoster() {
+    IList<unsigned int> *participants = meetingService_->GetMeetingParticipantsController()->GetParticipantsList();
+    if (participants) {
+        for (int i = 0; i < participants->GetCount(); i++) {
+            AddParticipant(participants->GetItem(i));
+        }
+    }
+    roster_.Publish();
+}
+
+// the participant who has been in the meeting the longest, it is just an arbitary UserID
+uint32_t MeetingSession::GetFirstParticipantId() {
+    const Participant *first = roster_.Snapshot()->FirstJoined();
+    uint32_t userId = first ? first->userId : 0;
+    std::cout << "UserID is : " << userId << std::endl;
+    return userId;
+}
+
+unsigned int MeetingSession::GetMyUserId() {
+    const Participant *myself = roster_.Snapshot()->Myself();
+    return myself ? myself->userId : 0;
+}
+
+// check if you have permission to start raw recording
+// returns true once every requested subscription is in place; calling it again only fills in what is missing
+bool MeetingSession::StartRawRecordingIfPermitted(bool isVideo, bool isAudio) {
+
+    if (!isVideo && !isAudio) {
+        return true;
+    }
+    IMeetingRecordingController *recordController = meetingService_->GetMeetingRecordingController();
+    SDKError err2 = recordController->CanStartRawRecording();
+    if (err2 != SDKERR_SUCCESS) {
+        std::cout << "Cannot start raw recording: no permissions yet, need host, co-host, or recording privilege" << std::endl;
+        return false;
+    }
+
+    SDKError err1 = recordController->StartRawRecording();
+    if (err1 != SDKERR_SUCCESS) {
+        std::cout << "Error occurred starting raw recording" << std::endl;
+        return false;
+    }
+
+    // enableVideoRawDataCapture
+    bool galleryComplete = true;
+    if (isVideo && options_.gallery) {
+        galleryStarted_ = true;
+        galleryComplete = SyncGallery();
+    } else if (isVideo && !videoHelper_) {
+        SDKError err = createRenderer(&videoHelper_, &videoRenderer_);
+        if (err != SDKERR_SUCCESS) {
+            std::cout << "Error occurred creating renderer : " << err << std::endl;
+            videoHelper_ = nullptr;
+        } else {
+            std::cout << "attemptToStartRawRecording : subscribing" << std::endl;
+            const VideoResolution *resolution = FindVideoResolution(options_.videoResolution);
+            videoHelper_->setRawDataResolution(resolution ? resolution->resolution : ZoomSDKResolution_720P);
+            uint32_t subscribeId = GetFirstParticipantId();
+            videoRenderer_.SetSynchronizer(&synchronizer_, subscribeId);
+            err = videoHelper_->subscribe(subscribeId, RAW_DATA_TYPE_VIDEO);
+            if (err != SDKERR_SUCCESS) {
+                std::cout << "Error occurred subscribing to video : " << err << std::endl;
+                destroyRenderer(videoHelper_);
+                videoHelper_ = nullptr;
+            }
+        }
+    }
+
+    // enableAudioRawDataCapture
+    if (isAudio && !audioSubscribed_) {
+        audioHelper_ = GetAudioRawdataHelper();
+        std::cout << "attemptToStartRawRecording : audio helper obtained = " << (audioHelper_ != nullptr) << std::endl;
+
+        // Check if HasRawdataLicense returns true
+        bool hasLicense = HasRawdataLicense();
+        std::cout << "Has Raw Data License: " << (hasLicense ? "Yes" : "No") << std::endl;
+
+        if (audioHelper_) {
+            audioRawDataSink_.SetDropNonSpeech(options_.dropNonSpeechAudio);
+
+            // Try to unsubscribe first in case there's a previous subscription
+            audioHelper_->unSubscribe();
+
+            // Now attempt to subscribe, only as configured: the other interpreterAudio mode
+            // would record languages nobody asked for, or silently leave them out
+            SDKError err = audioHelper_->subscribe(&audioRawDataSink_, options_.interpreterAudio);
+            if (err != SDKERR_SUCCESS) {
+                std::cout << "Error occurred subscribing to audio : " << err << std::endl;
+                BotEvent event("audio_subscribe_failed");
+                event.Add("meetingNumber", options_.meetingNumber)
+                    .Add("interpreterAudio", options_.interpreterAudio)
+                    .Add("error", (int)err);
+                botEvents_.Emit(event);
+            }
+            audioSubscribed_ = err == SDKERR_SUCCESS;
+        } else {
+            std::cout << "Error getting audioHelper" << std::endl;
+        }
+    }
+
+    return (!isVideo || (options_.gallery ? galleryComplete : videoHelper_ != nullptr)) && (!isAudio || audioSubscribed_);
+}
+
+// give every free gallery tile to a participant not shown yet, in the order they joined,
+// after emptying the tiles of those who left; false if a subscription failed
+bool MeetingSession::SyncGallery() {
+    std::shared_ptr<const RosterSnapshot> roster = roster_.Snapshot();
+    for (size_t i = 0; i < galleryRenderers_.size(); i++) {
+        if (galleryRenderers_[i].userId && !roster->Find(galleryRenderers_[i].userId)) {
+            ReleaseGalleryTile((unsigned int)i);
+        }
+    }
+
+    std::vector<Participant> participants = roster->List();
+    std::sort(participants.begin(), participants.end(), [](const Participant &a, const Participant &b) {
+        return a.joinSequence < b.joinSequence;
+    });
+    bool complete = true;
+    size_t tile = 0;
+    for (size_t p = 0; p < participants.size(); p++) {
+        if (participants[p].isMyself) {
+            continue;
+        }
+        bool shown = false;
+        for (size_t i = 0; i < galleryRenderers_.size() && !shown; i++) {
+            shown = galleryRenderers_[i].userId == participants[p].userId;
+        }
+        if (shown) {
+            continue;
+        }
+        while (tile < galleryRenderers_.size() && galleryRenderers_[tile].userId) {
+            tile++;
+        }
+        if (tile == galleryRenderers_.size()) {
+            break;
+        }
+        if (!SubscribeGalleryTile((unsigned int)tile, participants[p].userId)) {
+            complete = false;
+        }
+    }
+    return complete;
+}
+
+bool MeetingSession::SubscribeGalleryTile(unsigned int tile, uint32_t userId) {
+    GalleryRenderer &entry = galleryRenderers_[tile];
+    SDKError err = createRenderer(&entry.helper, &entry.renderer);
+    if (err != SDKERR_SUCCESS) {
+        std::cout << "Error occurred creating gallery renderer : " << err << std::endl;
+        entry.helper = nullptr;
+        return false;
+    }
+    entry.helper->setRawDataResolution(GalleryTileResolution(options_.videoResolution).resolution);
+    // the tile takes the participant's frames from the first one on
+    gallery_.SetTile(tile, userId);
+    entry.renderer.SetCompositor(&gallery_, tile, userId);
+    err = entry.helper->subscribe(userId, RAW_DATA_TYPE_VIDEO);
+    if (err != SDKERR_SUCCESS) {
+        std::cout << "Error occurred subscribing gallery tile " << tile << " to " << userId << " : " << err
+                  << std::endl;
+        destroyRenderer(entry.helper);
+        entry.helper = nullptr;
+        gallery_.SetTile(tile, 0);
+        return false;
+    }
+    entry.userId = userId;
+    return true;
+}
+
+void MeetingSession::ReleaseGalleryTile(unsigned int tile) {
+    GalleryRenderer &entry = galleryRenderers_[tile];
+    if (entry.helper) {
+        entry.helper->unSubscribe();
+        destroyRenderer(entry.helper);
+        entry.helper = nullptr;
+    }
+    entry.userId = 0;
+    gallery_.SetTile(tile, 0);
+}
+
+// check if you meet the requirements to send raw data
+void MeetingSession::StartRawDataPublishingIfPermitted(bool isVideo, bool isAudio) {
+
+    // enableVideoRawDataPublishing
+    if (isVideo) {
+
+        ZoomSdkVideoSource *virtualVideoSource = new ZoomSdkVideoSource(kDefaultVideoSource);
+        IZoomSDKVideoSourceHelper *videoSourceHelper = GetRawdataVideoSourceHelper();
+
+        if (videoSourceHelper) {
+            SDKError err = videoSourceHelper->setExternalVideoSource(virtualVideoSource);
+
+            if (err != SDKERR_SUCCESS) {
+                printf("attemptToStartRawVideoSending(): Failed to set external video source, error code: %d\n", err);
+            } else {
+                printf("attemptToStartRawVideoSending(): Success \n");
+                IMeetingVideoController *meetingController = meetingService_->GetMeetingVideoController();
+                meetingController->UnmuteVideo();
+            }
+        } else {
+            printf("attemptToStartRawVideoSending(): Failed to get video source helper\n");
+        }
+    }
+
+    // enableAudioRawDataPublishing
+    if (isAudio) {
+        if (!virtualAudioMic_) {
+            virtualAudioMic_ = new ZoomSdkVirtualAudioMicEvent(kDefaultAudioSource);
+            virtualAudioMic_->SetReference(&playbackReference_);
+        }
+        IZoomSDKAudioRawDataHelper *audioPublishingHelper = GetAudioRawdataHelper();
+        if (audioPublishingHelper) {
+            audioPublishingHelper->setExternalAudioSource(virtualAudioMic_);
+        }
+    }
+}
@@ -0,0 +1,364 @@
+// One joined meeting: its SDK services, raw data capture and recording
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <glib.h>
+#include <string>
+#include <vector>
+
+#include "meeting_service_components/meeting_audio_interface.h"
+#include "meeting_service_components/meeting_participants_ctrl_interface.h"
+#include "meeting_service_interface.h"
+#include "setting_service_interface.h"
+#include "zoom_sdk.h"
+
+#include "BotEventChannel.h"
+#include "GalleryCompositor.h"
+#include "MainLoopTask.h"
+#include "MediaSynchronizer.h"
+#include "MeetingEventBus.h"
+#include "Metrics.h"
+#include "ParticipantRoster.h"
+#include "PlaybackReference.h"
+#include "SegmentedRecorder.h"
+#include "SnapshotServer.h"
+#include "SnapshotStore.h"
+#include "SpeakerAnalytics.h"
+#include "TaskScheduler.h"
+#include "UtteranceWriter.h"
+#include "ZoomSdkAudioRawData.h"
+#include "ZoomSdkRenderer.h"
+
+USING_ZOOM_SDK_NAMESPACE
+
+class MeetingServiceEventListener;
+class MeetingParticipantsCtrlEventListener;
+class MeetingAudioCtrlEventListener;
+class MeetingVideoCtrlEventListener;
+class MeetingRecordingCtrlEventListener;
+class MeetingReminderEventListener;
+class ZoomSdkVirtualAudioMicEvent;
+
+enum MeetingSessionState {
+    SESSION_IDLE,
+    // join requested, waiting for the SDK to report in-meeting
+    SESSION_JOINING,
+    // in the meeting with capture running (or waiting for recording privilege)
+    SESSION_IN_MEETING,
+    // the SDK lost the connection and is reconnecting on its own
+    SESSION_RECONNECTING,
+    // the connection failed after we had been in the meeting; joining again after a backoff
+    SESSION_REJOINING,
+    // back in the meeting, re-establishing raw recording and subscriptions
+    SESSION_RECOVERING,
+    // the meeting ended; the recording is finished
+    SESSION_ENDED,
+    // shutting down: capture stopped, buffered media being written out
+    SESSION_DRAINING,
+};
+
+// Everything needed to join one meeting and size its pipeline, see BotConfig.
+struct MeetingOptions {
+    std::string meetingNumber;
+    std::string meetingPassword;
+    std::string recordingToken;
+    std::string userName;
+    // segments and manifest.json of this meeting are written here
+    std::string recordingDirectory;
+
+    bool enableVideoRawDataCapture;
+    bool enableAudioRawDataCapture;
+    bool enableVideoRawDataPublishing;
+    bool enableAudioRawDataPublishing;
+    // drop participant audio the VAD classifies as non-speech before it reaches the writers
+    bool dropNonSpeechAudio;
+    // what is recorded of the audio: pcm, logmel or both, see AudioOutput
+    std::string audioOutput;
+    // loudness every stream is normalized to, e.g. "-23" (LUFS), or "off"
+    std::string agcTargetLufs;
+    // what is done with the bot's own published audio in the mixed capture: off, subtract or gate
+    std::string selfAudioSuppression;
+    // also record a mix of the participant streams the lists select, as stream kLocalMixStreamId;
+    // the lists hold names or node ids, see LocalMixRulesFromConfig
+    bool localMix;
+    std::string localMixInclude;
+    std::string localMixExclude;
+    std::string localMixGains;
+    // keywords to spot in the participant streams, "keyword=example.wav,...", "" for none;
+    // a hit is a "keyword" event, see TemplateKeywordModel
+    std::string keywordTemplates;
+    // how close a match must be, in hundredths of the mean cosine distance
+    unsigned int keywordMaxDistance;
+    // threads the keyword spotter may use, under the analysis role of threadLayout
+    unsigned int keywordThreads;
+    // also write every participant's speech as utterances of utteranceMinSeconds to
+    // utteranceMaxSeconds, cut at pauses, under <recordingDirectory>/utterances; see
+    // UtteranceChunker. utteranceBuffers utterances of utteranceMaxSeconds are preallocated
+    bool utterances;
+    unsigned int utteranceMinSeconds;
+    unsigned int utteranceMaxSeconds;
+    unsigned int utteranceOverlapMs;
+    unsigned int utteranceBuffers;
+    // also subscribe to the language interpretation channels; each language is recorded
+    // as a stream of its own, like the shared-screen audio
+    bool interpreterAudio;
+    // record one gallery view of up to galleryTiles participants, composed at galleryFps,
+    // instead of the video of the first participant; see GalleryCompositor
+    bool gallery;
+    unsigned int galleryTiles;
+    unsigned int galleryFps;
+    // every snapshotIntervalSeconds, a JPEG thumbnail snapshotWidth pixels wide of each
+    // participant whose video is subscribed, served on <recordingDirectory>/snapshots.sock
+    // for the latest snapshotParticipants of them; 0 for none, see SnapshotServer
+    unsigned int snapshotIntervalSeconds;
+    unsigned int snapshotWidth;
+    unsigned int snapshotQuality;
+    unsigned int snapshotParticipants;
+
+    // raw video subscription: 90p, 180p, 360p, 720p or 1080p; also sizes the video slots
+    std::string videoResolution;
+    // synchronizer: how long media waits for earlier items, and its preallocated slots
+    unsigned int jitterWindowMs;
+    unsigned int audioSlots;
+    unsigned int videoSlots;
+    // recorder: writer block pool and the duration of one segment file
+    unsigned int writerBlockKb;
+    unsigned int writerBlocks;
+    unsigned int segmentSeconds;
+    // threads that resample and classify participant audio, 0 for the CPUs of the cgroup quota
+    unsigned int mediaWorkers;
+    // how often a talk_time event is emitted, 0 for only once at the end
+    unsigned int analyticsIntervalSeconds;
+    // unix datagram socket that also receives every event of events.jsonl, "" for none
+    std::string eventSocket;
+
+    MeetingOptions()
+        : userName("LinuxChun"), recordingDirectory("recording"), enableVideoRawDataCapture(true),
+          enableAudioRawDataCapture(true), enableVideoRawDataPublishing(false), enableAudioRawDataPublishing(false),
+          dropNonSpeechAudio(false), audioOutput("pcm"), agcTargetLufs("off"),
+          selfAudioSuppression("subtract"), localMix(false), keywordMaxDistance(20), keywordThreads(1),
+          utterances(false), utteranceMinSeconds(5), utteranceMaxSeconds(30), utteranceOverlapMs(500), utteranceBuffers(32),
+          interpreterAudio(false), gallery(false), galleryTiles(25), galleryFps(15), snapshotIntervalSeconds(0),
+          snapshotWidth(320), snapshotQuality(75), snapshotParticipants(64),
+          videoResolution("720p"), jitterWindowMs(120), audioSlots(256), videoSlots(8),
+          writerBlockKb(256), writerBlocks(32), segmentSeconds(60), mediaWorkers(0),
+          analyticsIntervalSeconds(10) {}
+};
+
+/// \brief Frame size of a videoResolution name such as "720p".
+/// \return false if the name is not one the SDK supports.
+bool VideoResolutionSize(const std::string &name, unsigned int &width, unsigned int &height);
+
+/// \brief Parse a meeting number: decimal digits without a leading zero that fit in 64 bits.
+/// It is also used as a directory name, so nothing else is accepted.
+bool ParseMeetingNumber(const std::string &text, uint64_t &number);
+
+// Owns the per-meeting state that used to live in MeetingSdkDemo.cpp globals. The SDK
+// itself (InitSDK, authentication, CleanUPSDK) is process-wide and stays with the caller.
+//
+// The Linux SDK hosts a single meeting per process, so only one session can be active at a
+// time; several meetings run as one worker process each under SessionSupervisor.
+//
+// SDK callbacks never act directly: the listeners post typed events to a MeetingEventBus
+// and the session handles them on the GLib main loop, so raw recording is started and
+// renderers subscribed outside the SDK's callbacks. Bookkeeping happens right away; what
+// has to wait (for the join, for recording privilege, for a backoff) is the Attend
+// coroutine, which takes status and privilege events from lifecycleEvents_.
+//
+// A dropped connection does not restart the recording. The capture sinks, synchronizer
+// and recorder stay as they are while the SDK reconnects (or the session joins again with
+// exponential backoff after a failure). Once back in the meeting the session re-establishes
+// raw recording and its subscriptions, again with backoff, so downstream sees a gap marker
+// for the outage instead of a new recording.
+class MeetingSession {
+public:
+    explicit MeetingSession(const MeetingOptions &options);
+    ~MeetingSession();
+
+    const MeetingOptions &Options() const { return options_; }
+
+    /// \brief The session whose SDK listeners are installed, or nullptr.
+    static MeetingSession *Active() { return active_; }
+
+    /// \brief Create the meeting and setting services, install the listeners, join and
+    /// capture, recovering from lost connections, until the meeting is over. Must be
+    /// started after the SDK is authenticated, on the main loop.
+    /// \return true when the meeting ended or the session was drained, false if it could
+    /// not be joined or recovery gave up.
+    Task<bool> Attend();
+
+    /// \brief Leave the meeting if the SDK reports one in progress.
+    void Leave();
+
+    /// \brief Apply the reloadable options (dropNonSpeechAudio, jitterWindowMs, segmentSeconds,
+    /// analyticsIntervalSeconds, the local mix lists) of options without leaving the meeting.
+    void ApplyOptions(const MeetingOptions &options);
+
+    /// \brief Write out media still held in the jitter window and close the open segment.
+    void FinishRecording();
+
+    struct DrainReport {
+        // items that were still in the jitter window and got written out
+        size_t releasedMedia;
+        // records written and dropped (no free writer blocks) during the drain
+        unsigned long long recordsWritten;
+        unsigned long long droppedRecords;
+        // writer operations still queued when the deadline passed
+        size_t pendingWrites;
+        long long elapsedMs;
+        bool complete;
+    };
+
+    /// \brief Stop capture, write out buffered media and wait for the writer, all within
+    /// deadlineMs. The meeting is not left; call Leave afterwards.
+    DrainReport Drain(unsigned int deadlineMs);
+
+    /// \brief Unsubscribe raw data and destroy the meeting and setting services.
+    void Destroy();
+
+    /// \brief Start a meeting as a normal user (used for non headless app).
+    void Start();
+
+    /// \brief Select the first speaker and microphone the SDK reports.
+    void ConfigureAudioDevices();
+
+    void EnableRawDataPublishing();
+    void DisableRawDataPublishing();
+
+    /// \brief Called once when the first audio of the meeting arrives, after the latency is logged.
+    void SetFirstAudioCallback(void (*callback)(void *), void *context);
+
+    /// \brief Who is in the meeting. Read it instead of querying the participants controller.
+    const ParticipantRoster &Roster() const { return roster_; }
+
+    /// \brief Milliseconds from creating the session to the first audio sample, or -1 before it.
+    long long FirstAudioLatencyMs() const { return firstAudioLatencyMs_; }
+
+    MeetingSessionState State() const { return state_; }
+
+private:
+    // the SDK listeners post to events_; these run on the main loop, in posting order
+    static void HandleEvent(const MeetingEvent &event, void *context);
+    void OnEvent(const MeetingEvent &event);
+    void OnMeetingStatusChanged(int status, int result);
+    Task<bool> JoinMeeting();
+    Task<> CaptureUntilDisconnected();
+    void OnInMeeting();
+    void OnRosterEvent(const MeetingEvent &event);
+    void AddParticipant(unsigned int userId);
+    void SeedRoster();
+    static void HandleFirstAudio(void *context);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+    static gboolean HandleAnalyticsTimeout(gpointer context);
+    void ScheduleAnalytics();
+    // the talk_time event with the counters so far; the final one is emitted once
+    void EmitTalkTime(bool final);
+
+    uint32_t GetFirstParticipantId();
+    unsigned int GetMyUserId();
+    bool CreateServices();
+    bool RequestJoin();
+    void EnterState(MeetingSessionState state);
+    void OnConnectionLost(MeetingSessionState state);
+    bool StartCapture();
+    void ReleaseSubscriptions();
+
+    bool StartRawRecordingIfPermitted(bool isVideo, bool isAudio);
+    bool SyncGallery();
+    bool SubscribeGalleryTile(unsigned int tile, uint32_t userId);
+    void ReleaseGalleryTile(unsigned int tile);
+    void StartRawDataPublishingIfPermitted(bool isVideo, bool isAudio);
+
+    static MeetingSession *active_;
+
+    MeetingOptions options_;
+    MeetingEventBus events_;
+    // statuses, privilege changes and renderer loss, for the Attend coroutine
+    AsyncChannel<MeetingEvent> lifecycleEvents_;
+
+    // the session is created when the join is requested, so this includes SDK start-up
+    // unless the process was already initialized and authenticated
+    std::chrono::steady_clock::time_point createdAt_;
+    std::atomic<long long> firstAudioLatencyMs_;
+
+    MeetingSessionState state_;
+    // set once in the meeting; a failure before that is not retried
+    bool everInMeeting_;
+    // when the connection was lost, for zoom_bot_reconnect_recovery_ms
+    std::chrono::steady_clock::time_point lostAt_;
+    unsigned long long reconnects_;
+    unsigned long long failedRecoveries_;
+    long long lastRecoveryMs_;
+    long long maxRecoveryMs_;
+    void (*onFirstAudio_)(void *);
+    void *firstAudioContext_;
+
+    IMeetingService *meetingService_;
+    ISettingService *settingService_;
+    MeetingServiceEventListener *meetingServiceListener_;
+    MeetingParticipantsCtrlEventListener *participantsListener_;
+    MeetingRecordingCtrlEventListener *recordingListener_;
+    MeetingReminderEventListener *reminderListener_;
+    MeetingAudioCtrlEventListener *audioListener_;
+    MeetingVideoCtrlEventListener *videoListener_;
+
+    // kept current from the participant, audio and video events on the main loop
+    ParticipantRoster roster_;
+    // thumbnails of the participants, taken by the renderers below and so declared before them
+    SnapshotStore snapshots_;
+    SnapshotServer snapshotServer_;
+
+    // references for enableVideoRawDataCapture
+    ZoomSdkRenderer videoRenderer_;
+    IZoomSDKRenderer *videoHelper_;
+    // with gallery, one renderer per tile of gallery_, subscribed to userId; never resized,
+    // the SDK keeps pointers to the renderers
+    struct GalleryRenderer {
+        ZoomSdkRenderer renderer;
+        IZoomSDKRenderer *helper;
+        uint32_t userId;
+    };
+    std::vector<GalleryRenderer> galleryRenderers_;
+    // set while raw recording runs, so roster changes resubscribe the gallery
+    bool galleryStarted_;
+    // audioHelper_ is the process-wide helper; this tracks whether our sink is subscribed
+    bool audioSubscribed_;
+
+    // per-speaker talk time, fed by the pipeline's strands; declared before the sink, which
+    // uses it until it is destroyed
+    SpeakerAnalytics speakerAnalytics_;
+    BotEventChannel botEvents_;
+    guint analyticsTimer_;
+    bool talkTimeFinal_;
+    // what the virtual microphone sent, cancelled from the mixed stream; declared before the
+    // sink for the same reason
+    PlaybackReference playbackReference_;
+    // mixes the selected participants when localMix is on; same reason again
+    LocalMixer localMixer_;
+    // runs keywordTemplates on its own threads; same reason again
+    KeywordSpotter keywordSpotter_;
+    // assembles utterances when utterances is on, written out by the writer, which returns
+    // the buffers to the chunker and so is declared after it
+    UtteranceChunker utteranceChunker_;
+    UtteranceWriter utteranceWriter_;
+
+    // runs the audio pipeline's per-stream work; declared before the sink, whose pipeline
+    // waits for its strands when it is destroyed
+    TaskScheduler mediaScheduler_;
+
+    // references for enableAudioRawDataCapture
+    ZoomSdkAudioRawData audioRawDataSink_;
+    // enableAudioRawDataPublishing; owned by the SDK's audio source, which is never released
+    ZoomSdkVirtualAudioMicEvent *virtualAudioMic_;
+    IZoomSDKAudioRawDataHelper *audioHelper_;
+
+    // orders captured audio and video by SDK timestamp before they are written to disk
+    MediaSynchronizer synchronizer_;
+    // declared before the recorder, which uses it until it is destroyed
+    AsyncWriter writer_;
+    SegmentedRecorder recorder_;
+    // composes onto the synchronizer, so declared after it and stopped first
+    GalleryCompositor gallery_;
+};
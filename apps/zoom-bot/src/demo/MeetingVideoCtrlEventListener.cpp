@@ -0,0 +1,39 @@
+#include "MeetingVideoCtrlEventListener.h"
+
+MeetingVideoCtrlEventListener::MeetingVideoCtrlEventListener(MeetingEventBus* events)
+{
+	events_ = events;
+}
+
+/// \brief Callback event of the user video status changes.
+/// \param userId The user ID whose video status changes
+/// \param status New video status. For more details, see \link VideoStatus \endlink enum.
+void MeetingVideoCtrlEventListener::onUserVideoStatusChange(unsigned int userId, VideoStatus status)
+{
+	MeetingEvent event(MEETING_EVENT_USER_VIDEO_CHANGED);
+	event.userId = userId;
+	event.flag = status == Video_ON;
+	events_->Post(event);
+}
+
+void MeetingVideoCtrlEventListener::onSpotlightedUserListChangeNotification(IList<unsigned int >* lstSpotlightedUserID) {}
+
+void MeetingVideoCtrlEventListener::onHostRequestStartVideo(IRequestStartVideoHandler* handler_) {}
+
+void MeetingVideoCtrlEventListener::onActiveSpeakerVideoUserChanged(unsigned int userid) {}
+
+void MeetingVideoCtrlEventListener::onActiveVideoUserChanged(unsigned int userid) {}
+
+void MeetingVideoCtrlEventListener::onHostVideoOrderUpdated(IList<unsigned int >* orderList) {}
+
+void MeetingVideoCtrlEventListener::onLocalVideoOrderUpdated(IList<unsigned int >* localOrderList) {}
+
+void MeetingVideoCtrlEventListener::onFollowHostVideoOrderChanged(bool bFollow) {}
+
+void MeetingVideoCtrlEventListener::onUserVideoQualityChanged(VideoConnectionQuality quality, unsigned int userid) {}
+
+void MeetingVideoCtrlEventListener::onVideoAlphaChannelStatusChanged(bool isAlphaModeOn) {}
+
+void MeetingVideoCtrlEventListener::onCameraControlRequestReceived(unsigned int userId, CameraControlRequestType requestType, ICameraControlRequestHandler* pHandler) {}
+
+void MeetingVideoCtrlEventListener::onCameraControlRequestResult(unsigned int userId, CameraControlRequestResult result) {}
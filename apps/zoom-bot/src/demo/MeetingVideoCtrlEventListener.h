@@ -0,0 +1,65 @@
+#include "zoom_sdk.h"
+#include <meeting_service_interface.h>
+#include <meeting_service_components/meeting_video_interface.h>
+
+#include "MeetingEventBus.h"
+
+USING_ZOOM_SDK_NAMESPACE
+
+class MeetingVideoCtrlEventListener :
+	public IMeetingVideoCtrlEvent
+{
+	MeetingEventBus* events_;
+
+public:
+	/// \brief Video on/off changes are posted to events and handled on the main loop.
+	MeetingVideoCtrlEventListener(MeetingEventBus* events);
+
+	/// \brief Callback event of the user video status changes.
+	/// \param userId The user ID whose video status changes
+	/// \param status New video status. For more details, see \link VideoStatus \endlink enum.
+	virtual void onUserVideoStatusChange(unsigned int userId, VideoStatus status);
+
+	/// \brief Callback event for when the video spotlight user list changes.
+	/// \param lstSpotlightedUserID spot light user list.
+	virtual void onSpotlightedUserListChangeNotification(IList<unsigned int >* lstSpotlightedUserID);
+
+	/// \brief Callback event of the requirement to turn on the video from the host.
+	/// \param handler_ A pointer to the IRequestStartVideoHandler. For more details, see \link IRequestStartVideoHandler \endlink.
+	virtual void onHostRequestStartVideo(IRequestStartVideoHandler* handler_);
+
+	/// \brief Callback event of the active speaker video user changes. 
+	/// \param userid The ID of user who becomes the new active speaker.
+	virtual void onActiveSpeakerVideoUserChanged(unsigned int userid);
+
+	/// \brief Callback event of the active video user changes. 
+	/// \param userid The ID of user who becomes the new active speaker.
+	virtual void onActiveVideoUserChanged(unsigned int userid);
+
+	/// \brief Callback event of the video order changes.
+	/// \param orderList The video order list contains the user ID of listed users.
+	virtual void onHostVideoOrderUpdated(IList<unsigned int >* orderList);
+
+	/// \brief Callback event of the local video order changes.
+	/// \param localOrderList The lcoal video order list contains the user ID of listed users.
+	virtual void onLocalVideoOrderUpdated(IList<unsigned int >* localOrderList);
+
+	/// \brief Notification the status of following host's video order changed.
+	/// \param follow Yes means the option of following host's video order is on, otherwise not.
+	virtual void onFollowHostVideoOrderChanged(bool bFollow);
+
+	/// \brief Callback event of the user video quality changes.
+	/// \param userId The user ID whose video quality changes
+	/// \param quality New video quality. For more details, see \link VideoConnectionQuality \endlink enum.
+	virtual void onUserVideoQualityChanged(VideoConnectionQuality quality, unsigned int userid);
+
+	/// \brief Callback event of video alpha channel mode changes.
+	/// \param isAlphaModeOn true means it's in alpha channel mode. Otherwise, it's not.
+	virtual void onVideoAlphaChannelStatusChanged(bool isAlphaModeOn);
+
+	/// \brief Callback for when the current user receives a camera control request.
+	virtual void onCameraControlRequestReceived(unsigned int userId, CameraControlRequestType requestType, ICameraControlRequestHandler* pHandler);
+
+	/// \brief Callback for when the current user is granted camera control access.
+	virtual void onCameraControlRequestResult(unsigned int userId, CameraControlRequestResult result);
+};
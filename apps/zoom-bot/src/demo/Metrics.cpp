@@ -0,0 +1,42 @@
+// Process-wide metrics registry rendered in the Prometheus text format
+
+#include "Metrics.h"
+
+void MetricsWriter::Write(const char *name, double value) {
+    out_ << name << " " << value << "\n";
+}
+
+void MetricsWriter::Write(const char *name, const char *label, const std::string &labelValue, double value) {
+    out_ << name << "{" << label << "=\"" << labelValue << "\"} " << value << "\n";
+}
+
+Metrics &Metrics::Instance() {
+    static Metrics instance;
+    return instance;
+}
+
+void Metrics::AddCollector(Collector collector, void *context) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry entry;
+    entry.collector = collector;
+    entry.context = context;
+    collectors_.push_back(entry);
+}
+
+void Metrics::RemoveCollector(void *context) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < collectors_.size(); i++) {
+        if (collectors_[i].context == context) {
+            collectors_.erase(collectors_.begin() + i);
+            return;
+        }
+    }
+}
+
+void Metrics::Render(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MetricsWriter writer(out);
+    for (size_t i = 0; i < collectors_.size(); i++) {
+        collectors_[i].collector(writer, collectors_[i].context);
+    }
+}
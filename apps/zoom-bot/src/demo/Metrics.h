@@ -0,0 +1,45 @@
+// Process-wide metrics registry rendered in the Prometheus text format
+#pragma once
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Formats samples for one scrape. Collectors call Write for every series they own.
+class MetricsWriter {
+public:
+    explicit MetricsWriter(std::ostream &out) : out_(out) {}
+
+    void Write(const char *name, double value);
+    void Write(const char *name, const char *label, const std::string &labelValue, double value);
+
+private:
+    std::ostream &out_;
+};
+
+// Components register a collector instead of pushing samples, so the media threads only
+// update their own counters and all formatting happens on the thread that renders.
+class Metrics {
+public:
+    typedef void (*Collector)(MetricsWriter &writer, void *context);
+
+    static Metrics &Instance();
+
+    void AddCollector(Collector collector, void *context);
+    void RemoveCollector(void *context);
+
+    /// \brief Run every collector and write the samples to out.
+    void Render(std::ostream &out);
+
+private:
+    Metrics() {}
+
+    struct Entry {
+        Collector collector;
+        void *context;
+    };
+
+    std::mutex mutex_;
+    std::vector<Entry> collectors_;
+};
@@ -0,0 +1,167 @@
+// Participants of the meeting, maintained from roster events
+
+#include "ParticipantRoster.h"
+
+namespace {
+
+// a power of two that covers a typical meeting without growing
+const size_t kInitialSlots = 64;
+
+size_t HashUserId(unsigned int userId) {
+    // Fibonacci hashing; ids are often sequential, so the low bits alone cluster
+    return (size_t)(((uint64_t)userId * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+} // namespace
+
+RosterSnapshot::RosterSnapshot()
+    : version_(0), size_(0), mask_(kInitialSlots - 1), myselfId_(0), keys_(kInitialSlots, 0),
+      slots_(kInitialSlots) {}
+
+size_t RosterSnapshot::SlotOf(unsigned int userId) const {
+    size_t slot = HashUserId(userId) & mask_;
+    while (keys_[slot] != 0 && keys_[slot] != userId) {
+        slot = (slot + 1) & mask_;
+    }
+    return slot;
+}
+
+const Participant *RosterSnapshot::Find(unsigned int userId) const {
+    if (userId == 0) {
+        return nullptr;
+    }
+    size_t slot = SlotOf(userId);
+    return keys_[slot] == userId ? &slots_[slot] : nullptr;
+}
+
+Participant *RosterSnapshot::FindMutable(unsigned int userId) {
+    return const_cast<Participant *>(Find(userId));
+}
+
+const Participant *RosterSnapshot::Myself() const {
+    return Find(myselfId_);
+}
+
+const Participant *RosterSnapshot::FirstJoined() const {
+    const Participant *first = nullptr;
+    for (size_t slot = 0; slot < keys_.size(); slot++) {
+        if (keys_[slot] != 0 && (!first || slots_[slot].joinSequence < first->joinSequence)) {
+            first = &slots_[slot];
+        }
+    }
+    return first;
+}
+
+std::vector<Participant> RosterSnapshot::List() const {
+    std::vector<Participant> participants;
+    participants.reserve(size_);
+    for (size_t slot = 0; slot < keys_.size(); slot++) {
+        if (keys_[slot] != 0) {
+            participants.push_back(slots_[slot]);
+        }
+    }
+    return participants;
+}
+
+Participant *RosterSnapshot::Insert(unsigned int userId) {
+    // keep the load factor under 0.7 so probe sequences stay short
+    if ((size_ + 1) * 10 > keys_.size() * 7) {
+        Grow();
+    }
+    size_t slot = SlotOf(userId);
+    if (keys_[slot] != userId) {
+        keys_[slot] = userId;
+        size_++;
+    }
+    return &slots_[slot];
+}
+
+bool RosterSnapshot::Erase(unsigned int userId) {
+    size_t hole = SlotOf(userId);
+    if (keys_[hole] != userId) {
+        return false;
+    }
+    // backward-shift deletion: pull later entries of the probe sequence into the hole so
+    // lookups never need tombstones
+    for (size_t next = (hole + 1) & mask_; keys_[next] != 0; next = (next + 1) & mask_) {
+        size_t home = HashUserId(keys_[next]) & mask_;
+        bool homeAfterHole = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!homeAfterHole) {
+            keys_[hole] = keys_[next];
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+    keys_[hole] = 0;
+    size_--;
+    if (userId == myselfId_) {
+        myselfId_ = 0;
+    }
+    return true;
+}
+
+void RosterSnapshot::Grow() {
+    std::vector<unsigned int> keys;
+    std::vector<Participant> slots;
+    keys.swap(keys_);
+    slots.swap(slots_);
+    keys_.assign(keys.size() * 2, 0);
+    slots_.resize(keys.size() * 2);
+    mask_ = keys_.size() - 1;
+    for (size_t slot = 0; slot < keys.size(); slot++) {
+        if (keys[slot] != 0) {
+            size_t target = SlotOf(keys[slot]);
+            keys_[target] = keys[slot];
+            slots_[target] = slots[slot];
+        }
+    }
+}
+
+ParticipantRoster::ParticipantRoster()
+    : dirty_(false), nextJoinSequence_(0), published_(std::make_shared<RosterSnapshot>()) {}
+
+std::shared_ptr<const RosterSnapshot> ParticipantRoster::Snapshot() const {
+    return std::atomic_load(&published_);
+}
+
+void ParticipantRoster::Upsert(const Participant &participant) {
+    if (participant.userId == 0) {
+        return;
+    }
+    *working_.Insert(participant.userId) = participant;
+    if (participant.isMyself) {
+        working_.myselfId_ = participant.userId;
+    }
+    dirty_ = true;
+}
+
+Participant *ParticipantRoster::Edit(unsigned int userId) {
+    Participant *participant = working_.FindMutable(userId);
+    if (participant) {
+        dirty_ = true;
+    }
+    return participant;
+}
+
+void ParticipantRoster::Remove(unsigned int userId) {
+    if (working_.Erase(userId)) {
+        dirty_ = true;
+    }
+}
+
+void ParticipantRoster::Clear() {
+    uint64_t version = working_.version_;
+    working_ = RosterSnapshot();
+    working_.version_ = version;
+    dirty_ = true;
+}
+
+void ParticipantRoster::Publish() {
+    if (!dirty_) {
+        return;
+    }
+    working_.version_++;
+    std::shared_ptr<const RosterSnapshot> snapshot = std::make_shared<RosterSnapshot>(working_);
+    std::atomic_store(&published_, snapshot);
+    dirty_ = false;
+}
@@ -0,0 +1,99 @@
+// Participants of the meeting, maintained from roster events
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum ParticipantRole {
+    PARTICIPANT_ATTENDEE,
+    PARTICIPANT_COHOST,
+    PARTICIPANT_HOST,
+};
+
+struct Participant {
+    unsigned int userId;
+    ParticipantRole role;
+    bool isMyself;
+    bool audioMuted;
+    bool videoOn;
+    // wall clock, milliseconds since the epoch
+    unsigned long long joinedAtMs;
+    // orders participants by arrival; the first one is what GetParticipantsList()->GetItem(0) used to be
+    unsigned long long joinSequence;
+    // truncated; a fixed size keeps every slot in one place
+    char name[64];
+};
+
+// One version of the roster. Lookups probe an open-addressing table keyed by user id:
+// keys_ is a dense array of ids (0 marks a free slot, the SDK never hands out 0), so a
+// probe usually touches a single cache line before it reads the matching participant.
+// A published snapshot is never modified.
+class RosterSnapshot {
+public:
+    RosterSnapshot();
+
+    uint64_t Version() const { return version_; }
+    size_t Size() const { return size_; }
+
+    /// \return The participant or nullptr if userId is not in the meeting.
+    const Participant *Find(unsigned int userId) const;
+
+    /// \brief The bot itself, or nullptr before it is in the roster.
+    const Participant *Myself() const;
+
+    /// \brief The participant that has been in the meeting the longest, or nullptr.
+    const Participant *FirstJoined() const;
+
+    /// \brief Every participant, in no particular order.
+    std::vector<Participant> List() const;
+
+private:
+    friend class ParticipantRoster;
+
+    Participant *FindMutable(unsigned int userId);
+    Participant *Insert(unsigned int userId);
+    bool Erase(unsigned int userId);
+    void Grow();
+    size_t SlotOf(unsigned int userId) const;
+
+    uint64_t version_;
+    size_t size_;
+    size_t mask_;
+    unsigned int myselfId_;
+    std::vector<unsigned int> keys_;
+    std::vector<Participant> slots_;
+};
+
+// Owned by the session and updated only on the main loop, from the participant, audio and
+// video events. Edits go to a working copy; Publish makes them visible as a new snapshot.
+// Readers on any thread take the current snapshot and keep it as long as they need: they
+// never wait for an update and never see one half applied.
+class ParticipantRoster {
+public:
+    ParticipantRoster();
+
+    /// \brief The latest published roster. Safe to call from any thread.
+    std::shared_ptr<const RosterSnapshot> Snapshot() const;
+
+    /// \brief Add or replace a participant.
+    void Upsert(const Participant &participant);
+
+    /// \return The working copy of the participant for in-place edits, or nullptr.
+    Participant *Edit(unsigned int userId);
+
+    void Remove(unsigned int userId);
+    void Clear();
+
+    /// \brief Publish the edits made since the last call as a new version.
+    void Publish();
+
+    /// \brief Join sequence for the next participant.
+    unsigned long long NextJoinSequence() { return nextJoinSequence_++; }
+
+private:
+    RosterSnapshot working_;
+    bool dirty_;
+    unsigned long long nextJoinSequence_;
+    std::shared_ptr<const RosterSnapshot> published_;
+};
@@ -0,0 +1,90 @@
+// The audio the bot published, kept as the reference for removing it from the capture
+
+#include "PlaybackReference.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// input converted at once when a buffer is written
+const size_t kWriteSlice = 4096;
+
+} // namespace
+
+PlaybackReference::PlaybackReference(unsigned int capacitySeconds)
+    : capacity_((size_t)capacitySeconds * kAsrSampleRate), origin_(std::chrono::steady_clock::now()), written_(0) {}
+
+long long PlaybackReference::IndexAt(std::chrono::steady_clock::time_point time) const {
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(time - origin_).count();
+    return us * kAsrSampleRate / 1000000;
+}
+
+bool PlaybackReference::Empty() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_ == 0;
+}
+
+void PlaybackReference::Write(const int16_t *pcm, size_t samples, unsigned int sampleRate) {
+    std::vector<float> mono(kWriteSlice);
+    std::vector<float> resampled;
+    long long now = IndexAt(std::chrono::steady_clock::now());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!resampler_.Configure(sampleRate)) {
+        std::cerr << "PlaybackReference: unsupported sample rate " << sampleRate << std::endl;
+        return;
+    }
+    if (!ring_) {
+        // only a bot that publishes pays for the ring
+        ring_.reset(new float[capacity_]);
+        memset(ring_.get(), 0, capacity_ * sizeof(float));
+    }
+    resampled.resize(resampler_.MaxOutputSamples(kWriteSlice));
+    if (now > written_) {
+        // the previous buffer has played out: silence until this one starts
+        if (now - written_ >= (long long)capacity_) {
+            memset(ring_.get(), 0, capacity_ * sizeof(float));
+        } else {
+            for (long long i = written_; i < now; i++) {
+                ring_[i % capacity_] = 0.0f;
+            }
+        }
+        written_ = now;
+        resampler_.Reset();
+    }
+    if ((unsigned long long)samples * kAsrSampleRate / sampleRate > capacity_) {
+        std::cerr << "PlaybackReference: " << samples / sampleRate << " s buffer is longer than the reference ring, "
+                  << "its start cannot be cancelled" << std::endl;
+    }
+
+    for (size_t offset = 0; offset < samples; offset += kWriteSlice) {
+        size_t slice = std::min(kWriteSlice, samples - offset);
+        SimdKernels::DownmixToMonoFloat(pcm + offset, slice, 1, mono.data());
+        size_t produced = resampler_.Process(mono.data(), slice, resampled.data());
+        for (size_t i = 0; i < produced; i++) {
+            ring_[(written_ + i) % capacity_] = resampled[i];
+        }
+        written_ += produced;
+    }
+}
+
+bool PlaybackReference::Read(long long index, size_t count, float *dst) {
+    memset(dst, 0, count * sizeof(float));
+    std::lock_guard<std::mutex> lock(mutex_);
+    long long first = std::max(index, std::max(0LL, written_ - (long long)capacity_));
+    long long last = std::min(index + (long long)count, written_);
+    if (first >= last) {
+        return false;
+    }
+    // at most two copies, the second after the ring wraps
+    size_t position = (size_t)(first % (long long)capacity_);
+    size_t total = (size_t)(last - first);
+    size_t head = std::min(total, capacity_ - position);
+    memcpy(dst + (first - index), ring_.get() + position, head * sizeof(float));
+    memcpy(dst + (first - index) + head, ring_.get(), (total - head) * sizeof(float));
+    return true;
+}
@@ -0,0 +1,45 @@
+// The audio the bot published, kept as the reference for removing it from the capture
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "AudioResampler.h"
+
+// A timeline of what the virtual microphone is playing, at kAsrSampleRate. The SDK takes a
+// whole buffer in one send and plays it out in real time, so each Write is placed where the
+// previous one ends, or at the current time if that has already passed; the silence in
+// between is kept as zeros. Sample n plays at Origin() + n / kAsrSampleRate.
+//
+// Write runs on the publishing thread and Read on the mixed stream's strand. The ring keeps
+// the last capacitySeconds, allocated on the first Write; older and future samples read as
+// silence. A buffer longer than the ring loses its start, so size it above the longest send.
+class PlaybackReference {
+public:
+    explicit PlaybackReference(unsigned int capacitySeconds = 30);
+
+    /// \brief Add what was just handed to the SDK sender.
+    void Write(const int16_t *pcm, size_t samples, unsigned int sampleRate);
+
+    /// \brief Copy samples [index, index + count) of the timeline to dst.
+    /// \return false if none of them is a written sample, dst is then all zeros.
+    bool Read(long long index, size_t count, float *dst);
+
+    /// \brief The timeline index playing at time.
+    long long IndexAt(std::chrono::steady_clock::time_point time) const;
+
+    /// \brief Whether anything was ever written, i.e. whether there is anything to cancel.
+    bool Empty();
+
+private:
+    std::mutex mutex_;
+    std::unique_ptr<float[]> ring_;
+    size_t capacity_;
+    std::chrono::steady_clock::time_point origin_;
+    // one past the last written index
+    long long written_;
+    AudioResampler resampler_;
+};
@@ -0,0 +1,75 @@
+// Real-input FFT used by the audio analysis stages
+
+#include "RealFft.h"
+
+#include <cmath>
+
+RealFft::RealFft(size_t size) : size_(size), half_(size / 2) {
+    unsigned int bits = 0;
+    while ((1u << bits) < half_) {
+        bits++;
+    }
+    bitReverse_.resize(half_);
+    for (unsigned int i = 0; i < half_; i++) {
+        unsigned int reversed = 0;
+        for (unsigned int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+        }
+        bitReverse_[i] = reversed;
+    }
+
+    // W_N^k for k in [0, N/2]; the half-size FFT uses every other entry
+    cosTable_.resize(half_ + 1);
+    sinTable_.resize(half_ + 1);
+    for (size_t k = 0; k <= half_; k++) {
+        double angle = 2.0 * 3.14159265358979323846 * k / size_;
+        cosTable_[k] = (float)cos(angle);
+        sinTable_[k] = (float)sin(angle);
+    }
+}
+
+void RealFft::PowerSpectrum(const float *input, float *power) const {
+    float re[kMaxSize / 2];
+    float im[kMaxSize / 2];
+
+    // pack even samples into the real part and odd samples into the imaginary part
+    for (size_t i = 0; i < half_; i++) {
+        unsigned int j = bitReverse_[i];
+        re[j] = input[2 * i];
+        im[j] = input[2 * i + 1];
+    }
+
+    for (size_t length = 2; length <= half_; length <<= 1) {
+        size_t stride = size_ / length;
+        size_t span = length / 2;
+        for (size_t base = 0; base < half_; base += length) {
+            for (size_t j = 0; j < span; j++) {
+                float c = cosTable_[j * stride];
+                float s = sinTable_[j * stride];
+                size_t a = base + j;
+                size_t b = a + span;
+                float vr = re[b] * c + im[b] * s;
+                float vi = im[b] * c - re[b] * s;
+                re[b] = re[a] - vr;
+                im[b] = im[a] - vi;
+                re[a] += vr;
+                im[a] += vi;
+            }
+        }
+    }
+
+    // split the half-size result into the spectrum of the real signal
+    for (size_t k = 0; k <= half_; k++) {
+        size_t p = k % half_;
+        size_t q = (half_ - k) % half_;
+        float evenRe = 0.5f * (re[p] + re[q]);
+        float evenIm = 0.5f * (im[p] - im[q]);
+        float oddRe = 0.5f * (im[p] + im[q]);
+        float oddIm = -0.5f * (re[p] - re[q]);
+        float c = cosTable_[k];
+        float s = sinTable_[k];
+        float xr = evenRe + oddRe * c + oddIm * s;
+        float xi = evenIm + oddIm * c - oddRe * s;
+        power[k] = xr * xr + xi * xi;
+    }
+}
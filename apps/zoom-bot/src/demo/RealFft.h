@@ -0,0 +1,32 @@
+// Real-input FFT used by the audio analysis stages
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Radix-2 FFT of a real signal computed as a half-size complex FFT.
+// Tables are built in the constructor; PowerSpectrum does not allocate and is safe to call
+// from several threads on the same instance.
+class RealFft {
+public:
+    static const size_t kMaxSize = 1024;
+
+    /// \param size Transform length, a power of two between 8 and kMaxSize.
+    explicit RealFft(size_t size);
+
+    size_t Size() const { return size_; }
+    size_t Bins() const { return size_ / 2 + 1; }
+
+    /// \brief Compute |X[k]|^2 for k in [0, size/2].
+    /// \param input size real samples.
+    /// \param power Receives Bins() values.
+    void PowerSpectrum(const float *input, float *power) const;
+
+private:
+    size_t size_;
+    size_t half_;
+    std::vector<unsigned int> bitReverse_;
+    // twiddles for the half-size complex FFT and for the real-split step
+    std::vector<float> cosTable_;
+    std::vector<float> sinTable_;
+};
@@ -0,0 +1,76 @@
+// On-disk layout of the segmented recording container
+#pragma once
+
+#include <cstdint>
+
+// A recording is a directory holding manifest.json and fixed-duration segment files.
+//
+// segment_NNNNNN.seg:
+//   SegmentHeader
+//   records, each a RecordHeader followed by payloadBytes of payload, in timestamp order
+//   IndexEntry[entryCount], sorted by timestamp
+//   SegmentFooter
+//
+// Payloads: audio is 16 kHz mono s16le, video is I420 (Y, U, V planes), a gap carries its
+// duration in milliseconds as a uint64. Features are `height` log-mel frames of `width`
+// bins each, frame after frame, as s16le fixed point (value * kFeatureScale), frameMs
+// apart. All integers are little-endian.
+
+namespace RecordingFormat {
+
+const char kSegmentMagic[8] = {'Z', 'B', 'S', 'E', 'G', '0', '0', '1'};
+const uint32_t kRecordMagic = 0x44524352;  // "RCRD"
+const uint32_t kFooterMagic = 0x5844495A;  // "ZIDX"
+const uint32_t kVersion = 1;
+// log-mel values are stored as int16 of value * kFeatureScale, i.e. 1/256 resolution
+const float kFeatureScale = 256.0f;
+
+enum RecordKind : uint8_t {
+    RECORD_AUDIO = 1,
+    RECORD_VIDEO = 2,
+    RECORD_GAP = 3,
+    RECORD_FEATURES = 4,
+};
+
+#pragma pack(push, 1)
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t segmentNumber;
+    uint64_t startTimestampMs;
+};
+
+struct RecordHeader {
+    uint32_t magic;
+    uint8_t kind;
+    uint8_t gapKind;
+    // RECORD_FEATURES: milliseconds between frames, 0 for other kinds
+    uint16_t frameMs;
+    uint32_t streamId;
+    uint32_t payloadBytes;
+    uint64_t timestampMs;
+    uint16_t width;
+    uint16_t height;
+    uint32_t reserved2;
+};
+
+struct IndexEntry {
+    uint64_t timestampMs;
+    uint64_t offset;
+    uint32_t streamId;
+    uint32_t kind;
+};
+
+struct SegmentFooter {
+    uint64_t indexOffset;
+    uint32_t entryCount;
+    uint32_t magic;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SegmentHeader) == 24, "segment header layout");
+static_assert(sizeof(RecordHeader) == 32, "record header layout");
+static_assert(sizeof(IndexEntry) == 24, "index entry layout");
+static_assert(sizeof(SegmentFooter) == 16, "segment footer layout");
+
+} // namespace RecordingFormat
@@ -0,0 +1,162 @@
+// Random access to segments written by SegmentedRecorder
+
+#include "RecordingReader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace RecordingFormat;
+
+RecordingReader::RecordingReader() : data_(nullptr), size_(0), index_(nullptr), entryCount_(0), indexOffset_(0) {
+}
+
+RecordingReader::~RecordingReader() {
+    Close();
+}
+
+bool RecordingReader::Open(const std::string &path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "RecordingReader: cannot open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SegmentHeader) + sizeof(SegmentFooter)) {
+        std::cerr << "RecordingReader: " << path << " is too short" << std::endl;
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "RecordingReader: cannot map " << path << std::endl;
+        return false;
+    }
+    data_ = static_cast<const uint8_t *>(mapped);
+    size_ = size;
+
+    SegmentHeader header;
+    SegmentFooter footer;
+    memcpy(&header, data_, sizeof(header));
+    memcpy(&footer, data_ + size_ - sizeof(footer), sizeof(footer));
+    // a segment without a footer was cut short by a crash; its index was never written
+    bool valid = memcmp(header.magic, kSegmentMagic, sizeof(header.magic)) == 0 && header.version == kVersion &&
+                 footer.magic == kFooterMagic && footer.indexOffset >= sizeof(SegmentHeader) &&
+                 footer.indexOffset + (uint64_t)footer.entryCount * sizeof(IndexEntry) + sizeof(footer) == size_;
+    if (!valid) {
+        std::cerr << "RecordingReader: " << path << " is not a complete segment" << std::endl;
+        Close();
+        return false;
+    }
+    indexOffset_ = footer.indexOffset;
+    entryCount_ = footer.entryCount;
+    // the index follows byte payloads, so it is not necessarily 8-byte aligned
+    index_ = reinterpret_cast<const IndexEntry *>(data_ + indexOffset_);
+    madvise(mapped, size_, MADV_RANDOM);
+    return true;
+}
+
+void RecordingReader::Close() {
+    if (data_) {
+        munmap(const_cast<uint8_t *>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    index_ = nullptr;
+    entryCount_ = 0;
+    indexOffset_ = 0;
+}
+
+unsigned long long RecordingReader::StartTimestamp() const {
+    if (!data_) {
+        return 0;
+    }
+    SegmentHeader header;
+    memcpy(&header, data_, sizeof(header));
+    return header.startTimestampMs;
+}
+
+size_t RecordingReader::Seek(unsigned long long timestampMs) const {
+    size_t low = 0;
+    size_t high = entryCount_;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        IndexEntry entry;
+        memcpy(&entry, &index_[middle], sizeof(entry));
+        if (entry.timestampMs < timestampMs) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+bool RecordingReader::Read(size_t position, RecordingRecord &record) const {
+    if (position >= entryCount_) {
+        return false;
+    }
+    IndexEntry entry;
+    memcpy(&entry, &index_[position], sizeof(entry));
+    if (entry.offset < sizeof(SegmentHeader) || entry.offset + sizeof(RecordHeader) > indexOffset_) {
+        return false;
+    }
+    RecordHeader header;
+    memcpy(&header, data_ + entry.offset, sizeof(header));
+    if (header.magic != kRecordMagic || entry.offset + sizeof(header) + header.payloadBytes > indexOffset_) {
+        return false;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.kind = (RecordKind)header.kind;
+    record.streamId = header.streamId;
+    record.timestampMs = header.timestampMs;
+    record.width = header.width;
+    record.height = header.height;
+    record.frameMs = header.frameMs;
+    record.payload = data_ + entry.offset + sizeof(header);
+    record.payloadBytes = header.payloadBytes;
+    if (record.kind == RECORD_GAP && header.payloadBytes == sizeof(uint64_t)) {
+        uint64_t gapMs;
+        memcpy(&gapMs, record.payload, sizeof(gapMs));
+        record.gapKind = (RecordKind)header.gapKind;
+        record.gapMs = gapMs;
+    }
+    return true;
+}
+
+bool RecordingReader::FindSegment(const std::string &directory, unsigned long long timestampMs, std::string &path) {
+    std::ifstream manifest((directory + "/manifest.json").c_str());
+    std::string line;
+    std::string candidate;
+    unsigned long long candidateEndMs = 0;
+    while (std::getline(manifest, line)) {
+        char file[64];
+        unsigned long long startMs = 0;
+        unsigned long long endMs = 0;
+        if (sscanf(line.c_str(), " {\"file\": \"%63[^\"]\", \"startMs\": %llu, \"endMs\": %llu", file, &startMs,
+                   &endMs) != 3) {
+            continue;
+        }
+        // segments are listed in order; the last one starting at or before the timestamp covers it
+        if (startMs > timestampMs) {
+            break;
+        }
+        candidate = file;
+        candidateEndMs = endMs;
+    }
+    // a timestamp between two segments belongs to the earlier one, past the last one to none
+    if (candidate.empty() || (timestampMs > candidateEndMs && manifest.eof())) {
+        return false;
+    }
+    path = directory + "/" + candidate;
+    return true;
+}
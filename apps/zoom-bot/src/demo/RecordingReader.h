@@ -0,0 +1,60 @@
+// Random access to segments written by SegmentedRecorder
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "RecordingFormat.h"
+
+// One record of a segment. Pointers reference the mapped file and stay valid until the
+// reader is closed.
+struct RecordingRecord {
+    RecordingFormat::RecordKind kind;
+    uint32_t streamId;
+    unsigned long long timestampMs;
+    // RECORD_VIDEO: frame size; RECORD_FEATURES: bins per frame and number of frames
+    unsigned int width;
+    unsigned int height;
+    // RECORD_FEATURES only: milliseconds between frames
+    unsigned int frameMs;
+    // RECORD_GAP only: kind of stream that skipped and for how long
+    RecordingFormat::RecordKind gapKind;
+    unsigned long long gapMs;
+    // s16le samples for audio, I420 planes for video, s16le fixed-point log-mel for features
+    const uint8_t *payload;
+    size_t payloadBytes;
+};
+
+// Maps one segment file read-only and looks records up through its index, so seeking to a
+// timestamp is a binary search over the index instead of a scan of the media.
+class RecordingReader {
+public:
+    RecordingReader();
+    ~RecordingReader();
+
+    /// \brief Map a segment and validate its header, index and footer.
+    bool Open(const std::string &path);
+    void Close();
+
+    /// \brief Find the segment of a recording directory that covers timestampMs, using manifest.json.
+    /// \return false if the timestamp is before the first or after the last finished segment.
+    static bool FindSegment(const std::string &directory, unsigned long long timestampMs, std::string &path);
+
+    /// \brief Number of records in the index.
+    size_t RecordCount() const { return entryCount_; }
+    unsigned long long StartTimestamp() const;
+
+    /// \brief Index position of the first record at or after timestampMs, or RecordCount().
+    size_t Seek(unsigned long long timestampMs) const;
+
+    /// \brief Read the record at an index position, in timestamp order.
+    bool Read(size_t position, RecordingRecord &record) const;
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    const RecordingFormat::IndexEntry *index_;
+    size_t entryCount_;
+    uint64_t indexOffset_;
+};
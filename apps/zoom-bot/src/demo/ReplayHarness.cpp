@@ -0,0 +1,493 @@
+// Replays a synthetic meeting through the capture path without the SDK, for benchmarks and PGO training
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zoom_sdk_raw_data_def.h"
+
+#include "AsyncWriter.h"
+#include "BotEventChannel.h"
+#include "GalleryCompositor.h"
+#include "KeywordSpotter.h"
+#include "MediaSynchronizer.h"
+#include "SegmentedRecorder.h"
+#include "SnapshotStore.h"
+#include "SpeakerAnalytics.h"
+#include "TaskScheduler.h"
+#include "TemplateKeywordModel.h"
+#include "UtteranceWriter.h"
+#include "ThreadPolicy.h"
+#include "ZoomSdkAudioRawData.h"
+#include "ZoomSdkRenderer.h"
+
+namespace {
+
+// what the SDK delivers: 10 ms of 32 kHz mono per callback
+const unsigned int kSdkSampleRate = 32000;
+const unsigned int kCallbackMs = 10;
+const unsigned int kCallbackSamples = kSdkSampleRate * kCallbackMs / 1000;
+const unsigned int kFrameIntervalMs = 40;
+const double kPi = 3.14159265358979323846;
+
+struct ReplayOptions {
+    unsigned int seconds;
+    unsigned int participants;
+    unsigned int width;
+    unsigned int height;
+    bool dropNonSpeech;
+    AudioOutput audioOutput;
+    float agcTargetLufs;
+    // node ids left out of a local mix, recorded when set
+    bool localMix;
+    std::string localMixExclude;
+    // keywordTemplates to spot in every participant stream, and the threads to do it with;
+    // hits go to events.jsonl in the output directory
+    std::string keywords;
+    unsigned int keywordThreads;
+    // write utterances of MIN to MAX seconds with OVERLAP ms to the output directory
+    bool utterances;
+    unsigned int utteranceMinSeconds;
+    unsigned int utteranceMaxSeconds;
+    unsigned int utteranceOverlapMs;
+    // compose the video of this many participants into a 720p gallery instead of recording one
+    unsigned int galleryTiles;
+    // take a 320 pixel thumbnail of every participant this often, in real seconds, 0 for none
+    unsigned int snapshotSeconds;
+    // multiple of real time to replay at, 0 for as fast as possible; the writer falls behind
+    // and drops records when the disk cannot keep up
+    unsigned int speed;
+    // scheduler threads for the audio pipeline, 0 for the CPU quota; without them the
+    // callbacks do the work themselves, as they did before the pool
+    unsigned int workers;
+    bool inlineAudio;
+    // threadLayout to run the workers and the writer under, as in config.txt
+    std::string threadLayout;
+    std::string output;
+
+    ReplayOptions()
+        : seconds(30), participants(4), width(640), height(360), dropNonSpeech(true), audioOutput(AUDIO_OUTPUT_PCM), agcTargetLufs(0.0f), localMix(false), keywordThreads(1), utterances(false),
+          utteranceMinSeconds(5), utteranceMaxSeconds(30), utteranceOverlapMs(500), galleryTiles(0), snapshotSeconds(0), speed(10), workers(0),
+          inlineAudio(false), output("/tmp/zoom-bot-replay") {}
+};
+
+class FakeAudioRawData : public AudioRawData {
+public:
+    FakeAudioRawData() : samples_(kCallbackSamples), timestampMs_(0) {}
+
+    std::vector<int16_t> &Samples() { return samples_; }
+    void SetTimeStamp(unsigned long long timestampMs) { timestampMs_ = timestampMs; }
+
+    virtual bool CanAddRef() { return false; }
+    virtual bool AddRef() { return false; }
+    virtual int Release() { return 0; }
+    virtual char *GetBuffer() { return reinterpret_cast<char *>(samples_.data()); }
+    virtual unsigned int GetBufferLen() { return (unsigned int)(samples_.size() * sizeof(int16_t)); }
+    virtual unsigned int GetSampleRate() { return kSdkSampleRate; }
+    virtual unsigned int GetChannelNum() { return 1; }
+    virtual unsigned long long GetTimeStamp() { return timestampMs_; }
+
+private:
+    std::vector<int16_t> samples_;
+    unsigned long long timestampMs_;
+};
+
+class FakeVideoFrame : public YUVRawDataI420 {
+public:
+    FakeVideoFrame(unsigned int width, unsigned int height)
+        : width_(width), height_(height), data_(width * height * 3 / 2, 128), timestampMs_(0) {}
+
+    // move a bright bar across the luma plane so consecutive frames differ
+    void Advance(unsigned long long timestampMs) {
+        timestampMs_ = timestampMs;
+        unsigned int bar = (unsigned int)(timestampMs / kFrameIntervalMs) % width_;
+        for (unsigned int y = 0; y < height_; y++) {
+            data_[y * width_ + bar] ^= 0x80;
+        }
+    }
+
+    virtual bool CanAddRef() { return false; }
+    virtual bool AddRef() { return false; }
+    virtual int Release() { return 0; }
+    virtual char *GetYBuffer() { return reinterpret_cast<char *>(data_.data()); }
+    virtual char *GetUBuffer() { return GetYBuffer() + width_ * height_; }
+    virtual char *GetVBuffer() { return GetUBuffer() + width_ * height_ / 4; }
+    virtual char *GetAlphaBuffer() { return nullptr; }
+    virtual char *GetBuffer() { return GetYBuffer(); }
+    virtual unsigned int GetBufferLen() { return (unsigned int)data_.size(); }
+    virtual unsigned int GetAlphaBufferLen() { return 0; }
+    virtual bool IsLimitedI420() { return true; }
+    virtual unsigned int GetStreamWidth() { return width_; }
+    virtual unsigned int GetStreamHeight() { return height_; }
+    virtual unsigned int GetRotation() { return 0; }
+    virtual unsigned int GetSourceID() { return 0; }
+    virtual unsigned long long GetTimeStamp() { return timestampMs_; }
+
+private:
+    unsigned int width_;
+    unsigned int height_;
+    std::vector<uint8_t> data_;
+    unsigned long long timestampMs_;
+};
+
+// Each participant talks in turns of about two seconds: a voiced tone with harmonics while
+// talking, low noise otherwise, so the VAD and the non-speech gate see both.
+class SyntheticSpeaker {
+public:
+    // levels differ as they do between real microphones: 0, 8, 16 or 24 dB below the loudest
+    SyntheticSpeaker(unsigned int index)
+        : pitchHz_(110.0 + 35.0 * index), level_(std::pow(10.0, -0.4 * (index % 4))), phase_(0.0),
+          seed_(0x9E3779B9u * (index + 1)), index_(index) {}
+
+    void Fill(std::vector<int16_t> &samples, unsigned long long timestampMs, unsigned int participants) {
+        bool talking = (timestampMs / 2000) % participants == index_;
+        double step = 2.0 * kPi * pitchHz_ / kSdkSampleRate;
+        for (size_t i = 0; i < samples.size(); i++) {
+            seed_ = seed_ * 1664525u + 1013904223u;
+            double noise = ((int32_t)(seed_ >> 16) - 32768) / 32768.0 * 60.0;
+            double voice = 0.0;
+            if (talking) {
+                voice = level_ * (6000.0 * std::sin(phase_) + 2500.0 * std::sin(2.0 * phase_) + 1200.0 * std::sin(3.0 * phase_));
+            }
+            phase_ += step;
+            samples[i] = (int16_t)(voice + noise);
+        }
+        phase_ = std::fmod(phase_, 2.0 * kPi);
+    }
+
+private:
+    double pitchHz_;
+    double level_;
+    double phase_;
+    uint32_t seed_;
+    unsigned int index_;
+};
+
+// Per-callback wall time. The SDK calls back on its own threads and expects them back
+// quickly, so the tail matters as much as the median.
+class LatencyStats {
+public:
+    explicit LatencyStats(const char *name) : name_(name) {}
+
+    void Add(std::chrono::steady_clock::duration elapsed) {
+        samplesNs_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    void Report(std::ostream &out) {
+        if (samplesNs_.empty()) {
+            return;
+        }
+        std::sort(samplesNs_.begin(), samplesNs_.end());
+        double total = 0.0;
+        for (size_t i = 0; i < samplesNs_.size(); i++) {
+            total += samplesNs_[i];
+        }
+        char line[160];
+        snprintf(line, sizeof(line), "%-10s %8zu calls  mean %8.1f us  p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  max %8.1f us",
+                 name_, samplesNs_.size(), total / samplesNs_.size() / 1000.0, Percentile(0.50), Percentile(0.99),
+                 Percentile(0.999), samplesNs_.back() / 1000.0);
+        out << line << std::endl;
+    }
+
+private:
+    double Percentile(double fraction) const {
+        size_t index = (size_t)(fraction * (samplesNs_.size() - 1));
+        return samplesNs_[index] / 1000.0;
+    }
+
+    const char *name_;
+    std::vector<long long> samplesNs_;
+};
+
+bool ParseOptions(int argc, char *argv[], ReplayOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--seconds" && value) {
+            options.seconds = (unsigned int)strtoul(value, NULL, 10);
+        } else if (arg == "--participants" && value) {
+            options.participants = std::max(1u, (unsigned int)strtoul(value, NULL, 10));
+        } else if (arg == "--video" && value) {
+            // the synchronizer's video slots hold up to 720p
+            if (sscanf(value, "%ux%u", &options.width, &options.height) != 2 || options.width * options.height > 1280 * 720) {
+                std::cerr << "--video takes WIDTHxHEIGHT up to 1280x720, or 0x0 to disable" << std::endl;
+                return false;
+            }
+        } else if (arg == "--speed" && value) {
+            options.speed = (unsigned int)strtoul(value, NULL, 10);
+        } else if (arg == "--workers" && value) {
+            options.workers = (unsigned int)strtoul(value, NULL, 10);
+        } else if (arg == "--layout" && value) {
+            std::string error;
+            if (!ThreadPolicy::Validate(value, error)) {
+                std::cerr << "--layout " << error << std::endl;
+                return false;
+            }
+            options.threadLayout = value;
+        } else if (arg == "--inline") {
+            options.inlineAudio = true;
+            continue;
+        } else if (arg == "--keep-silence") {
+            options.dropNonSpeech = false;
+            continue;
+        } else if (arg == "--audio-output" && value) {
+            if (!AudioOutputFromName(value, options.audioOutput)) {
+                std::cerr << "--audio-output takes pcm, logmel or both" << std::endl;
+                return false;
+            }
+        } else if (arg == "--agc" && value) {
+            if (!AgcTargetFromName(value, options.agcTargetLufs)) {
+                std::cerr << "--agc takes off or a loudness from -40 to -10 LUFS" << std::endl;
+                return false;
+            }
+        } else if (arg == "--local-mix-exclude" && value) {
+            options.localMix = true;
+            options.localMixExclude = value;
+        } else if (arg == "--keywords" && value) {
+            options.keywords = value;
+        } else if (arg == "--keyword-threads" && value) {
+            options.keywordThreads = std::max(1u, (unsigned int)strtoul(value, NULL, 10));
+        } else if (arg == "--utterances" && value) {
+            if (sscanf(value, "%u:%u:%u", &options.utteranceMinSeconds, &options.utteranceMaxSeconds,
+                       &options.utteranceOverlapMs) != 3 || options.utteranceMinSeconds == 0 ||
+                options.utteranceMaxSeconds <= options.utteranceMinSeconds ||
+                options.utteranceOverlapMs * 2 > options.utteranceMinSeconds * 1000) {
+                std::cerr << "--utterances takes MIN:MAX:OVERLAP, e.g. 5:30:500" << std::endl;
+                return false;
+            }
+            options.utterances = true;
+        } else if (arg == "--gallery" && value) {
+            options.galleryTiles = (unsigned int)strtoul(value, NULL, 10);
+            if (options.galleryTiles == 0 || options.galleryTiles > GalleryCompositor::kMaxTiles) {
+                std::cerr << "--gallery takes 1 to " << GalleryCompositor::kMaxTiles << " tiles" << std::endl;
+                return false;
+            }
+        } else if (arg == "--snapshots" && value) {
+            options.snapshotSeconds = (unsigned int)strtoul(value, NULL, 10);
+            if (options.snapshotSeconds == 0) {
+                std::cerr << "--snapshots takes the seconds between thumbnails" << std::endl;
+                return false;
+            }
+        } else if (arg == "--output" && value) {
+            options.output = value;
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--seconds N] [--participants N] [--video WxH] [--speed N] [--workers N] [--inline]"
+                      << " [--layout L] [--keep-silence] [--audio-output pcm|logmel|both] [--agc LUFS]"
+                      << " [--local-mix-exclude IDS] [--keywords SPEC] [--keyword-threads N]"
+                      << " [--utterances MIN:MAX:OVERLAP] [--gallery TILES] [--snapshots SECONDS]"
+                      << " [--output DIR]" << std::endl;
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    ReplayOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 2;
+    }
+    if (!options.threadLayout.empty()) {
+        ThreadPolicy::Instance().Configure(options.threadLayout);
+    }
+
+    LatencyStats mixedStats("mixed");
+    LatencyStats oneWayStats("one-way");
+    LatencyStats videoStats("video");
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    unsigned long long recordsWritten = 0;
+    unsigned long long droppedRecords = 0;
+    unsigned long long droppedChunks = 0;
+    unsigned long long keywordHits = 0;
+    unsigned long long keywordShedFrames = 0;
+    unsigned long long utterances = 0;
+    unsigned long long droppedUtterances = 0;
+    unsigned long long galleryFrames = 0;
+    unsigned long long galleryLateTicks = 0;
+    unsigned long long galleryMaxComposeUs = 0;
+    unsigned long long snapshotsEncoded = 0;
+    unsigned long long snapshotMaxEncodeUs = 0;
+    std::vector<SnapshotInfo> snapshots;
+    std::vector<SpeakerStats> speakerStats(options.participants);
+    ConversationStats conversation;
+    {
+        AsyncWriter writer;
+        SegmentedRecorder recorder(options.output, 60000, &writer);
+        MediaSynchronizer synchronizer;
+        synchronizer.SetSink(&recorder);
+        TaskScheduler scheduler(options.workers, THREAD_ROLE_AUDIO);
+        SpeakerAnalytics analytics;
+        BotEventChannel events;
+        // these outlive the sink, whose pipeline feeds them
+        LocalMixer mixer;
+        KeywordSpotter spotter;
+        UtteranceChunker chunker(options.utteranceMinSeconds * 1000, options.utteranceMaxSeconds * 1000,
+                                 options.utteranceOverlapMs, options.utterances ? 32 : 0);
+        UtteranceWriter utteranceWriter(&chunker);
+        ZoomSdkAudioRawData audioSink;
+        audioSink.SetSynchronizer(&synchronizer);
+        if (!options.inlineAudio) {
+            audioSink.SetScheduler(&scheduler);
+        }
+        audioSink.SetDropNonSpeech(options.dropNonSpeech);
+        audioSink.SetAudioOutput(options.audioOutput);
+        audioSink.SetSpeakerAnalytics(&analytics);
+        audioSink.SetAgcTarget(options.agcTargetLufs);
+        if (options.localMix) {
+            LocalMixRules rules;
+            LocalMixRulesFromConfig("", options.localMixExclude, "", rules);
+            mixer.SetRules(rules);
+            audioSink.SetLocalMixer(&mixer);
+        }
+        if (!options.keywords.empty() || options.utterances) {
+            events.Open(options.output + "/events.jsonl", "");
+        }
+        if (!options.keywords.empty()) {
+            std::string error;
+            std::unique_ptr<TemplateKeywordModel> model = TemplateKeywordModel::Load(options.keywords, 0.2f, error);
+            if (!model) {
+                std::cerr << "--keywords " << error << std::endl;
+                return 2;
+            }
+            spotter.Start(std::move(model), options.keywordThreads, &events, "replay");
+            audioSink.SetKeywordSpotter(&spotter);
+        }
+        if (options.utterances) {
+            utteranceWriter.Start(options.output + "/utterances", &events, "replay");
+            chunker.SetSink(&utteranceWriter);
+            audioSink.SetUtteranceChunker(&chunker);
+        }
+        SnapshotStore snapshotStore(options.snapshotSeconds * 1000, 64, 320, 75);
+        ZoomSdkRenderer videoSink;
+        videoSink.SetSynchronizer(&synchronizer, 16778240);
+        if (snapshotStore.Enabled()) {
+            videoSink.SetSnapshots(&snapshotStore);
+        }
+        // every tile gets the synthetic frame through a renderer of its own, as in a meeting
+        GalleryCompositor gallery(1280, 720, options.galleryTiles, 15,
+                                  std::max<size_t>((size_t)options.width * options.height * 3 / 2, 6));
+        std::vector<ZoomSdkRenderer> galleryRenderers(options.galleryTiles);
+        for (unsigned int i = 0; i < options.galleryTiles; i++) {
+            gallery.SetTile(i, 16778240 + i * 1024);
+            galleryRenderers[i].SetCompositor(&gallery, i, 16778240 + i * 1024);
+            if (snapshotStore.Enabled()) {
+                galleryRenderers[i].SetSnapshots(&snapshotStore);
+            }
+        }
+        gallery.Start(&synchronizer);
+
+        std::vector<SyntheticSpeaker> speakers;
+        for (unsigned int i = 0; i < options.participants; i++) {
+            speakers.push_back(SyntheticSpeaker(i));
+        }
+        FakeAudioRawData mixed;
+        std::vector<FakeAudioRawData> oneWay(options.participants);
+        bool withVideo = options.width > 0 && options.height > 0;
+        FakeVideoFrame frame(withVideo ? options.width : 2, withVideo ? options.height : 2);
+
+        for (unsigned long long ms = 0; ms < options.seconds * 1000ull; ms += kCallbackMs) {
+            if (options.speed > 0) {
+                std::this_thread::sleep_until(started + std::chrono::microseconds(ms * 1000 / options.speed));
+            }
+            std::fill(mixed.Samples().begin(), mixed.Samples().end(), 0);
+            for (unsigned int p = 0; p < options.participants; p++) {
+                speakers[p].Fill(oneWay[p].Samples(), ms, options.participants);
+                oneWay[p].SetTimeStamp(ms);
+                for (size_t i = 0; i < kCallbackSamples; i++) {
+                    mixed.Samples()[i] = (int16_t)std::max(-32768, std::min(32767, mixed.Samples()[i] + oneWay[p].Samples()[i]));
+                }
+            }
+            mixed.SetTimeStamp(ms);
+
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            audioSink.onMixedAudioRawDataReceived(&mixed);
+            mixedStats.Add(std::chrono::steady_clock::now() - begin);
+
+            for (unsigned int p = 0; p < options.participants; p++) {
+                begin = std::chrono::steady_clock::now();
+                audioSink.onOneWayAudioRawDataReceived(&oneWay[p], 16778240 + p * 1024);
+                oneWayStats.Add(std::chrono::steady_clock::now() - begin);
+            }
+
+            if (withVideo && ms % kFrameIntervalMs == 0) {
+                frame.Advance(ms);
+                begin = std::chrono::steady_clock::now();
+                if (options.galleryTiles == 0) {
+                    videoSink.onRawDataFrameReceived(&frame);
+                }
+                for (unsigned int i = 0; i < options.galleryTiles; i++) {
+                    galleryRenderers[i].onRawDataFrameReceived(&frame);
+                }
+                videoStats.Add(std::chrono::steady_clock::now() - begin);
+            }
+        }
+
+        audioSink.WaitIdle();
+        gallery.Stop();
+        galleryFrames = gallery.FramesComposed();
+        galleryLateTicks = gallery.LateTicks();
+        galleryMaxComposeUs = gallery.MaxComposeUs();
+        snapshotsEncoded = snapshotStore.Encoded();
+        snapshotMaxEncodeUs = snapshotStore.MaxEncodeUs();
+        snapshots = snapshotStore.List();
+        speakerStats.resize(analytics.Snapshot(speakerStats.data(), speakerStats.size(), conversation));
+        synchronizer.Flush();
+        recorder.Finish(30000);
+        recordsWritten = recorder.RecordsWritten();
+        droppedRecords = recorder.DroppedRecords();
+        droppedChunks = audioSink.DroppedChunks();
+        keywordHits = spotter.Hits();
+        keywordShedFrames = spotter.ShedFrames();
+        utteranceWriter.Drain(30000);
+        utterances = chunker.Finished();
+        droppedUtterances = chunker.Dropped();
+    }
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Replayed " << options.seconds << " s of a meeting with " << options.participants << " participants in "
+              << (long long)elapsedMs << " ms (" << options.seconds * 1000.0 / elapsedMs << "x real time), "
+              << recordsWritten << " records written, " << droppedRecords << " dropped, " << droppedChunks
+              << " audio chunks dropped by the pipeline" << std::endl;
+    mixedStats.Report(std::cout);
+    oneWayStats.Report(std::cout);
+    videoStats.Report(std::cout);
+    if (!options.keywords.empty()) {
+        std::cout << "Keywords: " << keywordHits << " hits, " << keywordShedFrames << " frames shed" << std::endl;
+    }
+    if (options.utterances) {
+        std::cout << "Utterances: " << utterances << " written, " << droppedUtterances << " dropped" << std::endl;
+    }
+    if (options.galleryTiles > 0) {
+        std::cout << "Gallery: " << galleryFrames << " frames of " << options.galleryTiles << " tiles composed, "
+                  << galleryLateTicks << " late ticks, longest " << galleryMaxComposeUs << " us" << std::endl;
+    }
+    if (options.snapshotSeconds > 0) {
+        size_t snapshotBytes = 0;
+        for (size_t i = 0; i < snapshots.size(); i++) {
+            snapshotBytes += snapshots[i].bytes;
+        }
+        std::cout << "Snapshots: " << snapshotsEncoded << " encoded, " << snapshots.size() << " held in "
+                  << snapshotBytes << " bytes, longest " << snapshotMaxEncodeUs << " us" << std::endl;
+    }
+    std::cout << "Talk time: " << conversation.speakerChanges << " speaker changes, " << conversation.interruptions
+              << " interruptions" << std::endl;
+    for (size_t i = 0; i < speakerStats.size(); i++) {
+        const SpeakerStats &stats = speakerStats[i];
+        std::cout << "  speaker " << stats.speakerId << ": " << stats.talkMs << " ms in " << stats.segments
+                  << " segments, " << stats.overlapMs << " ms overlapped" << std::endl;
+    }
+    return 0;
+}
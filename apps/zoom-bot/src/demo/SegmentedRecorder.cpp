@@ -0,0 +1,314 @@
+// Writes synchronized media into fixed-duration, indexed segment files
+
+#include "SegmentedRecorder.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace RecordingFormat;
+
+namespace {
+
+// a partially filled block is handed to the writer once it holds this much media
+const unsigned long long kMaxBlockAgeMs = 1000;
+// index capacity reserved up front: one minute of 100 ms audio slices and 30 fps video
+const size_t kExpectedIndexEntries = 4096;
+
+bool IndexEntryEarlier(const IndexEntry &a, const IndexEntry &b) {
+    if (a.timestampMs != b.timestampMs) {
+        return a.timestampMs < b.timestampMs;
+    }
+    return a.offset < b.offset;
+}
+
+} // namespace
+
+SegmentedRecorder::SegmentedRecorder(const std::string &directory, unsigned int segmentMs, AsyncWriter *writer)
+    : directory_(directory), segmentMs_(segmentMs), writer_(writer), ownsWriter_(false), segmentOpen_(false),
+      block_(nullptr), blockStartMs_(0), pcm_(1600), scaled_(1600), recordsWritten_(0), droppedRecords_(0) {
+    if (!writer_) {
+        writer_ = new AsyncWriter();
+        ownsWriter_ = true;
+    }
+    // create missing parents too, e.g. recording/<meeting number>
+    for (size_t slash = directory_.find('/', 1); ; slash = directory_.find('/', slash + 1)) {
+        std::string path = directory_.substr(0, slash);
+        if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+            std::cerr << "SegmentedRecorder: cannot create " << path << ": " << strerror(errno) << std::endl;
+            break;
+        }
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+    index_.reserve(kExpectedIndexEntries);
+    Metrics::Instance().AddCollector(&SegmentedRecorder::CollectMetrics, this);
+}
+
+SegmentedRecorder::~SegmentedRecorder() {
+    Finish();
+    Metrics::Instance().RemoveCollector(this);
+    if (ownsWriter_) {
+        delete writer_;
+    }
+}
+
+void SegmentedRecorder::onSyncedMedia(const SyncedMedia &media) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // gaps are reported late and never start a segment on their own
+    if (media.kind != SYNCED_MEDIA_GAP) {
+        if (segmentOpen_ && media.timestampMs >= segment_.startMs + segmentMs_) {
+            CloseSegment();
+        }
+        if (!segmentOpen_) {
+            OpenSegment(media.timestampMs);
+        }
+    } else if (!segmentOpen_) {
+        return;
+    }
+    WriteRecord(media);
+}
+
+bool SegmentedRecorder::Finish(unsigned int timeoutMs) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (segmentOpen_) {
+            CloseSegment();
+        }
+    }
+    return writer_->Drain(timeoutMs);
+}
+
+void SegmentedRecorder::SetSegmentDuration(unsigned int segmentMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segmentMs_ = segmentMs;
+}
+
+unsigned long long SegmentedRecorder::RecordsWritten() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recordsWritten_;
+}
+
+unsigned long long SegmentedRecorder::DroppedRecords() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return droppedRecords_;
+}
+
+void SegmentedRecorder::OpenSegment(unsigned long long timestampMs) {
+    segment_.number = (unsigned int)segments_.size();
+    segment_.startMs = timestampMs;
+    segment_.endMs = timestampMs;
+    segment_.records = 0;
+    segment_.bytes = 0;
+    index_.clear();
+
+    char name[32];
+    snprintf(name, sizeof(name), "/segment_%06u.seg", segment_.number);
+    writer_->Open(directory_ + name);
+    segmentOpen_ = true;
+
+    SegmentHeader header;
+    memcpy(header.magic, kSegmentMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.segmentNumber = segment_.number;
+    header.startTimestampMs = timestampMs;
+    if (!Reserve(sizeof(header))) {
+        // nothing can be written until the writer catches up; the reader rejects the file
+        std::cerr << "SegmentedRecorder: no free blocks for segment " << segment_.number << std::endl;
+        return;
+    }
+    AppendBytes(&header, sizeof(header));
+}
+
+void SegmentedRecorder::CloseSegment() {
+    SubmitBlock();
+
+    std::sort(index_.begin(), index_.end(), IndexEntryEarlier);
+    SegmentFooter footer;
+    footer.indexOffset = segment_.bytes;
+    footer.entryCount = (uint32_t)index_.size();
+    footer.magic = kFooterMagic;
+
+    // the index is small next to the media, so it goes out as one positioned write
+    std::string trailer;
+    trailer.reserve(index_.size() * sizeof(IndexEntry) + sizeof(footer));
+    if (!index_.empty()) {
+        trailer.append((const char *)index_.data(), index_.size() * sizeof(IndexEntry));
+    }
+    trailer.append((const char *)&footer, sizeof(footer));
+    writer_->WriteAt(segment_.bytes, trailer);
+    writer_->Close();
+
+    segment_.bytes += trailer.size();
+    segments_.push_back(segment_);
+    segmentOpen_ = false;
+    WriteManifest();
+}
+
+bool SegmentedRecorder::Reserve(size_t bytes) {
+    size_t available = block_ ? writer_->BlockSize() - block_->size : 0;
+    available += writer_->FreeBlocks() * writer_->BlockSize();
+    return available >= bytes;
+}
+
+void SegmentedRecorder::AppendBytes(const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (size > 0) {
+        if (!block_) {
+            block_ = writer_->AcquireBlock();
+        }
+        size_t take = std::min(size, writer_->BlockSize() - block_->size);
+        memcpy(block_->data + block_->size, bytes, take);
+        block_->size += take;
+        segment_.bytes += take;
+        bytes += take;
+        size -= take;
+        if (block_->size == writer_->BlockSize()) {
+            writer_->Append(block_);
+            block_ = nullptr;
+        }
+    }
+}
+
+void SegmentedRecorder::AppendAudio(const float *samples, size_t count) {
+    while (count > 0) {
+        size_t take = std::min(count, pcm_.size());
+        SimdKernels::FloatToInt16(samples, take, pcm_.data());
+        AppendBytes(pcm_.data(), take * sizeof(int16_t));
+        samples += take;
+        count -= take;
+    }
+}
+
+void SegmentedRecorder::AppendFeatures(const float *values, size_t count) {
+    // FloatToInt16 scales by 32768, so this stores value * kFeatureScale
+    const float scale = kFeatureScale / 32768.0f;
+    while (count > 0) {
+        size_t take = std::min(count, pcm_.size());
+        for (size_t i = 0; i < take; i++) {
+            scaled_[i] = values[i] * scale;
+        }
+        SimdKernels::FloatToInt16(scaled_.data(), take, pcm_.data());
+        AppendBytes(pcm_.data(), take * sizeof(int16_t));
+        values += take;
+        count -= take;
+    }
+}
+
+void SegmentedRecorder::SubmitBlock() {
+    if (block_) {
+        if (block_->size > 0) {
+            writer_->Append(block_);
+        } else {
+            writer_->ReleaseBlock(block_);
+        }
+        block_ = nullptr;
+    }
+}
+
+void SegmentedRecorder::WriteRecord(const SyncedMedia &media) {
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kRecordMagic;
+    header.streamId = media.streamId;
+    header.timestampMs = media.timestampMs;
+    uint64_t gapMs = media.gapMs;
+    switch (media.kind) {
+    case SYNCED_MEDIA_AUDIO:
+        header.kind = RECORD_AUDIO;
+        header.payloadBytes = (uint32_t)(media.sampleCount * sizeof(int16_t));
+        break;
+    case SYNCED_MEDIA_VIDEO:
+        header.kind = RECORD_VIDEO;
+        header.payloadBytes = (uint32_t)media.frameBytes;
+        header.width = (uint16_t)media.width;
+        header.height = (uint16_t)media.height;
+        break;
+    case SYNCED_MEDIA_FEATURES:
+        header.kind = RECORD_FEATURES;
+        header.payloadBytes = (uint32_t)(media.featureFrames * media.featureBins * sizeof(int16_t));
+        header.width = (uint16_t)media.featureBins;
+        header.height = (uint16_t)media.featureFrames;
+        header.frameMs = (uint16_t)media.frameMs;
+        break;
+    case SYNCED_MEDIA_GAP:
+        header.kind = RECORD_GAP;
+        header.gapKind = media.gapKind == SYNCED_MEDIA_AUDIO     ? RECORD_AUDIO
+                         : media.gapKind == SYNCED_MEDIA_FEATURES ? RECORD_FEATURES
+                                                                  : RECORD_VIDEO;
+        header.payloadBytes = sizeof(gapMs);
+        break;
+    }
+
+    if (!Reserve(sizeof(header) + header.payloadBytes)) {
+        droppedRecords_++;
+        return;
+    }
+
+    IndexEntry entry;
+    entry.timestampMs = media.timestampMs;
+    entry.offset = segment_.bytes;
+    entry.streamId = media.streamId;
+    entry.kind = header.kind;
+    index_.push_back(entry);
+
+    if (!block_ || block_->size == 0) {
+        blockStartMs_ = media.timestampMs;
+    }
+    AppendBytes(&header, sizeof(header));
+    switch (media.kind) {
+    case SYNCED_MEDIA_AUDIO:
+        AppendAudio(media.samples, media.sampleCount);
+        break;
+    case SYNCED_MEDIA_VIDEO:
+        AppendBytes(media.frame, media.frameBytes);
+        break;
+    case SYNCED_MEDIA_FEATURES:
+        AppendFeatures(media.features, media.featureFrames * media.featureBins);
+        break;
+    case SYNCED_MEDIA_GAP:
+        AppendBytes(&gapMs, sizeof(gapMs));
+        break;
+    }
+
+    segment_.records++;
+    if (media.timestampMs > segment_.endMs) {
+        segment_.endMs = media.timestampMs;
+    }
+    recordsWritten_++;
+
+    // bound how much media is lost if the process dies with a block half full
+    if (block_ && media.timestampMs >= blockStartMs_ + kMaxBlockAgeMs) {
+        SubmitBlock();
+    }
+}
+
+void SegmentedRecorder::WriteManifest() {
+    // one segment per line so RecordingReader can find a segment without a JSON parser
+    std::ostringstream manifest;
+    manifest << "{\n  \"version\": " << kVersion << ",\n  \"segmentMs\": " << segmentMs_ << ",\n  \"segments\": [\n";
+    for (size_t i = 0; i < segments_.size(); i++) {
+        const SegmentInfo &info = segments_[i];
+        char name[32];
+        snprintf(name, sizeof(name), "segment_%06u.seg", info.number);
+        manifest << "    {\"file\": \"" << name << "\", \"startMs\": " << info.startMs << ", \"endMs\": " << info.endMs
+                 << ", \"records\": " << info.records << ", \"bytes\": " << info.bytes << "}"
+                 << (i + 1 < segments_.size() ? "," : "") << "\n";
+    }
+    manifest << "  ]\n}\n";
+    writer_->Replace(directory_ + "/manifest.json", manifest.str());
+}
+
+void SegmentedRecorder::CollectMetrics(MetricsWriter &writer, void *context) {
+    SegmentedRecorder *self = static_cast<SegmentedRecorder *>(context);
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    writer.Write("zoom_bot_recorder_segments_total", self->segments_.size());
+    writer.Write("zoom_bot_recorder_records_total", self->recordsWritten_);
+    writer.Write("zoom_bot_recorder_dropped_records_total", self->droppedRecords_);
+}
@@ -0,0 +1,81 @@
+// Writes synchronized media into fixed-duration, indexed segment files
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AsyncWriter.h"
+#include "MediaSynchronizer.h"
+#include "Metrics.h"
+#include "RecordingFormat.h"
+
+// Receives media from the MediaSynchronizer and stores it in the layout described in
+// RecordingFormat.h. Records are serialized straight into AsyncWriter blocks, so the
+// synchronizer thread never touches the disk; when the writer falls behind far enough that
+// no blocks are free, whole records are dropped and counted instead of blocking capture.
+class SegmentedRecorder : public MediaSyncSink {
+public:
+    /// \param directory Recording directory, created if missing.
+    /// \param segmentMs Duration covered by one segment file, in SDK milliseconds.
+    /// \param writer Writer shared with other producers; nullptr creates a private one.
+    SegmentedRecorder(const std::string &directory = "recording", unsigned int segmentMs = 60000,
+                      AsyncWriter *writer = nullptr);
+    ~SegmentedRecorder();
+
+    virtual void onSyncedMedia(const SyncedMedia &media);
+
+    /// \brief Close the open segment (index, footer, manifest) and wait for the writer.
+    /// \return false if the writer did not finish within timeoutMs.
+    bool Finish(unsigned int timeoutMs = 5000);
+
+    /// \brief Segment duration; the open segment is closed once it reaches the new one.
+    void SetSegmentDuration(unsigned int segmentMs);
+
+    unsigned long long RecordsWritten();
+    unsigned long long DroppedRecords();
+
+    /// \brief Writer operations not yet on disk.
+    size_t PendingWrites() { return writer_->PendingOperations(); }
+
+private:
+    struct SegmentInfo {
+        unsigned int number;
+        unsigned long long startMs;
+        unsigned long long endMs;
+        size_t records;
+        unsigned long long bytes;
+    };
+
+    void OpenSegment(unsigned long long timestampMs);
+    void CloseSegment();
+    bool Reserve(size_t bytes);
+    void AppendBytes(const void *data, size_t size);
+    void AppendAudio(const float *samples, size_t count);
+    void AppendFeatures(const float *values, size_t count);
+    void SubmitBlock();
+    void WriteRecord(const SyncedMedia &media);
+    void WriteManifest();
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    std::mutex mutex_;
+    std::string directory_;
+    unsigned int segmentMs_;
+    AsyncWriter *writer_;
+    bool ownsWriter_;
+
+    bool segmentOpen_;
+    SegmentInfo segment_;
+    std::vector<RecordingFormat::IndexEntry> index_;
+    std::vector<SegmentInfo> segments_;
+
+    AsyncWriter::Block *block_;
+    unsigned long long blockStartMs_;
+    std::vector<int16_t> pcm_;
+    std::vector<float> scaled_;
+
+    unsigned long long recordsWritten_;
+    unsigned long long droppedRecords_;
+};
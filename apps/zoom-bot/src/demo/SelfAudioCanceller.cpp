@@ -0,0 +1,210 @@
+// Removes the bot's own published audio from the captured mixed stream
+
+#include "SelfAudioCanceller.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// mean square above which the reference counts as playing, about -50 dBFS
+const float kActiveEnergy = 1e-5f;
+// estimates in a row without the echo before the alignment is given up
+const int kMaxMisses = 4;
+const float kMaxEchoGain = 4.0f;
+// weight of each slice's least squares gain in the smoothed echo gain
+const float kGainSmoothing = 0.1f;
+
+} // namespace
+
+bool SelfAudioModeFromName(const std::string &name, SelfAudioMode &mode) {
+    if (name == "off") {
+        mode = SELF_AUDIO_OFF;
+    } else if (name == "subtract") {
+        mode = SELF_AUDIO_SUBTRACT;
+    } else if (name == "gate") {
+        mode = SELF_AUDIO_GATE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Process caps its slices with std::min, which takes the limit by reference
+const size_t SelfAudioCanceller::kMaxSliceSamples;
+
+SelfAudioCanceller::SelfAudioCanceller()
+    : reference_(nullptr), mode_(SELF_AUDIO_OFF), mixedIndex_(0), sinceEstimate_(0), offset_(0), misses_(0),
+      echoGain_(1.0f), gateGain_(1.0f), inputEnergy_(0.0), outputEnergy_(0.0), locked_(false), delayMs_(0),
+      cancelledSamples_(0), gatedSamples_(0), erleDb_(0.0f) {}
+
+void SelfAudioCanceller::SetReference(PlaybackReference *reference, SelfAudioMode mode) {
+    reference_ = reference;
+    mode_ = mode;
+    if (!Enabled() || !history_.empty()) {
+        return;
+    }
+    history_.assign(kWindowSamples, 0.0f);
+    aligned_.resize(kMaxSliceSamples);
+    mixedWindow_.resize(kWindowSamples);
+    referenceWindow_.resize(kWindowSamples + kMaxDelaySamples + kLeadSamples);
+    mixedDecimated_.resize(kWindowSamples / kDecimation);
+    referenceDecimated_.resize((kWindowSamples + kMaxDelaySamples + kLeadSamples) / kDecimation);
+}
+
+void SelfAudioCanceller::Process(float *samples, size_t count, std::chrono::steady_clock::time_point start) {
+    if (!Enabled()) {
+        return;
+    }
+    for (size_t done = 0; done < count;) {
+        size_t n = std::min(count - done, kMaxSliceSamples);
+        float *slice = samples + done;
+        std::chrono::steady_clock::time_point sliceStart = start + std::chrono::microseconds(done * 1000000 / kAsrSampleRate);
+        done += n;
+
+        // where the arrival time puts the reference; jittery, only the search is centred on it
+        long long coarse = reference_->IndexAt(sliceStart) - mixedIndex_;
+        for (size_t i = 0; i < n; i++) {
+            history_[(mixedIndex_ + i) % kWindowSamples] = slice[i];
+        }
+        long long mixedEnd = mixedIndex_ + (long long)n;
+        sinceEstimate_ += n;
+        if (sinceEstimate_ >= kEstimateEverySamples && mixedEnd >= (long long)kWindowSamples) {
+            sinceEstimate_ = 0;
+            Estimate(coarse, mixedEnd);
+        }
+
+        if (!locked_.load(std::memory_order_relaxed)) {
+            // the bot's audio could be anywhere in the search range
+            size_t span = n + kMaxDelaySamples + kLeadSamples;
+            bool active = reference_->Read(mixedIndex_ + coarse - (long long)kMaxDelaySamples, span,
+                                           referenceWindow_.data()) &&
+                          SimdKernels::DotProduct(referenceWindow_.data(), referenceWindow_.data(), span) >
+                              kActiveEnergy * span;
+            Gate(slice, n, active);
+            mixedIndex_ = mixedEnd;
+            continue;
+        }
+
+        float *aligned = aligned_.data();
+        float referenceEnergy = 0.0f;
+        if (reference_->Read(mixedIndex_ + offset_, n, aligned)) {
+            referenceEnergy = SimdKernels::DotProduct(aligned, aligned, n);
+        }
+        bool active = referenceEnergy > kActiveEnergy * n;
+        if (active && mode_ == SELF_AUDIO_SUBTRACT) {
+            float inputEnergy = SimdKernels::DotProduct(slice, slice, n);
+            float fit = SimdKernels::DotProduct(slice, aligned, n) / referenceEnergy;
+            echoGain_ += kGainSmoothing * (std::max(0.0f, std::min(kMaxEchoGain, fit)) - echoGain_);
+            SimdKernels::SubtractScaled(aligned, echoGain_, n, slice);
+            inputEnergy_ += inputEnergy;
+            outputEnergy_ += SimdKernels::DotProduct(slice, slice, n);
+            if (outputEnergy_ > 0.0) {
+                erleDb_.store((float)(10.0 * log10(inputEnergy_ / outputEnergy_)), std::memory_order_relaxed);
+            }
+            cancelledSamples_.fetch_add(n, std::memory_order_relaxed);
+            active = false;
+        }
+        Gate(slice, n, active);
+        mixedIndex_ = mixedEnd;
+    }
+}
+
+void SelfAudioCanceller::Gate(float *samples, size_t count, bool active) {
+    float target = active ? kGateGain : 1.0f;
+    if (active) {
+        gatedSamples_.fetch_add(count, std::memory_order_relaxed);
+    }
+    if (target == 1.0f && gateGain_ == 1.0f) {
+        return;
+    }
+    // ramp over the slice so opening and closing the gate does not click
+    float step = (target - gateGain_) / count;
+    SimdKernels::ApplyGainRamp(samples, count, gateGain_ + step, step, samples);
+    gateGain_ = target;
+}
+
+void SelfAudioCanceller::Estimate(long long coarse, long long mixedEnd) {
+    const size_t span = kMaxDelaySamples + kLeadSamples;
+    const size_t referenceLength = kWindowSamples + span;
+    long long referenceStart = mixedEnd - (long long)kWindowSamples + coarse - (long long)kMaxDelaySamples;
+    if (!reference_->Read(referenceStart, referenceLength, referenceWindow_.data()) ||
+        SimdKernels::DotProduct(referenceWindow_.data(), referenceWindow_.data(), referenceLength) <
+            kActiveEnergy * referenceLength) {
+        // the bot is silent: nothing to learn, keep what was found before
+        return;
+    }
+    size_t oldest = (size_t)(mixedEnd % (long long)kWindowSamples);
+    std::copy(history_.begin() + oldest, history_.end(), mixedWindow_.begin());
+    std::copy(history_.begin(), history_.begin() + oldest, mixedWindow_.begin() + (kWindowSamples - oldest));
+
+    // coarse search on 4 kHz signals; the boxcar is enough of a low-pass for speech
+    const size_t mixedCount = kWindowSamples / kDecimation;
+    const size_t referenceCount = referenceLength / kDecimation;
+    for (size_t i = 0; i < referenceCount; i++) {
+        float mixed = 0.0f;
+        float reference = 0.0f;
+        for (size_t k = 0; k < kDecimation; k++) {
+            reference += referenceWindow_[i * kDecimation + k];
+            if (i < mixedCount) {
+                mixed += mixedWindow_[i * kDecimation + k];
+            }
+        }
+        referenceDecimated_[i] = reference;
+        if (i < mixedCount) {
+            mixedDecimated_[i] = mixed;
+        }
+    }
+    double mixedEnergy = SimdKernels::DotProduct(mixedDecimated_.data(), mixedDecimated_.data(), mixedCount);
+    double referenceEnergy = SimdKernels::DotProduct(referenceDecimated_.data(), referenceDecimated_.data(), mixedCount);
+    float best = -1.0f;
+    size_t bestLag = 0;
+    for (size_t lag = 0; lag + mixedCount <= referenceCount; lag++) {
+        if (mixedEnergy > 0.0 && referenceEnergy > 0.0) {
+            float correlation =
+                SimdKernels::DotProduct(mixedDecimated_.data(), referenceDecimated_.data() + lag, mixedCount) /
+                (float)sqrt(mixedEnergy * referenceEnergy);
+            if (correlation > best) {
+                best = correlation;
+                bestLag = lag;
+            }
+        }
+        // slide the reference energy window by one
+        if (lag + mixedCount < referenceCount) {
+            float leaving = referenceDecimated_[lag];
+            float entering = referenceDecimated_[lag + mixedCount];
+            referenceEnergy = std::max(0.0, referenceEnergy - leaving * leaving + entering * entering);
+        }
+    }
+    if (best < kLockCorrelation) {
+        if (++misses_ >= kMaxMisses && locked_.load(std::memory_order_relaxed)) {
+            locked_.store(false, std::memory_order_relaxed);
+        }
+        return;
+    }
+    misses_ = 0;
+
+    // refine to the sample around the coarse peak
+    long long coarseLag = (long long)(bestLag * kDecimation);
+    long long fineLag = coarseLag;
+    float fineBest = -1.0f;
+    for (long long lag = coarseLag - (long long)kDecimation; lag <= coarseLag + (long long)kDecimation; lag++) {
+        if (lag < 0 || lag > (long long)span) {
+            continue;
+        }
+        const float *r = referenceWindow_.data() + lag;
+        float energy = SimdKernels::DotProduct(r, r, kWindowSamples);
+        if (energy <= 0.0f) {
+            continue;
+        }
+        float correlation = SimdKernels::DotProduct(mixedWindow_.data(), r, kWindowSamples) / sqrtf(energy);
+        if (correlation > fineBest) {
+            fineBest = correlation;
+            fineLag = lag;
+        }
+    }
+    offset_ = coarse - (long long)kMaxDelaySamples + fineLag;
+    delayMs_.store(((long long)kMaxDelaySamples - fineLag) * 1000 / kAsrSampleRate, std::memory_order_relaxed);
+    locked_.store(true, std::memory_order_relaxed);
+}
@@ -0,0 +1,102 @@
+// Removes the bot's own published audio from the captured mixed stream
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "PlaybackReference.h"
+
+// What to do with the bot's own audio in the mixed capture.
+enum SelfAudioMode {
+    // record it as it comes
+    SELF_AUDIO_OFF,
+    // subtract the aligned reference; gate while the alignment is not found yet
+    SELF_AUDIO_SUBTRACT,
+    // attenuate the mixed stream by 30 dB whenever the bot is playing
+    SELF_AUDIO_GATE,
+};
+
+/// \brief SelfAudioMode of a selfAudioSuppression name: "off", "subtract" or "gate".
+/// \return false if the name is none of them.
+bool SelfAudioModeFromName(const std::string &name, SelfAudioMode &mode);
+
+// Cancels a PlaybackReference out of the mixed stream. The bot's audio comes back in the
+// mix later than it was sent, by a delay nobody reports, so the canceller finds it: every
+// 500 ms while the bot plays, it correlates the last 500 ms of the mix with the reference
+// over -100 to +500 ms around where the arrival time places it, first decimated by 4 and
+// then refined to the sample. The offset found is kept in samples of the mixed stream, so
+// callback jitter does not move it. The gain of the echo is tracked with a smoothed least
+// squares fit and the scaled reference is subtracted.
+//
+// Single-threaded: the mixed stream's strand calls Process. The statistics are atomics.
+class SelfAudioCanceller {
+public:
+    static const size_t kWindowSamples = 8000;
+    static const size_t kMaxDelaySamples = 8000;
+    static const size_t kLeadSamples = 1600;
+    static const size_t kDecimation = 4;
+    static const size_t kEstimateEverySamples = 8000;
+    // longer input is processed in slices of this many samples
+    static const size_t kMaxSliceSamples = kWindowSamples;
+    // normalized correlation the echo must reach to be trusted
+    static constexpr float kLockCorrelation = 0.5f;
+    // -30 dB
+    static constexpr float kGateGain = 0.0316f;
+
+    SelfAudioCanceller();
+
+    /// \brief Cancel reference out of the audio given to Process, nullptr or SELF_AUDIO_OFF
+    /// for nothing. Set before the first Process.
+    void SetReference(PlaybackReference *reference, SelfAudioMode mode);
+
+    bool Enabled() const { return reference_ && mode_ != SELF_AUDIO_OFF; }
+
+    /// \brief Remove the bot's audio from count 16 kHz mixed samples, in place.
+    /// \param start When the first of the samples was captured, on the steady clock.
+    void Process(float *samples, size_t count, std::chrono::steady_clock::time_point start);
+
+    bool Locked() const { return locked_.load(std::memory_order_relaxed); }
+    /// \brief Delay of the bot's audio in the mix relative to when it was sent.
+    long long DelayMs() const { return delayMs_.load(std::memory_order_relaxed); }
+    double CancelledSeconds() const { return (double)cancelledSamples_.load(std::memory_order_relaxed) / kAsrSampleRate; }
+    double GatedSeconds() const { return (double)gatedSamples_.load(std::memory_order_relaxed) / kAsrSampleRate; }
+    /// \brief Echo return loss enhancement over everything subtracted so far: how much
+    /// quieter the mix got where the bot was playing.
+    float ErleDb() const { return erleDb_.load(std::memory_order_relaxed); }
+
+private:
+    void Estimate(long long coarse, long long mixedEnd);
+    void Gate(float *samples, size_t count, bool active);
+
+    PlaybackReference *reference_;
+    SelfAudioMode mode_;
+
+    // mixed samples seen so far, the stream's own timeline
+    long long mixedIndex_;
+    // the last kWindowSamples mixed samples before cancellation, a ring
+    std::vector<float> history_;
+    size_t sinceEstimate_;
+    // reference index of mixed sample m is m + offset_ once locked
+    long long offset_;
+    int misses_;
+    float echoGain_;
+    float gateGain_;
+    double inputEnergy_;
+    double outputEnergy_;
+
+    // scratch, sized once
+    std::vector<float> aligned_;
+    std::vector<float> mixedWindow_;
+    std::vector<float> referenceWindow_;
+    std::vector<float> mixedDecimated_;
+    std::vector<float> referenceDecimated_;
+
+    std::atomic<bool> locked_;
+    std::atomic<long long> delayMs_;
+    std::atomic<unsigned long long> cancelledSamples_;
+    std::atomic<unsigned long long> gatedSamples_;
+    std::atomic<float> erleDb_;
+};
@@ -0,0 +1,495 @@
+// Runs one worker process per meeting under a single parent
+
+#include "SessionSupervisor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// how often the loop wakes up without events to reap workers and run restarts
+const int kPollIntervalMs = 250;
+const unsigned int kMaxWarmBackoffSeconds = 60;
+
+double ElapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+volatile sig_atomic_t SessionSupervisor::stopRequested_ = 0;
+
+SessionSupervisor::SessionSupervisor(WorkerMain workerMain, unsigned int maxRestarts)
+    : workerMain_(workerMain), maxRestarts_(maxRestarts), warmWorkerMain_(nullptr), warmPoolSize_(0), listenFd_(-1),
+      warmBackoffSeconds_(0), nextWarmSpawn_(Clock::now()), warmStarts_(0), warmStartTotalMs_(0), joins_(0),
+      rejectedJoins_(0), firstAudioCount_(0), firstAudioTotalMs_(0), firstAudioMaxMs_(0), stopTimeoutMs_(30000) {
+}
+
+SessionSupervisor::~SessionSupervisor() {
+    for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it) {
+        close(it->fd);
+    }
+    for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+        if (it->controlFd >= 0) {
+            close(it->controlFd);
+        }
+    }
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        unlink(controlSocketPath_.c_str());
+    }
+}
+
+void SessionSupervisor::Add(const MeetingOptions &options) {
+    Worker worker;
+    worker.options = options;
+    worker.state = WORKER_WAITING;
+    worker.pid = -1;
+    worker.controlFd = -1;
+    worker.restarts = 0;
+    worker.exitCode = 0;
+    worker.restartAt = Clock::now();
+    workers_.push_back(worker);
+}
+
+bool SessionSupervisor::EnableWarmPool(WarmWorkerMain warmWorkerMain, size_t poolSize,
+                                       const std::string &controlSocketPath) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (controlSocketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "SessionSupervisor: control socket path too long" << std::endl;
+        return false;
+    }
+    strncpy(address.sun_path, controlSocketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(controlSocketPath.c_str());
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        std::cerr << "SessionSupervisor: cannot listen on " << controlSocketPath << ": " << strerror(errno)
+                  << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    warmWorkerMain_ = warmWorkerMain;
+    warmPoolSize_ = poolSize;
+    controlSocketPath_ = controlSocketPath;
+    listenFd_ = fd;
+    std::cout << "SessionSupervisor: keeping " << poolSize << " warm worker(s), control socket " << controlSocketPath
+              << std::endl;
+    return true;
+}
+
+void SessionSupervisor::CloseInheritedDescriptors(int keepFd) {
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+    }
+    for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it) {
+        close(it->fd);
+    }
+    for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+        if (it->controlFd >= 0 && it->controlFd != keepFd) {
+            close(it->controlFd);
+        }
+    }
+}
+
+bool SessionSupervisor::Spawn(Worker &worker) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "SessionSupervisor: fork failed for meeting " << worker.options.meetingNumber << ": "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+    if (pid == 0) {
+        CloseInheritedDescriptors(-1);
+        // the worker installs its own handlers; leave with the meeting if the parent dies
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() == 1) {
+            _exit(1);
+        }
+        std::exit(workerMain_(worker.options));
+    }
+    worker.pid = pid;
+    worker.state = WORKER_MEETING;
+    worker.startedAt = Clock::now();
+    std::cout << "SessionSupervisor: meeting " << worker.options.meetingNumber << " started in worker " << pid
+              << std::endl;
+    return true;
+}
+
+bool SessionSupervisor::SpawnWarm() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        std::cerr << "SessionSupervisor: socketpair failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "SessionSupervisor: fork failed for warm worker: " << strerror(errno) << std::endl;
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        CloseInheritedDescriptors(fds[1]);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() == 1) {
+            _exit(1);
+        }
+        std::exit(warmWorkerMain_(fds[1]));
+    }
+    close(fds[1]);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    Worker worker;
+    worker.state = WORKER_STARTING;
+    worker.pid = pid;
+    worker.controlFd = fds[0];
+    worker.restarts = 0;
+    worker.exitCode = 0;
+    worker.startedAt = Clock::now();
+    workers_.push_back(worker);
+    std::cout << "SessionSupervisor: warm worker " << pid << " starting" << std::endl;
+    return true;
+}
+
+size_t SessionSupervisor::CountWorkers(WorkerState state) const {
+    size_t count = 0;
+    for (std::list<Worker>::const_iterator it = workers_.begin(); it != workers_.end(); ++it) {
+        if (it->state == state) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void SessionSupervisor::FillWarmPool() {
+    if (listenFd_ < 0 || Clock::now() < nextWarmSpawn_) {
+        return;
+    }
+    size_t warm = CountWorkers(WORKER_STARTING) + CountWorkers(WORKER_IDLE);
+    while (warm < warmPoolSize_ && SpawnWarm()) {
+        warm++;
+    }
+}
+
+void SessionSupervisor::Reap() {
+    while (true) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid <= 0) {
+            return;
+        }
+        for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+            if (it->pid != pid) {
+                continue;
+            }
+            bool warm = it->state != WORKER_MEETING;
+            OnWorkerExit(*it, status);
+            if (warm) {
+                // warm workers are one-shot; the pool is refilled with fresh ones
+                workers_.erase(it);
+            }
+            break;
+        }
+    }
+}
+
+void SessionSupervisor::OnWorkerExit(Worker &worker, int status) {
+    int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    if (worker.controlFd >= 0) {
+        close(worker.controlFd);
+        worker.controlFd = -1;
+    }
+
+    switch (worker.state) {
+    case WORKER_STARTING:
+        warmBackoffSeconds_ = warmBackoffSeconds_ == 0 ? 1 : std::min(warmBackoffSeconds_ * 2, kMaxWarmBackoffSeconds);
+        nextWarmSpawn_ = Clock::now() + std::chrono::seconds(warmBackoffSeconds_);
+        std::cout << "SessionSupervisor: warm worker " << worker.pid << " failed to start (" << exitCode
+                  << "), next attempt in " << warmBackoffSeconds_ << " s" << std::endl;
+        break;
+    case WORKER_IDLE:
+        std::cout << "SessionSupervisor: idle warm worker " << worker.pid << " exited with " << exitCode << std::endl;
+        break;
+    case WORKER_ASSIGNED:
+        std::cout << "SessionSupervisor: meeting " << worker.options.meetingNumber << " worker " << worker.pid
+                  << " exited with " << exitCode << std::endl;
+        break;
+    default:
+        std::cout << "SessionSupervisor: meeting " << worker.options.meetingNumber << " worker " << worker.pid
+                  << " exited with " << exitCode << std::endl;
+        worker.exitCode = exitCode;
+        worker.state = WORKER_EXITED;
+        if (exitCode != 0 && !stopRequested_ && worker.restarts < maxRestarts_) {
+            // back off so a meeting that cannot be joined does not spin
+            unsigned int delay = 1u << worker.restarts;
+            worker.restarts++;
+            worker.state = WORKER_WAITING;
+            worker.restartAt = Clock::now() + std::chrono::seconds(delay);
+            std::cout << "SessionSupervisor: restarting meeting " << worker.options.meetingNumber << " in " << delay
+                      << " s (attempt " << worker.restarts << ")" << std::endl;
+        }
+        break;
+    }
+    worker.pid = -1;
+}
+
+void SessionSupervisor::HandleWorkerMessages(Worker &worker) {
+    bool open = worker.input.ReadFrom(worker.controlFd);
+    std::string line;
+    while (worker.input.NextLine(line)) {
+        if (line == "READY" && worker.state == WORKER_STARTING) {
+            double startMs = ElapsedMs(worker.startedAt);
+            warmStarts_++;
+            warmStartTotalMs_ += startMs;
+            warmBackoffSeconds_ = 0;
+            worker.state = WORKER_IDLE;
+            std::cout << "SessionSupervisor: warm worker " << worker.pid << " ready after " << (long long)startMs
+                      << " ms" << std::endl;
+        } else if (line == "FIRST_AUDIO" && worker.state == WORKER_ASSIGNED) {
+            double latencyMs = ElapsedMs(worker.assignedAt);
+            firstAudioCount_++;
+            firstAudioTotalMs_ += latencyMs;
+            firstAudioMaxMs_ = std::max(firstAudioMaxMs_, latencyMs);
+            std::cout << "SessionSupervisor: meeting " << worker.options.meetingNumber
+                      << " join request to first audio took " << (long long)latencyMs << " ms" << std::endl;
+        }
+    }
+    if (!open) {
+        // the worker is exiting; Reap collects it
+        close(worker.controlFd);
+        worker.controlFd = -1;
+    }
+}
+
+void SessionSupervisor::AcceptClients() {
+    while (true) {
+        int fd = accept4(listenFd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        Client client;
+        client.fd = fd;
+        clients_.push_back(client);
+    }
+}
+
+std::string SessionSupervisor::AssignMeeting(const std::string &line) {
+    MeetingOptions options;
+    std::string error;
+    if (!ControlProtocol::ParseJoin(line, options, error)) {
+        return "ERR " + error + "\n";
+    }
+    for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+        if (it->state != WORKER_IDLE || it->controlFd < 0) {
+            continue;
+        }
+        if (!ControlProtocol::Send(it->controlFd, ControlProtocol::FormatJoin(options))) {
+            continue;
+        }
+        it->options = options;
+        it->state = WORKER_ASSIGNED;
+        it->assignedAt = Clock::now();
+        joins_++;
+        std::cout << "SessionSupervisor: meeting " << options.meetingNumber << " assigned to warm worker " << it->pid
+                  << std::endl;
+        char reply[32];
+        snprintf(reply, sizeof(reply), "OK %d\n", (int)it->pid);
+        return reply;
+    }
+    rejectedJoins_++;
+    return "ERR no idle worker\n";
+}
+
+std::string SessionSupervisor::DescribeStatus() {
+    char status[320];
+    snprintf(status, sizeof(status),
+             "STATUS idle=%zu starting=%zu assigned=%zu meetings=%zu joins=%llu rejected=%llu "
+             "warm_start_avg_ms=%.0f first_audio_count=%llu first_audio_avg_ms=%.0f first_audio_max_ms=%.0f\n",
+             CountWorkers(WORKER_IDLE), CountWorkers(WORKER_STARTING), CountWorkers(WORKER_ASSIGNED),
+             CountWorkers(WORKER_MEETING), joins_, rejectedJoins_, warmStarts_ ? warmStartTotalMs_ / warmStarts_ : 0.0,
+             firstAudioCount_, firstAudioCount_ ? firstAudioTotalMs_ / firstAudioCount_ : 0.0, firstAudioMaxMs_);
+    return status;
+}
+
+void SessionSupervisor::HandleClient(Client &client) {
+    bool open = client.input.ReadFrom(client.fd);
+    std::string line;
+    while (client.input.NextLine(line)) {
+        std::string reply;
+        if (line.compare(0, 4, "JOIN") == 0) {
+            reply = AssignMeeting(line);
+        } else if (line == "STATUS") {
+            reply = DescribeStatus();
+        } else {
+            reply = "ERR unknown command\n";
+        }
+        ControlProtocol::Send(client.fd, reply);
+    }
+    if (!open) {
+        close(client.fd);
+        client.fd = -1;
+    }
+}
+
+void SessionSupervisor::StopWorkers() {
+    for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+        if (it->pid > 0) {
+            kill(it->pid, SIGTERM);
+        } else if (it->state == WORKER_WAITING) {
+            it->state = WORKER_EXITED;
+        }
+    }
+}
+
+void SessionSupervisor::HandleStopSignal(int signal) {
+    (void)signal;
+    stopRequested_ = 1;
+}
+
+int SessionSupervisor::Run() {
+    // no SA_RESTART, so a stop signal interrupts poll below
+    struct sigaction stopHandler;
+    memset(&stopHandler, 0, sizeof(stopHandler));
+    stopHandler.sa_handler = HandleStopSignal;
+    sigemptyset(&stopHandler.sa_mask);
+    sigaction(SIGINT, &stopHandler, NULL);
+    sigaction(SIGTERM, &stopHandler, NULL);
+    // a control client that disconnects before its reply must not kill the supervisor
+    signal(SIGPIPE, SIG_IGN);
+
+    bool stopping = false;
+    bool killed = false;
+    Clock::time_point killAt;
+    std::vector<struct pollfd> fds;
+    std::vector<Worker *> polledWorkers;
+    std::vector<Client *> polledClients;
+    while (true) {
+        if (stopRequested_ && !stopping) {
+            std::cout << "SessionSupervisor: stopping workers" << std::endl;
+            stopping = true;
+            killAt = Clock::now() + std::chrono::milliseconds(stopTimeoutMs_);
+            StopWorkers();
+            if (listenFd_ >= 0) {
+                close(listenFd_);
+                unlink(controlSocketPath_.c_str());
+                listenFd_ = -1;
+            }
+        }
+        if (stopping && !killed && Clock::now() >= killAt) {
+            // a worker stuck in its drain or in the SDK must not keep the pod alive
+            std::cerr << "SessionSupervisor: workers did not stop within " << stopTimeoutMs_ << " ms, killing them"
+                      << std::endl;
+            killed = true;
+            for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+                if (it->pid > 0) {
+                    kill(it->pid, SIGKILL);
+                }
+            }
+        }
+
+        Reap();
+        size_t live = 0;
+        for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+            if (it->state == WORKER_WAITING && !stopping && Clock::now() >= it->restartAt) {
+                if (!Spawn(*it)) {
+                    it->state = WORKER_EXITED;
+                    it->exitCode = 1;
+                }
+            }
+            if (it->pid > 0 || it->state == WORKER_WAITING) {
+                live++;
+            }
+        }
+        if (!stopping) {
+            FillWarmPool();
+        }
+        // with a warm pool the supervisor keeps serving the control socket until stopped
+        if (live == 0 && listenFd_ < 0) {
+            break;
+        }
+
+        fds.clear();
+        polledWorkers.clear();
+        polledClients.clear();
+        struct pollfd entry;
+        entry.events = POLLIN;
+        entry.revents = 0;
+        if (listenFd_ >= 0) {
+            entry.fd = listenFd_;
+            fds.push_back(entry);
+        }
+        for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it) {
+            entry.fd = it->fd;
+            fds.push_back(entry);
+            polledClients.push_back(&*it);
+        }
+        for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+            if (it->controlFd >= 0) {
+                entry.fd = it->controlFd;
+                fds.push_back(entry);
+                polledWorkers.push_back(&*it);
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), kPollIntervalMs) <= 0) {
+            continue;
+        }
+        size_t index = 0;
+        if (listenFd_ >= 0) {
+            if (fds[index].revents & POLLIN) {
+                AcceptClients();
+            }
+            index++;
+        }
+        for (size_t i = 0; i < polledClients.size(); i++, index++) {
+            if (fds[index].revents) {
+                HandleClient(*polledClients[i]);
+            }
+        }
+        for (size_t i = 0; i < polledWorkers.size(); i++, index++) {
+            if (fds[index].revents) {
+                HandleWorkerMessages(*polledWorkers[i]);
+            }
+        }
+        for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end();) {
+            if (it->fd < 0) {
+                it = clients_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    int result = 0;
+    for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ++it) {
+        if (it->state == WORKER_EXITED && it->exitCode != 0) {
+            result = 1;
+        }
+    }
+    return result;
+}
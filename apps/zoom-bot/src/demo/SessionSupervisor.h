@@ -0,0 +1,126 @@
+// Runs one worker process per meeting under a single parent
+#pragma once
+
+#include <chrono>
+#include <csignal>
+#include <list>
+#include <string>
+#include <sys/types.h>
+
+#include "ControlProtocol.h"
+#include "MeetingSession.h"
+
+// The Linux SDK supports one meeting per process, so a pod hosting several meetings forks a
+// worker for each. The parent loads the configuration and warms shared tables once before
+// forking, so workers start with them already mapped (copy-on-write) instead of each pod
+// paying for them. The parent stays single-threaded and never initializes the SDK, which
+// keeps fork safe.
+//
+// Besides the meetings listed in config.txt, the supervisor can keep a pool of warm workers
+// that have already initialized and authenticated the SDK. A JOIN on the control socket
+// hands the meeting to an idle warm worker, so joining skips the SDK start-up; the pool is
+// refilled in the background. The supervisor reports how long each join took from the
+// request to the first audio sample.
+class SessionSupervisor {
+public:
+    /// \brief Entry point of a worker; the return value becomes the worker's exit status.
+    typedef int (*WorkerMain)(const MeetingOptions &options);
+
+    /// \brief Entry point of a warm worker. It reports READY once authenticated and then
+    /// waits for a JOIN on controlFd (see ControlProtocol.h).
+    typedef int (*WarmWorkerMain)(int controlFd);
+
+    /// \param maxRestarts How often a worker that exits with an error is started again.
+    explicit SessionSupervisor(WorkerMain workerMain, unsigned int maxRestarts = 3);
+    ~SessionSupervisor();
+
+    void Add(const MeetingOptions &options);
+
+    /// \brief Keep poolSize warm workers ready and accept JOIN/STATUS on a unix socket.
+    bool EnableWarmPool(WarmWorkerMain warmWorkerMain, size_t poolSize, const std::string &controlSocketPath);
+
+    /// \brief How long workers get to drain and leave after a stop signal before they are killed.
+    void SetStopTimeout(unsigned int timeoutMs) { stopTimeoutMs_ = timeoutMs; }
+
+    /// \brief Fork every worker and supervise them until all have exited, or until
+    /// SIGINT/SIGTERM, which is forwarded to the workers as SIGTERM so they flush their
+    /// recordings and leave; workers still running after the stop timeout are killed.
+    /// \return 0 if every configured meeting finished cleanly.
+    int Run();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    enum WorkerState {
+        // configured meeting, joining or in the meeting
+        WORKER_MEETING,
+        // warm worker initializing and authenticating the SDK
+        WORKER_STARTING,
+        // warm worker waiting for a JOIN
+        WORKER_IDLE,
+        // warm worker that was handed a meeting
+        WORKER_ASSIGNED,
+        // configured meeting waiting for its restart
+        WORKER_WAITING,
+        // configured meeting that finished for good
+        WORKER_EXITED,
+    };
+
+    struct Worker {
+        MeetingOptions options;
+        WorkerState state;
+        pid_t pid;
+        int controlFd;
+        LineBuffer input;
+        unsigned int restarts;
+        int exitCode;
+        Clock::time_point startedAt;
+        Clock::time_point assignedAt;
+        Clock::time_point restartAt;
+    };
+
+    struct Client {
+        int fd;
+        LineBuffer input;
+    };
+
+    bool Spawn(Worker &worker);
+    bool SpawnWarm();
+    void CloseInheritedDescriptors(int keepFd);
+    void Reap();
+    void OnWorkerExit(Worker &worker, int status);
+    void FillWarmPool();
+    void AcceptClients();
+    void HandleClient(Client &client);
+    std::string AssignMeeting(const std::string &line);
+    std::string DescribeStatus();
+    void HandleWorkerMessages(Worker &worker);
+    void StopWorkers();
+    size_t CountWorkers(WorkerState state) const;
+    static void HandleStopSignal(int signal);
+
+    static volatile sig_atomic_t stopRequested_;
+
+    WorkerMain workerMain_;
+    unsigned int maxRestarts_;
+    std::list<Worker> workers_;
+
+    WarmWorkerMain warmWorkerMain_;
+    size_t warmPoolSize_;
+    std::string controlSocketPath_;
+    int listenFd_;
+    std::list<Client> clients_;
+    // a warm worker that dies before READY delays the next one, doubling up to a minute
+    unsigned int warmBackoffSeconds_;
+    Clock::time_point nextWarmSpawn_;
+
+    unsigned long long warmStarts_;
+    double warmStartTotalMs_;
+    unsigned long long joins_;
+    unsigned long long rejectedJoins_;
+    unsigned long long firstAudioCount_;
+    double firstAudioTotalMs_;
+    double firstAudioMaxMs_;
+
+    unsigned int stopTimeoutMs_;
+};
@@ -0,0 +1,433 @@
+// Vectorized kernels shared by the audio and video pipelines
+
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(ZOOM_BOT_SIMD_AVX2)
+#include <immintrin.h>
+#elif defined(ZOOM_BOT_SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const float kInt16ToFloat = 1.0f / 32768.0f;
+// 255 * 257 is the most a uint16 column sum of ScalePlaneBox holds
+const unsigned int kMaxBoxRows = 257;
+
+#if defined(ZOOM_BOT_SIMD_AVX2)
+// the AVX2 kernels are compiled for AVX2/FMA on their own and only run where the CPU has both,
+// so the rest of the binary stays baseline x86-64
+#define ZOOM_BOT_AVX2_TARGET __attribute__((target("avx2,fma")))
+
+bool UseAvx2() {
+    static const bool supported =
+        (__builtin_cpu_init(), __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+    return supported;
+}
+
+ZOOM_BOT_AVX2_TARGET inline float HorizontalSum(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 0x55));
+    return _mm_cvtss_f32(lo);
+}
+
+// Vector parts of the kernels below: each handles a prefix and returns the index the
+// scalar loop of the kernel continues at.
+
+ZOOM_BOT_AVX2_TARGET size_t DotProductAvx2(const float *a, const float *b, size_t count, float &sum) {
+    size_t i = 0;
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    sum = HorizontalSum(_mm256_add_ps(acc0, acc1));
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t MultiplyAvx2(const float *a, const float *b, size_t count, float *dst) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t PeakAbsAvx2(const float *src, size_t count, float &peak) {
+    size_t i = 0;
+    // clearing the sign bit is the absolute value
+    const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        acc = _mm256_max_ps(acc, _mm256_and_ps(_mm256_loadu_ps(src + i), mask));
+    }
+    __m128 lo = _mm_max_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    lo = _mm_max_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_max_ss(lo, _mm_shuffle_ps(lo, lo, 0x55));
+    peak = _mm_cvtss_f32(lo);
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t ApplyGainRampAvx2(const float *src, size_t count, float gain, float step, float *dst) {
+    size_t i = 0;
+    const __m256 offsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 steps = _mm256_set1_ps(step);
+    const __m256 base = _mm256_set1_ps(gain);
+    for (; i + 8 <= count; i += 8) {
+        // computed from the index rather than accumulated, so long slices do not drift
+        __m256 index = _mm256_add_ps(_mm256_set1_ps((float)i), offsets);
+        __m256 gains = _mm256_fmadd_ps(index, steps, base);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), gains));
+    }
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t SubtractScaledAvx2(const float *src, float scale, size_t count, float *dst) {
+    size_t i = 0;
+    const __m256 scales = _mm256_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_fnmadd_ps(_mm256_loadu_ps(src + i), scales, _mm256_loadu_ps(dst + i)));
+    }
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t MonoToFloatAvx2(const int16_t *src, size_t frames, float *dst) {
+    size_t i = 0;
+    const __m256 scale = _mm256_set1_ps(kInt16ToFloat);
+    for (; i + 8 <= frames; i += 8) {
+        __m256i wide = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(wide), scale));
+    }
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t StereoToMonoFloatAvx2(const int16_t *src, size_t frames, float *dst) {
+    size_t i = 0;
+    // madd against ones sums each L/R pair into one int32 without overflow
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256 scale = _mm256_set1_ps(kInt16ToFloat * 0.5f);
+    for (; i + 8 <= frames; i += 8) {
+        __m256i pairs = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(src + i * 2)), ones);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(pairs), scale));
+    }
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t FloatToInt16Avx2(const float *src, size_t count, int16_t *dst) {
+    size_t i = 0;
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    const __m256 hi = _mm256_set1_ps(32767.0f);
+    const __m256 lo = _mm256_set1_ps(-32768.0f);
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale), hi), lo);
+        __m256 b = _mm256_max_ps(_mm256_min_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale), hi), lo);
+        // packs works per 128-bit lane, the permute restores sample order
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t AddSaturatingAvx2(const int16_t *src, size_t count, int16_t *dst) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i sum = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i *)(src + i)),
+                                        _mm256_loadu_si256((const __m256i *)(dst + i)));
+        _mm256_storeu_si256((__m256i *)(dst + i), sum);
+    }
+    return i;
+}
+
+ZOOM_BOT_AVX2_TARGET size_t AccumulateBytesAvx2(const uint8_t *src, size_t count, uint16_t *acc) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(acc + i)), lo));
+        _mm256_storeu_si256((__m256i *)(acc + i + 16),
+                            _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(acc + i + 16)), hi));
+    }
+    return i;
+}
+#endif
+
+inline int16_t SaturateToInt16(float sample) {
+    float scaled = sample * 32768.0f;
+    if (scaled >= 32767.0f) {
+        return 32767;
+    }
+    if (scaled <= -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(scaled);
+}
+
+} // namespace
+
+namespace SimdKernels {
+
+const char *InstructionSet() {
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    return UseAvx2() ? "AVX2+FMA" : "scalar";
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+float DotProduct(const float *a, const float *b, size_t count) {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = DotProductAvx2(a, b, count, sum);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= count; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+    for (; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void Multiply(const float *a, const float *b, size_t count, float *dst) {
+    size_t i = 0;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = MultiplyAvx2(a, b, count, dst);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = a[i] * b[i];
+    }
+}
+
+float PeakAbs(const float *src, size_t count) {
+    size_t i = 0;
+    float peak = 0.0f;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = PeakAbsAvx2(src, count, peak);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= count; i += 4) {
+        acc = vmaxq_f32(acc, vabsq_f32(vld1q_f32(src + i)));
+    }
+    float32x2_t pair = vmax_f32(vget_low_f32(acc), vget_high_f32(acc));
+    peak = vget_lane_f32(vpmax_f32(pair, pair), 0);
+#endif
+    for (; i < count; i++) {
+        peak = std::max(peak, fabsf(src[i]));
+    }
+    return peak;
+}
+
+void ApplyGainRamp(const float *src, size_t count, float gain, float step, float *dst) {
+    size_t i = 0;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = ApplyGainRampAvx2(src, count, gain, step, dst);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    const float offsetValues[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+    const float32x4_t offsets = vld1q_f32(offsetValues);
+    const float32x4_t base = vdupq_n_f32(gain);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t index = vaddq_f32(vdupq_n_f32((float)i), offsets);
+        float32x4_t gains = vmlaq_n_f32(base, index, step);
+        vst1q_f32(dst + i, vmulq_f32(vld1q_f32(src + i), gains));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = src[i] * (gain + step * i);
+    }
+}
+
+void SubtractScaled(const float *src, float scale, size_t count, float *dst) {
+    size_t i = 0;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = SubtractScaledAvx2(src, scale, count, dst);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmlsq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), scale));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] -= scale * src[i];
+    }
+}
+
+void DownmixToMonoFloat(const int16_t *src, size_t frames, unsigned int channels, float *dst) {
+    size_t i = 0;
+    if (channels <= 1) {
+#if defined(ZOOM_BOT_SIMD_AVX2)
+        if (UseAvx2()) {
+            i = MonoToFloatAvx2(src, frames, dst);
+        }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+        const float32x4_t scale = vdupq_n_f32(kInt16ToFloat);
+        for (; i + 8 <= frames; i += 8) {
+            int16x8_t v = vld1q_s16(src + i);
+            vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+            vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+        }
+#endif
+        for (; i < frames; i++) {
+            dst[i] = src[i] * kInt16ToFloat;
+        }
+        return;
+    }
+
+    if (channels == 2) {
+#if defined(ZOOM_BOT_SIMD_AVX2)
+        if (UseAvx2()) {
+            i = StereoToMonoFloatAvx2(src, frames, dst);
+        }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+        const float32x4_t scale = vdupq_n_f32(kInt16ToFloat * 0.5f);
+        for (; i + 8 <= frames; i += 8) {
+            int16x8x2_t lr = vld2q_s16(src + i * 2);
+            int32x4_t lo = vaddl_s16(vget_low_s16(lr.val[0]), vget_low_s16(lr.val[1]));
+            int32x4_t hi = vaddl_s16(vget_high_s16(lr.val[0]), vget_high_s16(lr.val[1]));
+            vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(lo), scale));
+            vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(hi), scale));
+        }
+#endif
+        for (; i < frames; i++) {
+            dst[i] = (src[i * 2] + src[i * 2 + 1]) * (kInt16ToFloat * 0.5f);
+        }
+        return;
+    }
+
+    const float scale = kInt16ToFloat / channels;
+    for (; i < frames; i++) {
+        int32_t sum = 0;
+        for (unsigned int c = 0; c < channels; c++) {
+            sum += src[i * channels + c];
+        }
+        dst[i] = sum * scale;
+    }
+}
+
+void FloatToInt16(const float *src, size_t count, int16_t *dst) {
+    size_t i = 0;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = FloatToInt16Avx2(src, count, dst);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON) && defined(__aarch64__)
+    const float32x4_t scale = vdupq_n_f32(32768.0f);
+    for (; i + 8 <= count; i += 8) {
+        int32x4_t a = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i), scale));
+        int32x4_t b = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), scale));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = SaturateToInt16(src[i]);
+    }
+}
+
+void AddSaturating(const int16_t *src, size_t count, int16_t *dst) {
+    size_t i = 0;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = AddSaturatingAvx2(src, count, dst);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(src + i), vld1q_s16(dst + i)));
+    }
+#endif
+    for (; i < count; i++) {
+        int sum = (int)src[i] + dst[i];
+        dst[i] = (int16_t)std::max(-32768, std::min(32767, sum));
+    }
+}
+
+void AccumulateBytes(const uint8_t *src, size_t count, uint16_t *acc) {
+    size_t i = 0;
+#if defined(ZOOM_BOT_SIMD_AVX2)
+    if (UseAvx2()) {
+        i = AccumulateBytesAvx2(src, count, acc);
+    }
+#elif defined(ZOOM_BOT_SIMD_NEON)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t bytes = vld1q_u8(src + i);
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(bytes)));
+        vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(bytes)));
+    }
+#endif
+    for (; i < count; i++) {
+        acc[i] = (uint16_t)(acc[i] + src[i]);
+    }
+}
+
+void ScalePlaneBox(const uint8_t *src, unsigned int srcWidth, unsigned int srcHeight, size_t srcStride, uint8_t *dst,
+                   size_t dstStride, unsigned int dstWidth, unsigned int dstHeight, uint16_t *rowSums,
+                   uint32_t *columns) {
+    for (unsigned int x = 0; x <= dstWidth; x++) {
+        columns[x] = (uint32_t)((unsigned long long)x * srcWidth / dstWidth);
+    }
+    for (unsigned int y = 0; y < dstHeight; y++) {
+        // the source rows of this output row are summed with the kernel above, then every
+        // output column adds up its span of the sums
+        unsigned int y0 = (unsigned int)((unsigned long long)y * srcHeight / dstHeight);
+        unsigned int y1 = (unsigned int)((unsigned long long)(y + 1) * srcHeight / dstHeight);
+        y1 = std::min(std::max(y1, y0 + 1), y0 + kMaxBoxRows);
+        memset(rowSums, 0, srcWidth * sizeof(uint16_t));
+        for (unsigned int row = y0; row < y1; row++) {
+            AccumulateBytes(src + row * srcStride, srcWidth, rowSums);
+        }
+
+        uint8_t *out = dst + y * dstStride;
+        uint32_t lastArea = 0;
+        uint32_t reciprocal = 0;
+        for (unsigned int x = 0; x < dstWidth; x++) {
+            uint32_t x0 = columns[x];
+            uint32_t x1 = std::max(columns[x + 1], x0 + 1);
+            uint32_t sum = 0;
+            for (uint32_t column = x0; column < x1; column++) {
+                sum += rowSums[column];
+            }
+            // divide by multiplying with a 24-bit reciprocal; spans take one or two widths
+            uint32_t area = (y1 - y0) * (x1 - x0);
+            if (area != lastArea) {
+                lastArea = area;
+                reciprocal = ((1u << 24) + area / 2) / area;
+            }
+            out[x] = (uint8_t)std::min<unsigned long long>(255, ((unsigned long long)sum * reciprocal + (1u << 23)) >> 24);
+        }
+    }
+}
+
+} // namespace SimdKernels
@@ -0,0 +1,59 @@
+// Vectorized kernels shared by the audio and video pipelines
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// On x86-64 the AVX2/FMA kernels are built alongside the scalar ones and chosen at run time,
+// so one binary runs on any x86-64 host; ZOOM_BOT_ENABLE_AVX2=OFF in CMakeLists.txt leaves them
+// out. NEON is always present on aarch64. Every kernel has a scalar fallback.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(ZOOM_BOT_DISABLE_AVX2)
+#define ZOOM_BOT_SIMD_AVX2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ZOOM_BOT_SIMD_NEON 1
+#endif
+
+namespace SimdKernels {
+
+/// \brief Name of the instruction set the kernels were compiled for, used for startup logging.
+const char *InstructionSet();
+
+/// \brief Dot product of two float vectors.
+/// \param count Number of elements; any length is accepted, multiples of 8 take the fast path only.
+float DotProduct(const float *a, const float *b, size_t count);
+
+/// \brief Element-wise product dst[i] = a[i] * b[i], e.g. to apply an analysis window.
+void Multiply(const float *a, const float *b, size_t count, float *dst);
+
+/// \brief Largest absolute value of a float vector, 0 for an empty one.
+float PeakAbs(const float *src, size_t count);
+
+/// \brief Apply a linearly changing gain: dst[i] = src[i] * (gain + step * i). src and dst may
+/// be the same buffer.
+void ApplyGainRamp(const float *src, size_t count, float gain, float step, float *dst);
+
+/// \brief dst[i] -= scale * src[i], e.g. to subtract an aligned, scaled reference.
+void SubtractScaled(const float *src, float scale, size_t count, float *dst);
+
+/// \brief Convert interleaved int16 PCM to mono float in [-1, 1), averaging all channels.
+/// \param frames Number of sample frames (samples per channel) in src.
+void DownmixToMonoFloat(const int16_t *src, size_t frames, unsigned int channels, float *dst);
+
+/// \brief Convert float samples in [-1, 1) to int16 PCM with saturation.
+void FloatToInt16(const float *src, size_t count, int16_t *dst);
+
+/// \brief Mix int16 PCM into dst: dst[i] = src[i] + dst[i], clipped to the int16 range.
+void AddSaturating(const int16_t *src, size_t count, int16_t *dst);
+
+/// \brief Widen a row of bytes and add it to acc: acc[i] += src[i], e.g. to sum the rows of a
+/// box filter. The caller keeps the sums within uint16, at most 257 rows of 255.
+void AccumulateBytes(const uint8_t *src, size_t count, uint16_t *acc);
+
+/// \brief Box-filter an 8-bit plane of srcWidth x srcHeight, rows srcStride apart, into dst.
+/// Each output pixel averages the source pixels it covers, at least one, so enlarging repeats
+/// pixels. rowSums (srcWidth values) and columns (dstWidth + 1) are scratch of the caller.
+void ScalePlaneBox(const uint8_t *src, unsigned int srcWidth, unsigned int srcHeight, size_t srcStride, uint8_t *dst,
+                   size_t dstStride, unsigned int dstWidth, unsigned int dstHeight, uint16_t *rowSums,
+                   uint32_t *columns);
+
+} // namespace SimdKernels
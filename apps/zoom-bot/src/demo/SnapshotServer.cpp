@@ -0,0 +1,270 @@
+// Serves participant thumbnails over HTTP on a unix socket
+
+#include "SnapshotServer.h"
+#include "BotEventChannel.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <glib-unix.h>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+long long SteadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string Header(const char *status, const char *contentType, size_t length) {
+    char header[192];
+    snprintf(header, sizeof(header),
+             "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nCache-Control: no-store\r\n"
+             "Connection: close\r\n\r\n",
+             status, contentType, length);
+    return header;
+}
+
+std::string TextResponse(const char *status) {
+    std::string body = std::string(status) + "\n";
+    return Header(status, "text/plain", body.size()) + body;
+}
+
+} // namespace
+
+SnapshotServer::SnapshotServer(SnapshotStore &store, const ParticipantRoster &roster)
+    : store_(store), roster_(roster), listenFd_(-1), listenSource_(0), sweepSource_(0), requests_(0), notFound_(0) {}
+
+SnapshotServer::~SnapshotServer() {
+    Stop();
+}
+
+bool SnapshotServer::Start(const std::string &socketPath) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "SnapshotServer: socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(socketPath.c_str());
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        std::cerr << "SnapshotServer: cannot listen on " << socketPath << ": " << strerror(errno) << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    socketPath_ = socketPath;
+    listenFd_ = fd;
+    listenSource_ = g_unix_fd_add(fd, G_IO_IN, &SnapshotServer::HandleAccept, this);
+    sweepSource_ = g_timeout_add(1000, &SnapshotServer::HandleSweep, this);
+    Metrics::Instance().AddCollector(&SnapshotServer::CollectMetrics, this);
+    std::cout << "SnapshotServer: serving thumbnails on " << socketPath << std::endl;
+    return true;
+}
+
+void SnapshotServer::Stop() {
+    if (listenFd_ < 0) {
+        return;
+    }
+    Metrics::Instance().RemoveCollector(this);
+    while (!clients_.empty()) {
+        Close(clients_.front());
+    }
+    g_source_remove(listenSource_);
+    listenSource_ = 0;
+    g_source_remove(sweepSource_);
+    sweepSource_ = 0;
+    close(listenFd_);
+    listenFd_ = -1;
+    unlink(socketPath_.c_str());
+}
+
+gboolean SnapshotServer::HandleAccept(gint fd, GIOCondition, gpointer data) {
+    SnapshotServer *self = static_cast<SnapshotServer *>(data);
+    while (true) {
+        int clientFd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientFd < 0) {
+            break;
+        }
+        if (self->clients_.size() >= kMaxClients) {
+            close(clientFd);
+            continue;
+        }
+        self->clients_.push_back(Client());
+        Client &client = self->clients_.back();
+        client.server = self;
+        client.fd = clientFd;
+        client.sent = 0;
+        client.acceptedAtMs = SteadyNowMs();
+        client.source = g_unix_fd_add(clientFd, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR),
+                                      &SnapshotServer::HandleClient, &client);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean SnapshotServer::HandleClient(gint fd, GIOCondition, gpointer data) {
+    Client &client = *static_cast<Client *>(data);
+    SnapshotServer *self = client.server;
+    if (!client.response.empty()) {
+        if (self->Flush(client)) {
+            return G_SOURCE_CONTINUE;
+        }
+        client.source = 0;
+        self->Close(client);
+        return G_SOURCE_REMOVE;
+    }
+
+    char buffer[1024];
+    ssize_t received = read(fd, buffer, sizeof(buffer));
+    if (received < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return G_SOURCE_CONTINUE;
+    }
+    if (received <= 0) {
+        client.source = 0;
+        self->Close(client);
+        return G_SOURCE_REMOVE;
+    }
+    client.request.append(buffer, (size_t)received);
+    if (client.request.find("\r\n\r\n") == std::string::npos && client.request.find("\n\n") == std::string::npos) {
+        if (client.request.size() < kMaxRequestBytes) {
+            return G_SOURCE_CONTINUE;
+        }
+        client.response = TextResponse("431 Request Header Fields Too Large");
+    } else {
+        self->Respond(client);
+    }
+    if (self->Flush(client)) {
+        // the rest goes out as the socket drains; this source is replaced by one for writing
+        guint source = g_unix_fd_add(fd, (GIOCondition)(G_IO_OUT | G_IO_HUP | G_IO_ERR),
+                                     &SnapshotServer::HandleClient, &client);
+        client.source = source;
+        return G_SOURCE_REMOVE;
+    }
+    client.source = 0;
+    self->Close(client);
+    return G_SOURCE_REMOVE;
+}
+
+gboolean SnapshotServer::HandleSweep(gpointer data) {
+    SnapshotServer *self = static_cast<SnapshotServer *>(data);
+    long long nowMs = SteadyNowMs();
+    for (std::list<Client>::iterator it = self->clients_.begin(); it != self->clients_.end();) {
+        Client &client = *it++;
+        long long timeoutMs = client.response.empty() ? kRequestTimeoutMs : kConnectionTimeoutMs;
+        if (nowMs - client.acceptedAtMs >= timeoutMs) {
+            self->Close(client);
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+void SnapshotServer::Respond(Client &client) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    size_t lineEnd = client.request.find_first_of("\r\n");
+    std::string line = client.request.substr(0, lineEnd);
+    size_t methodEnd = line.find(' ');
+    size_t pathEnd = methodEnd == std::string::npos ? std::string::npos : line.find(' ', methodEnd + 1);
+    if (methodEnd == std::string::npos) {
+        client.response = TextResponse("400 Bad Request");
+        return;
+    }
+    std::string method = line.substr(0, methodEnd);
+    std::string path = line.substr(methodEnd + 1, pathEnd == std::string::npos ? std::string::npos
+                                                                                : pathEnd - methodEnd - 1);
+    if (method != "GET") {
+        client.response = TextResponse("405 Method Not Allowed");
+        return;
+    }
+
+    if (path == "/snapshots" || path == "/snapshots/") {
+        std::string body = ListSnapshots();
+        client.response = Header("200 OK", "application/json", body.size()) + body;
+        return;
+    }
+    const char *prefix = "/snapshots/";
+    const char *suffix = ".jpg";
+    size_t prefixLength = strlen(prefix);
+    if (path.size() > prefixLength + strlen(suffix) && path.compare(0, prefixLength, prefix) == 0 &&
+        path.compare(path.size() - strlen(suffix), std::string::npos, suffix) == 0) {
+        std::string id = path.substr(prefixLength, path.size() - prefixLength - strlen(suffix));
+        char *end = nullptr;
+        unsigned long userId = strtoul(id.c_str(), &end, 10);
+        std::vector<uint8_t> jpeg;
+        SnapshotInfo info;
+        if (end && *end == '\0' && userId <= 0xFFFFFFFFul && store_.Latest((uint32_t)userId, jpeg, info)) {
+            client.response = Header("200 OK", "image/jpeg", jpeg.size());
+            client.response.append((const char *)jpeg.data(), jpeg.size());
+            return;
+        }
+    }
+    notFound_.fetch_add(1, std::memory_order_relaxed);
+    client.response = TextResponse("404 Not Found");
+}
+
+std::string SnapshotServer::ListSnapshots() {
+    std::vector<SnapshotInfo> snapshots = store_.List();
+    std::shared_ptr<const RosterSnapshot> roster = roster_.Snapshot();
+    std::string body = "[";
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        const SnapshotInfo &snapshot = snapshots[i];
+        const Participant *participant = roster->Find(snapshot.userId);
+        char fields[192];
+        snprintf(fields, sizeof(fields),
+                 "%s{\"user_id\":%u,\"url\":\"/snapshots/%u.jpg\",\"timestamp_ms\":%llu,\"width\":%u,\"height\":%u,"
+                 "\"bytes\":%zu,\"name\":",
+                 i ? "," : "", snapshot.userId, snapshot.userId, snapshot.timestampMs, snapshot.width,
+                 snapshot.height, snapshot.bytes);
+        body += fields;
+        if (participant) {
+            AppendJsonString(body, participant->name);
+        } else {
+            // left the meeting since
+            body += "null";
+        }
+        body += "}";
+    }
+    body += "]\n";
+    return body;
+}
+
+bool SnapshotServer::Flush(Client &client) {
+    while (client.sent < client.response.size()) {
+        ssize_t written = send(client.fd, client.response.data() + client.sent, client.response.size() - client.sent,
+                               MSG_NOSIGNAL);
+        if (written < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        client.sent += (size_t)written;
+    }
+    return false;
+}
+
+void SnapshotServer::Close(Client &client) {
+    // the client's own handler clears source before it returns G_SOURCE_REMOVE
+    if (client.source != 0) {
+        g_source_remove(client.source);
+    }
+    close(client.fd);
+    for (std::list<Client>::iterator it = clients_.begin(); it != clients_.end(); ++it) {
+        if (&*it == &client) {
+            clients_.erase(it);
+            break;
+        }
+    }
+}
+
+void SnapshotServer::CollectMetrics(MetricsWriter &writer, void *context) {
+    SnapshotServer *self = static_cast<SnapshotServer *>(context);
+    writer.Write("zoom_bot_snapshot_requests_total", self->requests_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_snapshot_not_found_total", self->notFound_.load(std::memory_order_relaxed));
+}
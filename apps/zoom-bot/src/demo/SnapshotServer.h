@@ -0,0 +1,73 @@
+// Serves participant thumbnails over HTTP on a unix socket
+#pragma once
+
+#include <atomic>
+#include <glib.h>
+#include <list>
+#include <string>
+
+#include "Metrics.h"
+#include "ParticipantRoster.h"
+#include "SnapshotStore.h"
+
+// A minimal HTTP/1.0 server for the thumbnails of a SnapshotStore, run on the main loop:
+//
+//   GET /snapshots            JSON list of the thumbnails held, with participant names
+//   GET /snapshots/<id>.jpg   latest thumbnail of user id
+//
+// It listens on a unix socket rather than a TCP port, so only what can reach the recording
+// directory can see the meeting, e.g.
+// curl --unix-socket recording/<meeting>/snapshots.sock http://localhost/snapshots
+// Every response closes its connection. Sockets are non-blocking and a slow client only
+// holds its own connection: one that has not sent its request within kRequestTimeoutMs, or
+// not taken its response within kConnectionTimeoutMs, is closed so it cannot keep others out.
+class SnapshotServer {
+public:
+    SnapshotServer(SnapshotStore &store, const ParticipantRoster &roster);
+    ~SnapshotServer();
+
+    /// \brief Listen on socketPath, replacing a stale socket there.
+    bool Start(const std::string &socketPath);
+
+    /// \brief Close the socket and every connection.
+    void Stop();
+
+private:
+    struct Client {
+        SnapshotServer *server;
+        int fd;
+        guint source;
+        std::string request;
+        std::string response;
+        size_t sent;
+        // steady time of the accept
+        long long acceptedAtMs;
+    };
+
+    static const size_t kMaxClients = 16;
+    static const size_t kMaxRequestBytes = 4096;
+    static const long long kRequestTimeoutMs = 5000;
+    static const long long kConnectionTimeoutMs = 30000;
+
+    static gboolean HandleAccept(gint fd, GIOCondition condition, gpointer data);
+    static gboolean HandleClient(gint fd, GIOCondition condition, gpointer data);
+    static gboolean HandleSweep(gpointer data);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    void Respond(Client &client);
+    std::string ListSnapshots();
+    // false once the client has been sent everything or is gone
+    bool Flush(Client &client);
+    void Close(Client &client);
+
+    SnapshotStore &store_;
+    const ParticipantRoster &roster_;
+    std::string socketPath_;
+    int listenFd_;
+    guint listenSource_;
+    guint sweepSource_;
+    std::list<Client> clients_;
+
+    std::atomic<unsigned long long> requests_;
+    std::atomic<unsigned long long> notFound_;
+};
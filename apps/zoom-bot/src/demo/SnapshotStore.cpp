@@ -0,0 +1,279 @@
+// Periodic JPEG thumbnails of participant video, kept in a small LRU
+
+#include "SnapshotStore.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <jpeglib.h>
+
+namespace {
+
+long long SteadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// libjpeg reports errors through error_exit, which must not return; the default one exits
+// the process
+struct JpegError {
+    jpeg_error_mgr manager;
+    jmp_buf jump;
+};
+
+void JpegErrorExit(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<JpegError *>(cinfo->err)->jump, 1);
+}
+
+// writes into a vector that is kept from one encode to the next, so a steady stream of
+// thumbnails does not allocate
+struct VectorDestination {
+    jpeg_destination_mgr manager;
+    std::vector<uint8_t> *out;
+};
+
+void InitDestination(j_compress_ptr cinfo) {
+    VectorDestination *destination = reinterpret_cast<VectorDestination *>(cinfo->dest);
+    destination->out->resize(std::max<size_t>(destination->out->capacity(), 16384));
+    destination->manager.next_output_byte = destination->out->data();
+    destination->manager.free_in_buffer = destination->out->size();
+}
+
+boolean GrowDestination(j_compress_ptr cinfo) {
+    VectorDestination *destination = reinterpret_cast<VectorDestination *>(cinfo->dest);
+    size_t used = destination->out->size();
+    destination->out->resize(used * 2);
+    destination->manager.next_output_byte = destination->out->data() + used;
+    destination->manager.free_in_buffer = destination->out->size() - used;
+    return TRUE;
+}
+
+void TermDestination(j_compress_ptr cinfo) {
+    VectorDestination *destination = reinterpret_cast<VectorDestination *>(cinfo->dest);
+    destination->out->resize(destination->out->size() - destination->manager.free_in_buffer);
+}
+
+// Encode an I420 image as a 4:2:0 JPEG. The planes go in as raw data, so libjpeg does no
+// colour conversion or downsampling; width must be a multiple of 16.
+bool EncodeJpeg(const uint8_t *image, unsigned int width, unsigned int height, int quality,
+                std::vector<uint8_t> &out) {
+    jpeg_compress_struct cinfo;
+    JpegError error;
+    cinfo.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = JpegErrorExit;
+    if (setjmp(error.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+    jpeg_create_compress(&cinfo);
+    VectorDestination destination;
+    destination.manager.init_destination = InitDestination;
+    destination.manager.empty_output_buffer = GrowDestination;
+    destination.manager.term_destination = TermDestination;
+    destination.out = &out;
+    cinfo.dest = &destination.manager;
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_YCbCr;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_colorspace(&cinfo, JCS_YCbCr);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    cinfo.raw_data_in = TRUE;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.comp_info[0].h_samp_factor = 2;
+    cinfo.comp_info[0].v_samp_factor = 2;
+    for (int c = 1; c < 3; c++) {
+        cinfo.comp_info[c].h_samp_factor = 1;
+        cinfo.comp_info[c].v_samp_factor = 1;
+    }
+    jpeg_start_compress(&cinfo, TRUE);
+
+    // one iMCU row per call: 16 luma rows and 8 of each chroma plane; the last one repeats
+    // the bottom row of the image
+    const uint8_t *y = image;
+    const uint8_t *u = y + (size_t)width * height;
+    const uint8_t *v = u + (size_t)width * height / 4;
+    JSAMPROW yRows[16];
+    JSAMPROW uRows[8];
+    JSAMPROW vRows[8];
+    JSAMPARRAY planes[3] = {yRows, uRows, vRows};
+    while (cinfo.next_scanline < cinfo.image_height) {
+        unsigned int row = cinfo.next_scanline;
+        for (unsigned int i = 0; i < 16; i++) {
+            yRows[i] = (JSAMPROW)(y + (size_t)std::min(row + i, height - 1) * width);
+        }
+        for (unsigned int i = 0; i < 8; i++) {
+            size_t offset = (size_t)std::min(row / 2 + i, height / 2 - 1) * (width / 2);
+            uRows[i] = (JSAMPROW)(u + offset);
+            vRows[i] = (JSAMPROW)(v + offset);
+        }
+        jpeg_write_raw_data(&cinfo, planes, 16);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+} // namespace
+
+SnapshotStore::SnapshotStore(unsigned int intervalMs, size_t capacity, unsigned int width, unsigned int quality)
+    : intervalMs_(intervalMs), width_(std::max(width & ~15u, 16u)), quality_(std::min(std::max(quality, 1u), 100u)),
+      useCounter_(0), encoded_(0), failed_(0), maxEncodeUs_(0) {
+    for (int level = 0; level < 256; level++) {
+        lumaLevels_[level] = (uint8_t)std::min(255, std::max(0, ((level - 16) * 255 + 109) / 219));
+        chromaLevels_[level] = (uint8_t)std::min(255, std::max(0, 128 + ((level - 128) * 255) / 224));
+    }
+    if (intervalMs_ == 0) {
+        return;
+    }
+    entries_.resize(std::max<size_t>(capacity, 1));
+    for (size_t i = 0; i < entries_.size(); i++) {
+        entries_[i].info.userId = 0;
+    }
+    Metrics::Instance().AddCollector(&SnapshotStore::CollectMetrics, this);
+}
+
+SnapshotStore::~SnapshotStore() {
+    if (intervalMs_ > 0) {
+        Metrics::Instance().RemoveCollector(this);
+    }
+}
+
+SnapshotStore::Entry *SnapshotStore::Find(uint32_t userId) {
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (entries_[i].info.userId == userId) {
+            return &entries_[i];
+        }
+    }
+    return nullptr;
+}
+
+void SnapshotStore::Offer(uint32_t userId, YUVRawDataI420 *frame) {
+    if (intervalMs_ == 0 || userId == 0 || !frame) {
+        return;
+    }
+    long long nowMs = SteadyNowMs();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry *entry = Find(userId);
+        if (entry && nowMs - entry->takenAtMs < (long long)intervalMs_) {
+            return;
+        }
+    }
+    std::unique_lock<std::mutex> encoding(encodeMutex_, std::try_to_lock);
+    if (!encoding.owns_lock()) {
+        return;
+    }
+
+    unsigned int frameWidth = frame->GetStreamWidth();
+    unsigned int frameHeight = frame->GetStreamHeight();
+    if (!frame->GetYBuffer() || !frame->GetUBuffer() || !frame->GetVBuffer() || frameWidth < 16 || frameHeight < 2) {
+        return;
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    // never enlarged; a multiple of 16 wide for the encoder
+    unsigned int width = std::min(width_, frameWidth) & ~15u;
+    unsigned int height = std::max((unsigned int)((unsigned long long)frameHeight * width / frameWidth) & ~1u, 2u);
+    size_t ySize = (size_t)width * height;
+    thumbnail_.resize(ySize * 3 / 2);
+    rowSums_.resize(std::max<size_t>(rowSums_.size(), frameWidth));
+    columns_.resize(std::max<size_t>(columns_.size(), width + 1));
+    SimdKernels::ScalePlaneBox((const uint8_t *)frame->GetYBuffer(), frameWidth, frameHeight, frameWidth,
+                               thumbnail_.data(), width, width, height, rowSums_.data(), columns_.data());
+    SimdKernels::ScalePlaneBox((const uint8_t *)frame->GetUBuffer(), frameWidth / 2, frameHeight / 2, frameWidth / 2,
+                               thumbnail_.data() + ySize, width / 2, width / 2, height / 2, rowSums_.data(),
+                               columns_.data());
+    SimdKernels::ScalePlaneBox((const uint8_t *)frame->GetVBuffer(), frameWidth / 2, frameHeight / 2, frameWidth / 2,
+                               thumbnail_.data() + ySize + ySize / 4, width / 2, width / 2, height / 2,
+                               rowSums_.data(), columns_.data());
+    if (frame->IsLimitedI420()) {
+        for (size_t i = 0; i < ySize; i++) {
+            thumbnail_[i] = lumaLevels_[thumbnail_[i]];
+        }
+        for (size_t i = ySize; i < thumbnail_.size(); i++) {
+            thumbnail_[i] = chromaLevels_[thumbnail_[i]];
+        }
+    }
+    if (!EncodeJpeg(thumbnail_.data(), width, height, (int)quality_, output_)) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry *entry = Find(userId);
+        if (!entry) {
+            // a free entry has never been used, so it is also the least recently used
+            entry = &entries_[0];
+            for (size_t i = 1; i < entries_.size(); i++) {
+                if (entries_[i].info.userId == 0 || entries_[i].lastUsed < entry->lastUsed) {
+                    entry = &entries_[i];
+                    if (entry->info.userId == 0) {
+                        break;
+                    }
+                }
+            }
+        }
+        entry->info.userId = userId;
+        entry->info.timestampMs = frame->GetTimeStamp();
+        entry->info.width = width;
+        entry->info.height = height;
+        entry->info.bytes = output_.size();
+        entry->takenAtMs = nowMs;
+        entry->lastUsed = ++useCounter_;
+        entry->jpeg.swap(output_);
+    }
+    encoded_.fetch_add(1, std::memory_order_relaxed);
+    unsigned long long encodeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - begin)
+                                      .count();
+    if (encodeUs > maxEncodeUs_.load(std::memory_order_relaxed)) {
+        maxEncodeUs_.store(encodeUs, std::memory_order_relaxed);
+    }
+}
+
+bool SnapshotStore::Latest(uint32_t userId, std::vector<uint8_t> &jpeg, SnapshotInfo &info) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry *entry = userId ? Find(userId) : nullptr;
+    if (!entry) {
+        return false;
+    }
+    entry->lastUsed = ++useCounter_;
+    jpeg = entry->jpeg;
+    info = entry->info;
+    return true;
+}
+
+std::vector<SnapshotInfo> SnapshotStore::List() const {
+    std::vector<std::pair<unsigned long long, SnapshotInfo>> held;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].info.userId != 0) {
+                held.push_back(std::make_pair(entries_[i].lastUsed, entries_[i].info));
+            }
+        }
+    }
+    std::sort(held.begin(), held.end(),
+              [](const std::pair<unsigned long long, SnapshotInfo> &a,
+                 const std::pair<unsigned long long, SnapshotInfo> &b) { return a.first > b.first; });
+    std::vector<SnapshotInfo> list;
+    for (size_t i = 0; i < held.size(); i++) {
+        list.push_back(held[i].second);
+    }
+    return list;
+}
+
+void SnapshotStore::CollectMetrics(MetricsWriter &writer, void *context) {
+    SnapshotStore *self = static_cast<SnapshotStore *>(context);
+    writer.Write("zoom_bot_snapshots_encoded_total", self->encoded_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_snapshot_encode_failures_total", self->failed_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_snapshot_encode_max_us", self->maxEncodeUs_.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,93 @@
+// Periodic JPEG thumbnails of participant video, kept in a small LRU
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "zoom_sdk_raw_data_def.h"
+
+#include "Metrics.h"
+
+// What a snapshot is, without its JPEG.
+struct SnapshotInfo {
+    uint32_t userId;
+    // SDK timestamp of the frame
+    unsigned long long timestampMs;
+    unsigned int width;
+    unsigned int height;
+    size_t bytes;
+};
+
+// The snapshot stage of the renderers. Every intervalMs per participant, Offer box-filters a
+// frame down to a thumbnail of width pixels and encodes it to JPEG with libjpeg(-turbo),
+// straight from the I420 planes. The latest thumbnail of each participant is kept in a table
+// of capacity entries; when a new participant needs one, the entry used longest ago is
+// evicted. A thumbnail is a few KB where the raw frames are megabytes per second.
+//
+// Offer is for renderer threads. One frame is encoded at a time; a renderer that finds the
+// encoder busy skips its frame instead of waiting and offers the next one. Latest and List
+// are for any thread, usually the main loop serving them.
+class SnapshotStore {
+public:
+    /// \param intervalMs Time between thumbnails of one participant, 0 to disable the store.
+    /// \param width Thumbnail width, rounded down to a multiple of 16; height keeps the aspect.
+    /// \param quality JPEG quality, 1 to 100.
+    SnapshotStore(unsigned int intervalMs, size_t capacity, unsigned int width, unsigned int quality);
+    ~SnapshotStore();
+
+    bool Enabled() const { return intervalMs_ > 0; }
+
+    /// \brief Encode frame as userId's thumbnail if their latest is intervalMs old.
+    void Offer(uint32_t userId, YUVRawDataI420 *frame);
+
+    /// \brief Copy out userId's latest thumbnail and count it as used.
+    /// \return false if there is none.
+    bool Latest(uint32_t userId, std::vector<uint8_t> &jpeg, SnapshotInfo &info);
+
+    /// \brief Every thumbnail held, most recently used first.
+    std::vector<SnapshotInfo> List() const;
+
+    unsigned long long Encoded() const { return encoded_.load(std::memory_order_relaxed); }
+    /// \brief Longest time one thumbnail took to scale and encode so far.
+    unsigned long long MaxEncodeUs() const { return maxEncodeUs_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        SnapshotInfo info;
+        // steady time the thumbnail was taken
+        long long takenAtMs;
+        // order of the last use, for eviction
+        unsigned long long lastUsed;
+        std::vector<uint8_t> jpeg;
+    };
+
+    Entry *Find(uint32_t userId);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    unsigned int intervalMs_;
+    unsigned int width_;
+    unsigned int quality_;
+
+    // the table; an entry with userId 0 is free
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    unsigned long long useCounter_;
+
+    // held while one frame is scaled and encoded into the buffers below
+    std::mutex encodeMutex_;
+    std::vector<uint8_t> thumbnail_;
+    std::vector<uint16_t> rowSums_;
+    std::vector<uint32_t> columns_;
+    // swapped into the entry, which hands its previous buffer back for the next encode
+    std::vector<uint8_t> output_;
+    // limited-range video levels to the full range JPEG expects
+    uint8_t lumaLevels_[256];
+    uint8_t chromaLevels_[256];
+
+    std::atomic<unsigned long long> encoded_;
+    std::atomic<unsigned long long> failed_;
+    std::atomic<unsigned long long> maxEncodeUs_;
+};
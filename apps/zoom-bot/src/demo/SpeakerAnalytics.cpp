@@ -0,0 +1,180 @@
+// Who spoke when: talk time, overlaps and turn-taking from the per-participant VAD
+
+#include "SpeakerAnalytics.h"
+#include "AudioResampler.h"
+
+#include <cstring>
+#include <string>
+
+SpeakerAnalytics::SpeakerAnalytics(size_t maxSpeakers)
+    : capacity_(16), count_(0), haveFloor_(false), floorHolder_(0), speakerChanges_(0), totalResponseGapMs_(0),
+      droppedSpeakers_(0) {
+    while (capacity_ < maxSpeakers) {
+        capacity_ <<= 1;
+    }
+    speakers_.reset(new Speaker[capacity_]);
+    used_.reset(new uint32_t[capacity_]);
+    for (size_t i = 0; i < capacity_; i++) {
+        speakers_[i].inUse = false;
+    }
+    Metrics::Instance().AddCollector(&SpeakerAnalytics::CollectMetrics, this);
+}
+
+SpeakerAnalytics::~SpeakerAnalytics() {
+    Metrics::Instance().RemoveCollector(this);
+}
+
+SpeakerAnalytics::Speaker *SpeakerAnalytics::FindOrInsert(uint32_t speakerId) {
+    // open addressing with linear probing, as the audio pipeline's stream table
+    const size_t mask = capacity_ - 1;
+    size_t slot = (speakerId * 2654435761u) & mask;
+    for (size_t probe = 0; probe < capacity_; probe++) {
+        Speaker &speaker = speakers_[slot];
+        if (!speaker.inUse) {
+            if ((count_ + 1) * 4 > capacity_ * 3) {
+                return nullptr;
+            }
+            memset(&speaker, 0, sizeof(speaker));
+            speaker.inUse = true;
+            speaker.id = speakerId;
+            used_[count_++] = (uint32_t)slot;
+            return &speaker;
+        }
+        if (speaker.id == speakerId) {
+            return &speaker;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return nullptr;
+}
+
+void SpeakerAnalytics::CloseSegment(Speaker &speaker) {
+    unsigned long long lengthMs = speaker.lastVoicedEndMs - speaker.segmentStartMs;
+    speaker.speaking = false;
+    speaker.talkMs += lengthMs;
+    if (lengthMs > speaker.longestSegmentMs) {
+        speaker.longestSegmentMs = lengthMs;
+    }
+}
+
+unsigned long long SpeakerAnalytics::TalkMs(const Speaker &speaker) {
+    return speaker.talkMs + (speaker.speaking ? speaker.lastVoicedEndMs - speaker.segmentStartMs : 0);
+}
+
+void SpeakerAnalytics::Update(uint32_t speakerId, unsigned long long timestampMs, size_t samples, bool speech,
+                              bool voiced) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Speaker *speaker = FindOrInsert(speakerId);
+    if (!speaker) {
+        droppedSpeakers_++;
+        return;
+    }
+
+    if (!speech) {
+        if (speaker->speaking) {
+            CloseSegment(*speaker);
+        }
+        return;
+    }
+    if (!speaker->speaking) {
+        speaker->speaking = true;
+        speaker->interrupting = false;
+        speaker->segmentStartMs = timestampMs;
+        speaker->lastVoicedEndMs = timestampMs;
+        speaker->segments++;
+    }
+    if (!voiced) {
+        return;
+    }
+    speaker->lastVoicedEndMs = timestampMs + samples * 1000 / kAsrSampleRate;
+
+    bool overlapped = false;
+    bool concurrent = false;
+    for (size_t i = 0; i < count_; i++) {
+        Speaker &other = speakers_[used_[i]];
+        if (&other == speaker || !other.speaking || other.segmentStartMs > timestampMs ||
+            other.lastVoicedEndMs + kActiveSlackMs <= timestampMs) {
+            continue;
+        }
+        overlapped = true;
+        // the slack only keeps a handoff from taking the floor early; overlap needs the other
+        // speaker voiced up to this slice
+        if (other.lastVoicedEndMs >= timestampMs) {
+            concurrent = true;
+        }
+        // whoever started later talked over the other, once both kept going long enough
+        Speaker &later = other.segmentStartMs > speaker->segmentStartMs ? other : *speaker;
+        Speaker &earlier = &later == speaker ? other : *speaker;
+        if (!later.interrupting && timestampMs >= later.segmentStartMs + kMinOverlapMs) {
+            later.interrupting = true;
+            later.interruptions++;
+            earlier.interrupted++;
+        }
+    }
+    if (concurrent) {
+        speaker->overlapSamples += samples;
+    }
+    if (overlapped) {
+        return;
+    }
+
+    size_t slot = (size_t)(speaker - speakers_.get());
+    if (!haveFloor_) {
+        haveFloor_ = true;
+        floorHolder_ = slot;
+    } else if (floorHolder_ != slot && timestampMs >= speaker->segmentStartMs + kMinTurnMs) {
+        const Speaker &holder = speakers_[floorHolder_];
+        speakerChanges_++;
+        if (speaker->segmentStartMs > holder.lastVoicedEndMs) {
+            totalResponseGapMs_ += speaker->segmentStartMs - holder.lastVoicedEndMs;
+        }
+        floorHolder_ = slot;
+    }
+}
+
+size_t SpeakerAnalytics::Snapshot(SpeakerStats *speakers, size_t maxSpeakers, ConversationStats &conversation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memset(&conversation, 0, sizeof(conversation));
+    size_t written = 0;
+    for (size_t i = 0; i < count_; i++) {
+        const Speaker &speaker = speakers_[used_[i]];
+        unsigned long long talkMs = TalkMs(speaker);
+        conversation.talkMs += talkMs;
+        conversation.interruptions += speaker.interruptions;
+        if (written == maxSpeakers) {
+            continue;
+        }
+        SpeakerStats &stats = speakers[written++];
+        stats.speakerId = speaker.id;
+        stats.speaking = speaker.speaking;
+        stats.talkMs = talkMs;
+        stats.segments = speaker.segments;
+        stats.longestSegmentMs = speaker.longestSegmentMs;
+        // the open segment counts as long as it is so far
+        if (speaker.speaking && speaker.lastVoicedEndMs - speaker.segmentStartMs > stats.longestSegmentMs) {
+            stats.longestSegmentMs = speaker.lastVoicedEndMs - speaker.segmentStartMs;
+        }
+        stats.overlapMs = speaker.overlapSamples * 1000 / kAsrSampleRate;
+        stats.interruptions = speaker.interruptions;
+        stats.interrupted = speaker.interrupted;
+    }
+    conversation.speakerChanges = speakerChanges_;
+    conversation.totalResponseGapMs = totalResponseGapMs_;
+    conversation.speakers = count_;
+    conversation.droppedSpeakers = droppedSpeakers_;
+    return written;
+}
+
+void SpeakerAnalytics::CollectMetrics(MetricsWriter &writer, void *context) {
+    SpeakerAnalytics *self = static_cast<SpeakerAnalytics *>(context);
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    writer.Write("zoom_bot_conversation_speaker_changes_total", self->speakerChanges_);
+    for (size_t i = 0; i < self->count_; i++) {
+        const Speaker &speaker = self->speakers_[self->used_[i]];
+        std::string label = std::to_string(speaker.id);
+        writer.Write("zoom_bot_speaker_talk_seconds_total", "speaker", label, TalkMs(speaker) / 1000.0);
+        writer.Write("zoom_bot_speaker_overlap_seconds_total", "speaker", label,
+                     (double)speaker.overlapSamples / kAsrSampleRate);
+        writer.Write("zoom_bot_speaker_interruptions_total", "speaker", label, speaker.interruptions);
+    }
+}
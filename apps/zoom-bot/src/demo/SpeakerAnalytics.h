@@ -0,0 +1,109 @@
+// Who spoke when: talk time, overlaps and turn-taking from the per-participant VAD
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "Metrics.h"
+
+struct SpeakerStats {
+    uint32_t speakerId;
+    bool speaking;
+    // from the start of each segment to its last voiced frame, so the VAD hangover is not counted
+    unsigned long long talkMs;
+    // speech segments, as the VAD delimits them
+    unsigned long long segments;
+    unsigned long long longestSegmentMs;
+    // voiced speech while at least one other participant was voiced too
+    unsigned long long overlapMs;
+    // segments this speaker started over someone else and kept going for kMinOverlapMs, and
+    // how often someone did that to this one
+    unsigned long long interruptions;
+    unsigned long long interrupted;
+};
+
+struct ConversationStats {
+    unsigned long long talkMs;
+    // someone other than the previous speaker talking on their own for kMinTurnMs
+    unsigned long long speakerChanges;
+    // silence between the previous speaker's last voiced frame and the new speaker's start,
+    // 0 for changes that began in overlap
+    unsigned long long totalResponseGapMs;
+    unsigned long long interruptions;
+    size_t speakers;
+    // speakers the table had no room for
+    unsigned long long droppedSpeakers;
+};
+
+// Folds the VAD decisions of every one-way audio slice into running per-speaker counters.
+// Memory is a fixed table sized at construction; nothing is kept per segment, so the cost
+// does not grow with the length of the meeting.
+//
+// Segments open and close with the VAD state, hangover included, so short pauses do not
+// split them; their ends and everything compared across speakers use the last voiced frame
+// instead. Streams are processed concurrently and a little out of step with each other, so
+// another speaker counts as talking at time t while their last voiced frame ended less than
+// kActiveSlackMs before t. Short overlaps (backchannels, a handoff that latches) are not
+// interruptions, and a backchannel does not take the floor.
+class SpeakerAnalytics {
+public:
+    static const unsigned int kActiveSlackMs = 100;
+    static const unsigned int kMinOverlapMs = 200;
+    static const unsigned int kMinTurnMs = 500;
+
+    /// \param maxSpeakers Capacity of the speaker table, rounded up to a power of two.
+    explicit SpeakerAnalytics(size_t maxSpeakers = 512);
+    ~SpeakerAnalytics();
+
+    /// \brief Account one slice of a participant stream. Safe to call from any thread.
+    /// \param samples Length of the slice in 16 kHz samples.
+    /// \param speech Whether the VAD is inside a speech segment at the end of the slice.
+    /// \param voiced Whether the slice itself sounded like speech rather than hangover.
+    void Update(uint32_t speakerId, unsigned long long timestampMs, size_t samples, bool speech, bool voiced);
+
+    /// \brief Copy the counters of up to maxSpeakers speakers, in no particular order.
+    /// \return The number of entries written to speakers.
+    size_t Snapshot(SpeakerStats *speakers, size_t maxSpeakers, ConversationStats &conversation);
+
+    size_t Capacity() const { return capacity_; }
+
+private:
+    struct Speaker {
+        bool inUse;
+        uint32_t id;
+        bool speaking;
+        // this segment has already been counted as an interruption
+        bool interrupting;
+        unsigned long long segmentStartMs;
+        unsigned long long lastVoicedEndMs;
+        // closed segments only; the open one is added on read
+        unsigned long long talkMs;
+        // counted in samples so 10 ms slices of 159 or 161 samples do not drift
+        unsigned long long overlapSamples;
+        unsigned long long segments;
+        unsigned long long longestSegmentMs;
+        unsigned long long interruptions;
+        unsigned long long interrupted;
+    };
+
+    Speaker *FindOrInsert(uint32_t speakerId);
+    void CloseSegment(Speaker &speaker);
+    static unsigned long long TalkMs(const Speaker &speaker);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    std::mutex mutex_;
+    std::unique_ptr<Speaker[]> speakers_;
+    // indices of the entries in use, so scans skip the empty slots
+    std::unique_ptr<uint32_t[]> used_;
+    size_t capacity_;
+    size_t count_;
+
+    // turn-taking: the table slot of whoever last held the floor
+    bool haveFloor_;
+    size_t floorHolder_;
+    unsigned long long speakerChanges_;
+    unsigned long long totalResponseGapMs_;
+    unsigned long long droppedSpeakers_;
+};
@@ -0,0 +1,244 @@
+// Work-stealing thread pool with strands for per-stream media processing
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sched.h>
+#include <string>
+
+namespace {
+
+// the scheduler and index of the worker running on this thread, so a task posted from a
+// worker stays on its queue
+thread_local TaskScheduler *currentScheduler = nullptr;
+thread_local size_t currentWorker = 0;
+
+// CPUs granted by the cgroup of this container, 0 if unlimited or unknown
+size_t CgroupCpuLimit() {
+    long long quota = -1;
+    long long period = 0;
+    std::ifstream cpuMax("/sys/fs/cgroup/cpu.max");
+    std::string max;
+    if (cpuMax >> max >> period) {
+        // cgroup v2: "<quota> <period>" or "max <period>"
+        if (max != "max") {
+            quota = std::stoll(max);
+        }
+    } else {
+        std::ifstream quotaFile("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        std::ifstream periodFile("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (!(quotaFile >> quota) || !(periodFile >> period)) {
+            return 0;
+        }
+    }
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    // a quota of 1.5 CPUs still keeps two threads busy part of the time
+    return (size_t)((quota + period - 1) / period);
+}
+
+} // namespace
+
+TaskScheduler::TaskScheduler(size_t workers, ThreadRole role)
+    : role_(role), nextWorker_(0), pending_(0), sleepers_(0), stop_(false) {
+    if (workers == 0) {
+        size_t pinned = ThreadPolicy::Instance().CpuCount(role);
+        workers = pinned > 0 ? std::min(pinned, AvailableCpus()) : AvailableCpus();
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < workers; i++) {
+        workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+        workers_.back()->lastSampleAt = now;
+    }
+    // start the threads once every queue exists, since they steal from each other
+    for (size_t i = 0; i < workers; i++) {
+        workers_[i]->thread = std::thread(&TaskScheduler::Run, this, i);
+    }
+    Metrics::Instance().AddCollector(&TaskScheduler::CollectMetrics, this);
+}
+
+TaskScheduler::~TaskScheduler() {
+    Metrics::Instance().RemoveCollector(this);
+    {
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        stop_ = true;
+    }
+    idle_.notify_all();
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i]->thread.join();
+    }
+}
+
+size_t TaskScheduler::AvailableCpus() {
+    size_t cpus = std::thread::hardware_concurrency();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        cpus = CPU_COUNT(&set);
+    }
+    size_t limit = CgroupCpuLimit();
+    if (limit > 0) {
+        cpus = std::min(cpus, limit);
+    }
+    return std::max<size_t>(cpus, 1);
+}
+
+void TaskScheduler::Post(TaskFunction function, void *context) {
+    size_t index = currentScheduler == this ? currentWorker : nextWorker_++ % workers_.size();
+    Worker &worker = *workers_[index];
+    // counted before it is queued, so a thief taking it at once never drives pending_ below
+    // zero; a worker about to sleep either sees pending_ or is counted in sleepers_ by now
+    pending_++;
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(Task{function, context});
+    }
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        idle_.notify_one();
+    }
+}
+
+// the worker's own queue in order first, then the newest task of another worker
+bool TaskScheduler::Take(size_t index, Task &task) {
+    for (size_t i = 0; i < workers_.size(); i++) {
+        Worker &victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+        } else {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            workers_[index]->steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        pending_--;
+        return true;
+    }
+    return false;
+}
+
+void TaskScheduler::Run(size_t index) {
+    currentScheduler = this;
+    currentWorker = index;
+    char name[16];
+    if (role_ == THREAD_ROLE_AUDIO || role_ == THREAD_ROLE_NONE) {
+        snprintf(name, sizeof(name), "zb-worker-%zu", index);
+    } else {
+        snprintf(name, sizeof(name), "zb-%s-%zu", ThreadPolicy::RoleName(role_), index);
+    }
+    ThreadPolicy::Instance().Apply(role_, name);
+    Worker &worker = *workers_[index];
+    Task task;
+    for (;;) {
+        if (Take(index, task)) {
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            task.function(task.context);
+            worker.busyNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now() - begin)
+                                        .count(),
+                                    std::memory_order_relaxed);
+            worker.tasksRun.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idleMutex_);
+        sleepers_++;
+        idle_.wait(lock, [this] { return pending_.load() > 0 || stop_; });
+        sleepers_--;
+        // the queues are run empty before the pool stops
+        if (stop_ && pending_.load() == 0) {
+            return;
+        }
+    }
+}
+
+void TaskScheduler::CollectMetrics(MetricsWriter &writer, void *context) {
+    TaskScheduler *self = static_cast<TaskScheduler *>(context);
+    // the media pool keeps the plain series; other pools are told apart by their role
+    bool media = self->role_ == THREAD_ROLE_AUDIO || self->role_ == THREAD_ROLE_NONE;
+    std::string pool = ThreadPolicy::RoleName(self->role_);
+    if (media) {
+        writer.Write("zoom_bot_scheduler_workers", self->workers_.size());
+        writer.Write("zoom_bot_scheduler_queued_tasks", self->pending_.load());
+    } else {
+        writer.Write("zoom_bot_scheduler_workers", "pool", pool, self->workers_.size());
+        writer.Write("zoom_bot_scheduler_queued_tasks", "pool", pool, self->pending_.load());
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < self->workers_.size(); i++) {
+        Worker &worker = *self->workers_[i];
+        std::string label = media ? std::to_string(i) : pool + "-" + std::to_string(i);
+        unsigned long long busyNs = worker.busyNs.load(std::memory_order_relaxed);
+        long long elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - worker.lastSampleAt).count();
+        // share of the time since the previous scrape spent running tasks
+        double utilization = elapsedNs > 0 ? (double)(busyNs - worker.lastBusyNs) / elapsedNs : 0.0;
+        worker.lastBusyNs = busyNs;
+        worker.lastSampleAt = now;
+        writer.Write("zoom_bot_scheduler_worker_utilization", "worker", label, std::min(utilization, 1.0));
+        writer.Write("zoom_bot_scheduler_worker_busy_seconds_total", "worker", label, busyNs / 1e9);
+        writer.Write("zoom_bot_scheduler_worker_tasks_total", "worker", label,
+                     worker.tasksRun.load(std::memory_order_relaxed));
+        writer.Write("zoom_bot_scheduler_worker_steals_total", "worker", label,
+                     worker.steals.load(std::memory_order_relaxed));
+    }
+}
+
+Strand::Strand(TaskScheduler *scheduler) : scheduler_(scheduler), scheduled_(false) {}
+
+void Strand::Post(TaskScheduler::TaskFunction function, void *context) {
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(Task{function, context});
+        schedule = !scheduled_;
+        scheduled_ = true;
+    }
+    if (schedule) {
+        scheduler_->Post(&Strand::Run, this);
+    }
+}
+
+void Strand::Run(void *context) {
+    Strand *self = static_cast<Strand *>(context);
+    for (size_t i = 0; i < kBatch; i++) {
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex_);
+            if (self->tasks_.empty()) {
+                // the owner may destroy the strand once the lock is released
+                self->scheduled_ = false;
+                self->idle_.notify_all();
+                return;
+            }
+            task = self->tasks_.front();
+            self->tasks_.pop_front();
+        }
+        task.function(task.context);
+    }
+    {
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        if (self->tasks_.empty()) {
+            self->scheduled_ = false;
+            self->idle_.notify_all();
+            return;
+        }
+    }
+    // still busy: queue behind the strands that were waiting meanwhile
+    self->scheduler_->Post(&Strand::Run, self);
+}
+
+void Strand::WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return !scheduled_; });
+}
+
+bool Strand::WaitIdleUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return idle_.wait_until(lock, deadline, [this] { return !scheduled_; });
+}
@@ -0,0 +1,123 @@
+// Work-stealing thread pool with strands for per-stream media processing
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Metrics.h"
+#include "ThreadPolicy.h"
+
+// Runs short tasks on a fixed set of worker threads, one per CPU the container may use.
+// Each worker keeps its own queue and runs it in order; a task posted from a worker goes
+// to that worker's queue, tasks posted from other threads (the SDK callbacks) are spread
+// round robin. A worker that ran out takes the newest task of another one, away from the
+// end its owner is working on.
+//
+// Tasks must not block; the SDK threads that post them never wait for the pool.
+class TaskScheduler {
+public:
+    typedef void (*TaskFunction)(void *context);
+
+    /// \param workers Number of worker threads, 0 for the CPUs role is pinned to or, if it
+    /// is not pinned, AvailableCpus().
+    /// \param role ThreadPolicy role the workers apply when they start.
+    explicit TaskScheduler(size_t workers = 0, ThreadRole role = THREAD_ROLE_NONE);
+
+    /// \brief Run what is still queued, then stop the workers.
+    ~TaskScheduler();
+
+    /// \brief Queue function(context) to run on some worker. Safe to call from any thread.
+    void Post(TaskFunction function, void *context);
+
+    size_t WorkerCount() const { return workers_.size(); }
+
+    /// \brief CPUs this process may use: the affinity mask, capped by the cgroup CPU quota
+    /// (cpu.max, or cpu.cfs_quota_us on cgroup v1) rounded up, and at least 1.
+    static size_t AvailableCpus();
+
+private:
+    struct Task {
+        TaskFunction function;
+        void *context;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+
+        // read by the metrics collector
+        std::atomic<unsigned long long> busyNs;
+        std::atomic<unsigned long long> tasksRun;
+        std::atomic<unsigned long long> steals;
+        // the collector's previous sample, for utilization between two scrapes
+        unsigned long long lastBusyNs;
+        std::chrono::steady_clock::time_point lastSampleAt;
+
+        Worker() : busyNs(0), tasksRun(0), steals(0), lastBusyNs(0) {}
+    };
+
+    void Run(size_t index);
+    bool Take(size_t index, Task &task);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    ThreadRole role_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> nextWorker_;
+
+    // tasks queued on any worker; idle workers sleep until it is non-zero
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> sleepers_;
+    std::atomic<bool> stop_;
+    std::mutex idleMutex_;
+    std::condition_variable idle_;
+};
+
+// Runs the tasks posted to it one at a time and in posting order, on whichever worker is
+// free, so per-stream state needs no lock while different streams run in parallel. A
+// strand with a long backlog hands its worker back after a few tasks so other strands
+// are not starved.
+class Strand {
+public:
+    explicit Strand(TaskScheduler *scheduler = nullptr);
+
+    /// \brief Must be set before the first Post and not changed while tasks are queued.
+    void SetScheduler(TaskScheduler *scheduler) { scheduler_ = scheduler; }
+
+    /// \brief Queue function(context) behind the tasks already posted. Safe to call from any thread.
+    void Post(TaskScheduler::TaskFunction function, void *context);
+
+    /// \brief Wait until the strand ran everything and let go of its worker; after that
+    /// the strand may be destroyed if nothing posts to it anymore.
+    void WaitIdle();
+
+    /// \brief WaitIdle that gives up at deadline.
+    /// \return false if the strand was still busy then.
+    bool WaitIdleUntil(std::chrono::steady_clock::time_point deadline);
+
+private:
+    // tasks one strand runs before it goes back to the end of a worker queue
+    static const size_t kBatch = 8;
+
+    struct Task {
+        TaskScheduler::TaskFunction function;
+        void *context;
+    };
+
+    static void Run(void *context);
+
+    TaskScheduler *scheduler_;
+    std::mutex mutex_;
+    std::deque<Task> tasks_;
+    // queued on the scheduler or running
+    bool scheduled_;
+    std::condition_variable idle_;
+};
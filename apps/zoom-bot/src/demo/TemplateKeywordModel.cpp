@@ -0,0 +1,324 @@
+// Reference keyword model: recorded examples matched with dynamic time warping
+
+#include "TemplateKeywordModel.h"
+#include "AudioResampler.h"
+#include "LogMelExtractor.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// a cost no path has reached
+const float kUnreached = 1e30f;
+// example frames more than 30 dB below the loudest one are trimmed from both ends
+const float kTrimLogPower = 6.9f;
+const size_t kMinExampleFrames = 10;
+const size_t kMaxExampleFrames = 300;
+
+uint32_t ReadLe32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t ReadLe16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// 16-bit PCM of a RIFF WAVE file, downmixed to mono float
+bool ReadWav(const std::string &path, std::vector<float> &samples, unsigned int &sampleRate, std::string &error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) != 0 || memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+        error = path + " is not a WAV file";
+        return false;
+    }
+    unsigned int channels = 0;
+    unsigned int bits = 0;
+    sampleRate = 0;
+    for (size_t offset = 12; offset + 8 <= bytes.size();) {
+        const unsigned char *chunk = bytes.data() + offset;
+        size_t size = ReadLe32(chunk + 4);
+        size_t available = std::min(size, bytes.size() - offset - 8);
+        if (memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            if (ReadLe16(chunk + 8) != 1) {
+                error = path + " is not PCM";
+                return false;
+            }
+            channels = ReadLe16(chunk + 10);
+            sampleRate = ReadLe32(chunk + 12);
+            bits = ReadLe16(chunk + 22);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (bits != 16 || channels == 0) {
+                error = path + " must be 16-bit PCM";
+                return false;
+            }
+            size_t frames = available / (2 * channels);
+            std::vector<int16_t> pcm(frames * channels);
+            memcpy(pcm.data(), chunk + 8, pcm.size() * sizeof(int16_t));
+            samples.resize(frames);
+            SimdKernels::DownmixToMonoFloat(pcm.data(), frames, channels, samples.data());
+            return true;
+        }
+        // chunks are padded to an even size
+        offset += 8 + size + (size & 1);
+    }
+    error = path + " has no audio";
+    return false;
+}
+
+class TemplateKeywordDetector : public KeywordDetector {
+public:
+    explicit TemplateKeywordDetector(const TemplateKeywordModel &model) : model_(model), position_(0) {
+        const std::vector<TemplateKeywordModel::Example> &examples = model.Examples();
+        matches_.resize(examples.size());
+        for (size_t i = 0; i < examples.size(); i++) {
+            Match &match = matches_[i];
+            match.cost.resize(examples[i].frames);
+            match.next.resize(examples[i].frames);
+            match.length.resize(examples[i].frames);
+            match.nextLength.resize(examples[i].frames);
+            match.distance.resize(examples[i].frames);
+        }
+        Reset();
+    }
+
+    virtual void Reset() {
+        for (size_t i = 0; i < matches_.size(); i++) {
+            Rearm(matches_[i]);
+        }
+    }
+
+    virtual size_t Process(const float *frames, size_t count, KeywordHit *hits, size_t maxHits) {
+        const std::vector<TemplateKeywordModel::Example> &examples = model_.Examples();
+        long long first = position_;
+        size_t found = 0;
+        for (size_t f = 0; f < count; f++, position_++) {
+            KeywordFrameFeatures(frames + f * LogMelExtractor::kBins, frame_);
+            for (size_t e = 0; e < matches_.size(); e++) {
+                Match &match = matches_[e];
+                Step(examples[e], match);
+                if (!match.pending || ++match.settled < TemplateKeywordModel::kSettleFrames) {
+                    continue;
+                }
+                if (found < maxHits) {
+                    KeywordHit &hit = hits[found++];
+                    hit.keyword = examples[e].keyword;
+                    hit.endFrame = match.bestEnd - first;
+                    hit.frames = match.bestFrames;
+                    hit.confidence = std::max(0.0f, 1.0f - match.best);
+                }
+                // one hit per utterance, whichever example of the keyword found it
+                for (size_t other = 0; other < matches_.size(); other++) {
+                    if (examples[other].keyword == examples[e].keyword) {
+                        Rearm(matches_[other]);
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+private:
+    struct Match {
+        // accumulated distance and path length in stream frames, per example frame
+        std::vector<float> cost;
+        std::vector<float> next;
+        std::vector<uint32_t> length;
+        std::vector<uint32_t> nextLength;
+        std::vector<float> distance;
+        // the best match below the threshold, waiting to settle
+        bool pending;
+        float best;
+        long long bestEnd;
+        size_t bestFrames;
+        size_t settled;
+    };
+
+    static void Rearm(Match &match) {
+        std::fill(match.cost.begin(), match.cost.end(), kUnreached);
+        std::fill(match.length.begin(), match.length.end(), 0);
+        match.pending = false;
+        match.settled = 0;
+    }
+
+    void Step(const TemplateKeywordModel::Example &example, Match &match) {
+        const size_t frames = example.frames;
+        for (size_t j = 0; j < frames; j++) {
+            match.distance[j] =
+                1.0f - SimdKernels::DotProduct(frame_, example.values.data() + j * kKeywordCoefficients, kKeywordCoefficients);
+        }
+        // a match may start at any stream frame
+        match.next[0] = match.distance[0];
+        match.nextLength[0] = 1;
+        for (size_t j = 1; j < frames; j++) {
+            // from the previous stream frame: the next example frame, the one after it
+            // (stream twice as fast), or the same one (slower, up to half the speed)
+            float best = kUnreached;
+            uint32_t bestLength = 0;
+            size_t from[3] = {j - 1, j >= 2 ? j - 2 : j - 1, j};
+            for (size_t k = 0; k < 3; k++) {
+                float cost = match.cost[from[k]];
+                uint32_t length = match.length[from[k]] + 1;
+                if (cost >= kUnreached || length > 2 * (j + 1)) {
+                    continue;
+                }
+                if (best >= kUnreached || (cost + match.distance[j]) * bestLength < best * length) {
+                    best = cost + match.distance[j];
+                    bestLength = length;
+                }
+            }
+            match.next[j] = best;
+            match.nextLength[j] = bestLength;
+        }
+        match.cost.swap(match.next);
+        match.length.swap(match.nextLength);
+
+        float end = match.cost[frames - 1];
+        uint32_t length = match.length[frames - 1];
+        if (end >= kUnreached || length * 2 < frames) {
+            return;
+        }
+        float mean = end / length;
+        if (mean < model_.MaxDistance() && (!match.pending || mean < match.best)) {
+            match.pending = true;
+            match.best = mean;
+            match.bestEnd = position_;
+            match.bestFrames = length;
+            match.settled = 0;
+        }
+    }
+
+    const TemplateKeywordModel &model_;
+    std::vector<Match> matches_;
+    float frame_[kKeywordCoefficients];
+    // frames seen since the detector was created
+    long long position_;
+};
+
+} // namespace
+
+bool ParseKeywordTemplates(const std::string &spec, std::vector<std::pair<std::string, std::string>> &entries) {
+    entries.clear();
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t first = item.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            continue;
+        }
+        item = item.substr(first, item.find_last_not_of(" \t") - first + 1);
+        size_t equals = item.find('=');
+        if (equals == std::string::npos || equals == 0 || equals + 1 == item.size()) {
+            return false;
+        }
+        entries.push_back(std::make_pair(item.substr(0, equals), item.substr(equals + 1)));
+    }
+    return true;
+}
+
+void KeywordFrameFeatures(const float *frame, float *out) {
+    // DCT-II basis over the mel bins, coefficients 1 to kKeywordCoefficients
+    static const std::vector<float> basis = [] {
+        std::vector<float> table(kKeywordCoefficients * LogMelExtractor::kBins);
+        for (size_t k = 0; k < kKeywordCoefficients; k++) {
+            for (size_t b = 0; b < LogMelExtractor::kBins; b++) {
+                table[k * LogMelExtractor::kBins + b] =
+                    (float)cos(M_PI * (k + 1) * (b + 0.5) / LogMelExtractor::kBins);
+            }
+        }
+        return table;
+    }();
+    for (size_t k = 0; k < kKeywordCoefficients; k++) {
+        out[k] = SimdKernels::DotProduct(frame, basis.data() + k * LogMelExtractor::kBins, LogMelExtractor::kBins);
+    }
+    float norm = sqrtf(SimdKernels::DotProduct(out, out, kKeywordCoefficients));
+    float scale = norm > 1e-3f ? 1.0f / norm : 0.0f;
+    for (size_t k = 0; k < kKeywordCoefficients; k++) {
+        out[k] *= scale;
+    }
+}
+
+std::unique_ptr<TemplateKeywordModel> TemplateKeywordModel::Load(const std::string &spec, float maxDistance,
+                                                                 std::string &error) {
+    std::vector<std::pair<std::string, std::string>> entries;
+    if (!ParseKeywordTemplates(spec, entries) || entries.empty()) {
+        error = "keywordTemplates must be keyword=file.wav entries";
+        return nullptr;
+    }
+    std::unique_ptr<TemplateKeywordModel> model(new TemplateKeywordModel(maxDistance));
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::vector<float> samples;
+        unsigned int sampleRate = 0;
+        if (!ReadWav(entries[i].second, samples, sampleRate, error)) {
+            return nullptr;
+        }
+        AudioResampler resampler;
+        if (!resampler.Configure(sampleRate)) {
+            error = entries[i].second + " has an unsupported sample rate";
+            return nullptr;
+        }
+        std::vector<float> resampled(resampler.MaxOutputSamples(samples.size()));
+        resampled.resize(resampler.Process(samples.data(), samples.size(), resampled.data()));
+        if (!model->AddExample(entries[i].first, resampled.data(), resampled.size())) {
+            error = entries[i].second + " holds no usable example of " + entries[i].first;
+            return nullptr;
+        }
+    }
+    return model;
+}
+
+bool TemplateKeywordModel::AddExample(const std::string &keyword, const float *samples, size_t count) {
+    LogMelExtractor extractor;
+    std::vector<float> frames(LogMelExtractor::MaxFrames(count) * LogMelExtractor::kBins);
+    size_t total = extractor.Process(samples, count, frames.data());
+
+    // trim the silence around the keyword by the frames' mean log power
+    std::vector<float> power(total);
+    float loudest = -1e30f;
+    for (size_t f = 0; f < total; f++) {
+        float sum = 0.0f;
+        for (size_t b = 0; b < LogMelExtractor::kBins; b++) {
+            sum += frames[f * LogMelExtractor::kBins + b];
+        }
+        power[f] = sum / LogMelExtractor::kBins;
+        loudest = std::max(loudest, power[f]);
+    }
+    size_t begin = 0;
+    size_t end = total;
+    while (begin < end && power[begin] < loudest - kTrimLogPower) {
+        begin++;
+    }
+    while (end > begin && power[end - 1] < loudest - kTrimLogPower) {
+        end--;
+    }
+    if (end - begin < kMinExampleFrames || end - begin > kMaxExampleFrames) {
+        return false;
+    }
+
+    size_t index = std::find(keywords_.begin(), keywords_.end(), keyword) - keywords_.begin();
+    if (index == keywords_.size()) {
+        keywords_.push_back(keyword);
+    }
+    Example example;
+    example.keyword = index;
+    example.frames = end - begin;
+    example.values.resize(example.frames * kKeywordCoefficients);
+    for (size_t f = 0; f < example.frames; f++) {
+        KeywordFrameFeatures(frames.data() + (begin + f) * LogMelExtractor::kBins,
+                             example.values.data() + f * kKeywordCoefficients);
+    }
+    examples_.push_back(example);
+    return true;
+}
+
+std::unique_ptr<KeywordDetector> TemplateKeywordModel::CreateDetector() const {
+    return std::unique_ptr<KeywordDetector>(new TemplateKeywordDetector(*this));
+}
@@ -0,0 +1,67 @@
+// Reference keyword model: recorded examples matched with dynamic time warping
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "KeywordSpotter.h"
+
+/// \brief Split a keywordTemplates value, "keyword=example.wav,keyword=other.wav", into
+/// keyword and file pairs. A keyword may have several examples.
+/// \return false if an entry has no keyword or no file.
+bool ParseKeywordTemplates(const std::string &spec, std::vector<std::pair<std::string, std::string>> &entries);
+
+// Spots keywords by comparing the stream with recorded examples of them. Each example is a
+// 16-bit PCM WAV file, turned into log-mel frames with silence trimmed at both ends. Frames
+// are compared by the cosine distance of their cepstra (KeywordFrameFeatures), which ignores
+// level and pitch and keeps the vocal tract's shape.
+//
+// Every example is matched with subsequence DTW: the match may start at any frame, and
+// the stream may run from half to twice the speed of the example. A column of costs per
+// example is updated with each frame, so the cost per frame is one dot product per example
+// frame. A match whose mean distance is below maxDistance is reported once the distance
+// stops improving for kSettleFrames, and the example is rearmed.
+class TemplateKeywordModel : public KeywordModel {
+public:
+    // frames a match must stop improving for before it is reported
+    static const size_t kSettleFrames = 10;
+
+    /// \brief Load the examples of a keywordTemplates value.
+    /// \param maxDistance Mean cosine distance a match must stay under, 0 to 2.
+    /// \return nullptr with a description in error if a file cannot be used.
+    static std::unique_ptr<TemplateKeywordModel> Load(const std::string &spec, float maxDistance, std::string &error);
+
+    virtual size_t KeywordCount() const { return keywords_.size(); }
+    virtual const std::string &Keyword(size_t index) const { return keywords_[index]; }
+    virtual std::unique_ptr<KeywordDetector> CreateDetector() const;
+
+    struct Example {
+        size_t keyword;
+        size_t frames;
+        // frames x kKeywordCoefficients, see KeywordFrameFeatures
+        std::vector<float> values;
+    };
+
+    /// \brief Add an example from 16 kHz mono samples; Load does this for every file.
+    /// \return false if the samples hold no speech-like frames.
+    bool AddExample(const std::string &keyword, const float *samples, size_t count);
+
+    const std::vector<Example> &Examples() const { return examples_; }
+    float MaxDistance() const { return maxDistance_; }
+
+private:
+    explicit TemplateKeywordModel(float maxDistance) : maxDistance_(maxDistance) {}
+
+    float maxDistance_;
+    std::vector<std::string> keywords_;
+    std::vector<Example> examples_;
+};
+
+// cepstral coefficients a frame is compared by
+const size_t kKeywordCoefficients = 20;
+
+/// \brief The cepstrum of a log-mel frame without c0, scaled to unit length: the spectral
+/// envelope, independent of level and pitch. A flat frame becomes all zeros.
+void KeywordFrameFeatures(const float *frame, float *out);
@@ -0,0 +1,306 @@
+// CPU affinity and scheduling policy for the threads that handle media
+
+#include "ThreadPolicy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const char *const kRoleNames[] = {"none", "audio", "video", "writer", "analysis"};
+
+// CAP_SYS_NICE in the effective capability set of /proc/self/status
+const int kCapSysNice = 23;
+
+bool ParseInt(const std::string &text, long min, long max, int &value) {
+    if (text.empty()) {
+        return false;
+    }
+    char *end = nullptr;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || parsed < min || parsed > max) {
+        return false;
+    }
+    value = (int)parsed;
+    return true;
+}
+
+// "2-3,6" in the format of cpuset.cpus
+bool ParseCpuList(const std::string &text, std::vector<int> &cpus) {
+    std::stringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t dash = item.find('-');
+        int first = 0;
+        int last = 0;
+        if (dash == std::string::npos) {
+            if (!ParseInt(item, 0, CPU_SETSIZE - 1, first)) {
+                return false;
+            }
+            last = first;
+        } else if (!ParseInt(item.substr(0, dash), 0, CPU_SETSIZE - 1, first) ||
+                   !ParseInt(item.substr(dash + 1), 0, CPU_SETSIZE - 1, last) || last < first) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+std::string FormatCpus(const std::vector<int> &cpus) {
+    std::ostringstream out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            j++;
+        }
+        out << (i > 0 ? "," : "") << cpus[i];
+        if (j > i) {
+            out << "-" << cpus[j];
+        }
+        i = j + 1;
+    }
+    return out.str();
+}
+
+// whether sched_setscheduler(SCHED_FIFO, priority) can succeed for this process
+bool RealtimePermitted(int priority) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_RTPRIO, &limit) == 0 && (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur >= (rlim_t)priority)) {
+        return true;
+    }
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 7, "CapEff:") == 0) {
+            unsigned long long caps = strtoull(line.c_str() + 7, nullptr, 16);
+            return (caps >> kCapSysNice) & 1;
+        }
+    }
+    return false;
+}
+
+// video on the top quarter of the CPUs, the writer on the one below, audio on the rest
+void AutoLayout(const std::vector<int> &allowed, ThreadRolePolicy *policies) {
+    size_t count = allowed.size();
+    if (count < 4) {
+        return;
+    }
+    size_t video = std::max<size_t>(1, count / 4);
+    policies[THREAD_ROLE_VIDEO].cpus.assign(allowed.end() - video, allowed.end());
+    policies[THREAD_ROLE_VIDEO].nice = 10;
+    policies[THREAD_ROLE_VIDEO].setNice = true;
+    policies[THREAD_ROLE_WRITER].cpus.assign(1, allowed[count - video - 1]);
+    policies[THREAD_ROLE_AUDIO].cpus.assign(allowed.begin(), allowed.end() - video - 1);
+    // analysis gives way to the audio threads it shares the CPUs with
+    policies[THREAD_ROLE_ANALYSIS].cpus = policies[THREAD_ROLE_AUDIO].cpus;
+    policies[THREAD_ROLE_ANALYSIS].nice = 10;
+    policies[THREAD_ROLE_ANALYSIS].setNice = true;
+}
+
+} // namespace
+
+ThreadPolicy &ThreadPolicy::Instance() {
+    static ThreadPolicy instance;
+    return instance;
+}
+
+ThreadPolicy::ThreadPolicy() {
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        warned_[i] = false;
+    }
+}
+
+std::vector<int> ThreadPolicy::AllowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+bool ThreadPolicy::Parse(const std::string &layout, ThreadRolePolicy *policies, std::string &error) {
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        policies[i] = ThreadRolePolicy();
+    }
+    if (layout.empty()) {
+        return true;
+    }
+    if (layout == "auto") {
+        AutoLayout(AllowedCpus(), policies);
+        return true;
+    }
+
+    std::stringstream entries(layout);
+    std::string entry;
+    while (std::getline(entries, entry, ';')) {
+        std::vector<std::string> fields;
+        std::stringstream parts(entry);
+        std::string part;
+        while (std::getline(parts, part, ':')) {
+            fields.push_back(part);
+        }
+        int role = THREAD_ROLE_COUNT;
+        for (int i = THREAD_ROLE_AUDIO; i < THREAD_ROLE_COUNT; i++) {
+            if (!fields.empty() && fields[0] == kRoleNames[i]) {
+                role = i;
+            }
+        }
+        if (role == THREAD_ROLE_COUNT || fields.size() < 2 || fields.size() > 3) {
+            error = "\"" + entry + "\" is not audio|video|writer|analysis:CPUS[:fifoN|:niceN]";
+            return false;
+        }
+        ThreadRolePolicy &policy = policies[role];
+        if (!ParseCpuList(fields[1], policy.cpus)) {
+            error = "\"" + fields[1] + "\" is not a CPU list such as 2-3,6";
+            return false;
+        }
+        if (fields.size() == 3) {
+            const std::string &rule = fields[2];
+            if (rule.compare(0, 4, "fifo") == 0 && ParseInt(rule.substr(4), 1, 99, policy.fifoPriority)) {
+                continue;
+            }
+            if (rule.compare(0, 4, "nice") == 0 && ParseInt(rule.substr(4), -20, 19, policy.nice)) {
+                policy.setNice = true;
+                continue;
+            }
+            error = "\"" + rule + "\" is neither fifo1..fifo99 nor nice-20..nice19";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ThreadPolicy::Validate(const std::string &layout, std::string &error) {
+    ThreadRolePolicy policies[THREAD_ROLE_COUNT];
+    return Parse(layout, policies, error);
+}
+
+bool ThreadPolicy::Configure(const std::string &layout) {
+    std::string error;
+    ThreadRolePolicy policies[THREAD_ROLE_COUNT];
+    if (!Parse(layout, policies, error)) {
+        std::cerr << "ThreadPolicy: threadLayout " << error << std::endl;
+        return false;
+    }
+
+    std::vector<int> allowed = AllowedCpus();
+    std::cout << "ThreadPolicy: cpuset " << FormatCpus(allowed) << std::endl;
+    if (layout == "auto" && allowed.size() < 4) {
+        std::cout << "ThreadPolicy: the auto layout needs 4 CPUs, threads are not pinned" << std::endl;
+    }
+    for (int role = THREAD_ROLE_AUDIO; role < THREAD_ROLE_COUNT; role++) {
+        ThreadRolePolicy &policy = policies[role];
+        std::vector<int> usable;
+        std::set_intersection(policy.cpus.begin(), policy.cpus.end(), allowed.begin(), allowed.end(),
+                              std::back_inserter(usable));
+        if (usable.size() < policy.cpus.size()) {
+            std::cerr << "ThreadPolicy: " << kRoleNames[role] << " CPUs " << FormatCpus(policy.cpus)
+                      << " are not all in the cpuset, using " << (usable.empty() ? "any" : FormatCpus(usable))
+                      << std::endl;
+        }
+        policy.cpus = usable;
+
+        std::ostringstream line;
+        line << "ThreadPolicy: " << kRoleNames[role] << " threads on CPUs "
+             << (policy.cpus.empty() ? "any" : FormatCpus(policy.cpus));
+        if (policy.fifoPriority > 0) {
+            line << ", SCHED_FIFO " << policy.fifoPriority;
+            if (!RealtimePermitted(policy.fifoPriority)) {
+                line << " (not permitted here, " << (policy.setNice ? "falls back to nice" : "stays SCHED_OTHER") << ")";
+            }
+        }
+        if (policy.setNice) {
+            line << ", nice " << policy.nice;
+        }
+        std::cout << line.str() << std::endl;
+        policies_[role] = policy;
+    }
+    return true;
+}
+
+void ThreadPolicy::Apply(ThreadRole role, const char *name) {
+    if (role <= THREAD_ROLE_NONE || role >= THREAD_ROLE_COUNT) {
+        return;
+    }
+    if (name) {
+        pthread_setname_np(pthread_self(), name);
+    }
+    const ThreadRolePolicy &policy = policies_[role];
+    const char *refused = nullptr;
+    int error = 0;
+
+    if (!policy.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < policy.cpus.size(); i++) {
+            CPU_SET(policy.cpus[i], &set);
+        }
+        // pid 0 is the calling thread
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            refused = "CPU affinity";
+            error = errno;
+        }
+    }
+
+    bool realtime = false;
+    if (policy.fifoPriority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = policy.fifoPriority;
+        int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (result == 0) {
+            realtime = true;
+        } else {
+            refused = "SCHED_FIFO";
+            error = result;
+        }
+    }
+    // on Linux the nice level belongs to the thread, addressed by its tid
+    if (!realtime && policy.setNice && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), policy.nice) != 0) {
+        refused = "nice level";
+        error = errno;
+    }
+
+    if (refused && !warned_[role].exchange(true)) {
+        std::cerr << "ThreadPolicy: " << refused << " refused for " << kRoleNames[role] << " threads ("
+                  << strerror(error) << "), continuing without it" << std::endl;
+    }
+}
+
+void ThreadPolicy::ApplyOnce(ThreadRole role) {
+    thread_local bool applied = false;
+    if (!applied) {
+        applied = true;
+        Apply(role);
+    }
+}
+
+const char *ThreadPolicy::RoleName(ThreadRole role) {
+    return role >= THREAD_ROLE_NONE && role < THREAD_ROLE_COUNT ? kRoleNames[role] : "none";
+}
+
+size_t ThreadPolicy::CpuCount(ThreadRole role) const {
+    return role > THREAD_ROLE_NONE && role < THREAD_ROLE_COUNT ? policies_[role].cpus.size() : 0;
+}
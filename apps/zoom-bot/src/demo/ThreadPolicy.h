@@ -0,0 +1,84 @@
+// CPU affinity and scheduling policy for the threads that handle media
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+enum ThreadRole {
+    // left as the process started it
+    THREAD_ROLE_NONE,
+    // SDK audio callbacks and the audio pipeline workers
+    THREAD_ROLE_AUDIO,
+    // SDK video callbacks
+    THREAD_ROLE_VIDEO,
+    // the recorder's disk writer
+    THREAD_ROLE_WRITER,
+    // keyword spotting and other work that may fall behind without losing media
+    THREAD_ROLE_ANALYSIS,
+    THREAD_ROLE_COUNT,
+};
+
+struct ThreadRolePolicy {
+    // CPUs the role's threads may run on; empty for wherever the cpuset allows
+    std::vector<int> cpus;
+    // SCHED_FIFO priority 1-99, 0 to stay on SCHED_OTHER
+    int fifoPriority;
+    // nice level on SCHED_OTHER, also used when SCHED_FIFO is refused
+    int nice;
+    bool setNice;
+
+    ThreadRolePolicy() : fifoPriority(0), nice(0), setNice(false) {}
+};
+
+// Where audio, video and writer threads run, from threadLayout in config.txt:
+//
+//   audio:2-3:fifo20;writer:4:nice-5;video:5-7:nice10
+//
+// One entry per role (audio, video, writer, analysis): a CPU list, then optionally fifoN or
+// niceN. "auto" keeps video on the top quarter of the container's CPUs at nice 10, the
+// writer on the CPU below, audio on the rest and analysis next to audio at nice 10; an
+// empty layout leaves every thread alone.
+//
+// Requested CPUs outside the container's cpuset are ignored. Without CAP_SYS_NICE (or an
+// RLIMIT_RTPRIO) SCHED_FIFO and negative nice levels are refused; the thread then keeps
+// its affinity and runs at the nice level it may have, and the refusal is logged once.
+class ThreadPolicy {
+public:
+    static ThreadPolicy &Instance();
+
+    /// \brief Check the syntax of layout without applying it.
+    /// \return false with a description in error.
+    static bool Validate(const std::string &layout, std::string &error);
+
+    /// \brief Resolve layout against the cpuset of the process and log the result. Call
+    /// before the media threads start; threads that already applied a role keep it.
+    bool Configure(const std::string &layout);
+
+    /// \brief Move the calling thread to the role's CPUs and scheduling policy.
+    /// \param name Thread name shown by top and /proc, at most 15 characters; nullptr
+    /// keeps the name, for threads the SDK owns.
+    void Apply(ThreadRole role, const char *name = nullptr);
+
+    /// \brief Apply on the first call from each thread, for SDK callbacks; cheap afterwards.
+    /// A thread that delivers both audio and video keeps the role of its first callback.
+    void ApplyOnce(ThreadRole role);
+
+    /// \brief The role's name in threadLayout, e.g. "audio".
+    static const char *RoleName(ThreadRole role);
+
+    /// \brief Number of CPUs the role is pinned to, 0 if it is not pinned.
+    size_t CpuCount(ThreadRole role) const;
+
+    /// \brief CPUs of the process's affinity mask, which the container's cpuset bounds.
+    static std::vector<int> AllowedCpus();
+
+private:
+    ThreadPolicy();
+
+    static bool Parse(const std::string &layout, ThreadRolePolicy *policies, std::string &error);
+
+    ThreadRolePolicy policies_[THREAD_ROLE_COUNT];
+    // a refused policy is logged once per role, not once per thread
+    std::atomic<bool> warned_[THREAD_ROLE_COUNT];
+};
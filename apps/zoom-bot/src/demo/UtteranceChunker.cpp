@@ -0,0 +1,217 @@
+// Cuts participant streams into utterances sized for speech recognition
+
+#include "UtteranceChunker.h"
+#include "AudioResampler.h"
+#include "SimdKernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+struct UtteranceChunker::Stream {
+    uint32_t id;
+    // the open utterance, nullptr between utterances
+    Utterance *current;
+    // where the next slice should start if nothing was skipped
+    unsigned long long nextMs;
+    // samples of current up to the end of the last slice inside speech
+    size_t speechEnd;
+    // the unvoiced run in progress, and the best place to cut found so far: the middle of
+    // the longest run that ends past minSamples
+    bool inPause;
+    size_t pauseStart;
+    size_t bestCut;
+    size_t bestPause;
+    // no buffer was free when the speech began; skip it until the next pause
+    bool dropping;
+};
+
+UtteranceChunker::UtteranceChunker(unsigned int minMs, unsigned int maxMs, unsigned int overlapMs, size_t buffers)
+    : minSamples_((size_t)minMs * kAsrSampleRate / 1000), maxSamples_((size_t)maxMs * kAsrSampleRate / 1000),
+      overlapSamples_(std::min((size_t)overlapMs, (size_t)minMs / 2) * kAsrSampleRate / 1000),
+      maxJoinPauseSamples_((size_t)kMaxJoinPauseMs * kAsrSampleRate / 1000), sink_(nullptr), finished_(0),
+      finishedSamples_(0), dropped_(0) {
+    storage_.reset(new int16_t[maxSamples_ * buffers]);
+    utterances_.resize(buffers);
+    free_.reserve(buffers);
+    for (size_t i = 0; i < buffers; i++) {
+        utterances_[i].samples = storage_.get() + i * maxSamples_;
+        free_.push_back(&utterances_[i]);
+    }
+    Metrics::Instance().AddCollector(&UtteranceChunker::CollectMetrics, this);
+}
+
+UtteranceChunker::~UtteranceChunker() {
+    Metrics::Instance().RemoveCollector(this);
+}
+
+void UtteranceChunker::Add(Stream *&stream, uint32_t streamId, const float *samples, size_t count,
+                           unsigned long long timestampMs, bool speech, bool voiced) {
+    if (!sink_ || count == 0) {
+        return;
+    }
+    if (!stream) {
+        std::unique_ptr<Stream> created(new Stream());
+        created->id = streamId;
+        created->current = nullptr;
+        created->nextMs = 0;
+        created->dropping = false;
+        stream = created.get();
+        std::lock_guard<std::mutex> lock(streamsMutex_);
+        streams_.push_back(std::move(created));
+    }
+    Stream &state = *stream;
+
+    // the stream skipped ahead or went back: what came before is complete as it is
+    if (state.current && (timestampMs + kMaxJitterMs < state.nextMs || timestampMs > state.nextMs + kMaxJitterMs)) {
+        Finish(state, state.speechEnd, "gap");
+    }
+    state.nextMs = timestampMs + count * 1000 / kAsrSampleRate;
+
+    if (!state.current) {
+        if (!speech) {
+            state.dropping = false;
+            return;
+        }
+        if (state.dropping) {
+            return;
+        }
+        Open(state, timestampMs);
+        if (!state.current) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            state.dropping = true;
+            return;
+        }
+    }
+    if (state.current->count + count > maxSamples_) {
+        CutAtMax(state);
+        if (!state.current) {
+            return;
+        }
+    }
+
+    Utterance &utterance = *state.current;
+    if (!voiced && !state.inPause) {
+        state.inPause = true;
+        state.pauseStart = utterance.count;
+    } else if (voiced && state.inPause) {
+        state.inPause = false;
+        ConsiderCut(state, state.pauseStart, utterance.count);
+    }
+    SimdKernels::FloatToInt16(samples, count, utterance.samples + utterance.count);
+    utterance.count += count;
+    if (speech) {
+        state.speechEnd = utterance.count;
+        return;
+    }
+
+    // the VAD left speech: a long enough utterance ends here, a short one waits a while
+    // for more words to join it
+    if (state.speechEnd >= minSamples_ || utterance.count - state.speechEnd >= maxJoinPauseSamples_) {
+        Finish(state, state.speechEnd, "pause");
+    }
+}
+
+void UtteranceChunker::Flush() {
+    std::lock_guard<std::mutex> lock(streamsMutex_);
+    for (size_t i = 0; i < streams_.size(); i++) {
+        if (streams_[i]->current) {
+            Finish(*streams_[i], streams_[i]->speechEnd, "end");
+        }
+    }
+}
+
+void UtteranceChunker::Release(Utterance *utterance) {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    free_.push_back(utterance);
+}
+
+Utterance *UtteranceChunker::Acquire() {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    if (free_.empty()) {
+        return nullptr;
+    }
+    Utterance *utterance = free_.back();
+    free_.pop_back();
+    return utterance;
+}
+
+void UtteranceChunker::Open(Stream &stream, unsigned long long timestampMs) {
+    stream.current = Acquire();
+    if (!stream.current) {
+        return;
+    }
+    stream.current->streamId = stream.id;
+    stream.current->startMs = timestampMs;
+    stream.current->count = 0;
+    stream.current->overlap = 0;
+    stream.speechEnd = 0;
+    stream.inPause = false;
+    stream.bestPause = 0;
+}
+
+void UtteranceChunker::Finish(Stream &stream, size_t end, const char *cut) {
+    Utterance *utterance = stream.current;
+    stream.current = nullptr;
+    if (end <= utterance->overlap) {
+        // nothing but what the previous utterance already had
+        Release(utterance);
+        return;
+    }
+    utterance->count = end;
+    utterance->endMs = utterance->startMs + end * 1000 / kAsrSampleRate;
+    utterance->cut = cut;
+    finished_.fetch_add(1, std::memory_order_relaxed);
+    finishedSamples_.fetch_add(end - utterance->overlap, std::memory_order_relaxed);
+    sink_->OnUtterance(utterance);
+}
+
+void UtteranceChunker::ConsiderCut(Stream &stream, size_t start, size_t end) {
+    size_t middle = start + (end - start) / 2;
+    // the later of two equal pauses keeps more in this utterance
+    if (middle >= minSamples_ && end - start >= stream.bestPause) {
+        stream.bestCut = middle;
+        stream.bestPause = end - start;
+    }
+}
+
+void UtteranceChunker::CutAtMax(Stream &stream) {
+    Utterance *full = stream.current;
+    if (stream.inPause) {
+        ConsiderCut(stream, stream.pauseStart, full->count);
+    }
+    size_t cut = stream.bestPause > 0 ? stream.bestCut : full->count;
+    // the next utterance repeats overlapSamples_ before the cut
+    size_t from = cut > overlapSamples_ ? cut - overlapSamples_ : 0;
+
+    Utterance *next = Acquire();
+    if (next) {
+        next->streamId = stream.id;
+        next->startMs = full->startMs + from * 1000 / kAsrSampleRate;
+        next->count = full->count - from;
+        next->overlap = cut - from;
+        memcpy(next->samples, full->samples + from, next->count * sizeof(int16_t));
+    }
+    size_t speechEnd = stream.speechEnd;
+    Finish(stream, std::min(cut, speechEnd), "max");
+    if (!next) {
+        // the rest of the speech is lost, as if it had started without a buffer
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        stream.dropping = true;
+        return;
+    }
+    stream.current = next;
+    stream.speechEnd = speechEnd > from ? speechEnd - from : 0;
+    stream.pauseStart = stream.pauseStart > from ? stream.pauseStart - from : 0;
+    stream.bestPause = 0;
+}
+
+void UtteranceChunker::CollectMetrics(MetricsWriter &writer, void *context) {
+    UtteranceChunker *self = static_cast<UtteranceChunker *>(context);
+    writer.Write("zoom_bot_utterances_total", self->finished_.load(std::memory_order_relaxed));
+    writer.Write("zoom_bot_utterance_seconds_total",
+                 (double)self->finishedSamples_.load(std::memory_order_relaxed) / kAsrSampleRate);
+    writer.Write("zoom_bot_utterances_dropped_total", self->dropped_.load(std::memory_order_relaxed));
+    std::lock_guard<std::mutex> lock(self->poolMutex_);
+    writer.Write("zoom_bot_utterance_free_buffers", self->free_.size());
+}
+
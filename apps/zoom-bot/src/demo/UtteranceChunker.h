@@ -0,0 +1,116 @@
+// Cuts participant streams into utterances sized for speech recognition
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Metrics.h"
+
+// One utterance of a participant stream, held in a buffer of the chunker's pool.
+struct Utterance {
+    uint32_t streamId;
+    // SDK time of the first sample and of the end of the last one
+    unsigned long long startMs;
+    unsigned long long endMs;
+    // why it ended: "pause", "max" (the length limit, cut at the best pause inside), "gap"
+    // (the stream skipped) or "end" (flushed)
+    const char *cut;
+    // 16 kHz mono
+    int16_t *samples;
+    size_t count;
+    // leading samples that repeat the end of the previous utterance of the stream
+    size_t overlap;
+};
+
+// Receives finished utterances.
+class UtteranceSink {
+public:
+    virtual ~UtteranceSink() {}
+
+    /// \brief Called on the stream's pipeline strand, or in Flush. The sink owns the
+    /// utterance until it hands it back with UtteranceChunker::Release, from any thread.
+    virtual void OnUtterance(Utterance *utterance) = 0;
+};
+
+// Assembles the 16 kHz slices of every participant stream into utterances of minMs to
+// maxMs, so downstream recognition gets one request per utterance instead of one per
+// 10 ms chunk.
+//
+// An utterance opens when the VAD enters speech and ends when it leaves speech again,
+// which takes a pause of the VAD's hangover, 250 ms. An utterance shorter than minMs stays
+// open across the pause so the next words join it, unless nothing follows for
+// kMaxJoinPauseMs. One that reaches maxMs is cut at the longest unvoiced run after minMs,
+// or at maxMs if there is none. The next utterance then repeats the last overlapMs before
+// the cut, so a word split there is whole in one of them. Trailing silence is not kept.
+//
+// Utterances live in a fixed pool of buffers of maxMs, allocated up front; nothing is
+// allocated or copied per slice beyond the conversion into the buffer. With every buffer
+// at the sink or open, a new utterance is dropped and counted instead of waiting.
+class UtteranceChunker {
+public:
+    // a shorter utterance is sent anyway after this much silence
+    static const unsigned int kMaxJoinPauseMs = 2000;
+    // timestamps further than this from where the stream left off are a gap
+    static const unsigned int kMaxJitterMs = 30;
+
+    struct Stream;
+
+    /// \param maxMs At least a second more than minMs.
+    /// \param overlapMs At most half of minMs.
+    /// \param buffers Utterances that may be open or at the sink at once.
+    UtteranceChunker(unsigned int minMs, unsigned int maxMs, unsigned int overlapMs, size_t buffers);
+    ~UtteranceChunker();
+
+    /// \brief Send finished utterances to sink. Set before the first Add.
+    void SetSink(UtteranceSink *sink) { sink_ = sink; }
+
+    /// \brief Add count samples of streamId starting at timestampMs. Called on the stream's
+    /// pipeline strand; stream is the caller's handle, nullptr at first.
+    /// \param speech Whether the VAD is inside a speech segment at the end of the slice.
+    /// \param voiced Whether the slice itself sounded like speech rather than hangover.
+    void Add(Stream *&stream, uint32_t streamId, const float *samples, size_t count, unsigned long long timestampMs,
+             bool speech, bool voiced);
+
+    /// \brief End every open utterance, e.g. when the recording finishes. The pipeline
+    /// must be idle.
+    void Flush();
+
+    /// \brief Return an utterance the sink is done with to the pool.
+    void Release(Utterance *utterance);
+
+    size_t BufferCount() const { return utterances_.size(); }
+    unsigned long long Finished() const { return finished_.load(std::memory_order_relaxed); }
+    unsigned long long Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    Utterance *Acquire();
+    void Open(Stream &stream, unsigned long long timestampMs);
+    void Finish(Stream &stream, size_t end, const char *cut);
+    void ConsiderCut(Stream &stream, size_t start, size_t end);
+    void CutAtMax(Stream &stream);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    size_t minSamples_;
+    size_t maxSamples_;
+    size_t overlapSamples_;
+    size_t maxJoinPauseSamples_;
+    UtteranceSink *sink_;
+
+    std::unique_ptr<int16_t[]> storage_;
+    std::vector<Utterance> utterances_;
+    // the pool; Release may come from the sink's thread
+    std::mutex poolMutex_;
+    std::vector<Utterance *> free_;
+
+    // creation and Flush; every stream is kept until the chunker goes
+    std::mutex streamsMutex_;
+    std::vector<std::unique_ptr<Stream>> streams_;
+
+    std::atomic<unsigned long long> finished_;
+    std::atomic<unsigned long long> finishedSamples_;
+    std::atomic<unsigned long long> dropped_;
+};
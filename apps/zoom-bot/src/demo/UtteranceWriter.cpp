@@ -0,0 +1,181 @@
+// Writes finished utterances as WAV files and announces each with a bot event
+
+#include "UtteranceWriter.h"
+#include "AudioResampler.h"
+#include "ThreadPolicy.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+void PutLe32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+void PutLe16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+bool WriteFully(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+} // namespace
+
+UtteranceWriter::UtteranceWriter(UtteranceChunker *chunker, const ParticipantRoster *roster)
+    : chunker_(chunker), roster_(roster), events_(nullptr), queue_(chunker->BufferCount()), head_(0), count_(0),
+      busy_(false), stopping_(false), writeErrors_(0) {}
+
+UtteranceWriter::~UtteranceWriter() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        wake_.notify_one();
+    }
+    thread_.join();
+    Metrics::Instance().RemoveCollector(this);
+}
+
+void UtteranceWriter::Start(const std::string &directory, BotEventChannel *events, const std::string &meetingNumber) {
+    if (thread_.joinable()) {
+        return;
+    }
+    directory_ = directory;
+    events_ = events;
+    meetingNumber_ = meetingNumber;
+    if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "UtteranceWriter: cannot create " << directory_ << ": " << strerror(errno) << std::endl;
+    }
+    Metrics::Instance().AddCollector(&UtteranceWriter::CollectMetrics, this);
+    thread_ = std::thread(&UtteranceWriter::Run, this);
+}
+
+void UtteranceWriter::OnUtterance(Utterance *utterance) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!thread_.joinable() || count_ == queue_.size()) {
+        // not started; the queue itself cannot fill, it has room for every buffer
+        chunker_->Release(utterance);
+        return;
+    }
+    queue_[(head_ + count_) % queue_.size()] = utterance;
+    count_++;
+    wake_.notify_one();
+}
+
+bool UtteranceWriter::Drain(unsigned int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return idle_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return count_ == 0 && !busy_; });
+}
+
+void UtteranceWriter::Run() {
+    ThreadPolicy::Instance().Apply(THREAD_ROLE_WRITER, "zb-utterances");
+    while (true) {
+        Utterance *utterance = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return count_ > 0 || stopping_; });
+            if (count_ == 0) {
+                return;
+            }
+            utterance = queue_[head_];
+            head_ = (head_ + 1) % queue_.size();
+            count_--;
+            busy_ = true;
+        }
+
+        Write(*utterance);
+        chunker_->Release(utterance);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_ = false;
+        idle_.notify_all();
+    }
+}
+
+void UtteranceWriter::Write(const Utterance &utterance) {
+    char name[64];
+    snprintf(name, sizeof(name), "/%u-%llu.wav", utterance.streamId, utterance.startMs);
+    std::string path = directory_ + name;
+
+    uint8_t header[44];
+    uint32_t dataBytes = (uint32_t)(utterance.count * sizeof(int16_t));
+    memcpy(header, "RIFF", 4);
+    PutLe32(header + 4, 36 + dataBytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    PutLe32(header + 16, 16);
+    PutLe16(header + 20, 1);
+    PutLe16(header + 22, 1);
+    PutLe32(header + 24, kAsrSampleRate);
+    PutLe32(header + 28, kAsrSampleRate * sizeof(int16_t));
+    PutLe16(header + 32, sizeof(int16_t));
+    PutLe16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    PutLe32(header + 40, dataBytes);
+
+    // a consumer only ever sees complete files; they can be recomputed from the recording,
+    // so they are not synced
+    std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && WriteFully(fd, header, sizeof(header)) &&
+              WriteFully(fd, (const uint8_t *)utterance.samples, dataBytes);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "UtteranceWriter: cannot write " << path << std::endl;
+        unlink(temporary.c_str());
+        writeErrors_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!events_) {
+        return;
+    }
+
+    std::string participant;
+    if (roster_) {
+        std::shared_ptr<const RosterSnapshot> roster = roster_->Snapshot();
+        if (const Participant *found = roster->Find(utterance.streamId)) {
+            participant = found->name;
+        }
+    }
+    BotEvent event("utterance");
+    event.Add("meetingNumber", meetingNumber_)
+        .Add("nodeId", utterance.streamId)
+        .Add("name", participant)
+        .Add("startMs", utterance.startMs)
+        .Add("endMs", utterance.endMs)
+        .Add("overlapMs", (unsigned long long)(utterance.overlap * 1000 / kAsrSampleRate))
+        .Add("cut", utterance.cut)
+        .Add("path", path);
+    events_->Emit(event);
+}
+
+void UtteranceWriter::CollectMetrics(MetricsWriter &writer, void *context) {
+    UtteranceWriter *self = static_cast<UtteranceWriter *>(context);
+    writer.Write("zoom_bot_utterance_write_errors_total", self->writeErrors_.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,60 @@
+// Writes finished utterances as WAV files and announces each with a bot event
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BotEventChannel.h"
+#include "Metrics.h"
+#include "ParticipantRoster.h"
+#include "UtteranceChunker.h"
+
+// The sink the bot gives its UtteranceChunker. Each utterance becomes
+// <directory>/<node id>-<start ms>.wav, 16 kHz mono s16le, renamed into place once complete,
+// followed by an "utterance" event that names the file. A recognizer watching the event
+// socket can take the files as they come. One thread does the writing; its queue holds
+// every buffer of the chunker, so handing an utterance over never waits.
+class UtteranceWriter : public UtteranceSink {
+public:
+    /// \param roster Names the participant in events, nullptr to report node ids only.
+    explicit UtteranceWriter(UtteranceChunker *chunker, const ParticipantRoster *roster = nullptr);
+    ~UtteranceWriter();
+
+    /// \brief Create directory and start writing; events go to events, if not nullptr.
+    void Start(const std::string &directory, BotEventChannel *events, const std::string &meetingNumber);
+
+    virtual void OnUtterance(Utterance *utterance);
+
+    /// \brief Wait until every utterance handed over so far is written.
+    /// \return false if the deadline passed first.
+    bool Drain(unsigned int timeoutMs);
+
+private:
+    void Run();
+    void Write(const Utterance &utterance);
+    static void CollectMetrics(MetricsWriter &writer, void *context);
+
+    UtteranceChunker *chunker_;
+    const ParticipantRoster *roster_;
+    BotEventChannel *events_;
+    std::string directory_;
+    std::string meetingNumber_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    // fixed ring of utterances waiting for the thread
+    std::vector<Utterance *> queue_;
+    size_t head_;
+    size_t count_;
+    bool busy_;
+    bool stopping_;
+
+    std::atomic<unsigned long long> writeErrors_;
+    std::thread thread_;
+};
@@ -0,0 +1,149 @@
+// Streaming voice activity detector for 16 kHz mono audio
+
+#include "VoiceActivityDetector.h"
+#include "RealFft.h"
+#include "SimdKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const size_t kFftSize = 256;
+// 300-4000 Hz at 16 kHz with 62.5 Hz bins
+const size_t kBandFirstBin = 5;
+const size_t kBandLastBin = 64;
+
+const float kInitialNoiseDb = -60.0f;
+const float kAbsoluteFloorDb = -55.0f;
+const float kSpeechMarginDb = 10.0f;
+// white noise has a periodogram flatness of about 0.56, voiced speech sits well below
+const float kMaxSpeechFlatness = 0.45f;
+const int kOnsetFrames = 2;
+const int kHangoverFrames = 25;
+
+const RealFft &SharedFft() {
+    static const RealFft fft(kFftSize);
+    return fft;
+}
+
+struct HannTable {
+    float values[VoiceActivityDetector::kFrameSamples];
+
+    HannTable() {
+        for (size_t i = 0; i < VoiceActivityDetector::kFrameSamples; i++) {
+            values[i] = 0.5f - 0.5f * cosf(2.0f * 3.14159265f * i / (VoiceActivityDetector::kFrameSamples - 1));
+        }
+    }
+};
+
+const float *HannWindow() {
+    static const HannTable table;
+    return table.values;
+}
+
+} // namespace
+
+VoiceActivityDetector::VoiceActivityDetector() {
+    // build the shared tables before the first audio callback
+    SharedFft();
+    HannWindow();
+    Reset();
+}
+
+void VoiceActivityDetector::Reset() {
+    fill_ = 0;
+    noiseDb_ = kInitialNoiseDb;
+    onsetFrames_ = 0;
+    hangoverFrames_ = 0;
+    speech_ = false;
+    voiced_ = false;
+    speechFrames_ = 0;
+    totalFrames_ = 0;
+    segments_ = 0;
+}
+
+bool VoiceActivityDetector::Process(const float *samples, size_t count) {
+    bool completed = false;
+    bool anySpeech = false;
+    while (count > 0) {
+        size_t take = kFrameSamples - fill_;
+        if (take > count) {
+            take = count;
+        }
+        memcpy(frame_ + fill_, samples, take * sizeof(float));
+        fill_ += take;
+        samples += take;
+        count -= take;
+
+        if (fill_ == kFrameSamples) {
+            fill_ = 0;
+            completed = true;
+            if (AnalyzeFrame()) {
+                anySpeech = true;
+            }
+        }
+    }
+    return completed ? anySpeech : speech_;
+}
+
+bool VoiceActivityDetector::AnalyzeFrame() {
+    float energy = SimdKernels::DotProduct(frame_, frame_, kFrameSamples) / kFrameSamples;
+    float energyDb = 10.0f * log10f(energy + 1e-10f);
+
+    bool speechLike = energyDb > kAbsoluteFloorDb && energyDb > noiseDb_ + kSpeechMarginDb;
+    if (speechLike) {
+        // loud enough: also require a harmonic spectrum so noise bursts do not open the gate
+        float windowed[kFftSize];
+        const float *window = HannWindow();
+        for (size_t i = 0; i < kFrameSamples; i++) {
+            windowed[i] = frame_[i] * window[i];
+        }
+        memset(windowed + kFrameSamples, 0, (kFftSize - kFrameSamples) * sizeof(float));
+
+        float power[kFftSize / 2 + 1];
+        SharedFft().PowerSpectrum(windowed, power);
+
+        double logSum = 0.0;
+        double linearSum = 0.0;
+        for (size_t bin = kBandFirstBin; bin <= kBandLastBin; bin++) {
+            logSum += log(power[bin] + 1e-12);
+            linearSum += power[bin];
+        }
+        double bins = kBandLastBin - kBandFirstBin + 1;
+        double flatness = exp(logSum / bins) / (linearSum / bins + 1e-12);
+        speechLike = flatness < kMaxSpeechFlatness;
+    }
+
+    // the noise floor falls quickly, rises slowly, and barely moves while someone is talking
+    if (energyDb < noiseDb_) {
+        noiseDb_ += 0.2f * (energyDb - noiseDb_);
+    } else if (!speechLike) {
+        noiseDb_ += 0.05f * (energyDb - noiseDb_);
+    } else {
+        noiseDb_ += 0.001f * (energyDb - noiseDb_);
+    }
+
+    voiced_ = speechLike;
+    if (speechLike) {
+        onsetFrames_++;
+        if (!speech_ && onsetFrames_ >= kOnsetFrames) {
+            speech_ = true;
+            segments_++;
+        }
+        if (speech_) {
+            hangoverFrames_ = kHangoverFrames;
+        }
+    } else {
+        onsetFrames_ = 0;
+        if (speech_ && --hangoverFrames_ <= 0) {
+            speech_ = false;
+        }
+    }
+
+    totalFrames_++;
+    if (speech_) {
+        speechFrames_++;
+    }
+    return speech_;
+}
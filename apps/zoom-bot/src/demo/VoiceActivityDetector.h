@@ -0,0 +1,43 @@
+// Streaming voice activity detector for 16 kHz mono audio
+#pragma once
+
+#include <cstddef>
+
+// Classifies 10 ms frames as speech or non-speech from the frame energy against an adaptive
+// noise floor and the spectral flatness of the 300-4000 Hz band (voiced speech is harmonic,
+// background noise is flat). An onset needs two speech-like frames and a hangover keeps
+// trailing consonants and short pauses inside the segment.
+class VoiceActivityDetector {
+public:
+    static const size_t kFrameSamples = 160;
+
+    VoiceActivityDetector();
+
+    /// \brief Feed 16 kHz mono samples; partial frames are carried into the next call.
+    /// \return true if any frame completed in this call was inside a speech segment.
+    bool Process(const float *samples, size_t count);
+
+    bool InSpeech() const { return speech_; }
+    /// \brief Whether the last completed frame was speech-like itself, not only inside the
+    /// hangover that follows a segment.
+    bool Voiced() const { return voiced_; }
+    unsigned long long SpeechFrames() const { return speechFrames_; }
+    unsigned long long TotalFrames() const { return totalFrames_; }
+    unsigned long long Segments() const { return segments_; }
+
+    void Reset();
+
+private:
+    bool AnalyzeFrame();
+
+    float frame_[kFrameSamples];
+    size_t fill_;
+    float noiseDb_;
+    int onsetFrames_;
+    int hangoverFrames_;
+    bool speech_;
+    bool voiced_;
+    unsigned long long speechFrames_;
+    unsigned long long totalFrames_;
+    unsigned long long segments_;
+};
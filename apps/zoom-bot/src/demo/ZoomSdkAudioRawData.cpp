@@ -2,74 +2,198 @@
 #include "rawdata/rawdata_audio_helper_interface.h"
 #include "ZoomSdkAudioRawData.h"
 #include "zoom_sdk_def.h" 
+#include "ThreadPolicy.h"
 #include <iostream>
 #include <fstream>
 
+ZoomSdkAudioRawData::ZoomSdkAudioRawData()
+	: synchronizer_(nullptr), mixer_(nullptr), spotter_(nullptr), chunker_(nullptr), events_(nullptr), output_(AUDIO_OUTPUT_PCM), onFirstAudio_(nullptr), firstAudioContext_(nullptr), receivedAudio_(false),
+	  shareAnnounced_(false), droppedInterpreterChunks_(0)
+{
+	pipeline_.SetSink(this);
+}
+
 void ZoomSdkAudioRawData::onOneWayAudioRawDataReceived(AudioRawData* audioRawData, uint32_t node_id)
 {
-	std::cout << "\n===== ONE-WAY AUDIO DATA RECEIVED ====="  << std::endl;
-	std::cout << "  - From Node ID: " << node_id << std::endl;
-	std::cout << "  - Buffer Length: " << audioRawData->GetBufferLen() << " bytes" << std::endl;
-	std::cout << "  - Sample Rate: " << audioRawData->GetSampleRate() << " Hz" << std::endl;
-	std::cout << "  - Channels: " << audioRawData->GetChannelNum() << std::endl;
-	std::cout << "  - Valid Buffer: " << (audioRawData->GetBuffer() != nullptr ? "Yes" : "No") << std::endl;
-	std::cout << "========================================\n" << std::endl;
-	
-	// Optionally save one-way audio data
-	// SaveAudioToFile(audioRawData, "one_way_audio_" + std::to_string(node_id) + ".pcm");
+	// the SDK owns its callback threads, so they are pinned on their first delivery; nothing
+	// here prints, the pipeline metrics count what arrives
+	ThreadPolicy::Instance().ApplyOnce(THREAD_ROLE_AUDIO);
+	// resample to the ASR format; per-stream state lives in the pipeline
+	pipeline_.Process(node_id, audioRawData);
 }
 
 void ZoomSdkAudioRawData::onMixedAudioRawDataReceived(AudioRawData* audioRawData)
 {
-	std::cout << "\n===== MIXED AUDIO DATA RECEIVED ====="  << std::endl;
-	std::cout << "  - Buffer Length: " << audioRawData->GetBufferLen() << " bytes" << std::endl;
-	std::cout << "  - Sample Rate: " << audioRawData->GetSampleRate() << " Hz" << std::endl;
-	std::cout << "  - Channels: " << audioRawData->GetChannelNum() << std::endl;
-	
-	// Check if buffer is valid
-	bool validBuffer = (audioRawData->GetBuffer() != nullptr && audioRawData->GetBufferLen() > 0);
-	std::cout << "  - Valid Buffer: " << (validBuffer ? "Yes" : "No") << std::endl;
-	
-	// Calculate audio duration in milliseconds
-	if (validBuffer && audioRawData->GetSampleRate() > 0) {
-		float durationMs = (float)audioRawData->GetBufferLen() / 
-						 (audioRawData->GetSampleRate() * audioRawData->GetChannelNum() * 2) * 1000; // assuming 16-bit samples
-		std::cout << "  - Duration: " << durationMs << " ms" << std::endl;
-	}
-	
-	// Save audio to file if buffer is valid
-	if (validBuffer) {
-		static std::ofstream pcmFile;
-		pcmFile.open("audio.pcm", std::ios::out | std::ios::binary | std::ios::app);
-
-		if (!pcmFile.is_open()) {
-			std::cout << "  - ERROR: Failed to open audio.pcm file" << std::endl;
-		} else {
-			// Write the audio data to the file
-			pcmFile.write((char*)audioRawData->GetBuffer(), audioRawData->GetBufferLen());
-			pcmFile.close();
-			pcmFile.flush();
-			std::cout << "  - Saved to audio.pcm file" << std::endl;
-			
-			// Print first few bytes as hexadecimal for debugging
-			std::cout << "  - First 16 bytes: ";
-			const unsigned char* buffer = (const unsigned char*)audioRawData->GetBuffer();
-			int bytesToShow = std::min(16, (int)audioRawData->GetBufferLen());
-			for (int i = 0; i < bytesToShow; i++) {
-				char hex[4];
-				sprintf(hex, "%02X ", buffer[i]);
-				std::cout << hex;
-			}
-			std::cout << std::endl;
-		}
-	}
-	
-	std::cout << "=======================================\n" << std::endl;
+	ThreadPolicy::Instance().ApplyOnce(THREAD_ROLE_AUDIO);
+	// Convert to 16 kHz mono and queue for writing if buffer is valid
+	if (audioRawData->GetBuffer() != nullptr && audioRawData->GetBufferLen() > 0) {
+		pipeline_.Process(kMixedAudioStreamId, audioRawData);
+	}
 }
+
 void ZoomSdkAudioRawData::onShareAudioRawDataReceived(AudioRawData* data_)
 {
+	ThreadPolicy::Instance().ApplyOnce(THREAD_ROLE_AUDIO);
+	if (!shareAnnounced_.exchange(true)) {
+		AnnounceStream(kShareAudioStreamId, "share", "");
+	}
+	// recorded like the mixed stream, under an id of its own
+	pipeline_.Process(kShareAudioStreamId, data_);
 }
 
 void ZoomSdkAudioRawData::onOneWayInterpreterAudioRawDataReceived(AudioRawData* data_, const zchar_t* pLanguageName)
 {
+	ThreadPolicy::Instance().ApplyOnce(THREAD_ROLE_AUDIO);
+	uint32_t streamId = 0;
+	bool added = false;
+	if (!interpreters_.Find(pLanguageName, streamId, added)) {
+		droppedInterpreterChunks_.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	if (added) {
+		AnnounceStream(streamId, "interpreter", pLanguageName);
+	}
+	pipeline_.Process(streamId, data_);
+}
+
+void ZoomSdkAudioRawData::AnnounceStream(uint32_t streamId, const char* source, const char* language)
+{
+	std::cout << "ZoomSdkAudioRawData: recording " << source << " audio" << (*language ? " in " : "") << language
+		<< " as stream " << streamId << std::endl;
+	if (!events_) {
+		return;
+	}
+	BotEvent event("audio_stream");
+	event.Add("meetingNumber", meetingNumber_)
+		.Add("streamId", streamId)
+		.Add("source", source)
+		.Add("language", language);
+	events_->Emit(event);
+}
+
+void ZoomSdkAudioRawData::SetEventChannel(BotEventChannel* events, const std::string& meetingNumber)
+{
+	events_ = events;
+	meetingNumber_ = meetingNumber;
+}
+
+void ZoomSdkAudioRawData::SetDropNonSpeech(bool drop)
+{
+	pipeline_.SetDropNonSpeech(drop);
+}
+
+void ZoomSdkAudioRawData::SetScheduler(TaskScheduler* scheduler)
+{
+	pipeline_.SetScheduler(scheduler);
+}
+
+void ZoomSdkAudioRawData::WaitIdle()
+{
+	pipeline_.WaitIdle();
+	// no more participant audio is coming to wait for
+	if (mixer_) {
+		mixer_->Flush();
+	}
+	if (spotter_) {
+		spotter_->WaitIdle();
+	}
+	if (chunker_) {
+		chunker_->Flush();
+	}
+}
+
+bool ZoomSdkAudioRawData::WaitIdleUntil(std::chrono::steady_clock::time_point deadline)
+{
+	if (!pipeline_.WaitIdleUntil(deadline)) {
+		return false;
+	}
+	if (mixer_) {
+		mixer_->Flush();
+	}
+	if (spotter_ && !spotter_->WaitIdleUntil(deadline)) {
+		return false;
+	}
+	if (chunker_) {
+		chunker_->Flush();
+	}
+	return true;
+}
+
+void ZoomSdkAudioRawData::SetSynchronizer(MediaSynchronizer* synchronizer)
+{
+	synchronizer_ = synchronizer;
+}
+
+void ZoomSdkAudioRawData::SetSpeakerAnalytics(SpeakerAnalytics* analytics)
+{
+	pipeline_.SetAnalytics(analytics);
+}
+
+void ZoomSdkAudioRawData::SetAudioOutput(AudioOutput output)
+{
+	output_ = output;
+	pipeline_.SetFeatures(output != AUDIO_OUTPUT_PCM || spotter_);
+}
+
+void ZoomSdkAudioRawData::SetKeywordSpotter(KeywordSpotter* spotter)
+{
+	spotter_ = spotter;
+	// the spotter works on the features, recorded or not
+	pipeline_.SetFeatures(true);
+	pipeline_.SetKeywordSpotter(spotter);
+}
+
+void ZoomSdkAudioRawData::SetUtteranceChunker(UtteranceChunker* chunker)
+{
+	chunker_ = chunker;
+	pipeline_.SetUtteranceChunker(chunker);
+}
+
+void ZoomSdkAudioRawData::SetAgcTarget(float targetLufs)
+{
+	pipeline_.SetAgcTarget(targetLufs);
+}
+
+void ZoomSdkAudioRawData::SetLocalMixer(LocalMixer* mixer)
+{
+	mixer_ = mixer;
+	mixer_->SetSink(this);
+	pipeline_.SetLocalMixer(mixer);
+}
+
+void ZoomSdkAudioRawData::SetPlaybackReference(PlaybackReference* reference, SelfAudioMode mode)
+{
+	pipeline_.SetPlaybackReference(reference, mode);
+}
+
+void ZoomSdkAudioRawData::SetFirstAudioCallback(void (*callback)(void*), void* context)
+{
+	onFirstAudio_ = callback;
+	firstAudioContext_ = context;
+}
+
+void ZoomSdkAudioRawData::onPipelineAudio(const AudioChunk& chunk)
+{
+	if (!receivedAudio_.exchange(true) && onFirstAudio_) {
+		onFirstAudio_(firstAudioContext_);
+	}
+
+	if (!synchronizer_) {
+		return;
+	}
+	// the local mix is PCM whatever audioOutput says, it was asked for explicitly
+	if (chunk.streamId == kLocalMixStreamId) {
+		synchronizer_->PushAudio(chunk.streamId, chunk.samples, chunk.count, chunk.timestampMs);
+		return;
+	}
+	// the mixed, share and interpretation streams are ordered against video by SDK timestamp
+	// before they are written
+	if (!IsParticipantStream(chunk.streamId) && output_ != AUDIO_OUTPUT_LOGMEL) {
+		synchronizer_->PushAudio(chunk.streamId, chunk.samples, chunk.count, chunk.timestampMs);
+	}
+	// features are small enough to keep for every participant
+	if (chunk.featureFrames > 0 && output_ != AUDIO_OUTPUT_PCM) {
+		synchronizer_->PushFeatures(chunk.streamId, chunk.features, chunk.featureFrames, LogMelExtractor::kBins,
+			LogMelExtractor::kFrameMs, chunk.featureTimestampMs);
+	}
 }
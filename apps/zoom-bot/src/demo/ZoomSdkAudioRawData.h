@@ -1,16 +1,101 @@
 // Audio raw data delegate
+#pragma once
+
 #include "rawdata/rawdata_audio_helper_interface.h"
 #include "zoom_sdk.h"
 #include "zoom_sdk_raw_data_def.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "AudioPipeline.h"
+#include "BotEventChannel.h"
+#include "InterpreterStreams.h"
+#include "MediaSynchronizer.h"
+
 USING_ZOOM_SDK_NAMESPACE
 
 class ZoomSdkAudioRawData :
-	public IZoomSDKAudioRawDataDelegate
+	public IZoomSDKAudioRawDataDelegate,
+	public AudioPipelineSink
 {
 public:
+	ZoomSdkAudioRawData();
+
 	virtual void onMixedAudioRawDataReceived(AudioRawData* data_);
 	virtual void onOneWayAudioRawDataReceived(AudioRawData* data_, uint32_t node_id);
 	virtual void onShareAudioRawDataReceived(AudioRawData* data_);
 	virtual void onOneWayInterpreterAudioRawDataReceived(AudioRawData* data_, const zchar_t* pLanguageName);
-};
\ No newline at end of file
+
+	/// \brief Drop participant audio the VAD classifies as non-speech before it reaches the writers.
+	void SetDropNonSpeech(bool drop);
+
+	/// \brief Forward the mixed stream to the synchronizer that orders it against video.
+	void SetSynchronizer(MediaSynchronizer* synchronizer);
+
+	/// \brief Count talk time and overlaps of the participant streams in analytics.
+	void SetSpeakerAnalytics(SpeakerAnalytics* analytics);
+
+	/// \brief Choose between PCM and log-mel features for the recording. Set before subscribing.
+	void SetAudioOutput(AudioOutput output);
+
+	/// \brief Normalize every stream towards targetLufs, 0 for off. Set before subscribing.
+	void SetAgcTarget(float targetLufs);
+
+	/// \brief Remove what the bot itself published, recorded in reference, from the mixed stream. Set before subscribing.
+	void SetPlaybackReference(PlaybackReference* reference, SelfAudioMode mode);
+
+	/// \brief Record the mix mixer builds from the participant streams as stream kLocalMixStreamId. Set before subscribing.
+	void SetLocalMixer(LocalMixer* mixer);
+
+	/// \brief Spot keywords in the participant streams; computes features even for PCM output. Set before subscribing.
+	void SetKeywordSpotter(KeywordSpotter* spotter);
+
+	/// \brief Cut the participant streams into utterances in chunker. Set before subscribing.
+	void SetUtteranceChunker(UtteranceChunker* chunker);
+
+	/// \brief Announce the share and interpretation streams on events as they first arrive. Set before subscribing.
+	void SetEventChannel(BotEventChannel* events, const std::string& meetingNumber);
+
+	/// \brief Process participant streams on scheduler's workers instead of the SDK audio thread.
+	void SetScheduler(TaskScheduler* scheduler);
+
+	/// \brief Wait until all audio received so far went through the pipeline, the local mix, the keyword spotter and the open utterances included.
+	void WaitIdle();
+
+	/// \brief WaitIdle that gives up at deadline. The local mix and the open utterances are only flushed once the pipeline is idle.
+	/// \return false if audio was still on its way then.
+	bool WaitIdleUntil(std::chrono::steady_clock::time_point deadline);
+
+	/// \brief SDK chunks the pipeline could not take, e.g. because a stream fell behind.
+	unsigned long long DroppedChunks() const { return pipeline_.DroppedChunks(); }
+
+	/// \brief Interpretation chunks not recorded because their language had no stream id left.
+	unsigned long long DroppedInterpreterChunks() const { return droppedInterpreterChunks_.load(std::memory_order_relaxed); }
+
+	/// \brief Called once, on the thread that processed it, when the first audio of the meeting arrives.
+	void SetFirstAudioCallback(void (*callback)(void*), void* context);
+
+	/// \brief Receives 16 kHz mono audio from the pipeline.
+	virtual void onPipelineAudio(const AudioChunk& chunk);
+
+private:
+	void AnnounceStream(uint32_t streamId, const char* source, const char* language);
+
+	AudioPipeline pipeline_;
+	MediaSynchronizer* synchronizer_;
+	LocalMixer* mixer_;
+	KeywordSpotter* spotter_;
+	UtteranceChunker* chunker_;
+	BotEventChannel* events_;
+	std::string meetingNumber_;
+	InterpreterStreams interpreters_;
+	AudioOutput output_;
+	void (*onFirstAudio_)(void*);
+	void* firstAudioContext_;
+	std::atomic<bool> receivedAudio_;
+	std::atomic<bool> shareAnnounced_;
+	std::atomic<unsigned long long> droppedInterpreterChunks_;
+};
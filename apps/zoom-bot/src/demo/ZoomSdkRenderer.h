@@ -1,20 +1,48 @@
 // Video renderer delegate
+#pragma once
 
 #include "rawdata/rawdata_video_source_helper_interface.h"
 #include "rawdata/rawdata_renderer_interface.h"
 #include "zoom_sdk.h"
 #include "zoom_sdk_raw_data_def.h"
 
+#include <cstdint>
+
+#include "GalleryCompositor.h"
+#include "MediaSynchronizer.h"
+#include "MeetingEventBus.h"
+#include "SnapshotStore.h"
+
 USING_ZOOM_SDK_NAMESPACE
 
 class ZoomSdkRenderer :
 	public IZoomSDKRendererDelegate
 {
 public:
+	ZoomSdkRenderer();
+
 	virtual void onRawDataFrameReceived(YUVRawDataI420* data);
 	virtual void onRawDataStatusChanged(RawDataStatus	status);
 
 	virtual void onRendererBeDestroyed();
 
-	virtual void SaveToRawYUVFile(YUVRawDataI420* data);
+	/// \brief Queue frames on the synchronizer, tagged with the subscribed user id.
+	void SetSynchronizer(MediaSynchronizer* synchronizer, uint32_t userId);
+
+	/// \brief Hand frames of userId to tile of a gallery instead of queuing them on the synchronizer.
+	void SetCompositor(GalleryCompositor* compositor, unsigned int tile, uint32_t userId);
+
+	/// \brief Also offer every frame to a snapshot store for thumbnails of the user.
+	void SetSnapshots(SnapshotStore* snapshots);
+
+	/// \brief Report onRendererBeDestroyed to the session, which subscribes a new renderer.
+	void SetEventBus(MeetingEventBus* events);
+
+private:
+	MediaSynchronizer* synchronizer_;
+	MeetingEventBus* events_;
+	GalleryCompositor* compositor_;
+	unsigned int tile_;
+	SnapshotStore* snapshots_;
+	uint32_t userId_;
 };
\ No newline at end of file
@@ -20,7 +20,7 @@ int audio_play_flag = -1;
 
 
 
-void PlayAudioFileToVirtualMic(IZoomSDKAudioRawDataSender* audio_sender, string audio_source)
+void PlayAudioFileToVirtualMic(IZoomSDKAudioRawDataSender* audio_sender, string audio_source, std::atomic<PlaybackReference*>* reference)
 {
 	// execute in a thread.
 	while (audio_play_flag > 0 && audio_sender) {
@@ -46,6 +46,11 @@ void PlayAudioFileToVirtualMic(IZoomSDKAudioRawDataSender* audio_sender, string
 			std::cout << "Error: Failed to send audio data to virtual mic. Error code: " << err << std::endl;
 			return;
 		}
+		// the SDK plays the buffer from now on; keep the same samples to cancel them from the capture
+		PlaybackReference* playback = reference->load();
+		if (playback) {
+			playback->Write((const int16_t*)buffer.data(), buffer.size() / sizeof(int16_t), 44100);
+		}
 		file.close();
 		// Sleep for a while before replaying (adjust the delay as needed)
 		std::this_thread::sleep_for(std::chrono::milliseconds(10000)); // 10 second delay, this is a 10 second long wave file
@@ -57,7 +62,7 @@ void PlayAudioFileToVirtualMic(IZoomSDKAudioRawDataSender* audio_sender, string
 /// \brief Callback for virtual audio mic to do some initialization.
 /// \param pSender, You can send audio data based on this object, see \link IZoomSDKAudioRawDataSender \endlink.
 void ZoomSdkVirtualAudioMicEvent::onMicInitialize(IZoomSDKAudioRawDataSender* pSender) {
-	//pSender->send();	pSender_ = pSender;
+	pSender_ = pSender;
 	printf("ZoomSdkVirtualAudioMicEvent OnMicInitialize, waiting for turnOn chat command\n");
 }
 
@@ -69,7 +74,7 @@ void ZoomSdkVirtualAudioMicEvent::onMicStartSend() {
 	if (pSender_ && audio_play_flag != 1) {
 		while (audio_play_flag > -1) {}
 		audio_play_flag = 1;
-		thread(PlayAudioFileToVirtualMic, pSender_, audio_source_).detach();
+		thread(PlayAudioFileToVirtualMic, pSender_, audio_source_, &reference_).detach();
 
 	}
 }
@@ -86,6 +91,12 @@ void ZoomSdkVirtualAudioMicEvent::onMicUninitialized() {
 }
 
 ZoomSdkVirtualAudioMicEvent::ZoomSdkVirtualAudioMicEvent(std::string audio_source)
+	: pSender_(nullptr), reference_(nullptr)
 {
 	audio_source_ = audio_source;
 }
+
+void ZoomSdkVirtualAudioMicEvent::SetReference(PlaybackReference* reference)
+{
+	reference_ = reference;
+}
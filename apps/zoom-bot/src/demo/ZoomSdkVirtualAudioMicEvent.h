@@ -1,11 +1,14 @@
 // Virtual audio microphone event declaration
 
 #include <iostream>
+#include <atomic>
 #include <cstdint>
 #include "rawdata/rawdata_audio_helper_interface.h"
 #include "zoom_sdk.h"
 #include "zoom_sdk_raw_data_def.h"
 
+#include "PlaybackReference.h"
+
 
 using namespace std;
 using namespace ZOOMSDK;
@@ -17,6 +20,8 @@ class ZoomSdkVirtualAudioMicEvent :
 private:
 	IZoomSDKAudioRawDataSender* pSender_;
 	std::string audio_source_;
+	// the playing thread records every buffer it sends here; nullptr once the session is gone
+	std::atomic<PlaybackReference*> reference_;
 protected:
 
 	/// \brief Callback for virtual audio mic to do some initialization.
@@ -34,4 +39,7 @@ protected:
 
 public:
 	ZoomSdkVirtualAudioMicEvent(std::string audio_source);
+
+	/// \brief Record what is sent in reference, so it can be removed from the mixed capture.
+	void SetReference(PlaybackReference* reference);
 };
\ No newline at end of file
@@ -0,0 +1,29 @@
+#!/bin/bash
+# Build an LTO + PGO optimized bot: instrument, train on the replay harness, rebuild with the profile.
+# Usage: ./build-pgo.sh [build directory] [extra cmake arguments...]
+set -e
+
+SOURCE_DIR="$(cd "$(dirname "$0")" && pwd)"
+BUILD_DIR="${1:-$SOURCE_DIR/build}"
+shift || true
+PROFILE_DIR="$BUILD_DIR/pgo-profile"
+JOBS="$(nproc)"
+
+# the profile is keyed by object file path, so both passes must use the same build directory
+rm -rf "$PROFILE_DIR"
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=RelWithDebInfo -DZOOM_BOT_ENABLE_LTO=ON \
+      -DZOOM_BOT_PGO=GENERATE -DZOOM_BOT_PGO_DIR="$PROFILE_DIR" "$@"
+cmake --build "$BUILD_DIR" --target ReplayHarness -- -j"$JOBS"
+
+# a few meeting shapes so both the single-speaker and the crowded paths are trained
+TRAINING_OUTPUT="$(mktemp -d)"
+"$SOURCE_DIR/bin/ReplayHarness" --seconds 60 --participants 4 --video 1280x720 --output "$TRAINING_OUTPUT/a"
+"$SOURCE_DIR/bin/ReplayHarness" --seconds 30 --participants 12 --video 640x360 --output "$TRAINING_OUTPUT/b"
+"$SOURCE_DIR/bin/ReplayHarness" --seconds 30 --participants 1 --video 0x0 --keep-silence --output "$TRAINING_OUTPUT/c"
+rm -rf "$TRAINING_OUTPUT"
+
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DZOOM_BOT_PGO=USE "$@"
+cmake --build "$BUILD_DIR" -- -j"$JOBS"
+
+echo "Optimized build with profile from $PROFILE_DIR:"
+"$SOURCE_DIR/bin/ReplayHarness" --seconds 30 --output "$(mktemp -d)"